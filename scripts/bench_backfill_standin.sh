@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+# Пропускная способность выгрузки на локальном стенде Bybit (tools/bybit_standin).
+# Сервер должен быть запущен с ETAI_BYBIT_BASE_URL=http://127.0.0.1:18080 (ETAI_BYBIT_RPS — лимит движка).
+#   bench_backfill_standin.sh [SYMBOLS] [MONTHS] [WHICH]
+set -euo pipefail
+SYMBOLS="${1:-BTCUSDT,ETHUSDT,SOLUSDT,XRPUSDT}"
+MONTHS="${2:-6}"
+WHICH="${3:-15}"
+API="${API:-http://127.0.0.1:3000}"
+STANDIN="${STANDIN:-http://127.0.0.1:18080}"
+TIMEOUT="${TIMEOUT:-600}"
+
+curl -sS "${STANDIN}/standin/reset" >/dev/null || { echo "FAIL: stand-in not reachable at ${STANDIN}"; exit 1; }
+T0="$(date +%s%3N)"
+J="$(curl -sS "${API}/api/backfill/batch?symbols=${SYMBOLS}&which=${WHICH}&months=${MONTHS}&mode=full")"
+[ "$(jq -r '.ok' <<<"$J")" = "true" ] || { echo "FAIL: batch submit"; jq . <<<"$J"; exit 1; }
+B="$(jq -r '.batch' <<<"$J")"
+
+while :; do
+  S="$(curl -sS "${API}/api/backfill/jobs?batch=${B}")"
+  [ "$(jq -r '.queued + .running' <<<"$S")" = "0" ] && break
+  (( $(date +%s%3N) - T0 > TIMEOUT * 1000 )) && { echo "FAIL: timeout ${TIMEOUT}s"; exit 1; }
+  sleep 0.2
+done
+MS=$(( $(date +%s%3N) - T0 ))
+
+jq -r '.jobs[] | "\(.symbol)_\(.interval)\t\(.state)\trows=\(.rows_fetched)\tpages=\(.pages)"' <<<"$S"
+ROWS="$(jq -r '[.jobs[].rows_fetched] | add' <<<"$S")"
+PAGES="$(jq -r '[.jobs[].pages] | add' <<<"$S")"
+FAILED="$(jq -r '.failed' <<<"$S")"
+curl -sS "${STANDIN}/standin/stats" | jq -c '{requests, pages, bars, rate_limited, injected_errors, bad_requests}'
+awk -v ms="$MS" -v rows="$ROWS" -v pages="$PAGES" -v failed="$FAILED" -v rps="$(jq -r '.rate_limit.rps' <<<"$S")" \
+  'BEGIN{ s = (ms > 0 ? ms : 1) / 1000.0;
+          printf "elapsed=%.2fs rows=%d pages=%d bars/s=%.0f pages/s=%.1f failed=%d rps_limit=%s\n",
+                 s, rows, pages, rows / s, pages / s, failed, rps }'
+[ "$FAILED" = "0" ] || { echo "FAIL: ${FAILED} job(s) failed"; exit 1; }
+echo "[OK] Backfill via stand-in: batch=${B}"
@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# Бенчмарк роллинг-ядер: наивные O(n·p) окна против rolling_kernels (и сверка значений).
+# Сервер — с ETAI_ENABLE_BENCH=1 (иначе /api/bench/* → not_enabled); n ≤ 200000, p ≤ 200.
+set -euo pipefail
+N="${1:-100000}"
+P="${2:-14}"
+TOL="${TOL:-1e-9}"
+J="$(curl -sS "http://127.0.0.1:3000/api/bench/kernels?n=${N}&p=${P}")"
+[ "$(jq -r '.ok' <<<"$J")" = "true" ] || { echo "FAIL: bench error"; jq . <<<"$J"; exit 1; }
+jq -r '.kernels[] | "\(.name)\tnaive=\(.naive_ms)ms\tkernel=\(.kernel_ms)ms\tx\(.speedup)\terr=\(.max_rel_err)"' <<<"$J"
+BAD="$(jq -r --argjson tol "$TOL" '[.kernels[] | select((.max_rel_err|type)!="number" or .max_rel_err > $tol)] | length' <<<"$J")"
+[ "$BAD" = "0" ] || { echo "FAIL: kernels diverge from naive reference (tol=${TOL})"; exit 1; }
+echo "[OK] Kernels match naive reference: n=${N} p=${P}"
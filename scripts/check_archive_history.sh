@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+# Архив холодной истории не теряет бары для обучения/признаков:
+# clean → load_bars (rows) → archive → повторный clean → load_bars — то же число строк;
+# load_tail через границу архива (горячая серия + 100 баров) — ровно столько строк, тот же конец.
+# Серия должна быть длиннее MONTHS (иначе архивировать нечего).
+set -euo pipefail
+SYM="${1:-BTCUSDT}"
+TF="${2:-15}"
+MONTHS="${MONTHS:-1}"
+HOST="${HOST:-http://127.0.0.1:3000}"
+
+ok() { [ "$(jq -r '.ok' <<<"$1")" = "true" ] || { echo "FAIL: $2"; jq . <<<"$1"; exit 1; }; }
+
+J="$(curl -sS "${HOST}/api/backfill/clean?symbol=${SYM}&which=${TF}")";                  ok "$J" "clean (before)"
+H0="$(curl -sS "${HOST}/api/backfill/history?symbol=${SYM}&interval=${TF}")";             ok "$H0" "history (before)"
+A="$(curl -sS "${HOST}/api/backfill/archive?symbol=${SYM}&which=${TF}&months=${MONTHS}")"; ok "$A" "archive"
+MOVED="$(jq -r '.intervals[0].moved' <<<"$A")"
+[ "$MOVED" -gt 0 ] || { echo "FAIL: nothing archived (series shorter than ${MONTHS} months?)"; exit 1; }
+J="$(curl -sS "${HOST}/api/backfill/clean?symbol=${SYM}&which=${TF}")";                  ok "$J" "clean (after)"
+H1="$(curl -sS "${HOST}/api/backfill/history?symbol=${SYM}&interval=${TF}")";             ok "$H1" "history (after)"
+
+R0="$(jq -r '.rows' <<<"$H0")"; R1="$(jq -r '.rows' <<<"$H1")"
+[ "$R0" = "$R1" ] || { echo "FAIL: load_bars rows ${R0} → ${R1} after archive + re-clean ($(jq -r '.path' <<<"$H1"))"; exit 1; }
+[ "$(jq -r '.ts_min' <<<"$H0")" = "$(jq -r '.ts_min' <<<"$H1")" ] || { echo "FAIL: ts_min changed"; exit 1; }
+HOT="$(jq -r '.intervals[0].rows' <<<"$A")"; TN=$(( HOT + 100 ))
+if [ "$TN" -lt "$R1" ]; then
+  T="$(curl -sS "${HOST}/api/backfill/history?symbol=${SYM}&interval=${TF}&tail=${TN}")";     ok "$T" "history tail"
+  [ "$(jq -r '.rows' <<<"$T")" = "$TN" ] || { echo "FAIL: load_tail rows $(jq -r '.rows' <<<"$T") != ${TN}"; exit 1; }
+  [ "$(jq -r '.ts_max' <<<"$T")" = "$(jq -r '.ts_max' <<<"$H1")" ] || { echo "FAIL: load_tail ts_max"; exit 1; }
+  jq -e -n --argjson t "$T" --argjson h "$H1" '$t.ts_min > $h.ts_min' >/dev/null || { echo "FAIL: load_tail ts_min"; exit 1; }
+fi
+echo "[OK] archive history: ${SYM} ${TF} rows=${R1} moved=${MOVED} clean_moved=$(jq -r '.intervals[0].clean_moved // 0' <<<"$A") hot=$(jq -r '.intervals[0].rows' <<<"$A") path=$(jq -r '.path' <<<"$H1")"
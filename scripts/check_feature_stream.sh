@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+# Потоковые признаки (FeatureState) vs build_feature_matrix: v9 и, если включён MFLOW на сервере, v10.
+set -euo pipefail
+SYM="${1:-BTCUSDT}"
+TF="${2:-15}"
+TAIL="${TAIL:-2000}"
+TOL="${TOL:-1e-9}"
+J="$(curl -sS "http://127.0.0.1:3000/api/infer/stream_check?symbol=${SYM}&interval=${TF}&tail=${TAIL}&tol=${TOL}")"
+OK="$(jq -r '.ok' <<<"$J")"
+ERR="$(jq -r '.max_rel_err' <<<"$J")"
+PERR="$(jq -r '.prefix_max_rel_err' <<<"$J")"
+DIM="$(jq -r '.dim' <<<"$J")"
+[ "$OK" = "true" ] || { echo "FAIL: stream != batch (dim=${DIM} max_rel_err=${ERR} prefix=${PERR})"; jq . <<<"$J"; exit 1; }
+echo "[OK] Stream features match batch: ${SYM} ${TF} dim=${DIM} max_rel_err=${ERR} prefix=${PERR} us/bar=$(jq -r '.stream_us_per_bar' <<<"$J") batch_ms=$(jq -r '.batch_ms' <<<"$J")"
@@ -0,0 +1,10 @@
+#!/usr/bin/env bash
+# Хвостовой режим признаков (build_feature_tail) vs полная матрица: строки должны совпадать бит-в-бит.
+set -euo pipefail
+SYM="${1:-BTCUSDT}"
+TF="${2:-15}"
+K="${K:-1}"
+J="$(curl -sS "http://127.0.0.1:3000/api/infer/tail_check?symbol=${SYM}&interval=${TF}&k=${K}")"
+OK="$(jq -r '.ok' <<<"$J")"
+[ "$OK" = "true" ] || { echo "FAIL: tail != full"; jq . <<<"$J"; exit 1; }
+echo "[OK] Tail features match full matrix: ${SYM} ${TF} k=$(jq -r '.k' <<<"$J") dim=$(jq -r '.dim' <<<"$J") full_ms=$(jq -r '.full_ms' <<<"$J") tail_ms=$(jq -r '.tail_ms' <<<"$J")"
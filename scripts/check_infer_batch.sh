@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+# /api/infer/batch: каждая пара symbol×interval должна совпадать с одиночным /api/infer.
+set -euo pipefail
+SYMS="${1:-BTCUSDT,ETHUSDT}"
+TFS="${2:-15}"
+HOST="${HOST:-http://127.0.0.1:3000}"
+J="$(curl -sS "${HOST}/api/infer/batch?symbols=${SYMS}&intervals=${TFS}")"
+[ "$(jq -r '.ok' <<<"$J")" = "true" ] || { echo "FAIL: batch"; jq . <<<"$J"; exit 1; }
+N="$(jq -r '.count' <<<"$J")"
+for i in $(seq 0 $((N - 1))); do
+  R="$(jq -c ".results[$i]" <<<"$J")"
+  S="$(jq -r '.symbol' <<<"$R")"; T="$(jq -r '.interval' <<<"$R")"
+  ONE="$(curl -sS "${HOST}/api/infer?symbol=${S}&interval=${T}" | jq -c 'del(.agents, .symbol, .interval)')"
+  R="$(jq -c 'del(.symbol, .interval)' <<<"$R")"
+  [ "$ONE" = "$R" ] || { echo "FAIL: ${S} ${T} batch != single"; echo "$R"; echo "$ONE"; exit 1; }
+done
+echo "[OK] infer batch: count=${N} ok=$(jq -r '.ok_count' <<<"$J") workers=$(jq -r '.workers' <<<"$J") elapsed_ms=$(jq -r '.elapsed_ms' <<<"$J")"
@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+# Кэш ответов /api/infer: повтор без нового бара — hit с тем же телом (agents — живые), If-None-Match → 304.
+set -euo pipefail
+SYM="${1:-BTCUSDT}"
+TF="${2:-15}"
+HOST="${HOST:-http://127.0.0.1:3000}"
+U="${HOST}/api/infer?symbol=${SYM}&interval=${TF}"
+H="$(mktemp)"; B1="$(mktemp)"; B2="$(mktemp)"
+trap 'rm -f "$H" "$B1" "$B2"' EXIT
+curl -sS -o "$B1" "$U"
+curl -sS -D "$H" -o "$B2" "$U"
+grep -qi '^X-Infer-Cache: hit' "$H" || { echo "FAIL: second request is not a cache hit"; cat "$H"; exit 1; }
+[ "$(jq -c 'del(.agents)' "$B1")" = "$(jq -c 'del(.agents)' "$B2")" ] || { echo "FAIL: cached body differs"; exit 1; }
+# agents — живые счётчики, на попадании они не замораживаются
+A1="$(jq '.agents | .long_total + .short_total + .neutral_total' "$B1")"
+A2="$(jq '.agents | .long_total + .short_total + .neutral_total' "$B2")"
+[ "$A2" -gt "$A1" ] || { echo "FAIL: agents counters frozen on cache hit (${A1} → ${A2})"; exit 1; }
+ETAG="$(grep -i '^ETag:' "$H" | cut -d' ' -f2 | tr -d '\r')"
+CODE="$(curl -sS -o /dev/null -w '%{http_code}' -H "If-None-Match: ${ETAG}" "$U")"
+[ "$CODE" = "304" ] || { echo "FAIL: If-None-Match → ${CODE}, expected 304"; exit 1; }
+echo "[OK] infer cache: ${SYM} ${TF} etag=${ETAG} $(curl -sS "${HOST}/api/infer/cache" | jq -c '.cache | {hits, misses, not_modified}')"
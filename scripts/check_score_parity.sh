@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+# Скоры задеплоенных моделей не меняются при смене математики скоринга (vk::tanh1 /
+# affine_cols вместо libm tanh / arma W*x). Два прогона на одной серии:
+#   1) сервер прежней сборки:  ./check_score_parity.sh save  TST 15
+#   2) сервер новой сборки:    ./check_score_parity.sh check TST 15
+# Сравнение — по ts баров: карта score15 (n баров) + одиночный /api/infer (score15, htf, market_mode).
+set -euo pipefail
+MODE="${1:-check}"
+SYM="${2:-BTCUSDT}"
+TF="${3:-15}"
+N="${N:-3000}"
+TOL="${TOL:-1e-9}"
+REF="${REF:-cache/score_ref_${SYM}_${TF}.json}"
+HOST="${HOST:-http://127.0.0.1:3000}"
+
+ok() { [ "$(jq -r '.ok' <<<"$1")" = "true" ] || { echo "FAIL: $2"; jq . <<<"$1"; exit 1; }; }
+
+# HTF не берём: выравнивание HTF менялось отдельно, здесь — только скоринг
+M="$(curl -sS "${HOST}/api/infer/signal_map?symbol=${SYM}&interval=${TF}&n=${N}&htf=")"; ok "$M" "signal_map"
+ONE="$(curl -sS "${HOST}/api/infer?symbol=${SYM}&interval=${TF}")";                       ok "$ONE" "infer"
+# карта большая — через stdin/файлы, не через argv
+CUR="$(jq --argjson o "$ONE" '. as $m | {
+  map:  [range(0; $m.ts | length) as $i | {key: ($m.ts[$i] | tostring), value: $m.score15[$i]}] | from_entries,
+  last: {ts: $m.ts[-1], score15: $o.score15, market_mode: $o.market_mode,
+         htf: ($o.htf // {} | with_entries(.value = .value.score))}
+}' <<<"$M")"
+
+case "$MODE" in
+  save)
+    mkdir -p "$(dirname "$REF")"
+    printf '%s\n' "$CUR" > "$REF"
+    echo "[OK] score ref saved: ${REF} bars=$(jq '.map | length' "$REF") last_ts=$(jq '.last.ts' "$REF")"
+    ;;
+  check)
+    [ -f "$REF" ] || { echo "FAIL: no ${REF} (run 'save' on the previous build first)"; exit 1; }
+    R="$(jq -n --slurpfile r "$REF" --slurpfile c <(printf '%s\n' "$CUR") --argjson tol "$TOL" '
+      $r[0] as $r | $c[0] as $c
+      | [$r.map | keys[] | select($c.map[.] != null) | (($r.map[.] - $c.map[.]) | fabs)] as $d
+      | {common: ($d | length), max_diff: ($d | max // 0),
+         last_diff: (if $r.last.ts == $c.last.ts then ($r.last.score15 - $c.last.score15 | fabs) else 0 end),
+         htf_diff: (if $r.last.ts == $c.last.ts
+                    then [$r.last.htf | keys[] | select($c.last.htf[.] != null)
+                          | (($r.last.htf[.] - $c.last.htf[.]) | fabs)] | max // 0 else 0 end),
+         mode_same: ($r.last.ts != $c.last.ts or $r.last.market_mode == $c.last.market_mode)}
+      | . + {pass: (.common > 0 and .max_diff <= $tol and .last_diff <= $tol and .htf_diff <= $tol and .mode_same)}')"
+    [ "$(jq -r '.pass' <<<"$R")" = "true" ] || { echo "FAIL: scores drifted (tol=${TOL})"; jq . <<<"$R"; exit 1; }
+    echo "[OK] score parity: ${SYM} ${TF} bars=$(jq '.common' <<<"$R") max_diff=$(jq '.max_diff' <<<"$R") last_diff=$(jq '.last_diff' <<<"$R") htf_diff=$(jq '.htf_diff' <<<"$R")"
+    ;;
+  *) echo "usage: $0 save|check [SYMBOL] [INTERVAL]"; exit 2 ;;
+esac
@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+# Карта сигналов политики: последний бар карты должен совпадать с одиночным /api/infer.
+set -euo pipefail
+SYM="${1:-BTCUSDT}"
+TF="${2:-15}"
+N="${N:-3000}"
+HTF="${HTF:-60,240,1440}"
+HOST="${HOST:-http://127.0.0.1:3000}"
+M="$(curl -sS "${HOST}/api/infer/signal_map?symbol=${SYM}&interval=${TF}&n=${N}&htf=${HTF}")"
+[ "$(jq -r '.ok' <<<"$M")" = "true" ] || { echo "FAIL: signal_map"; jq . <<<"$M"; exit 1; }
+ONE="$(curl -sS "${HOST}/api/infer?symbol=${SYM}&interval=${TF}&htf=${HTF}")"
+LAST="$(jq -r '.score15[-1]' <<<"$M")"
+D="$(jq -n --argjson a "$LAST" --argjson o "$ONE" '($a - $o.score15) | fabs')"
+jq -e -n --argjson d "$D" '$d < 1e-9' >/dev/null || { echo "FAIL: score15 map=${LAST} infer=$(jq '.score15' <<<"$ONE")"; exit 1; }
+echo "[OK] signal map: ${SYM} ${TF} n=$(jq -r '.n' <<<"$M") elapsed_ms=$(jq -r '.elapsed_ms' <<<"$M") last_score_diff=${D}"
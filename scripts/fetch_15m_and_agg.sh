@@ -7,7 +7,7 @@ set -euo pipefail
 SYM="${1:?usage: fetch_15m_and_agg.sh <SYMBOL>}"
 CATEGORY="linear"
 
-API="https://api.bybit.com/v5"
+API="${ETAI_BYBIT_BASE_URL:-https://api.bybit.com}/v5"
 CACHE="/opt/edge-trader-server/cache"
 CLEAN="${CACHE}/clean"
 mkdir -p "${CACHE}" "${CLEAN}"
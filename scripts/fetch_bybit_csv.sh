@@ -11,7 +11,7 @@ if [[ "$TF" != "15" ]]; then
   exit 2
 fi
 
-URL="https://api.bybit.com/v5/market/kline?category=linear&symbol=${SYM}&interval=15&limit=1000"
+URL="${ETAI_BYBIT_BASE_URL:-https://api.bybit.com}/v5/market/kline?category=linear&symbol=${SYM}&interval=15&limit=1000"
 
 TMP="$(mktemp)"
 trap 'rm -f "$TMP"' EXIT
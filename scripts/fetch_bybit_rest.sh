@@ -7,7 +7,7 @@ SYMBOL="${SYMBOL:-BTCUSDT}"
 MONTHS="${MONTHS:-6}"                         # последние ~30*MONTHS дней
 INTERVALS="${INTERVALS:-"15 60 240 1440"}"    # 240 и 1440 считаем из 60
 VERBOSE="${VERBOSE:-1}"
-API="https://api.bybit.com"
+API="${ETAI_BYBIT_BASE_URL:-https://api.bybit.com}"
 
 log(){ [ "${VERBOSE}" = "1" ] && echo "[$(date -u +%H:%M:%S)] $*"; }
 need(){ command -v "$1" >/dev/null 2>&1 || { echo "[FAIL] need $1"; exit 1; }; }
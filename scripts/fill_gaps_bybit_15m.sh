@@ -29,7 +29,7 @@ fetch_one() {
   local start="$ts"
   local end="$((ts+899999))"
   # Bybit v5: /v5/market/kline?category=spot&symbol=OPUSDT&interval=15&start=...&end=...&limit=1
-  local url="https://api.bybit.com/v5/market/kline?category=spot&symbol=${SYM}&interval=15&start=${start}&end=${end}&limit=1"
+  local url="${ETAI_BYBIT_BASE_URL:-https://api.bybit.com}/v5/market/kline?category=spot&symbol=${SYM}&interval=15&start=${start}&end=${end}&limit=1"
   # Формат v5: result.list = [ [start, open, high, low, close, volume, turnover], ... ]
   curl -fsS "$url" \
     | jq -r '
@@ -0,0 +1,348 @@
+#include "backfill_engine.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace etai {
+
+using json = nlohmann::json;
+
+namespace {
+
+double env_num(const char* k, double defv) {
+    const char* s = std::getenv(k);
+    if (!s || !*s) return defv;
+    try { return std::stod(s); } catch (...) { return defv; }
+}
+
+// Token bucket: rate токенов/с, ёмкость burst; acquire ждёт вне замка
+class TokenBucket {
+public:
+    TokenBucket(double rate, double burst)
+        : rate_(std::max(0.1, rate)), burst_(std::max(1.0, burst)), tokens_(burst_), last_(clk::now()) {}
+
+    void acquire() {
+        for (;;) {
+            double wait_s = 0.0;
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                const auto now = clk::now();
+                tokens_ = std::min(burst_, tokens_ + rate_ * std::chrono::duration<double>(now - last_).count());
+                last_ = now;
+                if (tokens_ >= 1.0) { tokens_ -= 1.0; ++granted_; return; }
+                wait_s = (1.0 - tokens_) / rate_;
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait_s));
+        }
+    }
+    double rate()  const { return rate_; }
+    double burst() const { return burst_; }
+    unsigned long long granted() const { std::lock_guard<std::mutex> lk(mu_); return granted_; }
+
+private:
+    using clk = std::chrono::steady_clock;
+    const double rate_, burst_;
+    mutable std::mutex mu_;
+    double tokens_;
+    clk::time_point last_;
+    unsigned long long granted_ = 0;
+};
+
+enum class JobState { Queued, Running, Done, Failed };
+
+const char* state_str(JobState s) {
+    switch (s) {
+        case JobState::Queued:  return "queued";
+        case JobState::Running: return "running";
+        case JobState::Done:    return "done";
+        case JobState::Failed:  return "failed";
+    }
+    return "unknown";
+}
+
+struct Job {
+    unsigned long long id = 0, batch = 0;
+    BackfillJobSpec spec;
+
+    // под g_mu
+    JobState  state = JobState::Queued;
+    long long since = 0, until = 0, cursor = 0;
+    int       pages = 0;
+    size_t    rows  = 0;
+    long long created_ms = 0, started_ms = 0, finished_ms = 0;
+    bool      derive_locked = false;     // воркер уже взял spec — новые derive не попадут
+    std::shared_ptr<Job> next;           // задача того же ключа, ждущая окончания этой
+    json      result;
+};
+using JobPtr = std::shared_ptr<Job>;
+
+constexpr size_t KEEP_FINISHED = 2000;   // сколько завершённых задач помнить для статуса
+
+std::mutex                             g_mu;
+std::condition_variable                g_cv;        // очередь → воркеры
+std::condition_variable                g_done_cv;   // завершение → ожидающие
+std::deque<JobPtr>                     g_queue;
+std::map<unsigned long long, JobPtr>   g_jobs;      // id по возрастанию
+std::map<std::string, JobPtr>          g_active;    // "<SYM>_<TF>" → последняя задача ключа (очередь/работа/ожидание)
+unsigned long long                     g_next_id = 1, g_next_batch = 1;
+size_t                                 g_workers = 0;
+
+long long now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+TokenBucket& limiter() {
+    static TokenBucket tb(env_num("ETAI_BYBIT_RPS", 10.0),
+                          env_num("ETAI_BYBIT_BURST", env_num("ETAI_BYBIT_RPS", 10.0)));
+    return tb;
+}
+
+json job_json(const Job& j) {
+    double frac = 0.0;
+    if (j.state == JobState::Done || j.state == JobState::Failed) frac = 1.0;
+    else if (j.until > j.since) frac = std::clamp((double)(j.until - j.cursor) / (double)(j.until - j.since), 0.0, 1.0);
+    json out{
+        {"id", j.id},
+        {"batch", j.batch},
+        {"symbol", j.spec.symbol},
+        {"interval", j.spec.interval},
+        {"months", j.spec.months},
+        {"mode", j.spec.mode},
+        {"derive", j.spec.derive},
+        {"state", state_str(j.state)},
+        {"progress", frac},
+        {"pages", j.pages},
+        {"rows_fetched", (unsigned long long)j.rows},
+        {"cursor_ts", j.cursor},
+        {"created_ms", j.created_ms},
+        {"started_ms", j.started_ms},
+        {"finished_ms", j.finished_ms}
+    };
+    if (!j.result.is_null()) out["result"] = j.result;
+    return out;
+}
+
+// под g_mu
+void forget_old_locked() {
+    size_t finished = 0;
+    for (auto& kv : g_jobs)
+        if (kv.second->state == JobState::Done || kv.second->state == JobState::Failed) ++finished;
+    for (auto it = g_jobs.begin(); it != g_jobs.end() && finished > KEEP_FINISHED; ) {
+        const JobState s = it->second->state;
+        if (s == JobState::Done || s == JobState::Failed) { it = g_jobs.erase(it); --finished; }
+        else ++it;
+    }
+}
+
+void worker_loop() {
+    // постоянное соединение воркера: keep-alive между страницами и задачами
+    const auto cli = bybit_make_client();
+    cli->set_keep_alive(true);
+
+    for (;;) {
+        JobPtr job;
+        {
+            std::unique_lock<std::mutex> lk(g_mu);
+            g_cv.wait(lk, []{ return !g_queue.empty(); });
+            job = g_queue.front();
+            g_queue.pop_front();
+            job->state = JobState::Running;
+            job->started_ms = now_ms();
+        }
+
+        BackfillIo io;
+        io.cli = cli.get();
+        io.acquire = []{ limiter().acquire(); };
+        io.progress = [job](long long since, long long until, long long cursor, int pages, size_t rows) {
+            std::lock_guard<std::mutex> lk(g_mu);
+            job->since = since; job->until = until; job->cursor = cursor;
+            job->pages = pages; job->rows = rows;
+        };
+
+        json r;
+        std::vector<std::string> derive;
+        try {
+            BackfillJobSpec s;
+            {
+                std::lock_guard<std::mutex> lk(g_mu);
+                s = job->spec;
+                job->derive_locked = true;        // дальше derive не дополняется
+            }
+            if (s.mode == "delta") r = backfill_delta(s.symbol, s.interval, s.months, "linear", &io);
+            else r = backfill_last_months(s.symbol, s.interval, s.months, "linear", s.mode == "full", &io);
+            // старшие ТФ — из того, что лежит в 15m (даже если биржа сейчас не ответила)
+            if (!s.derive.empty()) {
+                json d = json::object();
+                for (const auto& tf : s.derive) d[tf] = backfill_derive(s.symbol, tf);
+                r["derived"] = d;
+            }
+        } catch (const std::exception& e) {
+            r = json{{"ok", false}, {"error", "backfill_exception"}, {"what", e.what()}};
+        }
+
+        bool released = false;
+        {
+            std::lock_guard<std::mutex> lk(g_mu);
+            job->result = r;
+            job->state = r.value("ok", false) ? JobState::Done : JobState::Failed;
+            job->finished_ms = now_ms();
+            auto act = g_active.find(job->spec.symbol + "_" + job->spec.interval);
+            if (act != g_active.end() && act->second == job) g_active.erase(act);
+            // отложенная задача того же ключа — теперь она единственный писатель серии
+            if (job->next) { g_queue.push_back(std::move(job->next)); released = true; }
+            forget_old_locked();
+        }
+        g_done_cv.notify_all();
+        if (released) g_cv.notify_one();
+        std::cerr << "[backfill] job " << job->id << " " << job->spec.symbol << "_" << job->spec.interval
+                  << " -> " << state_str(job->state) << " pages=" << r.value("pages", 0)
+                  << " rows=" << r.value("rows", 0) << std::endl;
+    }
+}
+
+// под g_mu
+void ensure_workers_locked() {
+    if (g_workers) return;
+    const double n = env_num("ETAI_BACKFILL_CONN", 4);
+    g_workers = (size_t)std::clamp(n, 1.0, 32.0);
+    for (size_t i = 0; i < g_workers; ++i) std::thread(worker_loop).detach();
+}
+
+} // namespace
+
+std::string backfill_htf_source() {
+    const char* s = std::getenv("ETAI_HTF_SOURCE");
+    return (s && std::string(s) == "fetch") ? "fetch" : "agg";
+}
+
+std::vector<unsigned long long> backfill_submit(const std::vector<BackfillJobSpec>& jobs,
+                                                unsigned long long* batch_id) {
+    std::vector<unsigned long long> ids;
+    ids.reserve(jobs.size());
+    {
+        std::lock_guard<std::mutex> lk(g_mu);
+        ensure_workers_locked();
+        const unsigned long long batch = g_next_batch++;
+        if (batch_id) *batch_id = batch;
+        // Один писатель на ключ: если задача ключа уже в работе, новая ждёт её окончания
+        // (Job::next) и встаёт в очередь из воркера — две выгрузки одной серии не идут разом.
+        auto enqueue = [&](const BackfillJobSpec& s) {
+            auto j = std::make_shared<Job>();
+            j->id = g_next_id++;
+            j->batch = batch;
+            j->spec = s;
+            j->created_ms = now_ms();
+            g_jobs[j->id] = j;
+            JobPtr& slot = g_active[s.symbol + "_" + s.interval];
+            if (slot && slot->state == JobState::Running) slot->next = j;
+            else g_queue.push_back(j);
+            slot = j;
+            return j;
+        };
+        const std::string src_default = backfill_htf_source();
+        for (const auto& in : jobs) {
+            BackfillJobSpec s = in;
+            s.interval = canonical_interval(s.interval);
+            if (s.source.empty()) s.source = src_default;
+            const std::string key = s.symbol + "_" + s.interval;
+
+            if (s.interval != "15" && s.source == "agg") {
+                // старший ТФ → derive в 15m задаче символа, которую воркер ещё не взял
+                // (в т.ч. отложенной за работающей); иначе — новая 15m задача после неё
+                auto act = g_active.find(s.symbol + "_15");
+                JobPtr base = (act != g_active.end() && !act->second->derive_locked) ? act->second : nullptr;
+                if (!base) base = enqueue(BackfillJobSpec{s.symbol, "15", s.months, s.mode, "", {}});
+                auto& d = base->spec.derive;
+                if (std::find(d.begin(), d.end(), s.interval) == d.end()) d.push_back(s.interval);
+                base->spec.months = std::max(base->spec.months, s.months);
+                ids.push_back(base->id);
+                continue;
+            }
+
+            auto act = g_active.find(key);
+            if (act != g_active.end()) { ids.push_back(act->second->id); continue; }
+            ids.push_back(enqueue(s)->id);
+        }
+    }
+    g_cv.notify_all();
+    return ids;
+}
+
+json backfill_wait(unsigned long long job_id, long long timeout_ms) {
+    std::unique_lock<std::mutex> lk(g_mu);
+    auto it = g_jobs.find(job_id);
+    if (it == g_jobs.end()) return json{{"ok", false}, {"error", "unknown_job"}};
+    JobPtr j = it->second;
+    auto done = [&]{ return j->state == JobState::Done || j->state == JobState::Failed; };
+    if (timeout_ms > 0) {
+        if (!g_done_cv.wait_for(lk, std::chrono::milliseconds(timeout_ms), done))
+            return json{{"ok", false}, {"error", "timeout"}, {"job", job_json(*j)}};
+    } else {
+        g_done_cv.wait(lk, done);
+    }
+    return j->result;
+}
+
+json backfill_result_for(const json& r, const std::string& interval) {
+    const std::string tf = canonical_interval(interval);
+    if (!r.contains("derived") || !r["derived"].contains(tf)) return r;
+    json d = r["derived"][tf];
+    d["base_ok"] = r.value("ok", false);
+    if (r.contains("error")) d["base_error"] = r["error"];
+    return d;
+}
+
+json backfill_run(const BackfillJobSpec& spec, long long timeout_ms) {
+    const auto ids = backfill_submit({spec});
+    return backfill_result_for(backfill_wait(ids.front(), timeout_ms), spec.interval);
+}
+
+json backfill_job_status(unsigned long long job_id) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    auto it = g_jobs.find(job_id);
+    if (it == g_jobs.end()) return json{{"ok", false}, {"error", "unknown_job"}};
+    json out = job_json(*it->second);
+    out["ok"] = true;
+    return out;
+}
+
+json backfill_jobs_status(unsigned long long batch_id) {
+    json jobs = json::array();
+    size_t queued = 0, running = 0, done = 0, failed = 0, workers = 0;
+    {
+        std::lock_guard<std::mutex> lk(g_mu);
+        workers = g_workers;
+        for (const auto& kv : g_jobs) {
+            const Job& j = *kv.second;
+            if (batch_id && j.batch != batch_id) continue;
+            switch (j.state) {
+                case JobState::Queued:  ++queued;  break;
+                case JobState::Running: ++running; break;
+                case JobState::Done:    ++done;    break;
+                case JobState::Failed:  ++failed;  break;
+            }
+            jobs.push_back(job_json(j));
+        }
+    }
+    return json{
+        {"ok", true},
+        {"batch", batch_id},
+        {"queued", queued}, {"running", running}, {"done", done}, {"failed", failed},
+        {"workers", (unsigned long long)workers},
+        {"rate_limit", {{"rps", limiter().rate()}, {"burst", limiter().burst()}, {"granted", limiter().granted()}}},
+        {"jobs", jobs}
+    };
+}
+
+} // namespace etai
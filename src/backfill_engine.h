@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+namespace etai {
+
+// ============================================================================
+// Движок выгрузки истории: много (symbol, interval) одновременно.
+//   Воркеры = постоянные TLS-соединения к бирже (ETAI_BACKFILL_CONN, по умолчанию 4),
+//   все страницы всех задач проходят через один token bucket
+//   (ETAI_BYBIT_RPS запросов/с, по умолчанию 10; ETAI_BYBIT_BURST, по умолчанию = RPS).
+//   Задача на ту же пару, что уже в очереди/работе, не дублируется — возвращается её id.
+//   Прогресс — постранично: pages, rows, cursor_ts и доля пройденного окна.
+// Старшие ТФ при source=agg (ETAI_HTF_SOURCE, по умолчанию agg) с биржи не качаются:
+//   задача 60/240/1440 сворачивается в 15m задачу символа (derive), после выгрузки 15m
+//   воркер пересчитывает их из базы (htf_aggregate); id такой задачи — id 15m задачи,
+//   результат ТФ — в result.derived[<tf>]. source=fetch — прежняя отдельная выгрузка.
+// ============================================================================
+
+struct BackfillJobSpec {
+    std::string symbol;
+    std::string interval;
+    int months = 6;
+    std::string mode = "auto";       // auto | delta | full
+    std::string source;              // agg | fetch (только старшие ТФ); пусто — ETAI_HTF_SOURCE
+    std::vector<std::string> derive; // ТФ, пересчитываемые из этой 15m серии после выгрузки
+};
+
+// Источник старших ТФ по умолчанию: "agg" | "fetch"
+std::string backfill_htf_source();
+
+// Поставить задачи в очередь; id в порядке spec
+std::vector<unsigned long long> backfill_submit(const std::vector<BackfillJobSpec>& jobs,
+                                                unsigned long long* batch_id = nullptr);
+
+// Дождаться результата задачи (json backfill_*), timeout_ms <= 0 — без ограничения.
+// {"ok":false,"error":"timeout"|"unknown_job"} при неудаче ожидания.
+nlohmann::json backfill_wait(unsigned long long job_id, long long timeout_ms = 0);
+
+// Результат для конкретного ТФ: у свёрнутой в 15m задачи — result.derived[<tf>]
+// (+ base_ok/base_error выгрузки 15m), иначе сам r
+nlohmann::json backfill_result_for(const nlohmann::json& r, const std::string& interval);
+
+// Синхронно: поставить и дождаться (общий лимитер и соединения)
+nlohmann::json backfill_run(const BackfillJobSpec& spec, long long timeout_ms = 0);
+
+// Прогресс: одна задача / все задачи пакета (batch_id = 0 — все известные)
+nlohmann::json backfill_job_status(unsigned long long job_id);
+nlohmann::json backfill_jobs_status(unsigned long long batch_id = 0);
+
+} // namespace etai
@@ -0,0 +1,432 @@
+#include "bar_archive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace etai {
+
+namespace fs = std::filesystem;
+
+static const char ARCHIVE_MAGIC[8] = {'E','T','A','I','B','A','R','A'};
+static constexpr int    DEC_MAX_SCALE = 8;
+static constexpr double DEC_LIMIT     = 9007199254740992.0;   // 2^53 — целые точно в double
+static const double     P10[DEC_MAX_SCALE + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8};
+
+enum : uint8_t { COL_DECIMAL = 0, COL_XOR = 1 };
+enum : uint8_t { PRICES_COLUMNS = 0, PRICES_BAR = 1 };
+
+static std::atomic<unsigned long long> G_ARCH_TMP_SEQ{0};
+
+std::string archive_path_for(const std::string& csv_path) {
+  const fs::path p(csv_path);
+  fs::path name = p.filename();
+  name.replace_extension(".bara");
+  return (p.parent_path() / "archive" / name).string();
+}
+
+// ---------------------------------------------------------------------------
+// varint / zigzag
+// ---------------------------------------------------------------------------
+static inline void put_varint(std::string& b, uint64_t v) {
+  while (v >= 0x80) { b.push_back((char)(uint8_t)(v | 0x80)); v >>= 7; }
+  b.push_back((char)(uint8_t)v);
+}
+
+static inline bool get_varint(const uint8_t*& p, const uint8_t* e, uint64_t& v) {
+  v = 0;
+  for (int sh = 0; p < e && sh < 64; sh += 7) {
+    const uint8_t c = *p++;
+    v |= (uint64_t)(c & 0x7f) << sh;
+    if (!(c & 0x80)) return true;
+  }
+  return false;
+}
+
+static inline uint64_t zigzag(int64_t v)    { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t  unzigzag(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+static inline uint64_t dbits(double v)   { uint64_t u; std::memcpy(&u, &v, 8); return u; }
+static inline double   bitsd(uint64_t u) { double v; std::memcpy(&v, &u, 8); return v; }
+
+// ---------------------------------------------------------------------------
+// Кодирование блока
+// ---------------------------------------------------------------------------
+
+// Наименьший d ≤ 8, при котором все v·10^d — целые и обратное деление даёт то же
+// значение бит-в-бит; -1 — не подходит (NaN/inf/-0, слишком много знаков)
+static int decimal_scale(const double* v, size_t n) {
+  int d = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (!std::isfinite(v[i]) || (v[i] == 0.0 && std::signbit(v[i]))) return -1;
+    for (;; ++d) {
+      if (d > DEC_MAX_SCALE) return -1;
+      const double s = v[i] * P10[d];
+      if (std::fabs(s) >= DEC_LIMIT) return -1;
+      if (std::nearbyint(s) / P10[d] == v[i]) break;
+    }
+  }
+  return d;
+}
+
+// Проверка на выбранном масштабе: каждое значение восстанавливается точно
+static bool exact_at_scale(const double* v, size_t n, int d) {
+  for (size_t i = 0; i < n; ++i)
+    if ((double)std::llround(v[i] * P10[d]) / P10[d] != v[i]) return false;
+  return true;
+}
+
+static void encode_column(std::string& b, const double* v, size_t n) {
+  const int d = decimal_scale(v, n);
+  if (d >= 0) {
+    if (exact_at_scale(v, n, d)) {
+      b.push_back((char)COL_DECIMAL);
+      b.push_back((char)d);
+      int64_t prev = 0;
+      for (size_t i = 0; i < n; ++i) {
+        const int64_t m = std::llround(v[i] * P10[d]);
+        put_varint(b, zigzag(m - prev));
+        prev = m;
+      }
+      return;
+    }
+  }
+  b.push_back((char)COL_XOR);
+  uint64_t prev = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t u = dbits(v[i]);
+    put_varint(b, u ^ prev);
+    prev = u;
+  }
+}
+
+static void encode_block(std::string& b, const BarRows& rows, size_t i0, size_t n, bool turnover) {
+  // ts: первый, затем delta-of-delta (арифметика по модулю 2^64 — без переполнений)
+  uint64_t prev = 0, prev_d = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t t = (uint64_t)rows.ts[i0 + i];
+    const uint64_t d = t - prev;
+    put_varint(b, zigzag((int64_t)(d - prev_d)));
+    prev = t;
+    prev_d = d;
+  }
+
+  // цены: общий десятичный масштаб → бар относительно себя и прошлого close
+  // (open − close[i−1], close − open, high − max(o,c), min(o,c) − low — обычно малые)
+  int d = 0;
+  for (int k = BAR_OPEN; k <= BAR_CLOSE; ++k) {
+    const int dk = decimal_scale(rows.cols[k].data() + i0, n);
+    if (dk < 0) { d = -1; break; }
+    d = std::max(d, dk);
+  }
+  for (int k = BAR_OPEN; k <= BAR_CLOSE && d >= 0; ++k)
+    if (!exact_at_scale(rows.cols[k].data() + i0, n, d)) d = -1;
+  if (d >= 0) {
+    b.push_back((char)PRICES_BAR);
+    b.push_back((char)d);
+    int64_t prev_c = 0;
+    for (size_t i = i0; i < i0 + n; ++i) {
+      const int64_t o = std::llround(rows.cols[BAR_OPEN][i]  * P10[d]);
+      const int64_t h = std::llround(rows.cols[BAR_HIGH][i]  * P10[d]);
+      const int64_t l = std::llround(rows.cols[BAR_LOW][i]   * P10[d]);
+      const int64_t c = std::llround(rows.cols[BAR_CLOSE][i] * P10[d]);
+      put_varint(b, zigzag(o - prev_c));
+      put_varint(b, zigzag(c - o));
+      put_varint(b, zigzag(h - std::max(o, c)));
+      put_varint(b, zigzag(std::min(o, c) - l));
+      prev_c = c;
+    }
+  } else {
+    b.push_back((char)PRICES_COLUMNS);
+    for (int k = BAR_OPEN; k <= BAR_CLOSE; ++k) encode_column(b, rows.cols[k].data() + i0, n);
+  }
+  encode_column(b, rows.cols[BAR_VOLUME].data() + i0, n);
+  if (turnover) encode_column(b, rows.cols[BAR_TURNOVER].data() + i0, n);
+}
+
+static bool decode_column(const uint8_t*& p, const uint8_t* e, double* out, size_t n) {
+  if (e - p < 1) return false;
+  const uint8_t mode = *p++;
+  uint64_t u = 0;
+  if (mode == COL_DECIMAL) {
+    if (p >= e || *p > DEC_MAX_SCALE) return false;
+    const double scale = P10[*p++];
+    int64_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (!get_varint(p, e, u)) return false;
+      m += unzigzag(u);
+      out[i] = (double)m / scale;
+    }
+    return true;
+  }
+  if (mode == COL_XOR) {
+    uint64_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (!get_varint(p, e, u)) return false;
+      prev ^= u;
+      out[i] = bitsd(prev);
+    }
+    return true;
+  }
+  return false;
+}
+
+// Блок → бары с ts в [ts_from, ts_to] в конец out
+static bool decode_block(const uint8_t* p, const uint8_t* e, size_t n, bool turnover,
+                         int64_t ts_from, int64_t ts_to, BarRows& out) {
+  std::vector<int64_t> ts(n);
+  uint64_t t = 0, d = 0, u = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (!get_varint(p, e, u)) return false;
+    d += (uint64_t)unzigzag(u);
+    t += d;
+    ts[i] = (int64_t)t;
+  }
+  std::vector<double> cols[6];
+  for (int k = 0; k < 6; ++k) cols[k].assign(n, 0.0);
+  if (e - p < 1) return false;
+  const uint8_t prices = *p++;
+  if (prices == PRICES_BAR) {
+    if (p >= e || *p > DEC_MAX_SCALE) return false;
+    const double scale = P10[*p++];
+    int64_t prev_c = 0;
+    uint64_t zo = 0, zc = 0, zh = 0, zl = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (!get_varint(p, e, zo) || !get_varint(p, e, zc) || !get_varint(p, e, zh) || !get_varint(p, e, zl))
+        return false;
+      const int64_t o = prev_c + unzigzag(zo);
+      const int64_t c = o + unzigzag(zc);
+      cols[BAR_OPEN][i]  = (double)o / scale;
+      cols[BAR_CLOSE][i] = (double)c / scale;
+      cols[BAR_HIGH][i]  = (double)(std::max(o, c) + unzigzag(zh)) / scale;
+      cols[BAR_LOW][i]   = (double)(std::min(o, c) - unzigzag(zl)) / scale;
+      prev_c = c;
+    }
+  } else if (prices == PRICES_COLUMNS) {
+    for (int k = BAR_OPEN; k <= BAR_CLOSE; ++k)
+      if (!decode_column(p, e, cols[k].data(), n)) return false;
+  } else {
+    return false;
+  }
+  if (!decode_column(p, e, cols[BAR_VOLUME].data(), n)) return false;
+  if (turnover && !decode_column(p, e, cols[BAR_TURNOVER].data(), n)) return false;
+
+  const size_t i0 = (size_t)(std::lower_bound(ts.begin(), ts.end(), ts_from) - ts.begin());
+  const size_t i1 = (size_t)(std::upper_bound(ts.begin(), ts.end(), ts_to) - ts.begin());
+  for (size_t i = i0; i < i1; ++i)
+    out.push_back(ts[i], cols[0][i], cols[1][i], cols[2][i], cols[3][i], cols[4][i], cols[5][i]);
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Запись
+// ---------------------------------------------------------------------------
+bool archive_write(const std::string& path, const BarRows& rows, uint32_t block_rows) {
+  if (block_rows == 0) block_rows = ARCHIVE_BLOCK_ROWS;
+  const size_t n = rows.size();
+  const size_t nblocks = (n + block_rows - 1) / block_rows;
+
+  ArchiveHeader h{};
+  std::memcpy(h.magic, ARCHIVE_MAGIC, 8);
+  h.version    = ARCHIVE_VERSION;
+  h.flags      = rows.has_turnover ? BARS_F_TURNOVER : 0u;
+  h.nrows      = n;
+  h.nblocks    = nblocks;
+  h.block_rows = block_rows;
+
+  std::string data;
+  data.reserve(n * 8 + 64);
+  std::vector<ArchiveBlock> index(nblocks);
+  for (size_t b = 0; b < nblocks; ++b) {
+    const size_t i0 = b * block_rows;
+    const size_t cnt = std::min<size_t>(block_rows, n - i0);
+    ArchiveBlock& ib = index[b];
+    ib.first_ts = rows.ts[i0];
+    ib.last_ts  = rows.ts[i0 + cnt - 1];
+    ib.offset   = sizeof(ArchiveHeader) + data.size();
+    ib.rows     = (uint32_t)cnt;
+    encode_block(data, rows, i0, cnt, rows.has_turnover);
+    ib.size     = (uint32_t)(sizeof(ArchiveHeader) + data.size() - ib.offset);
+  }
+  h.index_off = sizeof(ArchiveHeader) + data.size();
+
+  std::error_code ec;
+  const fs::path parent = fs::path(path).parent_path();
+  if (!parent.empty()) fs::create_directories(parent, ec);
+  const std::string tmp = path + ".tmp." + std::to_string((long long)::getpid()) + "." +
+                          std::to_string(G_ARCH_TMP_SEQ.fetch_add(1, std::memory_order_relaxed));
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f.good()) return false;
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    f.write(data.data(), (std::streamsize)data.size());
+    f.write(reinterpret_cast<const char*>(index.data()), (std::streamsize)(nblocks * sizeof(ArchiveBlock)));
+    if (!f.good()) { f.close(); ::unlink(tmp.c_str()); return false; }
+  }
+  if (::rename(tmp.c_str(), path.c_str()) != 0) { ::unlink(tmp.c_str()); return false; }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Чтение
+// ---------------------------------------------------------------------------
+namespace {
+
+struct ArchiveFile {
+  int fd = -1;
+  ArchiveHeader h{};
+  std::vector<ArchiveBlock> index;
+  uint64_t bytes = 0;
+
+  ~ArchiveFile() { if (fd >= 0) ::close(fd); }
+
+  bool open(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) return false;
+    bytes = (uint64_t)st.st_size;
+    if (::pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) return false;
+    if (std::memcmp(h.magic, ARCHIVE_MAGIC, 8) != 0 || h.version != ARCHIVE_VERSION) return false;
+    if (h.index_off + h.nblocks * sizeof(ArchiveBlock) > bytes) return false;
+    index.resize((size_t)h.nblocks);
+    const size_t len = index.size() * sizeof(ArchiveBlock);
+    return len == 0 || ::pread(fd, index.data(), len, (off_t)h.index_off) == (ssize_t)len;
+  }
+
+  bool turnover() const { return (h.flags & BARS_F_TURNOVER) != 0; }
+
+  bool read_block(size_t b, int64_t ts_from, int64_t ts_to, BarRows& out, std::string& buf) const {
+    const ArchiveBlock& ib = index[b];
+    if (ib.offset + ib.size > h.index_off) return false;
+    buf.resize(ib.size);
+    if (::pread(fd, &buf[0], ib.size, (off_t)ib.offset) != (ssize_t)ib.size) return false;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(buf.data());
+    return decode_block(p, p + buf.size(), ib.rows, turnover(), ts_from, ts_to, out);
+  }
+};
+
+} // namespace
+
+bool archive_read_range(const std::string& path, int64_t ts_from, int64_t ts_to, BarRows& out) {
+  out.clear();
+  ArchiveFile af;
+  if (!af.open(path)) return false;
+  out.has_turnover = af.turnover();
+  // первый блок, который может содержать ts_from: last_ts >= ts_from
+  auto it = std::lower_bound(af.index.begin(), af.index.end(), ts_from,
+                             [](const ArchiveBlock& b, int64_t t) { return b.last_ts < t; });
+  std::string buf;
+  for (size_t b = (size_t)(it - af.index.begin()); b < af.index.size() && af.index[b].first_ts <= ts_to; ++b)
+    if (!af.read_block(b, ts_from, ts_to, out, buf)) { out.clear(); return false; }
+  return true;
+}
+
+bool archive_read_tail(const std::string& path, size_t n, BarRows& out) {
+  out.clear();
+  ArchiveFile af;
+  if (!af.open(path)) return false;
+  out.has_turnover = af.turnover();
+  if (n == 0 || af.index.empty()) return true;
+  size_t b0 = af.index.size(), have = 0;
+  while (b0 > 0 && have < n) have += af.index[--b0].rows;
+  std::string buf;
+  for (size_t b = b0; b < af.index.size(); ++b)
+    if (!af.read_block(b, INT64_MIN, INT64_MAX, out, buf)) { out.clear(); return false; }
+  if (out.size() > n) {
+    const size_t drop = out.size() - n;
+    out.ts.erase(out.ts.begin(), out.ts.begin() + drop);
+    for (auto& c : out.cols) c.erase(c.begin(), c.begin() + drop);
+  }
+  return true;
+}
+
+bool archive_info(const std::string& path, ArchiveInfo& out) {
+  ArchiveFile af;
+  if (!af.open(path)) return false;
+  out = ArchiveInfo{};
+  out.rows   = af.h.nrows;
+  out.blocks = af.h.nblocks;
+  out.bytes  = af.bytes;
+  out.has_turnover = af.turnover();
+  if (!af.index.empty()) { out.ts_min = af.index.front().first_ts; out.ts_max = af.index.back().last_ts; }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Холодная + горячая части серии
+// ---------------------------------------------------------------------------
+bool archive_series(const std::string& csv_path, int64_t before_ts, size_t* moved) {
+  if (moved) *moved = 0;
+  BarRows cold;
+  if (!load_series_range(csv_path, INT64_MIN, before_ts - 1, cold)) return false;
+  if (cold.empty()) return true;
+
+  const std::string ap = archive_path_for(csv_path);
+  BarRows arch;
+  if (fs::exists(ap) && !archive_read_range(ap, INT64_MIN, INT64_MAX, arch)) {
+    std::cerr << "[ARCHIVE] unreadable archive, not touching series: " << ap << std::endl;
+    return false;
+  }
+  merge_bars(arch, cold);
+  // сначала архив, потом обрезка горячей серии — при сбое бары не теряются
+  if (!archive_write(ap, arch)) {
+    std::cerr << "[ARCHIVE] write failed: " << ap << std::endl;
+    return false;
+  }
+  if (!compact_series(csv_path, before_ts)) return false;
+  if (moved) *moved = cold.size();
+  return true;
+}
+
+// Архив для склейки: свой; у clean-серии без своего архива (архивирована до
+// появления clean) — архив raw-серии того же символа/ТФ, иначе холодная история теряется
+std::string history_archive_path(const std::string& csv_path) {
+  const std::string ap = archive_path_for(csv_path);
+  const fs::path p(csv_path);
+  if (fs::exists(ap) || p.parent_path().filename() != "clean") return ap;
+  return archive_path_for((p.parent_path().parent_path() / p.filename()).string());
+}
+
+bool load_history_range(const std::string& csv_path, int64_t ts_from, int64_t ts_to, BarRows& out) {
+  BarRows hot;
+  const bool have_hot = load_series_range(csv_path, ts_from, ts_to, hot);
+  const std::string ap = history_archive_path(csv_path);
+  BarRows arch;
+  bool have_arch = false;
+  if (fs::exists(ap)) {
+    const int64_t hi = hot.empty() ? ts_to : std::min(ts_to, hot.ts.front() - 1);
+    have_arch = ts_from > hi || archive_read_range(ap, ts_from, hi, arch);
+  }
+  if (!have_hot && !have_arch) return false;
+  if (arch.empty()) { out = std::move(hot); return true; }
+  merge_bars(arch, hot);
+  out = std::move(arch);
+  return true;
+}
+
+bool load_history_tail(const std::string& csv_path, size_t n, BarRows& out) {
+  BarRows hot;
+  const bool have_hot = load_series_tail(csv_path, n, hot);
+  const std::string ap = history_archive_path(csv_path);
+  if (hot.size() >= n || !fs::exists(ap)) {
+    out = std::move(hot);
+    return have_hot;
+  }
+  BarRows arch;
+  if (!archive_read_tail(ap, n - hot.size(), arch)) { out = std::move(hot); return have_hot; }
+  merge_bars(arch, hot);
+  if (arch.size() > n) trim_bars_before(arch, arch.ts[arch.size() - n]);
+  out = std::move(arch);
+  return true;
+}
+
+} // namespace etai
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "bar_store.h"
+
+namespace etai {
+
+// ============================================================================
+// Сжатый архив холодной истории (одна серия = symbol+interval).
+//   Файл: cache/archive/<SYM>_<TF>.bara рядом с горячим cache/ (.bars + CSV).
+//   Бары режутся на блоки по block_rows (по умолчанию 4096), в конце файла —
+//   индекс блоков (first_ts, last_ts, смещение) → чтение любого окна по времени
+//   декодирует только пересекающиеся блоки.
+//   Кодирование внутри блока:
+//     ts       — delta-of-delta, zigzag varint (ровный шаг → 1 байт на бар);
+//     цены/объём/оборот — десятичный масштаб (v·10^d — целое, d ≤ 8) и дельты
+//                zigzag varint; если масштаб не подходит — XOR с предыдущим
+//                значением (varint). Декодирование всегда бит-в-бит.
+// Горячая серия и архив не пересекаются: archive_series переносит бары старше
+// границы в архив и обрезает горячую серию; load_history_* склеивает обе части.
+// ============================================================================
+
+constexpr uint32_t ARCHIVE_VERSION    = 1;
+constexpr uint32_t ARCHIVE_BLOCK_ROWS = 4096;
+
+struct ArchiveHeader {
+  char     magic[8];      // "ETAIBARA"
+  uint32_t version;
+  uint32_t flags;         // BARS_F_TURNOVER
+  uint64_t nrows;
+  uint64_t nblocks;
+  uint64_t index_off;     // смещение индекса блоков (ArchiveBlock × nblocks)
+  uint32_t block_rows;
+  uint32_t reserved0;
+  uint64_t reserved[2];
+};
+static_assert(sizeof(ArchiveHeader) == 64, "ArchiveHeader must be 64 bytes");
+
+struct ArchiveBlock {
+  int64_t  first_ts;
+  int64_t  last_ts;
+  uint64_t offset;
+  uint32_t size;
+  uint32_t rows;
+};
+static_assert(sizeof(ArchiveBlock) == 32, "ArchiveBlock must be 32 bytes");
+
+struct ArchiveInfo {
+  uint64_t rows = 0, blocks = 0;
+  uint64_t bytes = 0;             // размер файла
+  int64_t  ts_min = 0, ts_max = 0;
+  bool     has_turnover = false;
+};
+
+// cache/X_15.csv → cache/archive/X_15.bara (cache/clean/X_15.csv → cache/clean/archive/X_15.bara)
+std::string archive_path_for(const std::string& csv_path);
+
+// Атомарная запись архива целиком (tmp + rename); rows — по возрастанию ts
+bool archive_write(const std::string& path, const BarRows& rows, uint32_t block_rows = ARCHIVE_BLOCK_ROWS);
+
+// Окно [ts_from, ts_to] (включительно) / последние n баров архива. false — архива нет / битый.
+bool archive_read_range(const std::string& path, int64_t ts_from, int64_t ts_to, BarRows& out);
+bool archive_read_tail(const std::string& path, size_t n, BarRows& out);
+
+bool archive_info(const std::string& path, ArchiveInfo& out);
+
+// Перенести бары серии с ts < before_ts в архив (слияние с имеющимся архивом),
+// затем обрезать горячую серию. moved — сколько баров ушло в архив.
+bool archive_series(const std::string& csv_path, int64_t before_ts, size_t* moved = nullptr);
+
+// Архив, который склеивает load_history_*: свой, а для cache/clean/X без своего — архив raw
+std::string history_archive_path(const std::string& csv_path);
+
+// Склейка архив + горячая серия (архива нет — только горячая): окно по времени / хвост.
+// cache/clean/X без cache/clean/archive/X.bara — берётся архив raw (cache/archive/X.bara).
+// false — нет ни одной части.
+bool load_history_range(const std::string& csv_path, int64_t ts_from, int64_t ts_to, BarRows& out);
+bool load_history_tail(const std::string& csv_path, size_t n, BarRows& out);
+
+} // namespace etai
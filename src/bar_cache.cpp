@@ -0,0 +1,207 @@
+#include "bar_cache.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+namespace etai {
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Entry {
+  BarMatrixPtr m;
+  size_t       bytes  = 0;
+  long long    t_csv  = -1;   // mtime (ns) CSV/.bars на момент загрузки
+  long long    t_bars = -1;
+  std::list<std::string>::iterator lru;
+};
+
+std::mutex                              g_mu;
+std::unordered_map<std::string, Entry>  g_map;
+std::list<std::string>                  g_lru;     // front — самый свежий
+size_t                                  g_bytes = 0;
+
+std::atomic<unsigned long long> g_hits{0};
+std::atomic<unsigned long long> g_misses{0};
+std::atomic<unsigned long long> g_evictions{0};
+
+size_t budget_bytes() {
+  static const size_t b = []{
+    long long mb = 256;
+    if (const char* s = std::getenv("ETAI_BAR_CACHE_MB")) {
+      try { mb = std::stoll(s); } catch (...) {}
+    }
+    if (mb < 0) mb = 0;
+    return (size_t)mb * 1024ULL * 1024ULL;
+  }();
+  return b;
+}
+
+long long mtime_ns(const std::string& path) {
+  struct stat st{};
+  if (::stat(path.c_str(), &st) != 0) return -1;
+  return (long long)st.st_mtim.tv_sec * 1000000000LL + (long long)st.st_mtim.tv_nsec;
+}
+
+BarMatrixPtr to_matrix(const MappedBars& mb) {
+  const size_t n = mb.size();
+  auto M = std::make_shared<arma::mat>(n, 6);
+  auto ts = mb.ts();
+  double* c0 = M->colptr(0);
+  for (size_t i = 0; i < n; ++i) c0[i] = (double)ts[i];
+  for (int k = BAR_OPEN; k <= BAR_VOLUME; ++k) {
+    auto c = mb.col(k);
+    std::copy(c.begin(), c.end(), M->colptr(k + 1));
+  }
+  return M;
+}
+
+BarMatrixPtr to_matrix(const BarRows& r) {
+  const size_t n = r.size();
+  auto M = std::make_shared<arma::mat>(n, 6);
+  double* c0 = M->colptr(0);
+  for (size_t i = 0; i < n; ++i) c0[i] = (double)r.ts[i];
+  for (int k = BAR_OPEN; k <= BAR_VOLUME; ++k)
+    std::copy(r.cols[k].begin(), r.cols[k].end(), M->colptr(k + 1));
+  return M;
+}
+
+// под g_mu
+void erase_locked(std::unordered_map<std::string, Entry>::iterator it) {
+  g_bytes -= it->second.bytes;
+  g_lru.erase(it->second.lru);
+  g_map.erase(it);
+}
+
+// под g_mu; запись больше бюджета не кладём вовсе
+void put_locked(const std::string& key, BarMatrixPtr m, long long t_csv, long long t_bars) {
+  auto old = g_map.find(key);
+  if (old != g_map.end()) erase_locked(old);
+
+  const size_t bytes = m->n_elem * sizeof(double);
+  const size_t cap = budget_bytes();
+  if (bytes > cap) return;
+  while (g_bytes + bytes > cap && !g_lru.empty()) {
+    auto victim = g_map.find(g_lru.back());
+    if (victim == g_map.end()) { g_lru.pop_back(); continue; }
+    erase_locked(victim);
+    g_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+  g_lru.push_front(key);
+  Entry e;
+  e.m = std::move(m); e.bytes = bytes; e.t_csv = t_csv; e.t_bars = t_bars; e.lru = g_lru.begin();
+  g_map.emplace(key, std::move(e));
+  g_bytes += bytes;
+}
+
+} // namespace
+
+BarMatrixPtr get_cached_bars_path(const std::string& csv_path) {
+  const std::string bars_path = bars_path_for(csv_path);
+  const long long t_csv  = mtime_ns(csv_path);
+  const long long t_bars = mtime_ns(bars_path);
+  {
+    std::lock_guard<std::mutex> lk(g_mu);
+    auto it = g_map.find(csv_path);
+    if (it != g_map.end()) {
+      // внешняя правка CSV (скрипты) — запись устарела
+      if (it->second.t_csv == t_csv && it->second.t_bars == t_bars) {
+        g_lru.splice(g_lru.begin(), g_lru, it->second.lru);
+        g_hits.fetch_add(1, std::memory_order_relaxed);
+        return it->second.m;
+      }
+      erase_locked(it);
+    }
+  }
+  g_misses.fetch_add(1, std::memory_order_relaxed);
+
+  // загрузка вне замка: параллельные промахи по разным сериям не ждут друг друга
+  auto mb = open_bars_for_csv(csv_path);
+  if (!mb || mb->size() == 0) return nullptr;
+  BarMatrixPtr m = to_matrix(*mb);
+
+  // mtime — снятые ДО загрузки: запись во время загрузки сделает их старыми, и следующее
+  // чтение перечитает серию; запись, положенную писателем за это время, не затираем
+  std::lock_guard<std::mutex> lk(g_mu);
+  if (g_map.find(csv_path) == g_map.end()) put_locked(csv_path, m, t_csv, t_bars);
+  return m;
+}
+
+BarMatrixPtr get_cached_bars(const std::string& symbol, const std::string& interval) {
+  return get_cached_bars_path(cache_file(symbol, interval));
+}
+
+void bar_cache_on_write(const std::string& csv_path, const BarRows& rows) {
+  std::lock_guard<std::mutex> lk(g_mu);
+  auto it = g_map.find(csv_path);
+  if (it == g_map.end()) return;                 // не в кэше — загрузится при первом чтении
+  if (rows.empty()) { erase_locked(it); return; }
+  put_locked(csv_path, to_matrix(rows), mtime_ns(csv_path), mtime_ns(bars_path_for(csv_path)));
+}
+
+void bar_cache_append(const std::string& csv_path, const BarRows& tail,
+                      int64_t disk_last_ts, size_t disk_rows) {
+  if (tail.empty()) return;
+  std::lock_guard<std::mutex> lk(g_mu);
+  auto it = g_map.find(csv_path);
+  if (it == g_map.end()) return;
+
+  const arma::mat& old = *it->second.m;
+  if (old.n_rows != disk_rows || (int64_t)old(old.n_rows - 1, 0) != disk_last_ts ||
+      disk_last_ts > tail.ts.front()) {
+    erase_locked(it);                            // запись отстала от диска / не чистая дозапись — перечитаем
+    return;
+  }
+  // первый бар хвоста с ts последнего — замена формировавшегося бара
+  const size_t n0 = old.n_rows - ((int64_t)old(old.n_rows - 1, 0) == tail.ts.front() ? 1 : 0);
+  const size_t n1 = tail.size();
+  auto M = std::make_shared<arma::mat>(n0 + n1, 6);
+  for (int c = 0; c < 6; ++c) {
+    std::copy(old.colptr(c), old.colptr(c) + n0, M->colptr(c));
+    double* dst = M->colptr(c) + n0;
+    if (c == 0) for (size_t i = 0; i < n1; ++i) dst[i] = (double)tail.ts[i];
+    else        std::copy(tail.cols[c - 1].begin(), tail.cols[c - 1].end(), dst);
+  }
+  put_locked(csv_path, M, mtime_ns(csv_path), mtime_ns(bars_path_for(csv_path)));
+}
+
+void invalidate_cached_bars_path(const std::string& csv_path) {
+  std::lock_guard<std::mutex> lk(g_mu);
+  auto it = g_map.find(csv_path);
+  if (it != g_map.end()) erase_locked(it);
+}
+
+void invalidate_cached_bars(const std::string& symbol, const std::string& interval) {
+  const std::string tf = canonical_interval(interval);
+  invalidate_cached_bars_path(cache_file(symbol, tf));
+  invalidate_cached_bars_path("cache/clean/" + symbol + "_" + tf + ".csv");
+}
+
+void invalidate_all_cached_bars() {
+  std::lock_guard<std::mutex> lk(g_mu);
+  g_map.clear();
+  g_lru.clear();
+  g_bytes = 0;
+}
+
+json bar_cache_stats() {
+  std::lock_guard<std::mutex> lk(g_mu);
+  return json{
+    {"entries",      (unsigned long long)g_map.size()},
+    {"bytes",        (unsigned long long)g_bytes},
+    {"budget_bytes", (unsigned long long)budget_bytes()},
+    {"hits",         g_hits.load(std::memory_order_relaxed)},
+    {"misses",       g_misses.load(std::memory_order_relaxed)},
+    {"evictions",    g_evictions.load(std::memory_order_relaxed)}
+  };
+}
+
+} // namespace etai
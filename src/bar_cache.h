@@ -0,0 +1,45 @@
+#pragma once
+#include <armadillo>
+#include <memory>
+#include <string>
+#include "json.hpp"
+#include "bar_store.h"
+
+namespace etai {
+
+// ============================================================================
+// Процессный кэш OHLCV-матриц (N×6: ts,open,high,low,close,volume).
+//   Ключ — путь CSV серии (cache/<SYM>_<TF>.csv или cache/clean/...).
+//   Бюджет памяти: ETAI_BAR_CACHE_MB (по умолчанию 256), вытеснение LRU.
+//   Писатели (store_series / backfill / pipeline) обновляют или сбрасывают запись;
+//   на случай внешних правок (скрипты) запись сверяется с mtime CSV/.bars.
+// Матрицы отдаются как shared_ptr<const> — читатели не блокируют замену.
+// ============================================================================
+
+using BarMatrixPtr = std::shared_ptr<const arma::mat>;
+
+// cache/<SYM>_<TF> — тот же ряд, что load_cached_matrix, без копии (вид — bars_view)
+BarMatrixPtr get_cached_bars(const std::string& symbol, const std::string& interval);
+
+// Произвольная серия по пути CSV (nullptr — серии нет)
+BarMatrixPtr get_cached_bars_path(const std::string& csv_path);
+
+// Хук писателей: серия по пути полностью переписана → обновить запись, если она есть
+void bar_cache_on_write(const std::string& csv_path, const BarRows& rows);
+
+// Дозапись хвоста в существующую запись (первый ts >= последнего: равный заменяет
+// последний бар). disk_last_ts / disk_rows — последний ts и число строк .bars ДО
+// дозаписи: запись, отстающая от диска (не тот последний бар / не то число строк), —
+// сброс, иначе хвост лёг бы после молчаливой дыры
+void bar_cache_append(const std::string& csv_path, const BarRows& tail,
+                      int64_t disk_last_ts, size_t disk_rows);
+
+// Сброс серии (raw + clean) / всего кэша
+void invalidate_cached_bars(const std::string& symbol, const std::string& interval);
+void invalidate_cached_bars_path(const std::string& csv_path);
+void invalidate_all_cached_bars();
+
+// Телеметрия: entries, bytes, budget_bytes, hits, misses, evictions
+nlohmann::json bar_cache_stats();
+
+} // namespace etai
@@ -0,0 +1,838 @@
+#include "bar_store.h"
+#include "bar_cache.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace etai {
+
+static const char BARS_MAGIC[8] = {'E','T','A','I','B','A','R','S'};
+static constexpr size_t BARS_CAP_ALIGN = 4096;   // запас строк под дозапись
+
+static std::atomic<unsigned long long> G_TMP_SEQ{0};
+
+static std::string tmp_path_for(const std::string& path) {
+  return path + ".tmp." + std::to_string((long long)::getpid()) + "." +
+         std::to_string(G_TMP_SEQ.fetch_add(1, std::memory_order_relaxed));
+}
+
+// mtime в наносекундах; -1 — файла нет
+static long long file_mtime_ns(const std::string& path) {
+  struct stat st{};
+  if (::stat(path.c_str(), &st) != 0) return -1;
+  return (long long)st.st_mtim.tv_sec * 1000000000LL + (long long)st.st_mtim.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------
+// MappedBars
+// ---------------------------------------------------------------------------
+MappedBars::~MappedBars() { close(); }
+
+MappedBars::MappedBars(MappedBars&& o) noexcept { *this = std::move(o); }
+
+MappedBars& MappedBars::operator=(MappedBars&& o) noexcept {
+  if (this != &o) {
+    close();
+    base_ = o.base_; len_ = o.len_; n_ = o.n_; cap_ = o.cap_; flags_ = o.flags_;
+    path_ = std::move(o.path_);
+    o.base_ = nullptr; o.len_ = 0; o.n_ = 0; o.cap_ = 0; o.flags_ = 0;
+  }
+  return *this;
+}
+
+void MappedBars::close() {
+  if (base_) ::munmap(base_, len_);
+  base_ = nullptr; len_ = 0; n_ = 0; cap_ = 0; flags_ = 0;
+}
+
+bool MappedBars::open(const std::string& path, std::string* err) {
+  close();
+  auto fail = [&](const char* why) { if (err) *err = why; return false; };
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return fail("open_failed");
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BarsHeader)) { ::close(fd); return fail("short_file"); }
+
+  const size_t len = (size_t)st.st_size;
+  void* p = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) return fail("mmap_failed");
+
+  BarsHeader h;
+  std::memcpy(&h, p, sizeof(h));
+  const bool ok_hdr = std::memcmp(h.magic, BARS_MAGIC, 8) == 0 &&
+                      h.version == BARS_VERSION && h.ncols == BARS_NCOLS &&
+                      h.nrows <= h.capacity &&
+                      sizeof(BarsHeader) + h.capacity * BARS_NCOLS * 8 <= len;
+  if (!ok_hdr) { ::munmap(p, len); return fail("bad_header"); }
+
+  ::madvise(p, len, MADV_WILLNEED);
+  base_ = p; len_ = len; n_ = (size_t)h.nrows; cap_ = (size_t)h.capacity; flags_ = h.flags;
+  path_ = path;
+  return true;
+}
+
+ColView<int64_t> MappedBars::ts() const {
+  if (!base_) return {};
+  return { reinterpret_cast<const int64_t*>(static_cast<const char*>(base_) + sizeof(BarsHeader)), n_ };
+}
+
+ColView<double> MappedBars::col(int k) const {
+  if (!base_ || k < 0 || k > BAR_TURNOVER) return {};
+  const char* p = static_cast<const char*>(base_) + sizeof(BarsHeader) + (size_t)(k + 1) * cap_ * 8;
+  return { reinterpret_cast<const double*>(p), n_ };
+}
+
+// ---------------------------------------------------------------------------
+// CSV → колонки
+// ---------------------------------------------------------------------------
+std::string bars_path_for(const std::string& csv_path) {
+  const std::string ext = ".csv";
+  if (csv_path.size() > ext.size() &&
+      csv_path.compare(csv_path.size() - ext.size(), ext.size(), ext) == 0)
+    return csv_path.substr(0, csv_path.size() - ext.size()) + ".bars";
+  return csv_path + ".bars";
+}
+
+static inline bool parse_num(const char* b, const char* e, double& out) {
+  while (b < e && (*b == ' ' || *b == '\t' || *b == '"')) ++b;
+  while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r' || e[-1] == '"')) --e;
+  if (b == e) return false;
+  auto r = std::from_chars(b, e, out);
+  return r.ec == std::errc() && r.ptr == e;
+}
+
+// после push_back без гарантий порядка: сортировка по ts, дубликаты — последний выигрывает.
+// Возвращает число отброшенных дублей.
+static size_t sort_dedup(BarRows& r) {
+  const size_t n = r.size();
+  bool sorted = true;
+  for (size_t i = 1; i < n; ++i) if (r.ts[i] <= r.ts[i-1]) { sorted = false; break; }
+  if (sorted) return 0;
+
+  std::vector<size_t> idx(n);
+  std::iota(idx.begin(), idx.end(), 0);
+  std::stable_sort(idx.begin(), idx.end(), [&](size_t a, size_t b){ return r.ts[a] < r.ts[b]; });
+
+  BarRows out;
+  out.has_turnover = r.has_turnover;
+  out.reserve(n);
+  for (size_t k = 0; k < n; ++k) {
+    const size_t i = idx[k];
+    if (k + 1 < n && r.ts[idx[k+1]] == r.ts[i]) continue;   // следующий с тем же ts новее
+    out.push_back(r.ts[i], r.cols[0][i], r.cols[1][i], r.cols[2][i], r.cols[3][i], r.cols[4][i], r.cols[5][i]);
+  }
+  const size_t dropped = n - out.size();
+  r = std::move(out);
+  return dropped;
+}
+
+// Строка CSV [ln, eol) → v[0..nf); false — битое поле (nf — сколько разобрано до него)
+static bool parse_csv_line(const char* ln, const char* eol, double v[7], int& nf) {
+  nf = 0;
+  const char* c = ln;
+  while (c <= eol && nf < 7) {
+    const char* ce = static_cast<const char*>(std::memchr(c, ',', eol - c));
+    if (!ce) ce = eol;
+    if (!parse_num(c, ce, v[nf])) return false;
+    ++nf;
+    c = ce + 1;
+  }
+  return true;
+}
+
+bool parse_csv_bars(const std::string& csv_path, BarRows& out, size_t* skipped, size_t* duplicates) {
+  out.clear();
+  out.has_turnover = false;
+  std::ifstream f(csv_path, std::ios::binary);
+  if (!f.good()) return false;
+  std::string buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+  const char* p   = buf.data();
+  const char* end = p + buf.size();
+  if (buf.size() >= 3 && (unsigned char)p[0] == 0xEF && (unsigned char)p[1] == 0xBB && (unsigned char)p[2] == 0xBF) p += 3;
+
+  out.reserve(std::count(p, end, '\n') + 1);
+  bool first_line = true;
+  size_t n_turn = 0;
+
+  while (p < end) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (!eol) eol = end;
+    const char* ln = p;
+    p = eol + 1;
+    if (eol == ln || (eol - ln == 1 && *ln == '\r')) continue;
+
+    double v[7];
+    int nf = 0;
+    const bool bad = !parse_csv_line(ln, eol, v, nf);
+    const bool header = first_line && bad && nf == 0;
+    first_line = false;
+    if (header) continue;                       // заголовок
+    if (bad || nf < 6 || !std::isfinite(v[0])) { if (skipped) ++(*skipped); continue; }
+
+    if (nf >= 7) ++n_turn; else v[6] = 0.0;
+    out.push_back((int64_t)std::llround(v[0]), v[1], v[2], v[3], v[4], v[5], v[6]);
+  }
+
+  out.has_turnover = (n_turn > 0);
+  const size_t dups = sort_dedup(out);
+  if (duplicates) *duplicates = dups;
+  return true;
+}
+
+// Обратный проход по CSV-зеркалу (отсортировано по ts): блоками с конца файла,
+// до первой строки с ts < ts_from или до max_rows строк окна (0 — без ограничения).
+static bool csv_scan_back(const std::string& csv_path, int64_t ts_from, int64_t ts_to,
+                          size_t max_rows, BarRows& out) {
+  int fd = ::open(csv_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+
+  BarRows rev;                       // строки окна от новых к старым
+  size_t n_turn = 0;
+  bool done = false;
+  auto take = [&](const char* ln, const char* eol) {
+    if (eol > ln && eol[-1] == '\r') --eol;
+    if (eol == ln) return;
+    double v[7];
+    int nf = 0;
+    if (!parse_csv_line(ln, eol, v, nf) || nf < 6 || !std::isfinite(v[0])) return;   // заголовок / битая
+    const int64_t t = (int64_t)std::llround(v[0]);
+    if (t > ts_to) return;
+    if (t < ts_from) { done = true; return; }
+    if (nf >= 7) ++n_turn; else v[6] = 0.0;
+    rev.push_back(t, v[1], v[2], v[3], v[4], v[5], v[6]);
+    if (max_rows && rev.size() >= max_rows) done = true;
+  };
+
+  constexpr size_t BLOCK = 64 * 1024;
+  off_t pos = st.st_size;
+  std::string buf, carry;            // carry — начало строки, разрезанной границей блока
+  bool ok = true;
+  while (!done && pos > 0) {
+    const size_t len = (size_t)std::min<off_t>((off_t)BLOCK, pos);
+    pos -= (off_t)len;
+    buf.resize(len);
+    if (::pread(fd, &buf[0], len, pos) != (ssize_t)len) { ok = false; break; }
+    buf += carry;
+    const char* b = buf.data();
+    const char* line_end = b + buf.size();
+    for (const char* q = line_end; q > b && !done; --q) {
+      if (q[-1] != '\n') continue;
+      take(q, line_end);
+      line_end = q - 1;
+    }
+    if (done) break;
+    if (pos == 0) {
+      if (line_end - b >= 3 && (unsigned char)b[0] == 0xEF && (unsigned char)b[1] == 0xBB && (unsigned char)b[2] == 0xBF) b += 3;
+      take(b, line_end);
+    } else {
+      carry.assign(b, line_end);
+    }
+  }
+  ::close(fd);
+  if (!ok) return false;
+
+  out.clear();
+  out.has_turnover = (n_turn > 0);
+  out.reserve(rev.size());
+  for (size_t i = rev.size(); i-- > 0;)
+    out.push_back(rev.ts[i], rev.cols[0][i], rev.cols[1][i], rev.cols[2][i], rev.cols[3][i], rev.cols[4][i], rev.cols[5][i]);
+  sort_dedup(out);                   // зеркало правили руками — порядок не гарантирован
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Метаданные (.meta)
+// ---------------------------------------------------------------------------
+static const char META_MAGIC[8] = {'E','T','A','I','M','E','T','A'};
+static constexpr uint32_t META_VERSION = 2;   // 2: step_ms по таймфрейму + min_step_ms
+
+static std::string meta_path_from_bars(const std::string& bars_path) {
+  const std::string ext = ".bars";
+  if (bars_path.size() > ext.size() &&
+      bars_path.compare(bars_path.size() - ext.size(), ext.size(), ext) == 0)
+    return bars_path.substr(0, bars_path.size() - ext.size()) + ".meta";
+  return bars_path + ".meta";
+}
+
+std::string meta_path_for(const std::string& csv_path) {
+  return meta_path_from_bars(bars_path_for(csv_path));
+}
+
+static int64_t unix_ms_now() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a по байтам строки + финальное перемешивание (суммы хэшей не гасят друг друга)
+static uint64_t row_hash(int64_t ts, const double v[6]) {
+  uint64_t h = 1469598103934665603ULL;
+  auto mix = [&h](const void* p, size_t n) {
+    const unsigned char* b = static_cast<const unsigned char*>(p);
+    for (size_t i = 0; i < n; ++i) { h ^= b[i]; h *= 1099511628211ULL; }
+  };
+  mix(&ts, 8);
+  mix(v, 6 * 8);
+  h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+uint64_t series_row_hash(int64_t ts, const double v[6]) { return row_hash(ts, v); }
+
+// Шаг таймфрейма по имени файла серии: cache/X_15.bars, cache/clean/X_1h.bars → мс;
+// 0 — имя не несёт известного ТФ (тогда шаг — наименьший по данным)
+static int64_t frame_ms_for(const std::string& bars_path) {
+  const size_t slash = bars_path.find_last_of('/');
+  const size_t dot   = bars_path.find_last_of('.');
+  const size_t us    = bars_path.find_last_of('_');
+  if (us == std::string::npos || (slash != std::string::npos && us < slash)) return 0;
+  const std::string tf = canonical_interval(
+      bars_path.substr(us + 1, (dot != std::string::npos && dot > us ? dot : bars_path.size()) - us - 1));
+  if (tf == "15" || tf == "60" || tf == "240" || tf == "1440") return tf_ms(tf);
+  return 0;
+}
+
+// Полный расчёт по колонкам (cols[k] — k-я колонка BarCol); frame_ms — шаг ТФ (0 — неизвестен).
+// Разрывы считаются по шагу ТФ: серия, у которой где-то оказались два бара ближе шага
+// (дубль-минута, смещённая свеча), не теряет разрывы — это видно по min_step_ms < step_ms.
+static SeriesMeta meta_compute(const int64_t* ts, const double* const cols[6], size_t n, bool turnover,
+                               int64_t frame_ms) {
+  SeriesMeta m{};
+  std::memcpy(m.magic, META_MAGIC, 8);
+  m.version = META_VERSION;
+  m.cols    = turnover ? 7u : 6u;
+  m.rows    = n;
+  m.written_ms = unix_ms_now();
+  if (n == 0) return m;
+  m.ts_min = ts[0];
+  m.ts_max = ts[n - 1];
+  int64_t min_step = 0;
+  for (size_t i = 1; i < n; ++i) {
+    const int64_t d = ts[i] - ts[i - 1];
+    if (d > 0 && (min_step == 0 || d < min_step)) min_step = d;
+  }
+  const int64_t step = frame_ms > 0 ? frame_ms : min_step;
+  m.step_ms = step;
+  m.min_step_ms = min_step;
+  for (size_t i = 0; i < n; ++i) {
+    const double v[6] = {cols[0][i], cols[1][i], cols[2][i], cols[3][i], cols[4][i], cols[5][i]};
+    m.hash += row_hash(ts[i], v);
+    if (i && step > 0) {
+      const int64_t d = ts[i] - ts[i - 1];
+      if (d > step) { ++m.gaps; m.missing += (uint64_t)((d - 1) / step); }
+    }
+  }
+  return m;
+}
+
+static bool meta_write(const std::string& meta_path, const SeriesMeta& m) {
+  const std::string tmp = tmp_path_for(meta_path);
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f.good()) return false;
+    f.write(reinterpret_cast<const char*>(&m), sizeof(m));
+    if (!f.good()) { f.close(); ::unlink(tmp.c_str()); return false; }
+  }
+  if (::rename(tmp.c_str(), meta_path.c_str()) != 0) { ::unlink(tmp.c_str()); return false; }
+  return true;
+}
+
+static bool meta_read(const std::string& meta_path, SeriesMeta& m) {
+  int fd = ::open(meta_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  const bool ok = ::pread(fd, &m, sizeof(m), 0) == (ssize_t)sizeof(m);
+  ::close(fd);
+  return ok && std::memcmp(m.magic, META_MAGIC, 8) == 0 && m.version == META_VERSION;
+}
+
+static void meta_store_rows(const std::string& bars_path, const BarRows& rows, size_t dups, size_t skipped) {
+  const double* cols[6];
+  for (int k = 0; k < 6; ++k) cols[k] = rows.cols[k].data();
+  SeriesMeta m = meta_compute(rows.ts.data(), cols, rows.size(), rows.has_turnover, frame_ms_for(bars_path));
+  m.dups = dups;
+  m.skipped = skipped;
+  if (!meta_write(meta_path_from_bars(bars_path), m))
+    std::cerr << "[BARS] meta write failed: " << bars_path << std::endl;
+}
+
+// ---------------------------------------------------------------------------
+// Запись/чтение .bars
+// ---------------------------------------------------------------------------
+static bool write_bars_only(const std::string& bars_path, const BarRows& rows);
+
+bool write_bars(const std::string& bars_path, const BarRows& rows) {
+  if (!write_bars_only(bars_path, rows)) return false;
+  meta_store_rows(bars_path, rows, 0, 0);
+  return true;
+}
+
+static bool write_bars_only(const std::string& bars_path, const BarRows& rows) {
+  const size_t n   = rows.size();
+  const size_t cap = std::max<size_t>(BARS_CAP_ALIGN, ((n + BARS_CAP_ALIGN - 1) / BARS_CAP_ALIGN) * BARS_CAP_ALIGN);
+
+  BarsHeader h{};
+  std::memcpy(h.magic, BARS_MAGIC, 8);
+  h.version  = BARS_VERSION;
+  h.ncols    = BARS_NCOLS;
+  h.nrows    = n;
+  h.capacity = cap;
+  h.flags    = rows.has_turnover ? BARS_F_TURNOVER : 0u;
+
+  const std::string tmp = tmp_path_for(bars_path);
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f.good()) return false;
+    const std::vector<char> pad((cap - n) * 8, 0);
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    f.write(reinterpret_cast<const char*>(rows.ts.data()), n * 8);
+    f.write(pad.data(), pad.size());
+    for (const auto& c : rows.cols) {
+      f.write(reinterpret_cast<const char*>(c.data()), n * 8);
+      f.write(pad.data(), pad.size());
+    }
+    if (!f.good()) { f.close(); ::unlink(tmp.c_str()); return false; }
+  }
+  if (::rename(tmp.c_str(), bars_path.c_str()) != 0) { ::unlink(tmp.c_str()); return false; }
+  return true;
+}
+
+bool read_bars(const std::string& bars_path, BarRows& out) {
+  MappedBars mb;
+  if (!mb.open(bars_path)) return false;
+  const size_t n = mb.size();
+  out.clear();
+  out.has_turnover = mb.has_turnover();
+  auto ts = mb.ts();
+  out.ts.assign(ts.begin(), ts.end());
+  for (int k = 0; k <= BAR_TURNOVER; ++k) {
+    auto c = mb.col(k);
+    out.cols[k].assign(c.begin(), c.end());
+  }
+  return out.size() == n;
+}
+
+static inline void append_num(std::string& s, double v) {
+  char buf[64];
+  auto r = std::to_chars(buf, buf + sizeof(buf), v);
+  s.append(buf, r.ptr);
+}
+
+bool write_csv_mirror(const std::string& csv_path, const BarRows& rows) {
+  std::string s;
+  s.reserve(rows.size() * 96);
+  char buf[32];
+  const int ncol = rows.has_turnover ? 6 : 5;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    auto r = std::to_chars(buf, buf + sizeof(buf), (long long)rows.ts[i]);
+    s.append(buf, r.ptr);
+    for (int k = 0; k < ncol; ++k) { s.push_back(','); append_num(s, rows.cols[k][i]); }
+    s.push_back('\n');
+  }
+
+  const std::string tmp = tmp_path_for(csv_path);
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f.good()) return false;
+    f.write(s.data(), (std::streamsize)s.size());
+    if (!f.good()) { f.close(); ::unlink(tmp.c_str()); return false; }
+  }
+  if (::rename(tmp.c_str(), csv_path.c_str()) != 0) { ::unlink(tmp.c_str()); return false; }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Импорт / открытие серии
+// ---------------------------------------------------------------------------
+static bool import_csv(const std::string& csv_path, const std::string& bars_path,
+                       size_t* skipped, std::string* err) {
+  BarRows rows;
+  size_t bad = 0, dups = 0;
+  if (!parse_csv_bars(csv_path, rows, &bad, &dups)) { if (err) *err = "csv_read_failed"; return false; }
+  if (skipped) *skipped += bad;
+  if (!write_bars_only(bars_path, rows))            { if (err) *err = "bars_write_failed"; return false; }
+  meta_store_rows(bars_path, rows, dups, bad);
+  std::cerr << "[BARS] imported " << csv_path << " rows=" << rows.size() << std::endl;
+  return true;
+}
+
+bool ensure_bars_for_csv(const std::string& csv_path, size_t* skipped, std::string* err) {
+  const std::string bars_path = bars_path_for(csv_path);
+  const long long t_csv  = file_mtime_ns(csv_path);
+  const long long t_bars = file_mtime_ns(bars_path);
+  if (t_csv < 0) {
+    if (t_bars < 0) { if (err) *err = "missing"; return false; }
+    return true;                                   // серия только в .bars
+  }
+  if (t_bars >= t_csv) return true;                // .bars актуален
+  return import_csv(csv_path, bars_path, skipped, err);
+}
+
+std::shared_ptr<MappedBars> open_bars_for_csv(const std::string& csv_path, size_t* skipped) {
+  if (!ensure_bars_for_csv(csv_path, skipped)) return nullptr;
+  const std::string bars_path = bars_path_for(csv_path);
+  auto mb = std::make_shared<MappedBars>();
+  std::string err;
+  if (mb->open(bars_path, &err)) return mb;
+
+  // битый/чужой формат → один принудительный переимпорт из CSV
+  std::cerr << "[BARS] reopen " << bars_path << " failed: " << err << std::endl;
+  if (file_mtime_ns(csv_path) < 0 || !import_csv(csv_path, bars_path, skipped, &err)) return nullptr;
+  if (!mb->open(bars_path, &err)) return nullptr;
+  return mb;
+}
+
+bool load_series(const std::string& csv_path, BarRows& out, size_t* skipped) {
+  out.clear();
+  if (!ensure_bars_for_csv(csv_path, skipped)) return false;
+  if (read_bars(bars_path_for(csv_path), out)) return true;
+  return parse_csv_bars(csv_path, out, skipped);
+}
+
+// Окно [ts_from, ts_to], не больше max_rows последних баров окна (0 — все)
+static bool load_series_window(const std::string& csv_path, int64_t ts_from, int64_t ts_to,
+                               size_t max_rows, BarRows& out) {
+  out.clear();
+  out.has_turnover = false;
+  if (auto mb = open_bars_for_csv(csv_path)) {
+    const auto ts = mb->ts();
+    const size_t i1 = (size_t)(std::upper_bound(ts.begin(), ts.end(), ts_to) - ts.begin());
+    size_t i0 = (size_t)(std::lower_bound(ts.begin(), ts.end(), ts_from) - ts.begin());
+    if (i0 > i1) i0 = i1;
+    if (max_rows && i1 - i0 > max_rows) i0 = i1 - max_rows;
+    out.has_turnover = mb->has_turnover();
+    out.ts.assign(ts.begin() + i0, ts.begin() + i1);
+    for (int k = 0; k <= BAR_TURNOVER; ++k) {
+      const auto c = mb->col(k);
+      out.cols[k].assign(c.begin() + i0, c.begin() + i1);
+    }
+    return true;
+  }
+  // .bars не создать (нет места / только чтение) — обратный проход по CSV
+  return file_mtime_ns(csv_path) >= 0 && csv_scan_back(csv_path, ts_from, ts_to, max_rows, out);
+}
+
+bool load_series_range(const std::string& csv_path, int64_t ts_from, int64_t ts_to, BarRows& out) {
+  return load_series_window(csv_path, ts_from, ts_to, 0, out);
+}
+
+bool load_series_tail(const std::string& csv_path, size_t n, BarRows& out) {
+  if (n == 0) { out.clear(); return ensure_bars_for_csv(csv_path) || file_mtime_ns(csv_path) >= 0; }
+  return load_series_window(csv_path, INT64_MIN, INT64_MAX, n, out);
+}
+
+bool store_series(const std::string& csv_path, const BarRows& rows) {
+  // сначала зеркало, потом .bars — чтобы mtime(.bars) >= mtime(csv) и не было лишнего импорта
+  const std::string bars_path = bars_path_for(csv_path);
+  const bool ok_csv  = write_csv_mirror(csv_path, rows);
+  const bool ok_bars = write_bars(bars_path, rows);
+  if (!ok_csv)  std::cerr << "[BARS] csv mirror write failed: " << csv_path << std::endl;
+  if (!ok_bars) std::cerr << "[BARS] bars write failed: " << bars_path << std::endl;
+  if (ok_bars) bar_cache_on_write(csv_path, rows);
+  else         invalidate_cached_bars_path(csv_path);
+  return ok_bars;
+}
+
+// ---------------------------------------------------------------------------
+// Дозапись / компакция
+// ---------------------------------------------------------------------------
+static std::mutex G_APPEND_MU;     // дозаписи одной серии из очереди и из роутов не перемешиваются
+
+static bool read_header_fd(int fd, BarsHeader& h) {
+  if (::pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) return false;
+  return std::memcmp(h.magic, BARS_MAGIC, 8) == 0 && h.version == BARS_VERSION &&
+         h.ncols == BARS_NCOLS && h.nrows <= h.capacity;
+}
+
+bool series_last_ts(const std::string& csv_path, int64_t& last_ts, size_t* nrows) {
+  if (!ensure_bars_for_csv(csv_path)) return false;
+  int fd = ::open(bars_path_for(csv_path).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  BarsHeader h;
+  bool ok = read_header_fd(fd, h) && h.nrows > 0 &&
+            ::pread(fd, &last_ts, 8, (off_t)(sizeof(BarsHeader) + (h.nrows - 1) * 8)) == 8;
+  ::close(fd);
+  if (ok && nrows) *nrows = (size_t)h.nrows;
+  return ok;
+}
+
+static SeriesMeta meta_from_mapped(const MappedBars& mb, const std::string& bars_path) {
+  const double* cols[6];
+  for (int k = 0; k < 6; ++k) cols[k] = mb.col(k).data();
+  return meta_compute(mb.ts().data(), cols, mb.size(), mb.has_turnover(), frame_ms_for(bars_path));
+}
+
+bool series_meta(const std::string& csv_path, SeriesMeta& out) {
+  if (!ensure_bars_for_csv(csv_path)) return false;
+  const std::string bars_path = bars_path_for(csv_path);
+  const std::string mp = meta_path_from_bars(bars_path);
+
+  BarsHeader h;
+  int fd = ::open(bars_path.c_str(), O_RDONLY | O_CLOEXEC);
+  const bool hdr = fd >= 0 && read_header_fd(fd, h);
+  if (fd >= 0) ::close(fd);
+  if (hdr && meta_read(mp, out) && out.rows == h.nrows && file_mtime_ns(mp) >= file_mtime_ns(bars_path))
+    return true;
+
+  // сайдкара нет или он отстал (старый формат, внешняя правка .bars) — один пересчёт
+  auto mb = open_bars_for_csv(csv_path);
+  if (!mb) return false;
+  SeriesMeta old{};
+  const bool had = meta_read(mp, old);
+  out = meta_from_mapped(*mb, bars_path);
+  if (had) { out.dups = old.dups; out.skipped = old.skipped; }
+  meta_write(mp, out);
+  return true;
+}
+
+// После дозаписи на месте: хэш/разрывы/границы/min_step_ms обновляются по добавленным строкам;
+// если сайдкар не соответствует состоянию до дозаписи (или шаг взят из данных и уменьшился) — пересчёт.
+static void meta_after_append(const std::string& bars_path, uint64_t old_rows, int64_t last_ts,
+                              bool replace_last, const double old_last[6], const BarRows& add) {
+  const std::string mp = meta_path_from_bars(bars_path);
+  SeriesMeta m{};
+  bool inc = meta_read(mp, m) && m.rows == old_rows && m.ts_max == last_ts && m.step_ms > 0;
+  const bool by_frame = inc && frame_ms_for(bars_path) == m.step_ms;
+  int64_t prev = last_ts;
+  if (inc) {
+    if (replace_last) m.hash -= row_hash(last_ts, old_last);
+    for (size_t i = 0; i < add.size() && inc; ++i) {
+      const double v[6] = {add.cols[0][i], add.cols[1][i], add.cols[2][i], add.cols[3][i], add.cols[4][i], add.cols[5][i]};
+      m.hash += row_hash(add.ts[i], v);
+      if (add.ts[i] <= prev) continue;
+      const int64_t d = add.ts[i] - prev;
+      if (d < m.step_ms && !by_frame) { inc = false; break; }
+      if (m.min_step_ms <= 0 || d < m.min_step_ms) m.min_step_ms = d;
+      if (d > m.step_ms) { ++m.gaps; m.missing += (uint64_t)((d - 1) / m.step_ms); }
+      prev = add.ts[i];
+    }
+  }
+  if (inc) {
+    m.rows = old_rows - (replace_last ? 1 : 0) + add.size();
+    m.ts_max = prev;
+    m.written_ms = unix_ms_now();
+  } else {
+    MappedBars mb;
+    if (!mb.open(bars_path)) return;
+    const SeriesMeta old = m;
+    m = meta_from_mapped(mb, bars_path);
+    if (std::memcmp(old.magic, META_MAGIC, 8) == 0) { m.dups = old.dups; m.skipped = old.skipped; }
+  }
+  if (!meta_write(mp, m)) std::cerr << "[BARS] meta write failed: " << bars_path << std::endl;
+}
+
+// Хвост CSV-зеркала: убрать последнюю строку (если это бар last_ts) и дописать строки.
+// false — зеркало не похоже на серию (внешняя правка), нужна полная перезапись.
+static bool csv_mirror_append(const std::string& csv_path, const BarRows& add, bool replace_last, int64_t last_ts) {
+  int fd = ::open(csv_path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+  off_t size = st.st_size;
+
+  // последняя строка: ищем '\n' перед ней в хвосте файла
+  char tail[512];
+  const off_t from = size > (off_t)sizeof(tail) ? size - (off_t)sizeof(tail) : 0;
+  const ssize_t got = ::pread(fd, tail, (size_t)(size - from), from);
+  if (got != size - from) { ::close(fd); return false; }
+  ssize_t e = got;
+  while (e > 0 && (tail[e - 1] == '\n' || tail[e - 1] == '\r')) --e;
+  ssize_t b = e;
+  while (b > 0 && tail[b - 1] != '\n') --b;
+  if (b == 0 && from > 0) { ::close(fd); return false; }   // строка длиннее буфера
+
+  int64_t ts_last_line = 0;
+  const bool parsed = std::from_chars(tail + b, tail + e, ts_last_line).ec == std::errc();
+  if (!parsed || ts_last_line != last_ts) { ::close(fd); return false; }
+
+  std::string s;
+  if (replace_last) {
+    size = from + b;                                   // срезаем строку формировавшегося бара
+  } else if (got > 0 && tail[got - 1] != '\n') {
+    s.push_back('\n');
+  }
+  s.reserve(s.size() + add.size() * 96);
+  char buf[32];
+  const int ncol = add.has_turnover ? 6 : 5;
+  for (size_t i = 0; i < add.size(); ++i) {
+    auto r = std::to_chars(buf, buf + sizeof(buf), (long long)add.ts[i]);
+    s.append(buf, r.ptr);
+    for (int k = 0; k < ncol; ++k) { s.push_back(','); append_num(s, add.cols[k][i]); }
+    s.push_back('\n');
+  }
+  bool ok = ::ftruncate(fd, size) == 0 &&
+            ::pwrite(fd, s.data(), s.size(), size) == (ssize_t)s.size();
+  ::close(fd);
+  return ok;
+}
+
+static bool append_rewrite(const std::string& csv_path, const BarRows& add, AppendStats* st) {
+  BarRows merged;
+  load_series(csv_path, merged);
+  const size_t n0 = merged.size();
+  merge_bars(merged, add);
+  if (st) {
+    st->rewritten = true;
+    st->rows      = merged.size();
+    st->appended  = merged.size() - n0;
+    st->replaced  = add.size() - st->appended;
+  }
+  return store_series(csv_path, merged);
+}
+
+bool append_series(const std::string& csv_path, const BarRows& tail_in, AppendStats* st) {
+  AppendStats local;
+  if (!st) st = &local;
+  *st = AppendStats{};
+  if (tail_in.empty()) { int64_t t = 0; series_last_ts(csv_path, t, &st->rows); return true; }
+
+  BarRows tail = tail_in;
+  sort_dedup(tail);
+
+  std::lock_guard<std::mutex> lk(G_APPEND_MU);
+  const std::string bars_path = bars_path_for(csv_path);
+  if (!ensure_bars_for_csv(csv_path)) return append_rewrite(csv_path, tail, st);
+
+  int fd = ::open(bars_path.c_str(), O_RDWR | O_CLOEXEC);
+  BarsHeader h;
+  if (fd < 0 || !read_header_fd(fd, h) || h.nrows == 0) {
+    if (fd >= 0) ::close(fd);
+    return append_rewrite(csv_path, tail, st);
+  }
+  int64_t last_ts = 0;
+  if (::pread(fd, &last_ts, 8, (off_t)(sizeof(BarsHeader) + (h.nrows - 1) * 8)) != 8) {
+    ::close(fd);
+    return append_rewrite(csv_path, tail, st);
+  }
+
+  // эффективный хвост: ts >= last_ts
+  const size_t k0 = (size_t)(std::lower_bound(tail.ts.begin(), tail.ts.end(), last_ts) - tail.ts.begin());
+  st->ignored = k0;
+  if (k0 == tail.size()) { ::close(fd); st->rows = (size_t)h.nrows; return true; }
+  BarRows add;
+  add.has_turnover = tail.has_turnover;
+  add.reserve(tail.size() - k0);
+  for (size_t i = k0; i < tail.size(); ++i)
+    add.push_back(tail.ts[i], tail.cols[0][i], tail.cols[1][i], tail.cols[2][i], tail.cols[3][i], tail.cols[4][i], tail.cols[5][i]);
+
+  const bool replace_last = add.ts.front() == last_ts;
+  const size_t start = (size_t)h.nrows - (replace_last ? 1 : 0);
+  const size_t new_n = start + add.size();
+  const bool file_turnover = (h.flags & BARS_F_TURNOVER) != 0;
+  // формат зеркала и запас capacity должны позволять дозапись на месте
+  if (new_n > h.capacity || (add.has_turnover && !file_turnover)) {
+    ::close(fd);
+    return append_rewrite(csv_path, add, st);
+  }
+  add.has_turnover = file_turnover;
+
+  // сначала CSV (если есть), потом .bars — mtime(.bars) >= mtime(csv), переимпорта не будет
+  if (file_mtime_ns(csv_path) >= 0 && !csv_mirror_append(csv_path, add, replace_last, last_ts)) {
+    ::close(fd);
+    return append_rewrite(csv_path, add, st);
+  }
+
+  // значения заменяемого бара — для хэша в .meta
+  double old_last[6] = {0, 0, 0, 0, 0, 0};
+  if (replace_last)
+    for (int k = 0; k <= BAR_TURNOVER; ++k)
+      (void)::pread(fd, &old_last[k], 8, (off_t)(sizeof(BarsHeader) + ((size_t)(k + 1) * h.capacity + start) * 8));
+
+  // колонки пишем до заголовка: новый читатель не увидит nrows раньше данных.
+  // Замена последнего бара — pwrite поверх строки, которую читатель через MAP_SHARED
+  // может копировать в этот момент: такой читатель получит последнюю строку «наполовину»
+  // (часть колонок старые, часть новые). Окно — время pwrite одной строки; строки до
+  // start не трогаются. Бар всё равно формирующийся, следующее чтение увидит целый.
+  bool ok = ::pwrite(fd, add.ts.data(), add.size() * 8,
+                     (off_t)(sizeof(BarsHeader) + start * 8)) == (ssize_t)(add.size() * 8);
+  for (int k = 0; k <= BAR_TURNOVER && ok; ++k) {
+    const off_t off = (off_t)(sizeof(BarsHeader) + ((size_t)(k + 1) * h.capacity + start) * 8);
+    ok = ::pwrite(fd, add.cols[k].data(), add.size() * 8, off) == (ssize_t)(add.size() * 8);
+  }
+  const uint64_t nrows = new_n;
+  ok = ok && ::pwrite(fd, &nrows, sizeof(nrows), (off_t)offsetof(BarsHeader, nrows)) == (ssize_t)sizeof(nrows);
+  ::close(fd);
+  if (!ok) {
+    std::cerr << "[BARS] in-place append failed: " << bars_path << std::endl;
+    invalidate_cached_bars_path(csv_path);
+    return append_rewrite(csv_path, add, st);
+  }
+
+  meta_after_append(bars_path, h.nrows, last_ts, replace_last, old_last, add);
+
+  st->replaced = replace_last ? 1 : 0;
+  st->appended = add.size() - st->replaced;
+  st->rows     = new_n;
+  bar_cache_append(csv_path, add, last_ts, (size_t)h.nrows);
+  return true;
+}
+
+bool compact_series(const std::string& csv_path, int64_t since_ms, size_t* dropped) {
+  std::lock_guard<std::mutex> lk(G_APPEND_MU);
+  BarRows rows;
+  if (!load_series(csv_path, rows)) return false;
+  const size_t n0 = rows.size();
+  trim_bars_before(rows, since_ms);
+  if (dropped) *dropped = n0 - rows.size();
+  if (rows.size() == n0) return true;
+  return store_series(csv_path, rows);
+}
+
+// ---------------------------------------------------------------------------
+// merge / trim
+// ---------------------------------------------------------------------------
+void merge_bars(BarRows& base, const BarRows& add_in) {
+  if (add_in.empty()) return;
+  // пачки с биржи могут перекрываться — приводим add к строгому порядку
+  BarRows add_sorted;
+  bool add_ok = true;
+  for (size_t k = 1; k < add_in.size(); ++k) if (add_in.ts[k] <= add_in.ts[k-1]) { add_ok = false; break; }
+  if (!add_ok) { add_sorted = add_in; sort_dedup(add_sorted); }
+  const BarRows& add = add_ok ? add_in : add_sorted;
+  BarRows out;
+  out.has_turnover = base.has_turnover || add.has_turnover;
+  out.reserve(base.size() + add.size());
+  size_t i = 0, j = 0;
+  auto take = [&](const BarRows& r, size_t k) {
+    out.push_back(r.ts[k], r.cols[0][k], r.cols[1][k], r.cols[2][k], r.cols[3][k], r.cols[4][k], r.cols[5][k]);
+  };
+  while (i < base.size() || j < add.size()) {
+    if (j >= add.size())                 { take(base, i++); }
+    else if (i >= base.size())           { take(add, j++); }
+    else if (base.ts[i] < add.ts[j])     { take(base, i++); }
+    else if (add.ts[j] < base.ts[i])     { take(add, j++); }
+    else                                 { take(add, j++); ++i; }
+  }
+  base = std::move(out);
+}
+
+void trim_bars_before(BarRows& rows, int64_t since_ms) {
+  auto it = std::lower_bound(rows.ts.begin(), rows.ts.end(), since_ms);
+  const size_t k = (size_t)(it - rows.ts.begin());
+  if (k == 0) return;
+  rows.ts.erase(rows.ts.begin(), rows.ts.begin() + k);
+  for (auto& c : rows.cols) c.erase(c.begin(), c.begin() + k);
+}
+
+} // namespace etai
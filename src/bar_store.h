@@ -0,0 +1,192 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace etai {
+
+// ============================================================================
+// Бинарное колоночное хранилище баров (одна серия = symbol+interval).
+//   Файл: рядом с CSV, расширение .bars (cache/BTCUSDT_15.bars, cache/clean/...).
+//   Формат: заголовок 64 байта, затем колонки длиной capacity:
+//     ts[int64] | open | high | low | close | volume | turnover  [float64]
+//   capacity >= nrows — запас под дозапись без перекладки колонок.
+// CSV остаётся зеркалом для скриптов (clean/fill_gaps/wc -l); если CSV новее
+// .bars (его переписал внешний скрипт) — серия переимпортируется один раз.
+// ============================================================================
+
+constexpr uint32_t BARS_VERSION    = 1;
+constexpr uint32_t BARS_NCOLS      = 7;     // ts + 6×float64
+constexpr uint32_t BARS_F_TURNOVER = 1u;    // в исходном CSV была 7-я колонка
+
+enum BarCol : int {
+  BAR_OPEN = 0, BAR_HIGH = 1, BAR_LOW = 2, BAR_CLOSE = 3, BAR_VOLUME = 4, BAR_TURNOVER = 5
+};
+
+struct BarsHeader {
+  char     magic[8];      // "ETAIBARS"
+  uint32_t version;
+  uint32_t ncols;
+  uint64_t nrows;
+  uint64_t capacity;
+  uint32_t flags;
+  uint32_t reserved0;
+  uint64_t reserved[3];
+};
+static_assert(sizeof(BarsHeader) == 64, "BarsHeader must be 64 bytes");
+
+// Владеющий колоночный буфер (merge/запись)
+struct BarRows {
+  std::vector<int64_t> ts;
+  std::vector<double>  cols[6];   // индексы — BarCol
+  bool has_turnover = false;
+
+  size_t size()  const { return ts.size(); }
+  bool   empty() const { return ts.empty(); }
+  void reserve(size_t n) { ts.reserve(n); for (auto& c : cols) c.reserve(n); }
+  void clear() { ts.clear(); for (auto& c : cols) c.clear(); }
+  void push_back(int64_t t, double o, double h, double l, double c, double v, double to = 0.0) {
+    ts.push_back(t);
+    cols[BAR_OPEN].push_back(o);  cols[BAR_HIGH].push_back(h);
+    cols[BAR_LOW].push_back(l);   cols[BAR_CLOSE].push_back(c);
+    cols[BAR_VOLUME].push_back(v); cols[BAR_TURNOVER].push_back(to);
+  }
+};
+
+// Невладеющий вид на колонку (zero-copy поверх mmap)
+template<class T>
+struct ColView {
+  const T* ptr = nullptr;
+  size_t   n   = 0;
+  size_t   size()  const { return n; }
+  bool     empty() const { return n == 0; }
+  const T* data()  const { return ptr; }
+  const T* begin() const { return ptr; }
+  const T* end()   const { return ptr + n; }
+  const T& operator[](size_t i) const { return ptr[i]; }
+  const T& back() const { return ptr[n - 1]; }
+};
+
+// mmap-представление .bars (только чтение)
+class MappedBars {
+public:
+  MappedBars() = default;
+  ~MappedBars();
+  MappedBars(const MappedBars&) = delete;
+  MappedBars& operator=(const MappedBars&) = delete;
+  MappedBars(MappedBars&& o) noexcept;
+  MappedBars& operator=(MappedBars&& o) noexcept;
+
+  bool open(const std::string& path, std::string* err = nullptr);
+  void close();
+
+  bool   is_open()      const { return base_ != nullptr; }
+  size_t size()         const { return n_; }
+  size_t capacity()     const { return cap_; }
+  bool   has_turnover() const { return (flags_ & BARS_F_TURNOVER) != 0; }
+  const std::string& path() const { return path_; }
+
+  ColView<int64_t> ts() const;
+  ColView<double>  col(int k) const;   // k — BarCol
+
+  int64_t first_ts() const { return n_ ? ts()[0] : 0; }
+  int64_t last_ts()  const { return n_ ? ts().back() : 0; }
+
+private:
+  void*       base_  = nullptr;
+  size_t      len_   = 0;
+  size_t      n_     = 0;
+  size_t      cap_   = 0;
+  uint32_t    flags_ = 0;
+  std::string path_;
+};
+
+// cache/X_15.csv → cache/X_15.bars
+std::string bars_path_for(const std::string& csv_path);
+
+// CSV (6/7 колонок, допускается заголовок) → колонки; сортировка + дедуп по ts (последний выигрывает)
+bool parse_csv_bars(const std::string& csv_path, BarRows& out, size_t* skipped = nullptr,
+                    size_t* duplicates = nullptr);
+
+// Атомарная запись .bars (tmp + rename), читатели со старым mmap не страдают
+bool write_bars(const std::string& bars_path, const BarRows& rows);
+bool read_bars(const std::string& bars_path, BarRows& out);
+
+// CSV-зеркало (кратчайшее точное представление чисел)
+bool write_csv_mirror(const std::string& csv_path, const BarRows& rows);
+
+// Однократный импорт: .bars нет или он старше CSV → пересобрать из CSV
+bool ensure_bars_for_csv(const std::string& csv_path, size_t* skipped = nullptr, std::string* err = nullptr);
+
+// Открыть серию по пути CSV (импорт по необходимости + mmap). nullptr — серии нет.
+std::shared_ptr<MappedBars> open_bars_for_csv(const std::string& csv_path, size_t* skipped = nullptr);
+
+// Прочитать серию целиком в буфер / сохранить (.bars + CSV-зеркало)
+bool load_series(const std::string& csv_path, BarRows& out, size_t* skipped = nullptr);
+bool store_series(const std::string& csv_path, const BarRows& rows);
+
+// Окно серии по времени [ts_from, ts_to] (включительно) / последние n баров:
+// бинарный поиск по ts в .bars, копируется только окно. Если .bars не создать —
+// обратный проход по CSV-зеркалу от конца файла (до первого бара старше окна).
+bool load_series_range(const std::string& csv_path, int64_t ts_from, int64_t ts_to, BarRows& out);
+bool load_series_tail(const std::string& csv_path, size_t n, BarRows& out);
+
+// Последний ts серии (заголовок + одна ячейка .bars, без чтения колонок). false — серии нет.
+bool series_last_ts(const std::string& csv_path, int64_t& last_ts, size_t* nrows = nullptr);
+
+// Дозапись хвоста: бары с ts > последнего дописываются в запас capacity .bars и в конец
+// CSV-зеркала, бар с ts == последнему (формировавшийся) заменяется, более ранние — игнорируются.
+// Если на месте нельзя (кончился capacity, нет серии, сменился формат) — merge + полная перезапись.
+// Замена последнего бара идёт pwrite на месте: mmap-читатель, копирующий серию в этот
+// момент, может получить эту одну строку смешанной (старые/новые колонки).
+struct AppendStats { size_t appended = 0; size_t replaced = 0; size_t ignored = 0; bool rewritten = false; size_t rows = 0; };
+bool append_series(const std::string& csv_path, const BarRows& tail, AppendStats* st = nullptr);
+
+// Компакция: отбросить бары с ts < since_ms и переписать серию целиком (редкая операция)
+bool compact_series(const std::string& csv_path, int64_t since_ms, size_t* dropped = nullptr);
+
+// ---------------------------------------------------------------------------
+// Метаданные серии — сайдкар .meta рядом с .bars (cache/X_15.meta), 128 байт.
+// Обновляется при каждой записи (полная запись, импорт CSV, дозапись на месте),
+// поэтому health/status/diagnostic отвечают за O(1), не читая CSV и колонки.
+// hash — сумма хэшей строк (ts + 6 колонок): дозапись/замена последнего бара
+// обновляют его без пересчёта всей серии.
+// ---------------------------------------------------------------------------
+struct SeriesMeta {
+  char     magic[8];      // "ETAIMETA"
+  uint32_t version;
+  uint32_t cols;          // колонок CSV-зеркала: 6 (ts,o,h,l,c,v) или 7 (+turnover)
+  uint64_t rows;
+  int64_t  ts_min, ts_max;
+  int64_t  step_ms;       // шаг таймфрейма серии (из имени файла X_15 → 900000);
+                          // ТФ не распознан — наименьший положительный шаг ts
+  uint64_t gaps;          // разрывов (шаг > step_ms)
+  uint64_t missing;       // недостающих баров в разрывах
+  uint64_t dups;          // дублей ts, отброшенных при последнем импорте CSV
+  uint64_t skipped;       // битых строк CSV при последнем импорте
+  int64_t  written_ms;    // время последней записи (unix ms)
+  uint64_t hash;          // хэш содержимого
+  int64_t  min_step_ms;   // наименьший положительный шаг ts — диагностика (< step_ms — бары вне сетки)
+  uint64_t reserved[3];
+};
+static_assert(sizeof(SeriesMeta) == 128, "SeriesMeta must be 128 bytes");
+
+// cache/X_15.csv → cache/X_15.meta
+std::string meta_path_for(const std::string& csv_path);
+
+// Слагаемое SeriesMeta::hash для одной строки (v — колонки BarCol): хэш диапазона строк
+// серии = meta.hash − сумма по остальным строкам
+uint64_t series_row_hash(int64_t ts, const double v[6]);
+
+// Метаданные серии: сайдкар, а если его нет / он отстал от .bars — один пересчёт
+// по колонкам и запись. false — серии нет.
+bool series_meta(const std::string& csv_path, SeriesMeta& out);
+
+// merge по ts: строки add заменяют совпадающие; результат отсортирован
+void merge_bars(BarRows& base, const BarRows& add);
+// отбросить бары с ts < since_ms
+void trim_bars_before(BarRows& rows, int64_t since_ms);
+
+} // namespace etai
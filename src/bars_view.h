@@ -0,0 +1,121 @@
+#pragma once
+#include <armadillo>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bar_store.h"
+
+namespace etai {
+
+// ============================================================================
+// Невладеющие виды на серию баров (structure-of-arrays).
+//   DSpan    — колонка double (указатель + длина): std::vector, ColView .bars,
+//              колонка N×6 матрицы — без копии.
+//   BarsView — ts + open/high/low/close/volume одной серии поверх источника:
+//              N×6 матрицы (bar_cache / хранилище признаков), BarRows, mmap .bars.
+// Серия материализуется один раз (кэш / загрузчик), дальше по конвейеру
+// (индикаторы, признаки, контекст, Money Flow, тренер) ходят только виды.
+// Вид не продлевает жизнь источника: держать владельца (BarMatrixPtr и т.п.)
+// столько, сколько используется вид.
+// ============================================================================
+
+struct DSpan {
+  const double* ptr = nullptr;
+  size_t        n   = 0;
+
+  DSpan() = default;
+  DSpan(const double* p, size_t len) : ptr(p), n(len) {}
+  DSpan(const std::vector<double>& v) : ptr(v.data()), n(v.size()) {}
+  DSpan(const ColView<double>& c) : ptr(c.data()), n(c.size()) {}
+
+  size_t        size()  const { return n; }
+  bool          empty() const { return n == 0; }
+  const double* data()  const { return ptr; }
+  const double* begin() const { return ptr; }
+  const double* end()   const { return ptr + n; }
+  const double& operator[](size_t i) const { return ptr[i]; }
+  const double& back() const { return ptr[n - 1]; }
+  DSpan subspan(size_t off, size_t cnt) const { return DSpan(ptr + off, cnt); }
+};
+
+struct BarsView {
+  const int64_t* ts_i = nullptr;   // ts из .bars / BarRows
+  const double*  ts_d = nullptr;   // ts из колонки 0 матрицы N×6
+  DSpan open, high, low, close, volume;
+
+  size_t size()  const { return close.size(); }
+  bool   empty() const { return close.empty(); }
+
+  // ts бара i (мс); серия без времени (make_features) → 0
+  int64_t ts(size_t i) const {
+    return ts_i ? ts_i[i] : (ts_d ? static_cast<int64_t>(ts_d[i]) : 0);
+  }
+
+  // Подсерия [from, from+count) — те же указатели со сдвигом
+  BarsView slice(size_t from, size_t count) const {
+    BarsView v;
+    if (from > size()) from = size();
+    if (count > size() - from) count = size() - from;
+    v.ts_i = ts_i ? ts_i + from : nullptr;
+    v.ts_d = ts_d ? ts_d + from : nullptr;
+    v.open   = open.subspan(from, count);
+    v.high   = high.subspan(from, count);
+    v.low    = low.subspan(from, count);
+    v.close  = close.subspan(from, count);
+    v.volume = volume.subspan(from, count);
+    return v;
+  }
+  BarsView slice(size_t from) const { return slice(from, size() > from ? size() - from : 0); }
+};
+
+// N×6 (ts,open,high,low,close,vol), column-major — колонки матрицы напрямую.
+// Меньше 6 колонок → пустой вид.
+inline BarsView bars_view(const arma::mat& M) {
+  BarsView v;
+  if (M.n_cols < 6 || M.n_rows == 0) return v;
+  const size_t n = M.n_rows;
+  v.ts_d   = M.colptr(0);
+  v.open   = DSpan(M.colptr(1), n);
+  v.high   = DSpan(M.colptr(2), n);
+  v.low    = DSpan(M.colptr(3), n);
+  v.close  = DSpan(M.colptr(4), n);
+  v.volume = DSpan(M.colptr(5), n);
+  return v;
+}
+
+inline BarsView bars_view(const BarRows& r) {
+  BarsView v;
+  v.ts_i   = r.ts.data();
+  v.open   = r.cols[BAR_OPEN];
+  v.high   = r.cols[BAR_HIGH];
+  v.low    = r.cols[BAR_LOW];
+  v.close  = r.cols[BAR_CLOSE];
+  v.volume = r.cols[BAR_VOLUME];
+  return v;
+}
+
+inline BarsView bars_view(const MappedBars& mb) {
+  BarsView v;
+  v.ts_i   = mb.ts().data();
+  v.open   = mb.col(BAR_OPEN);
+  v.high   = mb.col(BAR_HIGH);
+  v.low    = mb.col(BAR_LOW);
+  v.close  = mb.col(BAR_CLOSE);
+  v.volume = mb.col(BAR_VOLUME);
+  return v;
+}
+
+// Материализация вида в N×6 (единственная копия серии — для владельца-матрицы)
+inline arma::mat bars_matrix(const BarsView& v) {
+  const size_t n = v.size();
+  arma::mat M(n, 6);
+  double* t = M.colptr(0);
+  for (size_t i = 0; i < n; ++i) t[i] = static_cast<double>(v.ts(i));
+  const DSpan* cols[5] = {&v.open, &v.high, &v.low, &v.close, &v.volume};
+  for (int k = 0; k < 5; ++k)
+    if (n) std::copy(cols[k]->begin(), cols[k]->end(), M.colptr(k + 1));
+  return M;
+}
+
+} // namespace etai
@@ -1,9 +1,38 @@
 #pragma once
 #include <vector>
+#include <cmath>
+#include <algorithm>
 #include "json.hpp"
+#include "bars_view.h"
+#include "features/simd_kernels.h"
 
 namespace etai {
 
+// --- Поточечные правила контекста (общие для batch и потокового расчёта) ---
+inline double ctx_safe_div(double a, double b){
+    if(!std::isfinite(a) || !std::isfinite(b) || std::fabs(b) < 1e-12) return 0.0;
+    return a/b;
+}
+
+inline int ctx_pick_phase(double energy, double liquidity, double body_rel_atr, double body_sign){
+    if(energy > 1.1 && liquidity > 0.6 && body_rel_atr > 0.25) return 1; // expansion
+    if(energy > 1.0 && liquidity > 0.6 && body_rel_atr > 0.15 && std::fabs(body_sign) < 0.3) return 2; // distribution
+    if(energy > 0.9 && body_sign < 0.0) return 3; // correction
+    return 0; // accumulation
+}
+
+// tanh и час — те же, что у векторных ядер vk::candle_sentiment / vk::session_cycle (batch)
+inline double ctx_candle_sentiment(double open, double close, double atr){
+    double body = close - open;
+    double denom = std::max(1e-6, atr);
+    return vk::tanh1(body / denom);
+}
+
+// sin/cos 2π·hour/24 (таблица по часу)
+inline void ctx_session_cycle(long long ts_ms, double& s, double& c){
+    vk::session1(ts_ms, s, c);
+}
+
 // Контекст рынка для текущей свечи
 struct ContextPoint {
     double energy;        // ATR / SMA(ATR,14)
@@ -24,20 +53,16 @@ struct ContextSeries {
     std::vector<int>    phase;
 };
 
-// Основной расчёт контекста (без таймзоны — работаем по Unix-ts в ms)
-ContextSeries compute_context(const std::vector<long long>& ts_ms,
-                              const std::vector<double>& open,
-                              const std::vector<double>& high,
-                              const std::vector<double>& low,
-                              const std::vector<double>& close,
-                              const std::vector<double>& volume);
+class IndicatorGraph;
+
+// Контекст по графу индикаторов серии (ATR14, SMA(ATR14), max объёма — общие узлы графа)
+ContextSeries compute_context(IndicatorGraph& g);
+
+// Основной расчёт контекста по виду серии (без таймзоны — работаем по Unix-ts в ms)
+// phase — абсолютный индекс первого бара, если передан хвост ряда (см. rolling_kernels.h)
+ContextSeries compute_context(const BarsView& bars, size_t phase = 0);
 
 // Упаковка последних значений в JSON для диагностики
-nlohmann::json context_tail_to_json(const std::vector<long long>& ts_ms,
-                                    const std::vector<double>& open,
-                                    const std::vector<double>& high,
-                                    const std::vector<double>& low,
-                                    const std::vector<double>& close,
-                                    const std::vector<double>& volume);
+nlohmann::json context_tail_to_json(const BarsView& bars);
 
 } // namespace etai
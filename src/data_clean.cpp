@@ -0,0 +1,129 @@
+#include "data_clean.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace etai {
+
+using json = nlohmann::json;
+
+std::vector<BarGap> find_gaps(const int64_t* ts, size_t n, int64_t step_ms, size_t* missing) {
+  std::vector<BarGap> gaps;
+  size_t total = 0;
+  if (step_ms > 0) {
+    for (size_t i = 1; i < n; ++i) {
+      const int64_t d = ts[i] - ts[i - 1];
+      if (d <= step_ms) continue;
+      BarGap g;
+      g.from_ts = ts[i - 1] + step_ms;
+      g.to_ts   = ts[i] - step_ms;
+      g.missing = (size_t)((d - 1) / step_ms);   // шаг не кратен — неполный слот тоже пропуск
+      if (g.to_ts < g.from_ts) g.to_ts = g.from_ts;
+      total += g.missing;
+      gaps.push_back(g);
+    }
+  }
+  if (missing) *missing = total;
+  return gaps;
+}
+
+void clean_bars(BarRows& rows, int64_t step_ms, CleanReport* rep) {
+  CleanReport local;
+  CleanReport& r = rep ? *rep : local;
+  r = CleanReport{};
+  const auto t0 = std::chrono::steady_clock::now();
+  const size_t n = rows.size();
+  r.rows_in = n;
+
+  // порядок: обычно вход уже отсортирован — тогда без перестановки
+  std::vector<size_t> order;
+  for (size_t i = 1; i < n; ++i) if (rows.ts[i] < rows.ts[i - 1]) ++r.out_of_order;
+  if (r.out_of_order) {
+    order.resize(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return rows.ts[a] < rows.ts[b]; });
+  }
+
+  // компактный проход: запись на место w (при сортировке — в новый буфер)
+  BarRows out;
+  BarRows& dst = r.out_of_order ? out : rows;
+  if (r.out_of_order) { out.has_turnover = rows.has_turnover; out.reserve(n); }
+  size_t w = 0;
+  auto put = [&](size_t i) {
+    if (r.out_of_order) {
+      dst.push_back(rows.ts[i], rows.cols[0][i], rows.cols[1][i], rows.cols[2][i],
+                    rows.cols[3][i], rows.cols[4][i], rows.cols[5][i]);
+    } else {
+      dst.ts[w] = rows.ts[i];
+      for (int k = 0; k < 6; ++k) dst.cols[k][w] = rows.cols[k][i];
+    }
+    ++w;
+  };
+  auto last_ts = [&]() { return dst.ts[w - 1]; };
+  auto replace_last = [&](size_t i) {
+    --w;
+    if (r.out_of_order) { dst.ts.pop_back(); for (auto& c : dst.cols) c.pop_back(); }
+    put(i);
+  };
+
+  for (size_t k = 0; k < n; ++k) {
+    const size_t i = r.out_of_order ? order[k] : k;
+    const int64_t t = rows.ts[i];
+    const double o = rows.cols[BAR_OPEN][i], h = rows.cols[BAR_HIGH][i], l = rows.cols[BAR_LOW][i];
+    const double c = rows.cols[BAR_CLOSE][i], v = rows.cols[BAR_VOLUME][i];
+
+    if (t <= 0) { ++r.bad_ts; continue; }
+    if (!std::isfinite(o) || !std::isfinite(h) || !std::isfinite(l) || !std::isfinite(c) || !std::isfinite(v)) {
+      ++r.non_finite; continue;
+    }
+    if (l <= 0.0 || h < std::max(o, c) || l > std::min(o, c) || v < 0.0) { ++r.bad_ohlc; continue; }
+    if (step_ms > 0 && t % step_ms != 0) ++r.misaligned;
+
+    if (w > 0 && last_ts() == t) { ++r.duplicates; replace_last(i); continue; }   // последний выигрывает
+    put(i);
+  }
+
+  if (r.out_of_order) {
+    rows = std::move(out);
+  } else {
+    rows.ts.resize(w);
+    for (auto& col : rows.cols) col.resize(w);
+  }
+  r.rows_out = rows.size();
+  r.gaps = find_gaps(rows.ts.data(), rows.size(), step_ms, &r.missing_bars);
+  r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool clean_series(const std::string& raw_csv, const std::string& clean_csv, int64_t step_ms,
+                  CleanReport* rep) {
+  BarRows rows;
+  if (!load_series(raw_csv, rows)) return false;
+  clean_bars(rows, step_ms, rep);
+  rows.has_turnover = false;       // clean — 6 колонок (ts,o,h,l,c,v), как у clean_from_raw.sh
+  return store_series(clean_csv, rows);
+}
+
+json clean_report_json(const CleanReport& rep, size_t max_gaps) {
+  json gaps = json::array();
+  for (size_t i = 0; i < rep.gaps.size() && i < max_gaps; ++i)
+    gaps.push_back(json{{"from_ts", rep.gaps[i].from_ts}, {"to_ts", rep.gaps[i].to_ts},
+                        {"missing", rep.gaps[i].missing}});
+  return json{
+    {"rows_in", rep.rows_in},
+    {"rows", rep.rows_out},
+    {"duplicates", rep.duplicates},
+    {"out_of_order", rep.out_of_order},
+    {"bad_ts", rep.bad_ts},
+    {"non_finite", rep.non_finite},
+    {"bad_ohlc", rep.bad_ohlc},
+    {"misaligned", rep.misaligned},
+    {"gap_count", rep.gaps.size()},
+    {"missing_bars", rep.missing_bars},
+    {"gaps", gaps},
+    {"ms", rep.ms}
+  };
+}
+
+} // namespace etai
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "bar_store.h"
+
+namespace etai {
+
+// ============================================================================
+// Очистка серии в процессе (вместо clean_from_raw.sh / awk / wc -l):
+//   один проход: порядок ts (сортировка — только если он нарушен), дубли
+//   (последний выигрывает), проверка бара — ts > 0, конечные числа,
+//   low ≤ min(open, close), high ≥ max(open, close), low > 0, volume ≥ 0.
+//   Битые бары отбрасываются, пропуски шага собираются в индекс BarGap.
+// Результат пишется как cache/clean/<SYM>_<TF> (.bars + CSV из 6 колонок, как у скрипта).
+// ============================================================================
+
+// Пропуск: from_ts..to_ts — первый и последний отсутствующие бары
+struct BarGap {
+  int64_t from_ts = 0;
+  int64_t to_ts   = 0;
+  size_t  missing = 0;
+};
+
+struct CleanReport {
+  size_t rows_in = 0, rows_out = 0;
+  size_t duplicates = 0;
+  size_t out_of_order = 0;        // нарушений порядка во входе
+  size_t bad_ts = 0, non_finite = 0, bad_ohlc = 0;
+  size_t misaligned = 0;          // ts не кратен шагу (только счётчик — бар остаётся)
+  std::vector<BarGap> gaps;
+  size_t missing_bars = 0;
+  double ms = 0.0;
+};
+
+// Индекс пропусков по отсортированному ts с шагом step_ms
+std::vector<BarGap> find_gaps(const int64_t* ts, size_t n, int64_t step_ms, size_t* missing = nullptr);
+
+// На месте: порядок/дубли/проверка + индекс пропусков в rep
+void clean_bars(BarRows& rows, int64_t step_ms, CleanReport* rep = nullptr);
+
+// raw_csv → clean_csv (серии .bars). false — нет исходной серии / не записалось.
+bool clean_series(const std::string& raw_csv, const std::string& clean_csv, int64_t step_ms,
+                  CleanReport* rep = nullptr);
+
+// max_gaps — сколько пропусков перечислить (остальные — только в счётчиках)
+nlohmann::json clean_report_json(const CleanReport& rep, size_t max_gaps = 50);
+
+} // namespace etai
@@ -0,0 +1,318 @@
+#include "feature_store.h"
+#include "bar_archive.h"
+#include "bar_store.h"
+#include "bars_view.h"
+#include "utils_data.h"
+#include "features/features.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace etai {
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+static constexpr char   FEAT_MAGIC[8]  = {'E','T','A','I','F','E','A','T'};
+static constexpr size_t FEAT_CAP_ALIGN = 4096;     // строк; запас под дозапись
+
+static std::atomic<unsigned long long> g_feat_hits{0}, g_feat_extends{0}, g_feat_rebuilds{0}, g_feat_rows{0};
+static std::atomic<unsigned long long> G_FEAT_TMP_SEQ{0};
+
+// Замок на файл хранилища: запросы по разным сериям не ждут друг друга
+static std::mutex& feat_path_mu(const std::string& path) {
+  static std::mutex mu;
+  static std::unordered_map<std::string, std::unique_ptr<std::mutex>> by_path;
+  std::lock_guard<std::mutex> lk(mu);
+  auto& m = by_path[path];
+  if (!m) m = std::make_unique<std::mutex>();
+  return *m;
+}
+
+std::string feature_store_path(const std::string& csv_path, int feat_version) {
+  const fs::path p(csv_path);
+  fs::path name = p.filename();
+  name.replace_extension(".f" + std::to_string(feat_version) + ".feat");
+  return (p.parent_path() / "features" / name).string();
+}
+
+// Ключ источника: .meta горячей серии + заголовок архива — без чтения баров
+struct FeatSrcKey {
+  uint64_t hot_rows = 0, hot_hash = 0, arch_rows = 0;
+  int64_t  arch_ts_max = 0, last_ts = 0;
+  bool operator==(const FeatSrcKey& o) const {
+    return hot_rows == o.hot_rows && hot_hash == o.hot_hash && arch_rows == o.arch_rows &&
+           arch_ts_max == o.arch_ts_max && last_ts == o.last_ts;
+  }
+  bool operator!=(const FeatSrcKey& o) const { return !(*this == o); }
+};
+
+static FeatSrcKey feat_src_key(const std::string& csv_path) {
+  FeatSrcKey k;
+  SeriesMeta m{};
+  if (series_meta(csv_path, m)) { k.hot_rows = m.rows; k.hot_hash = m.hash; k.last_ts = m.ts_max; }
+  ArchiveInfo ai;
+  if (archive_info(history_archive_path(csv_path), ai)) {
+    k.arch_rows = ai.rows;
+    k.arch_ts_max = ai.ts_max;
+    if (k.hot_rows == 0) k.last_ts = ai.ts_max;
+  }
+  return k;
+}
+
+// Слагаемое SeriesMeta::hash строки i склейки
+static uint64_t feat_row_hash(const BarRows& rows, size_t i) {
+  const double v[6] = {rows.cols[0][i], rows.cols[1][i], rows.cols[2][i], rows.cols[3][i], rows.cols[4][i], rows.cols[5][i]};
+  return series_row_hash(rows.ts[i], v);
+}
+
+static bool feat_read_header(int fd, FeatStoreHeader& h) {
+  return ::pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+         std::memcmp(h.magic, FEAT_MAGIC, 8) == 0 && h.version == FEAT_STORE_VERSION &&
+         h.nrows <= h.capacity && h.ncols > 0;
+}
+
+static void feat_set_key(FeatStoreHeader& h, const FeatSrcKey& k, uint64_t hot_head) {
+  h.hot_rows = k.hot_rows;
+  h.hot_hash = k.hot_hash;
+  h.hot_head = hot_head;
+  h.arch_rows = k.arch_rows;
+  h.arch_ts_max = k.arch_ts_max;
+  h.last_ts = k.last_ts;
+}
+
+// Первые rows строк всех колонок → F(0..rows-1, :)
+static bool feat_read_rows(int fd, const FeatStoreHeader& h, size_t rows, arma::mat& F) {
+  for (uint32_t k = 0; k < h.ncols; ++k) {
+    const off_t off = (off_t)(sizeof(FeatStoreHeader) + (size_t)k * h.capacity * 8);
+    if (rows && ::pread(fd, F.colptr(k), rows * 8, off) != (ssize_t)(rows * 8)) return false;
+  }
+  return true;
+}
+
+// v10 cum_flow нормируется по всему ряду (calc_cum_flow), поэтому в файле колонка хранится
+// накопленной суммой (flow_ratio − 0.5): новые бары её только продолжают. Нормировка —
+// при чтении, O(N) по одной колонке, в том же порядке операций (бит-в-бит как batch).
+static bool feat_has_cum_flow(int feat_version) {
+  return feature_dim(feat_version) > (size_t)FeatCol::CUM_FLOW;
+}
+
+// строки [from, n) колонки cum_flow ← накопленная сумма; run — значение строки from − 1
+static void cum_flow_to_runs(arma::mat& F, size_t from, double run) {
+  const double* fr = F.colptr((arma::uword)FeatCol::FLOW_RATIO);
+  double* cf = F.colptr((arma::uword)FeatCol::CUM_FLOW);
+  for (size_t i = from; i < F.n_rows; ++i) {
+    run += std::isfinite(fr[i]) ? (fr[i] - 0.5) : 0.0;
+    cf[i] = run;
+  }
+}
+
+static void cum_flow_from_runs(arma::mat& F) {
+  const size_t n = F.n_rows;
+  if (n < 2) return;
+  double* cf = F.colptr((arma::uword)FeatCol::CUM_FLOW);
+  const double mean = std::accumulate(cf, cf + n, 0.0) / static_cast<double>(n);
+  double maxdev = 0.0;
+  for (size_t i = 0; i < n; ++i) maxdev = std::max(maxdev, std::fabs(cf[i] - mean));
+  const double scale = (maxdev > 0.0) ? (1.0 / maxdev) : 1.0;
+  for (size_t i = 0; i < n; ++i) {
+    const double v = (cf[i] - mean) * scale;
+    cf[i] = std::isfinite(v) ? v : 0.0;
+  }
+}
+
+// Полная запись (tmp + rename; tmp уникален — pid + счётчик, как у bar_store)
+static bool feat_write_all(const std::string& path, const arma::mat& F, int feat_version,
+                           const FeatSrcKey& key, uint64_t hot_head) {
+  const size_t n = F.n_rows;
+  const size_t cap = std::max<size_t>(FEAT_CAP_ALIGN, ((n + FEAT_CAP_ALIGN - 1) / FEAT_CAP_ALIGN) * FEAT_CAP_ALIGN);
+  FeatStoreHeader h{};
+  std::memcpy(h.magic, FEAT_MAGIC, 8);
+  h.version = FEAT_STORE_VERSION;
+  h.feat_version = (uint32_t)feat_version;
+  h.code_rev = FEAT_CODE_REV;
+  h.ncols = (uint32_t)F.n_cols;
+  h.nrows = n;
+  h.capacity = cap;
+  feat_set_key(h, key, hot_head);
+
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+  const std::string tmp = path + ".tmp." + std::to_string((long long)::getpid()) + "." +
+                          std::to_string(G_FEAT_TMP_SEQ.fetch_add(1, std::memory_order_relaxed));
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f.good()) return false;
+    const std::vector<char> pad((cap - n) * 8, 0);
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    for (arma::uword k = 0; k < F.n_cols; ++k) {
+      f.write(reinterpret_cast<const char*>(F.colptr(k)), n * 8);
+      f.write(pad.data(), pad.size());
+    }
+    if (!f.good()) { f.close(); ::unlink(tmp.c_str()); return false; }
+  }
+  if (::rename(tmp.c_str(), path.c_str()) != 0) { ::unlink(tmp.c_str()); return false; }
+  return true;
+}
+
+// Дозапись строк [start, n) на место; колонки до заголовка
+static bool feat_write_tail(int fd, const FeatStoreHeader& h, const arma::mat& F, size_t start,
+                            const FeatSrcKey& key, uint64_t hot_head) {
+  const size_t n = F.n_rows, k_rows = n - start;
+  std::vector<double> buf(k_rows);
+  for (uint32_t k = 0; k < h.ncols; ++k) {
+    std::copy(F.colptr(k) + start, F.colptr(k) + n, buf.begin());
+    const off_t off = (off_t)(sizeof(FeatStoreHeader) + ((size_t)k * h.capacity + start) * 8);
+    if (::pwrite(fd, buf.data(), k_rows * 8, off) != (ssize_t)(k_rows * 8)) return false;
+  }
+  FeatStoreHeader nh = h;
+  nh.nrows = n;
+  feat_set_key(nh, key, hot_head);
+  return ::pwrite(fd, &nh, sizeof(nh), 0) == (ssize_t)sizeof(nh);
+}
+
+bool feature_store_load(const std::string& csv_path, FeatureSet& out, int feat_version, bool need_raw) {
+  out = FeatureSet{};
+  if (!feature_version_supported(feat_version)) return false;
+  out.feat_version = feat_version;
+  out.path = feature_store_path(csv_path, feat_version);
+  const bool cum_flow = feat_has_cum_flow(feat_version);
+
+  const FeatSrcKey key = feat_src_key(csv_path);
+  const size_t N = (size_t)(key.hot_rows + key.arch_rows);
+  if (N < 30) return false;
+  out.last_ts = key.last_ts;
+
+  // склейка архив + горячая; ключ после чтения тот же — между ними не было записи
+  BarRows rows;
+  bool src_ok = false;
+  auto load_src = [&]() {
+    src_ok = load_history_range(csv_path, INT64_MIN, INT64_MAX, rows) &&
+             rows.size() == N && feat_src_key(csv_path) == key;
+    if (src_ok) out.raw = bars_matrix(bars_view(rows));   // единственная копия серии на запрос
+    return src_ok;
+  };
+
+  std::lock_guard<std::mutex> lk(feat_path_mu(out.path));
+
+  FeatStoreHeader h{};
+  const int fd = ::open(out.path.c_str(), O_RDWR | O_CLOEXEC);
+  const bool have = fd >= 0 && feat_read_header(fd, h) &&
+                    h.feat_version == (uint32_t)feat_version && h.code_rev == FEAT_CODE_REV &&
+                    h.ncols == feature_dim(feat_version) &&
+                    h.arch_rows == key.arch_rows && h.arch_ts_max == key.arch_ts_max;
+
+  // ключ совпал — строки из файла, источник не хэшируется (и не читается без need_raw)
+  if (have && h.nrows == N && h.hot_rows == key.hot_rows && h.hot_hash == key.hot_hash && h.last_ts == key.last_ts) {
+    out.F.set_size(N, h.ncols);
+    if (feat_read_rows(fd, h, N, out.F) && (!need_raw || load_src())) {
+      ::close(fd);
+      if (cum_flow) cum_flow_from_runs(out.F);
+      g_feat_hits.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    out.F.reset();
+  }
+
+  if (!src_ok && !load_src()) {
+    if (fd >= 0) ::close(fd);
+    // источник менялся во время чтения — посчитать по прочитанному, хранилище не трогать
+    if (rows.size() < 30) return false;
+    out.raw = bars_matrix(bars_view(rows));
+    out.F = build_feature_matrix(out.raw, feat_version);
+    out.last_ts = rows.ts.back();
+    out.built_rows = rows.size();
+    out.rebuilt = true;
+    return out.F.n_rows == rows.size();
+  }
+  const size_t A = (size_t)key.arch_rows;
+  const uint64_t hot_head = key.hot_rows ? key.hot_hash - feat_row_hash(rows, N - 1) : 0;
+
+  // сколько строк файла ещё верны: хэш горячей части до строки файла = meta.hash − хэш новых строк
+  size_t keep = 0;
+  if (have && h.hot_rows > 0 && h.nrows == A + h.hot_rows && key.hot_rows >= h.hot_rows) {
+    uint64_t tail = 0;
+    for (size_t j = A + (size_t)h.hot_rows; j < N; ++j) tail += feat_row_hash(rows, j);
+    if (key.hot_hash - tail == h.hot_hash) keep = (size_t)h.nrows;
+    else if (key.hot_hash - tail - feat_row_hash(rows, (size_t)h.nrows - 1) == h.hot_head)
+      keep = (size_t)h.nrows - 1;                                        // заменён последний бар
+  }
+
+  if (keep > 0) {
+    // дозапись: хвост N - keep строк, строки совпадают с полной матрицей бит-в-бит
+    arma::mat T = build_feature_tail(out.raw, N - keep, feat_version);
+    if (T.n_rows == N - keep && T.n_cols == h.ncols) {
+      out.F.set_size(N, h.ncols);
+      if (feat_read_rows(fd, h, keep, out.F)) {
+        out.F.rows(keep, N - 1) = T;
+        if (cum_flow) cum_flow_to_runs(out.F, keep, out.F(keep - 1, (arma::uword)FeatCol::CUM_FLOW));
+        out.built_rows = N - keep;
+        g_feat_extends.fetch_add(1, std::memory_order_relaxed);
+        g_feat_rows.fetch_add(out.built_rows, std::memory_order_relaxed);
+        const bool in_place = N <= h.capacity && feat_write_tail(fd, h, out.F, keep, key, hot_head);
+        ::close(fd);
+        if (!in_place && !feat_write_all(out.path, out.F, feat_version, key, hot_head))
+          std::cerr << "[FEAT] store write failed: " << out.path << std::endl;
+        if (cum_flow) cum_flow_from_runs(out.F);
+        return true;
+      }
+    }
+  }
+  if (fd >= 0) ::close(fd);
+
+  // полная пересборка
+  out.F = build_feature_matrix(out.raw, feat_version);
+  if (out.F.n_rows != N) return false;
+  if (cum_flow) cum_flow_to_runs(out.F, 0, 0.0);
+  out.built_rows = N;
+  out.rebuilt = true;
+  g_feat_rebuilds.fetch_add(1, std::memory_order_relaxed);
+  g_feat_rows.fetch_add(N, std::memory_order_relaxed);
+  if (!feat_write_all(out.path, out.F, feat_version, key, hot_head))
+    std::cerr << "[FEAT] store write failed: " << out.path << std::endl;
+  if (cum_flow) cum_flow_from_runs(out.F);
+  return true;
+}
+
+bool feature_store_get(const std::string& symbol, const std::string& interval, FeatureSet& out,
+                       int feat_version, bool need_raw) {
+  bool used_clean = false;
+  return feature_store_load(select_raw_path(symbol, interval, used_clean), out, feat_version, need_raw);
+}
+
+bool feature_set_since(const FeatureSet& set, int64_t ts_from, arma::mat& raw, arma::mat& F) {
+  const size_t N = set.raw.n_rows;
+  const double* ts = set.raw.colptr(0);
+  const size_t i0 = (size_t)(std::lower_bound(ts, ts + N, (double)ts_from) - ts);
+  if (i0 >= N || set.F.n_rows != N) return false;
+  raw = set.raw.rows(i0, N - 1);
+  F   = set.F.rows(i0, N - 1);
+  return true;
+}
+
+json feature_store_stats() {
+  return json{
+    {"hits", g_feat_hits.load()},
+    {"extends", g_feat_extends.load()},
+    {"rebuilds", g_feat_rebuilds.load()},
+    {"rows_built", g_feat_rows.load()},
+    {"feat_version", feature_version()},
+    {"code_rev", FEAT_CODE_REV}
+  };
+}
+
+} // namespace etai
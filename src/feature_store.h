@@ -0,0 +1,81 @@
+#pragma once
+#include <armadillo>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "json.hpp"
+#include "features/feature_spec.h"
+
+namespace etai {
+
+// ============================================================================
+// Хранилище матрицы признаков серии (полная F = build_feature_matrix по истории).
+//   Файл: cache/features/<SYM>_<TF>.f<ver>.feat (cache/clean/features/... для clean),
+//   ver — версия признаков (9; 10 — с Money Flow), т.е. переключение
+//   ETAI_FEAT_ENABLE_MFLOW не затирает другую версию.
+//   Формат: заголовок 128 байт, затем D колонок float64 длиной capacity
+//   (как .bars — запас под дозапись на месте).
+//   Ключ актуальности: версия + FEAT_CODE_REV (ревизия кода признаков) + ключ источника:
+//   .meta горячей серии (rows, hash, ts_max) и заголовок архива (rows, ts_max) —
+//   совпал → строки из файла без чтения и хэширования баров.
+//   Новые бары → хэш старой части = meta.hash − хэши новых строк (SeriesMeta::hash
+//   аддитивен), дописываются только новые строки (build_feature_tail, бит-в-бит как у
+//   полной матрицы); заменён последний бар → пересчёт с него; сменился архив — пересборка.
+//   v10 cum_flow (нормировка по всему ряду) хранится накопленной суммой и нормируется
+//   при чтении, поэтому новые бары его тоже только дописывают.
+// ============================================================================
+
+constexpr uint32_t FEAT_STORE_VERSION = 2;   // 2: ключ по .meta/архиву, cum_flow — накопленной суммой
+// Поднимать при любом изменении расчёта признаков (features.cpp / контекст / ядра)
+constexpr uint32_t FEAT_CODE_REV      = 2;   // 2: sentiment — vk::tanh вместо libm
+
+struct FeatStoreHeader {
+  char     magic[8];      // "ETAIFEAT"
+  uint32_t version;
+  uint32_t feat_version;  // 9 / 10
+  uint32_t code_rev;      // FEAT_CODE_REV на момент записи
+  uint32_t ncols;         // D
+  uint64_t nrows;         // = баров источника (архив + горячая серия)
+  uint64_t capacity;
+  // ключ источника на момент записи
+  uint64_t hot_rows;      // строк горячей серии
+  uint64_t hot_hash;      // SeriesMeta::hash горячей серии
+  uint64_t hot_head;      // то же без последней строки
+  uint64_t arch_rows;     // архив: строк / последний ts (0 — архива нет)
+  int64_t  arch_ts_max;
+  int64_t  last_ts;       // ts последнего бара источника
+  uint64_t reserved[5];
+};
+static_assert(sizeof(FeatStoreHeader) == 128, "FeatStoreHeader must be 128 bytes");
+
+struct FeatureSet {
+  arma::mat raw;              // N×6 источник (ts,open,high,low,close,vol); пуст при need_raw = false
+  arma::mat F;                // N×D, строка i — признаки бара i
+  int         feat_version = 0;
+  std::string path;           // файл хранилища
+  int64_t     last_ts = 0;    // ts последнего бара источника
+  size_t      built_rows = 0; // строк посчитано в этом вызове (0 — всё из файла)
+  bool        rebuilt = false;
+};
+
+// cache/X_15.csv → cache/features/X_15.f9.feat
+std::string feature_store_path(const std::string& csv_path, int feat_version);
+
+// Признаки серии по пути CSV: из хранилища / с дозаписью / с пересборкой.
+// feat_version — версия признаков (по умолчанию — процесса, feature_spec.h).
+// need_raw = false — нужна только F (карта сигналов): при совпавшем ключе бары не читаются.
+// false — нет источника, баров меньше 30 или версия неизвестна.
+bool feature_store_load(const std::string& csv_path, FeatureSet& out, int feat_version = feature_version(),
+                        bool need_raw = true);
+
+// То же для symbol/interval (clean/ в приоритете, как load_bars)
+bool feature_store_get(const std::string& symbol, const std::string& interval, FeatureSet& out,
+                       int feat_version = feature_version(), bool need_raw = true);
+
+// Строки set с ts >= ts_from (окно обучения); false — окно пустое
+bool feature_set_since(const FeatureSet& set, int64_t ts_from, arma::mat& raw, arma::mat& F);
+
+// Телеметрия: hits, extends, rebuilds, rows_built
+nlohmann::json feature_store_stats();
+
+} // namespace etai
@@ -0,0 +1,177 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "indicator_graph.h"
+
+// ============================================================================
+// Спецификация признаков (compile-time): колонка, окно истории, зависимости
+// от узлов графа индикаторов. Версия признаков — префикс таблицы:
+//   v9  — 28 базовых колонок; v10 — + 4 колонки Money Flow (32).
+// Размерность, раскладка колонок и прогрев хвостового режима выводятся из
+// таблицы; версия передаётся явно (policy.feat_version модели / FeatureSet),
+// окружение (ETAI_FEAT_ENABLE_MFLOW) задаёт только версию процесса по умолчанию.
+// ============================================================================
+
+namespace etai {
+
+constexpr int FEAT_V9  = 9;    // базовые признаки
+constexpr int FEAT_V10 = 10;   // + Money Flow
+
+enum class FeatCol : int {
+    TREND = 0,        // EMA12 − EMA26
+    RSI01,            // RSI14 / 100
+    MACD,
+    MACD_HIST,
+    ATR14,
+    ACCEL,            // ret[i] − ret[i−1]
+    SLOPE3,           // close[i] − close[i−3]
+    ENERGY,           // контекст
+    LIQUIDITY,
+    SENTIMENT,
+    SESSION_SIN,
+    SESSION_COS,
+    PH_EXPANSION,     // one-hot фазы
+    PH_DISTRIBUTION,
+    PH_CORRECTION,
+    BODY_PCT,         // (close − open) / open
+    RET1,
+    DVOL1,
+    SMA5_10,
+    RSI_CENTERED,
+    MACD_ATR,
+    VOL_RATIO,        // SMA10(vol) / SMA20(vol)
+    ATR_RATIO,        // SMA10(ATR) / SMA20(ATR)
+    BULL_CONF,
+    BEAR_CONF,
+    ENERGY_DIR,
+    SENT_ENERGY,
+    CORR_BEAR,
+    MFI01,            // Money Flow (v10)
+    FLOW_RATIO,
+    CUM_FLOW,
+    SFI,
+    Count
+};
+
+constexpr uint32_t ind_bit(Ind id) { return 1u << (unsigned)id; }
+
+// Затухание IIR sentiment (0.7·s + 0.3·prev): 0.3^31 ниже ulp
+constexpr int FEAT_SENT_DECAY = 31;
+constexpr int FEAT_FULL_HISTORY = -1;   // колонка зависит от всего ряда (cum_flow)
+
+struct FeatColSpec {
+    FeatCol     id;
+    const char* name;
+    int         lookback;   // баров истории до значения (цепочка окон); FEAT_FULL_HISTORY — весь ряд
+    int         guard;      // строки среза i < guard — 0 (нет разностей / неполные окна)
+    uint32_t    deps;       // узлы IndicatorGraph (ind_bit)
+};
+
+namespace featspec_detail {
+constexpr uint32_t CTX = ind_bit(Ind::ATR14) | ind_bit(Ind::ATR14_AVG14) | ind_bit(Ind::VOL_MAX21);
+}
+
+constexpr FeatColSpec FEAT_COLS[] = {
+    {FeatCol::TREND,           "trend",          26, 0, ind_bit(Ind::MACD)},
+    {FeatCol::RSI01,           "rsi01",          15, 0, ind_bit(Ind::RSI14)},
+    {FeatCol::MACD,            "macd",           26, 0, ind_bit(Ind::MACD)},
+    {FeatCol::MACD_HIST,       "macd_hist",      35, 0, ind_bit(Ind::MACD_HIST)},
+    {FeatCol::ATR14,           "atr14",          15, 0, ind_bit(Ind::ATR14)},
+    {FeatCol::ACCEL,           "accel",           3, 2, ind_bit(Ind::Returns)},
+    {FeatCol::SLOPE3,          "slope3",          4, 3, 0},
+    {FeatCol::ENERGY,          "energy",         29, 0, featspec_detail::CTX},
+    {FeatCol::LIQUIDITY,       "liquidity",      21, 0, featspec_detail::CTX},
+    {FeatCol::SENTIMENT,       "sentiment",      15 + FEAT_SENT_DECAY, 0, featspec_detail::CTX},
+    {FeatCol::SESSION_SIN,     "session_sin",     1, 0, 0},
+    {FeatCol::SESSION_COS,     "session_cos",     1, 0, 0},
+    {FeatCol::PH_EXPANSION,    "ph_expansion",   29, 0, featspec_detail::CTX},
+    {FeatCol::PH_DISTRIBUTION, "ph_distribution",29, 0, featspec_detail::CTX},
+    {FeatCol::PH_CORRECTION,   "ph_correction",  29, 0, featspec_detail::CTX},
+    {FeatCol::BODY_PCT,        "body_pct",        1, 0, 0},
+    {FeatCol::RET1,            "ret1",            2, 1, ind_bit(Ind::Returns)},
+    {FeatCol::DVOL1,           "dvol1",           2, 1, 0},
+    {FeatCol::SMA5_10,         "sma5_10",        10, 5, 0},
+    {FeatCol::RSI_CENTERED,    "rsi_centered",   15, 14, ind_bit(Ind::RSI14)},
+    {FeatCol::MACD_ATR,        "macd_atr",       26, 0, ind_bit(Ind::MACD) | ind_bit(Ind::ATR14)},
+    {FeatCol::VOL_RATIO,       "vol_ratio",      20, 10, 0},
+    {FeatCol::ATR_RATIO,       "atr_ratio",      35, 20, ind_bit(Ind::ATR14)},
+    {FeatCol::BULL_CONF,       "bull_conf",      26, 0, ind_bit(Ind::MACD) | ind_bit(Ind::RSI14)},
+    {FeatCol::BEAR_CONF,       "bear_conf",      26, 0, ind_bit(Ind::MACD) | ind_bit(Ind::RSI14)},
+    {FeatCol::ENERGY_DIR,      "energy_dir",     29, 0, featspec_detail::CTX | ind_bit(Ind::MACD)},
+    {FeatCol::SENT_ENERGY,     "sent_energy",    15 + FEAT_SENT_DECAY, 0, featspec_detail::CTX},
+    {FeatCol::CORR_BEAR,       "corr_bear",      15 + FEAT_SENT_DECAY, 0, featspec_detail::CTX},
+    {FeatCol::MFI01,           "mfi01",          15, 0, 0},
+    {FeatCol::FLOW_RATIO,      "flow_ratio",     15, 0, 0},
+    {FeatCol::CUM_FLOW,        "cum_flow",       FEAT_FULL_HISTORY, 0, 0},
+    {FeatCol::SFI,             "sfi",            15, 0, 0},
+};
+static_assert(sizeof(FEAT_COLS) / sizeof(FEAT_COLS[0]) == (size_t)FeatCol::Count, "FEAT_COLS must cover FeatCol");
+
+namespace featspec_detail {
+constexpr bool cols_in_order() {
+    for (size_t k = 0; k < (size_t)FeatCol::Count; ++k)
+        if ((size_t)FEAT_COLS[k].id != k) return false;
+    return true;
+}
+static_assert(cols_in_order(), "FEAT_COLS[k].id must equal k");
+
+constexpr int max_lookback(size_t dim) {
+    int m = 0;
+    for (size_t k = 0; k < dim; ++k)
+        if (FEAT_COLS[k].lookback > m) m = FEAT_COLS[k].lookback;
+    return m;
+}
+constexpr bool full_history(size_t dim) {
+    for (size_t k = 0; k < dim; ++k)
+        if (FEAT_COLS[k].lookback == FEAT_FULL_HISTORY) return true;
+    return false;
+}
+constexpr uint32_t deps(size_t dim) {
+    uint32_t d = 0;
+    for (size_t k = 0; k < dim; ++k) d |= FEAT_COLS[k].deps;
+    return d;
+}
+} // namespace featspec_detail
+
+// Версия → раскладка. tail_warmup: каждое окно цепочки может ждать ещё один
+// точный пересчёт (rolling_kernels, phase) → 2·max_lookback, округление до 64.
+template<int V>
+struct FeatSpec {
+    static_assert(V == FEAT_V9 || V == FEAT_V10, "unknown feature version");
+    static constexpr int      version      = V;
+    static constexpr size_t   dim          = (V == FEAT_V10) ? 32 : 28;
+    static constexpr bool     mflow        = (V == FEAT_V10);
+    static constexpr int      max_lookback = featspec_detail::max_lookback(dim);   // без FULL_HISTORY
+    static constexpr bool     full_history = featspec_detail::full_history(dim);
+    static constexpr uint32_t deps         = featspec_detail::deps(dim);
+    static constexpr size_t   tail_warmup  = ((2 * (size_t)max_lookback + 63) / 64) * 64;
+};
+static_assert(FeatSpec<FEAT_V9>::tail_warmup == 128 && FeatSpec<FEAT_V10>::tail_warmup == 128,
+              "tail warmup changed — bump FEAT_CODE_REV and re-check build_feature_tail");
+
+// ---------- runtime-доступ по номеру версии ----------
+constexpr bool feature_version_supported(int v) { return v == FEAT_V9 || v == FEAT_V10; }
+constexpr size_t feature_dim(int v) {
+    return v == FEAT_V10 ? FeatSpec<FEAT_V10>::dim : (v == FEAT_V9 ? FeatSpec<FEAT_V9>::dim : 0);
+}
+constexpr int feature_max_lookback(int v) {
+    return v == FEAT_V10 ? FeatSpec<FEAT_V10>::max_lookback : FeatSpec<FEAT_V9>::max_lookback;
+}
+constexpr size_t feature_tail_warmup(int v) {
+    return v == FEAT_V10 ? FeatSpec<FEAT_V10>::tail_warmup : FeatSpec<FEAT_V9>::tail_warmup;
+}
+constexpr bool feature_full_history(int v) {
+    return v == FEAT_V10 ? FeatSpec<FEAT_V10>::full_history : FeatSpec<FEAT_V9>::full_history;
+}
+// Модели без policy.feat_version: версия по размерности
+constexpr int feature_version_for_dim(size_t dim) {
+    return dim == FeatSpec<FEAT_V10>::dim ? FEAT_V10 : FEAT_V9;
+}
+constexpr const char* feature_col_name(size_t k) {
+    return k < (size_t)FeatCol::Count ? FEAT_COLS[k].name : "?";
+}
+
+// Версия процесса по умолчанию (ETAI_FEAT_ENABLE_MFLOW, читается один раз)
+int feature_version();
+
+} // namespace etai
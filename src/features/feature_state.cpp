@@ -0,0 +1,308 @@
+#include "feature_state.h"
+#include "features.h"
+#include "context_detector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace etai {
+
+// ---------- FeatureState ----------
+FeatureState::FeatureState(int feat_version)
+    : version_(feat_version), mflow_(feature_dim(feat_version) > (size_t)FeatCol::MFI01) {}
+
+void FeatureState::reset() { *this = FeatureState(version_); }
+
+arma::rowvec FeatureState::push(long long ts, double o, double h, double l, double c, double v) {
+    const size_t i = n_;
+    if (i == 0) first_ts_ = ts;
+
+    // EMA 12/26, MACD + сигнальная 9
+    const double ef    = ema12_.push(c);
+    const double es    = ema26_.push(c);
+    const double macd  = ef - es;
+    const double mhist = macd - sig9_.push(macd);
+
+    // RSI(14) и ATR(14) — окна разностей/TR начинаются со 2-го бара
+    if (i >= 1) {
+        const double diff = c - c1_;
+        if (diff >= 0) { gain14_.push(diff); loss14_.push(0.0); }
+        else           { gain14_.push(0.0);  loss14_.push(-diff); }
+        tr14_.push(std::max({h - l, std::fabs(h - c1_), std::fabs(l - c1_)}));
+    }
+    double rsi = rk::NaN;
+    if (i >= 14) {
+        const double gain = gain14_.sum(), loss = loss14_.sum();
+        rsi = (loss == 0) ? 100.0 : 100.0 - (100.0 / (1.0 + gain / loss));
+    }
+    const double atr = (i >= 14) ? tr14_.mean() : rk::NaN;
+
+    double accel = 0.0, slope = 0.0;
+    if (i >= 2) {
+        accel = (c - c1_) - (c1_ - c2_);
+        slope = (i >= 3) ? (c - c3_) : 0.0;
+    }
+
+    c5_.push(c);  c10_.push(c);
+    v10_.push(v); v20_.push(v);
+    atr10_.push(atr); atr14_.push(atr); atr20_.push(atr);
+    vmax21_.push(v);
+
+    // контекст (как compute_context)
+    const double atr_sma = atr14_.mean();
+    const double energy  = (std::isfinite(atr_sma) && atr_sma > 0.0) ? ctx_safe_div(atr, atr_sma) : 0.0;
+    const double vol_max = (i >= 20) ? vmax21_.value() : 0.0;
+    const double liq     = (vol_max > 0.0) ? ctx_safe_div(v, vol_max) : 0.0;
+    double ss, cc; ctx_session_cycle(ts, ss, cc);
+    double sent = ctx_candle_sentiment(o, c, std::isfinite(atr) ? atr : 0.0);
+    if (i > 0) sent = 0.7 * sent + 0.3 * sent1_;
+    const double body_rel_atr = ctx_safe_div(std::fabs(c - o), std::max(1e-6, atr));
+    const double body_sign    = ctx_safe_div((c - o), std::max(1e-6, atr));
+    const int    ph           = ctx_pick_phase(energy, liq, body_rel_atr, body_sign);
+
+    arma::rowvec F(dim(), arma::fill::zeros);
+    auto at = [&F](FeatCol k) -> double& { return F((arma::uword)k); };
+    at(FeatCol::TREND)     = ef - es;
+    at(FeatCol::RSI01)     = rsi / 100.0;
+    at(FeatCol::MACD)      = macd;
+    at(FeatCol::MACD_HIST) = mhist;
+    at(FeatCol::ATR14)     = atr;
+    at(FeatCol::ACCEL)     = accel;
+    at(FeatCol::SLOPE3)    = slope;
+
+    at(FeatCol::ENERGY)          = energy;
+    at(FeatCol::LIQUIDITY)       = liq;
+    at(FeatCol::SENTIMENT)       = sent;
+    at(FeatCol::SESSION_SIN)     = ss;
+    at(FeatCol::SESSION_COS)     = cc;
+    at(FeatCol::PH_EXPANSION)    = (ph == 1) ? 1.0 : 0.0;
+    at(FeatCol::PH_DISTRIBUTION) = (ph == 2) ? 1.0 : 0.0;
+    at(FeatCol::PH_CORRECTION)   = (ph == 3) ? 1.0 : 0.0;
+
+    const double diff = c - o;
+    at(FeatCol::BODY_PCT)     = (o > 0) ? diff / o : 0.0;
+    at(FeatCol::RET1)         = (i > 0) ? c - c1_ : 0.0;
+    at(FeatCol::DVOL1)        = (i > 0) ? (v - v1_) : 0.0;
+    at(FeatCol::SMA5_10)      = (i >= 5)  ? c5_.mean() - c10_.mean() : 0.0;
+    at(FeatCol::RSI_CENTERED) = (i >= 14) ? (rsi - 50.0) / 50.0 : 0.0;
+    at(FeatCol::MACD_ATR)     = std::fabs(ef - es) / (atr + 1e-8);
+    at(FeatCol::VOL_RATIO)    = (i >= 10) ? v10_.mean() / (v20_.mean() + 1e-8) : 0.0;
+    at(FeatCol::ATR_RATIO)    = (i >= 20) ? atr10_.mean() / (atr20_.mean() + 1e-8) : 0.0;
+    at(FeatCol::BULL_CONF)    = (macd > 0 && rsi > 50) ? 1.0 : 0.0;
+    at(FeatCol::BEAR_CONF)    = (macd < 0 && rsi < 50) ? 1.0 : 0.0;
+    at(FeatCol::ENERGY_DIR)   = energy * (macd > 0 ? 1 : -1);
+    at(FeatCol::SENT_ENERGY)  = sent * energy;
+    at(FeatCol::CORR_BEAR)    = (ph == 3 && sent < 0) ? 1.0 : 0.0;
+
+    const double tp = (h + l + c) / 3.0;
+    if (mflow_) {
+        if (i >= 1) {
+            const double mf = tp * v;
+            mpos14_.push(tp > tp1_ ? mf : 0.0);
+            mneg14_.push(tp < tp1_ ? mf : 0.0);
+        }
+        double mfi = 50.0;
+        if (i >= 14) {
+            const double pos = mpos14_.sum(), neg = mneg14_.sum();
+            const double ratio = (neg <= 0.0) ? 100.0 : pos / neg;
+            mfi = 100.0 - (100.0 / (1.0 + ratio));
+        }
+        double fr = 0.5;
+        if (i >= 1) {
+            double x = mfi / 100.0;
+            if (!std::isfinite(x)) x = 0.5;
+            fr = std::clamp(x, 0.0, 1.0);
+        }
+
+        // cum_flow: нормировка по префиксу [0..i] (batch нормирует по всему ряду)
+        cf_run_ += std::isfinite(fr) ? (fr - 0.5) : 0.0;
+        cf_total_ += cf_run_;
+        if (i == 0) { cf_min_ = cf_max_ = cf_run_; }
+        else { cf_min_ = std::min(cf_min_, cf_run_); cf_max_ = std::max(cf_max_, cf_run_); }
+        double cf = cf_run_;
+        if (i >= 1) {
+            const double mean   = cf_total_ / static_cast<double>(i + 1);
+            const double maxdev = std::max(std::fabs(cf_max_ - mean), std::fabs(cf_min_ - mean));
+            const double scale  = (maxdev > 0.0) ? (1.0 / maxdev) : 1.0;
+            cf = (cf_run_ - mean) * scale;
+        }
+
+        const double mi  = std::isfinite(mfi) ? (mfi / 100.0) : 0.5;
+        const double sfi = (fr - 0.5) * 2.0 * mi;
+
+        at(FeatCol::MFI01)      = std::isfinite(mfi) ? (mfi / 100.0) : 0.5;
+        at(FeatCol::FLOW_RATIO) = std::isfinite(fr)  ? fr  : 0.5;
+        at(FeatCol::CUM_FLOW)   = std::isfinite(cf)  ? cf  : 0.0;
+        at(FeatCol::SFI)        = std::isfinite(sfi) ? sfi : 0.0;
+    }
+
+    c3_ = c2_; c2_ = c1_; c1_ = c;
+    v1_ = v; sent1_ = sent; tp1_ = tp;
+    last_ts_ = ts;
+    ++n_;
+
+    F.replace(arma::datum::nan, 0.0);
+    return F;
+}
+
+// ---------------------------------------------------------------------------
+// Реестр
+// ---------------------------------------------------------------------------
+namespace {
+
+struct StreamEntry {
+    std::mutex   mu;
+    FeatureState st;
+};
+
+std::mutex                                                   g_stream_mu;
+std::unordered_map<std::string, std::shared_ptr<StreamEntry>> g_stream;
+std::atomic<unsigned long long> g_stream_calls{0};
+std::atomic<unsigned long long> g_stream_rows{0};
+std::atomic<unsigned long long> g_stream_resets{0};
+
+std::shared_ptr<StreamEntry> stream_entry(const std::string& key) {
+    std::lock_guard<std::mutex> lk(g_stream_mu);
+    auto& e = g_stream[key];
+    if (!e) e = std::make_shared<StreamEntry>();
+    return e;
+}
+
+inline arma::rowvec push_raw_row(FeatureState& st, const arma::mat& raw, size_t i) {
+    return st.push((long long)raw(i, 0), raw(i, 1), raw(i, 2), raw(i, 3), raw(i, 4), raw(i, 5));
+}
+
+} // namespace
+
+bool feature_stream_enabled() {
+    const char* s = std::getenv("ETAI_FEAT_STREAM");
+    if (!s || !*s) return true;
+    return !(s[0] == '0' || s[0] == 'f' || s[0] == 'F' || s[0] == 'n' || s[0] == 'N');
+}
+
+bool stream_feature_last_row(const std::string& key, const arma::mat& raw, arma::rowvec& out,
+                             int feat_version) {
+    const size_t N = raw.n_rows;
+    if (raw.n_cols < 6 || N < 30 || !feature_version_supported(feat_version)) return false;
+    g_stream_calls.fetch_add(1, std::memory_order_relaxed);
+
+    auto e = stream_entry(key);
+    std::lock_guard<std::mutex> lk(e->mu);
+    FeatureState& st = e->st;
+
+    // префикс должен совпадать с тем, что уже съедено; иначе — пересборка с нуля
+    size_t c = st.count();
+    const bool same_prefix = c > 0 && c <= N - 1 && st.version() == feat_version &&
+                             (long long)raw(0, 0)     == st.first_ts() &&
+                             (long long)raw(c - 1, 0) == st.last_ts()  &&
+                             raw(c - 1, 4)            == st.last_close();
+    if (!same_prefix) {
+        if (c > 0) g_stream_resets.fetch_add(1, std::memory_order_relaxed);
+        st = FeatureState(feat_version);
+        c = 0;
+    }
+
+    // коммитим всё, кроме последнего бара (он может ещё формироваться)
+    for (size_t i = c; i + 1 < N; ++i) push_raw_row(st, raw, i);
+    g_stream_rows.fetch_add((N - 1) - c, std::memory_order_relaxed);
+
+    FeatureState tip = st;
+    out = push_raw_row(tip, raw, N - 1);
+    return true;
+}
+
+void stream_feature_reset(const std::string& key) {
+    std::lock_guard<std::mutex> lk(g_stream_mu);
+    g_stream.erase(key);
+}
+
+json stream_feature_stats() {
+    size_t keys = 0;
+    { std::lock_guard<std::mutex> lk(g_stream_mu); keys = g_stream.size(); }
+    return json{
+        {"enabled", feature_stream_enabled()},
+        {"keys",    (unsigned long long)keys},
+        {"calls",   g_stream_calls.load(std::memory_order_relaxed)},
+        {"rows_pushed", g_stream_rows.load(std::memory_order_relaxed)},
+        {"resets",  g_stream_resets.load(std::memory_order_relaxed)}
+    };
+}
+
+// ---------------------------------------------------------------------------
+// Эквивалентность с batch
+// ---------------------------------------------------------------------------
+json stream_feature_check(const arma::mat& raw, size_t tail, double tol, int feat_version) {
+    using clk = std::chrono::steady_clock;
+    const size_t N = raw.n_rows;
+    if (raw.n_cols < 6 || N < 30) return json{{"ok", false}, {"error", "not_enough_data"}, {"rows", (int)N}};
+    if (!feature_version_supported(feat_version)) return json{{"ok", false}, {"error", "bad_feat_version"}};
+    if (tail == 0 || tail > N) tail = N;
+
+    const bool mflow = FeatureState(feat_version).mflow();
+    const int  CF_COL = (int)FeatCol::CUM_FLOW;   // нормировка по всему ряду, сверяем только по префиксам
+
+    auto t0 = clk::now();
+    arma::mat F = build_feature_matrix(raw, feat_version);
+    const double batch_ms = std::chrono::duration<double, std::milli>(clk::now() - t0).count();
+
+    FeatureState st(feat_version);
+    double max_err = 0.0;
+    int worst_row = -1, worst_col = -1;
+    t0 = clk::now();
+    for (size_t i = 0; i < N; ++i) {
+        arma::rowvec r = push_raw_row(st, raw, i);
+        if (i < N - tail) continue;
+        for (arma::uword j = 0; j < F.n_cols && j < r.n_elem; ++j) {
+            if (mflow && (int)j == CF_COL && i + 1 != N) continue;
+            const double a = r(j), b = F(i, j);
+            const double err = std::fabs(a - b) / std::max(1.0, std::fabs(b));
+            if (err > max_err) { max_err = err; worst_row = (int)i; worst_col = (int)j; }
+        }
+    }
+    const double stream_ms = std::chrono::duration<double, std::milli>(clk::now() - t0).count();
+
+    // последняя строка потока == последняя строка batch на префиксе (в т.ч. cum_flow)
+    double prefix_err = 0.0;
+    const size_t n_prefix = std::min<size_t>(5, N - 29);
+    for (size_t k = 1; k <= n_prefix; ++k) {
+        const size_t m = N - k + 1;
+        arma::mat Fp = build_feature_matrix(raw.rows(0, m - 1), feat_version);
+        FeatureState sp(feat_version);
+        arma::rowvec r;
+        for (size_t i = 0; i < m; ++i) r = push_raw_row(sp, raw, i);
+        for (arma::uword j = 0; j < Fp.n_cols && j < r.n_elem; ++j) {
+            const double b = Fp(m - 1, j);
+            prefix_err = std::max(prefix_err, std::fabs(r(j) - b) / std::max(1.0, std::fabs(b)));
+        }
+    }
+
+    const bool dim_ok = (F.n_cols == (arma::uword)st.dim());
+    return json{
+        {"ok", dim_ok && max_err <= tol && prefix_err <= tol},
+        {"rows", (int)N},
+        {"dim", (int)F.n_cols},
+        {"feat_version", feat_version},
+        {"max_lookback", feature_max_lookback(feat_version)},
+        {"tail_warmup", (int)feature_tail_warmup(feat_version)},
+        {"mflow", mflow},
+        {"checked_rows", (int)tail},
+        {"max_rel_err", max_err},
+        {"worst_row", worst_row},
+        {"worst_col", worst_col},
+        {"prefix_checks", (int)n_prefix},
+        {"prefix_max_rel_err", prefix_err},
+        {"tol", tol},
+        {"batch_ms", batch_ms},
+        {"stream_us_per_bar", N ? stream_ms * 1000.0 / (double)N : 0.0}
+    };
+}
+
+} // namespace etai
@@ -0,0 +1,77 @@
+#pragma once
+#include <armadillo>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "rolling_kernels.h"
+#include "feature_spec.h"
+
+namespace etai {
+
+// ============================================================================
+// Потоковый расчёт признаков: один закрытый бар → одна строка F за O(1).
+// Семантика строка-в-строку совпадает с build_feature_matrix (v9: 28, v10: 32 колонки):
+//   те же окна, те же NaN-правила (NaN → 0 в выходной строке).
+// Отличие только в cum_flow (MFLOW): в batch он нормируется по всему ряду,
+//   здесь — по префиксу [0..i], т.е. совпадает с batch для ПОСЛЕДНЕЙ строки.
+// Окна — общие ядра rolling_kernels.h (те же, что в batch).
+// ============================================================================
+
+class FeatureState {
+public:
+    explicit FeatureState(int feat_version = FEAT_V9);
+    void reset();
+
+    // Добавить закрытый бар, вернуть строку признаков (D = dim())
+    arma::rowvec push(long long ts, double o, double h, double l, double c, double v);
+
+    int       dim()        const { return (int)feature_dim(version_); }
+    int       version()    const { return version_; }
+    bool      mflow()      const { return mflow_; }
+    size_t    count()      const { return n_; }
+    long long first_ts()   const { return first_ts_; }
+    long long last_ts()    const { return last_ts_; }
+    double    last_close() const { return c1_; }
+
+private:
+    int    version_;
+    bool   mflow_;
+    size_t n_ = 0;
+    long long first_ts_ = 0, last_ts_ = 0;
+
+    // предыдущие значения
+    double c1_ = 0, c2_ = 0, c3_ = 0, v1_ = 0, sent1_ = 0, tp1_ = 0;
+
+    rk::WindowEma  ema12_{12}, ema26_{26}, sig9_{9};
+    rk::RollingSum gain14_{14}, loss14_{14}, tr14_{14};
+    rk::RollingSum c5_{5}, c10_{10}, v10_{10}, v20_{20};
+    rk::RollingSum atr10_{10}, atr14_{14}, atr20_{20};
+    rk::RollingMax vmax21_{21};
+
+    // Money Flow
+    rk::RollingSum mpos14_{14}, mneg14_{14};
+    double cf_run_ = 0.0, cf_total_ = 0.0, cf_min_ = 0.0, cf_max_ = 0.0;
+};
+
+// ---------------------------------------------------------------------------
+// Реестр состояний per (symbol, interval)
+// ---------------------------------------------------------------------------
+
+// Включено ли потоковое ядро (ETAI_FEAT_STREAM, по умолчанию да; "0" — выкл.)
+bool feature_stream_enabled();
+
+// Последняя строка F версии feat_version для ряда raw (N×6). Догоняет только новые бары
+// ключа; последний (возможно формирующийся) бар считается на копии состояния.
+// Смена версии для ключа — пересборка состояния с нуля.
+// false — ряд короче 30 строк (batch вернул бы пустую матрицу) или версия неизвестна.
+bool stream_feature_last_row(const std::string& key, const arma::mat& raw, arma::rowvec& out,
+                             int feat_version = feature_version());
+
+void stream_feature_reset(const std::string& key);
+nlohmann::json stream_feature_stats();
+
+// Проверка эквивалентности: поток vs build_feature_matrix на последних tail барах ряда
+nlohmann::json stream_feature_check(const arma::mat& raw, size_t tail, double tol,
+                                    int feat_version = feature_version());
+
+} // namespace etai
@@ -12,15 +12,16 @@
 
 // Money Flow layer
 #include "money_flow.h"
+#include "rolling_kernels.h"
+#include "indicator_graph.h"
+#include "feature_spec.h"
+#include "simd_kernels.h"
 
 using json = nlohmann::json;
 using namespace arma;
 
 namespace etai {
 
-// Версия фич по умолчанию (без Money Flow)
-constexpr int FEAT_VERSION_BASE = 9;
-
 static inline bool env_enabled(const char* k){
     const char* s = std::getenv(k);
     if(!s || !*s) return false;
@@ -28,192 +29,241 @@ static inline bool env_enabled(const char* k){
     return (s[0]=='1') || (s[0]=='T'||s[0]=='t') || (s[0]=='Y'||s[0]=='y');
 }
 
-// ---------- вспомогательные функции ----------
-static double ema_one(const std::vector<double>& v, int period, size_t i) {
-    if (i + 1 < (size_t)period) return NAN;
-    double k = 2.0 / (period + 1);
-    double e = v[i - period + 1];
-    for (size_t j = i - period + 2; j <= i; ++j)
-        e = v[j] * k + e * (1.0 - k);
-    return e;
+int feature_version() {
+    static const int v = env_enabled("ETAI_FEAT_ENABLE_MFLOW") ? FEAT_V10 : FEAT_V9;
+    return v;
 }
 
-static double sma_one(const std::vector<double>& v, int period, size_t i) {
-    if (i + 1 < (size_t)period) return NAN;
-    double s = 0;
-    for (size_t j = i + 1 - period; j <= i; ++j) s += v[j];
-    return s / period;
+// ---------- построение матрицы признаков ----------
+// Колонка col: строки среза i ∈ [max(keep, guard), n) = f(i) — подряд по колонке,
+// без ветвлений по версии; строки ниже guard остаются нулями (F создана нулевой).
+template<class Fn>
+static inline void feat_fill(arma::Mat<double>& F, FeatCol col, size_t keep, size_t n, Fn f) {
+    const size_t k = (size_t)col;
+    double* dst = F.colptr(k);
+    for (size_t i = std::max(keep, (size_t)FEAT_COLS[k].guard); i < n; ++i) dst[i - keep] = f(i);
 }
 
-static double rsi_one(const std::vector<double>& c, int period, size_t i) {
-    if (i + 1 < (size_t)period + 1) return NAN;
-    double gain = 0, loss = 0;
-    for (size_t j = i + 1 - period; j <= i; ++j) {
-        double diff = c[j] - c[j - 1];
-        if (diff >= 0) gain += diff; else loss -= diff;
-    }
-    if (loss == 0) return 100.0;
-    double rs = gain / loss;
-    return 100.0 - (100.0 / (1.0 + rs));
-}
-
-static double atr_one(const std::vector<double>& h,
-                      const std::vector<double>& l,
-                      const std::vector<double>& c,
-                      int period, size_t i)
-{
-    if (i + 1 < (size_t)period + 1) return NAN;
-    double s = 0;
-    for (size_t j = i + 1 - period; j <= i; ++j) {
-        double tr = std::max({h[j] - l[j],
-                              std::fabs(h[j] - c[j - 1]),
-                              std::fabs(l[j] - c[j - 1])});
-        s += tr;
-    }
-    return s / period;
+// То же колоночным ядром: kernel(смещение строки среза, выход, длина)
+template<class Kernel>
+static inline void feat_fill_k(arma::Mat<double>& F, FeatCol col, size_t keep, size_t n, Kernel kernel) {
+    const size_t k = (size_t)col;
+    const size_t s = std::max(keep, (size_t)FEAT_COLS[k].guard);
+    if (s < n) kernel(s, F.colptr(k) + (s - keep), n - s);
 }
 
-// ---------- построение матрицы признаков ----------
-arma::Mat<double> build_feature_matrix(const arma::Mat<double>& raw) {
-    if (raw.n_rows < 30 || raw.n_cols < 6) return arma::Mat<double>();
+// Строки [keep, m) среза bars[from, N): окна привязаны к абсолютным индексам (phase = from),
+// поэтому при keep >= Spec::tail_warmup строки совпадают со строками полной матрицы.
+template<class Spec>
+static arma::Mat<double> feat_build_rows(const BarsView& bars, size_t from, size_t keep) {
+    // общие промежуточные ряды (ATR14, EMA, MACD, RSI, ...) — по одному разу на срез
+    IndicatorGraph g(bars.slice(from), from);
+    const size_t n = g.size();
+    const DSpan open  = g.open();
+    const DSpan close = g.close();
+    const DSpan vol   = g.volume();
 
-    const bool ENABLE_MFLOW = env_enabled("ETAI_FEAT_ENABLE_MFLOW");
+    const std::vector<double>& rsi_v     = g[Ind::RSI14];
+    const std::vector<double>& atr_v     = g[Ind::ATR14];
+    const std::vector<double>& macd_v    = g[Ind::MACD];
+    const std::vector<double>& macd_hist = g[Ind::MACD_HIST];
+    const std::vector<double>& ret_v     = g[Ind::Returns];
 
-    size_t n = raw.n_rows;
-    std::vector<long long> ts(n);
-    std::vector<double> open(n), high(n), low(n), close(n), vol(n);
-    for (size_t i = 0; i < n; ++i) {
-        ts[i]    = static_cast<long long>(raw(i, 0));
-        open[i]  = raw(i, 1);
-        high[i]  = raw(i, 2);
-        low[i]   = raw(i, 3);
-        close[i] = raw(i, 4);
-        vol[i]   = raw(i, 5);
-    }
+    const std::vector<double> c_sma5   = rk::sma(close, 5, from);
+    const std::vector<double> c_sma10  = rk::sma(close, 10, from);
+    const std::vector<double> v_sma10  = rk::sma(vol, 10, from);
+    const std::vector<double> v_sma20  = rk::sma(vol, 20, from);
+    const std::vector<double> atr_sma10 = rk::sma(atr_v, 10, from);
+    const std::vector<double> atr_sma20 = rk::sma(atr_v, 20, from);
 
-    std::vector<double> ema_fast(n), ema_slow(n), rsi_v(n),
-                        macd_v(n), macd_hist(n), atr_v(n), accel_v(n), slope_v(n);
+    // контекст — на тех же узлах графа (ATR14 не пересчитывается)
+    const ContextSeries ctx = compute_context(g);
 
-    for (size_t i = 0; i < n; ++i) {
-        ema_fast[i] = ema_one(close, 12, i);
-        ema_slow[i] = ema_one(close, 26, i);
-        rsi_v[i]    = rsi_one(close, 14, i);
-        atr_v[i]    = atr_one(high, low, close, 14, i);
-
-        // ускорение и наклон
-        if (i >= 2) {
-            double d1 = close[i] - close[i - 1];
-            double d2 = close[i - 1] - close[i - 2];
-            accel_v[i] = d1 - d2;
-            slope_v[i] = (i >= 3) ? (close[i] - close[i - 3]) : 0.0;
-        } else {
-            accel_v[i] = 0.0;
-            slope_v[i] = 0.0;
-        }
-    }
+    arma::Mat<double> F(n - keep, Spec::dim, arma::fill::zeros);
 
-    // MACD
-    for (size_t i = 0; i < n; ++i) {
-        macd_v[i] = ema_fast[i] - ema_slow[i];
-        double macd_signal = ema_one(macd_v, 9, i);
-        macd_hist[i] = macd_v[i] - macd_signal;
-    }
+    // базовые технические
+    feat_fill(F, FeatCol::TREND,     keep, n, [&](size_t i){ return macd_v[i]; });   // = EMA12 − EMA26
+    feat_fill(F, FeatCol::RSI01,     keep, n, [&](size_t i){ return rsi_v[i] / 100.0; });
+    feat_fill(F, FeatCol::MACD,      keep, n, [&](size_t i){ return macd_v[i]; });
+    feat_fill(F, FeatCol::MACD_HIST, keep, n, [&](size_t i){ return macd_hist[i]; });
+    feat_fill(F, FeatCol::ATR14,     keep, n, [&](size_t i){ return atr_v[i]; });
+    feat_fill(F, FeatCol::ACCEL,     keep, n, [&](size_t i){ return ret_v[i] - ret_v[i - 1]; });
+    feat_fill(F, FeatCol::SLOPE3,    keep, n, [&](size_t i){ return close[i] - close[i - 3]; });
 
     // контекст
-    ContextSeries ctx = compute_context(ts, open, high, low, close, vol);
-
-    // Money Flow (необязательный блок)
-    std::vector<double> mfi, flow_ratio, cum_flow, sfi;
-    if (ENABLE_MFLOW) {
-        mfi        = calc_mfi(high, low, close, vol, 14);
-        flow_ratio = calc_flow_ratio(mfi);
-        cum_flow   = calc_cum_flow(flow_ratio);
-        sfi        = calc_sfi(flow_ratio, mfi);
-    }
+    feat_fill(F, FeatCol::ENERGY,      keep, n, [&](size_t i){ return ctx.energy[i]; });
+    feat_fill(F, FeatCol::LIQUIDITY,   keep, n, [&](size_t i){ return ctx.liquidity[i]; });
+    feat_fill(F, FeatCol::SENTIMENT,   keep, n, [&](size_t i){ return ctx.sentiment[i]; });
+    feat_fill(F, FeatCol::SESSION_SIN, keep, n, [&](size_t i){ return ctx.session_sin[i]; });
+    feat_fill(F, FeatCol::SESSION_COS, keep, n, [&](size_t i){ return ctx.session_cos[i]; });
 
-    // Матрица признаков
-    const size_t D_base = 28;
-    const size_t D_mflow = ENABLE_MFLOW ? 4 : 0;
-    const size_t D = D_base + D_mflow;
+    // one-hot фазы
+    feat_fill(F, FeatCol::PH_EXPANSION,    keep, n, [&](size_t i){ return ctx.phase[i] == 1 ? 1.0 : 0.0; });
+    feat_fill(F, FeatCol::PH_DISTRIBUTION, keep, n, [&](size_t i){ return ctx.phase[i] == 2 ? 1.0 : 0.0; });
+    feat_fill(F, FeatCol::PH_CORRECTION,   keep, n, [&](size_t i){ return ctx.phase[i] == 3 ? 1.0 : 0.0; });
 
-    arma::Mat<double> F(n, D, arma::fill::zeros);
+    // производные
+    feat_fill_k(F, FeatCol::BODY_PCT, keep, n, [&](size_t s, double* out, size_t len){
+        vk::body_pct(open.data() + s, close.data() + s, out, len);   // дневной %
+    });
+    feat_fill(F, FeatCol::RET1,         keep, n, [&](size_t i){ return ret_v[i]; });
+    feat_fill(F, FeatCol::DVOL1,        keep, n, [&](size_t i){ return vol[i] - vol[i - 1]; });
+    feat_fill(F, FeatCol::SMA5_10,      keep, n, [&](size_t i){ return c_sma5[i] - c_sma10[i]; });
+    feat_fill(F, FeatCol::RSI_CENTERED, keep, n, [&](size_t i){ return (rsi_v[i] - 50.0) / 50.0; });
+    feat_fill_k(F, FeatCol::MACD_ATR,   keep, n, [&](size_t s, double* out, size_t len){
+        vk::abs_ratio_eps(macd_v.data() + s, atr_v.data() + s, 1e-8, out, len); });
+    feat_fill_k(F, FeatCol::VOL_RATIO,  keep, n, [&](size_t s, double* out, size_t len){
+        vk::ratio_eps(v_sma10.data() + s, v_sma20.data() + s, 1e-8, out, len); });
+    feat_fill_k(F, FeatCol::ATR_RATIO,  keep, n, [&](size_t s, double* out, size_t len){
+        vk::ratio_eps(atr_sma10.data() + s, atr_sma20.data() + s, 1e-8, out, len); });
+    feat_fill(F, FeatCol::BULL_CONF,    keep, n, [&](size_t i){ return (macd_v[i] > 0 && rsi_v[i] > 50) ? 1.0 : 0.0; });
+    feat_fill(F, FeatCol::BEAR_CONF,    keep, n, [&](size_t i){ return (macd_v[i] < 0 && rsi_v[i] < 50) ? 1.0 : 0.0; });
+    feat_fill(F, FeatCol::ENERGY_DIR,   keep, n, [&](size_t i){ return ctx.energy[i] * (macd_v[i] > 0 ? 1 : -1); });
+    feat_fill(F, FeatCol::SENT_ENERGY,  keep, n, [&](size_t i){ return ctx.sentiment[i] * (ctx.energy[i]); });
+    feat_fill(F, FeatCol::CORR_BEAR,    keep, n, [&](size_t i){ return (ctx.phase[i] == 3 && ctx.sentiment[i] < 0) ? 1.0 : 0.0; });
 
-    for (size_t i = 0; i < n; ++i) {
-        // базовые технические
-        F(i, 0) = ema_fast[i] - ema_slow[i];   // trend spread
-        F(i, 1) = rsi_v[i] / 100.0;            // RSI
-        F(i, 2) = macd_v[i];
-        F(i, 3) = macd_hist[i];
-        F(i, 4) = atr_v[i];
-        F(i, 5) = accel_v[i];
-        F(i, 6) = slope_v[i];
-
-        // контекст
-        F(i, 7)  = ctx.energy[i];
-        F(i, 8)  = ctx.liquidity[i];
-        F(i, 9)  = ctx.sentiment[i];
-        F(i, 10) = ctx.session_sin[i];
-        F(i, 11) = ctx.session_cos[i];
-
-        // one-hot фазы
-        int ph = ctx.phase[i];
-        F(i, 12) = (ph == 1) ? 1.0 : 0.0; // expansion
-        F(i, 13) = (ph == 2) ? 1.0 : 0.0; // distribution
-        F(i, 14) = (ph == 3) ? 1.0 : 0.0; // correction
-
-        // производные
-        double diff = close[i] - open[i];
-        F(i, 15) = (open[i] > 0) ? diff / open[i] : 0.0; // дневной %
-        F(i, 16) = (i > 0) ? close[i] - close[i - 1] : 0.0;
-        F(i, 17) = (i > 0) ? (vol[i] - vol[i - 1]) : 0.0;
-        F(i, 18) = (i >= 5)  ? sma_one(close, 5, i) - sma_one(close, 10, i) : 0.0;
-        F(i, 19) = (i >= 14) ? (rsi_one(close, 14, i) - 50.0) / 50.0 : 0.0;
-        F(i, 20) = std::fabs(ema_fast[i] - ema_slow[i]) / (atr_v[i] + 1e-8);
-        F(i, 21) = (i >= 10) ? sma_one(vol, 10, i) / (sma_one(vol, 20, i) + 1e-8) : 0.0;
-        F(i, 22) = (i >= 20) ? sma_one(atr_v, 10, i) / (sma_one(atr_v, 20, i) + 1e-8) : 0.0;
-        F(i, 23) = (macd_v[i] > 0 && rsi_v[i] > 50) ? 1.0 : 0.0;
-        F(i, 24) = (macd_v[i] < 0 && rsi_v[i] < 50) ? 1.0 : 0.0;
-        F(i, 25) = ctx.energy[i] * (macd_v[i] > 0 ? 1 : -1);
-        F(i, 26) = ctx.sentiment[i] * (ctx.energy[i]);
-        F(i, 27) = (ctx.phase[i] == 3 && ctx.sentiment[i] < 0) ? 1.0 : 0.0;
-
-        // --- Money Flow block (опционально) ---
-        if (ENABLE_MFLOW) {
-            size_t k = D_base;
-            // Нормировки: MFI -> [0..1], cum_flow/sfi уже ~[-1..1]
-            double mfi01 = (i < mfi.size() && std::isfinite(mfi[i])) ? (mfi[i] / 100.0) : 0.5;
-            double fr    = (i < flow_ratio.size() && std::isfinite(flow_ratio[i])) ? flow_ratio[i] : 0.5;
-            double cf    = (i < cum_flow.size()   && std::isfinite(cum_flow[i]))   ? cum_flow[i]   : 0.0;
-            double sfi_v = (i < sfi.size()        && std::isfinite(sfi[i]))        ? sfi[i]        : 0.0;
-            F(i, k+0) = mfi01;
-            F(i, k+1) = fr;
-            F(i, k+2) = cf;
-            F(i, k+3) = sfi_v;
-        }
+    // Money Flow (v10). cum_flow нормируется по всему ряду, поэтому блок всегда
+    // считается по полному виду bars (колонки источника, без копий); строка i — бар from + i.
+    if constexpr (Spec::mflow) {
+        const std::vector<double> mfi        = calc_mfi(bars.high, bars.low, bars.close, bars.volume, 14);
+        const std::vector<double> flow_ratio = calc_flow_ratio(mfi);
+        const std::vector<double> cum_flow   = calc_cum_flow(flow_ratio);
+        const std::vector<double> sfi        = calc_sfi(flow_ratio, mfi);
+        // Нормировки: MFI -> [0..1], cum_flow/sfi уже ~[-1..1]
+        feat_fill(F, FeatCol::MFI01, keep, n, [&](size_t i){
+            const double x = mfi[from + i];        return std::isfinite(x) ? x / 100.0 : 0.5; });
+        feat_fill(F, FeatCol::FLOW_RATIO, keep, n, [&](size_t i){
+            const double x = flow_ratio[from + i]; return std::isfinite(x) ? x : 0.5; });
+        feat_fill(F, FeatCol::CUM_FLOW, keep, n, [&](size_t i){
+            const double x = cum_flow[from + i];   return std::isfinite(x) ? x : 0.0; });
+        feat_fill(F, FeatCol::SFI, keep, n, [&](size_t i){
+            const double x = sfi[from + i];        return std::isfinite(x) ? x : 0.0; });
     }
 
     F.replace(arma::datum::nan, 0.0);
     return F;
 }
 
+template<class Spec>
+static arma::Mat<double> feat_build_tail(const BarsView& bars, size_t k) {
+    const size_t n = bars.size();
+    k = std::min(std::max<size_t>(k, 1), n);
+    // короткий ряд — прогрева не хватает, считаем целиком и отдаём хвост
+    if (n - k < Spec::tail_warmup + 30) return feat_build_rows<Spec>(bars, 0, n - k);
+    return feat_build_rows<Spec>(bars, n - k - Spec::tail_warmup, Spec::tail_warmup);
+}
+
+// Версия → инстанс FeatSpec; неизвестная версия — пустая матрица
+template<class Fn>
+static arma::Mat<double> feat_dispatch(int version, Fn&& fn) {
+    switch (version) {
+        case FEAT_V9:  return fn(FeatSpec<FEAT_V9>{});
+        case FEAT_V10: return fn(FeatSpec<FEAT_V10>{});
+        default:       return arma::Mat<double>();
+    }
+}
+
+arma::Mat<double> build_feature_matrix(const BarsView& bars, int version) {
+    if (bars.size() < 30) return arma::Mat<double>();
+    return feat_dispatch(version, [&](auto spec) {
+        return feat_build_rows<decltype(spec)>(bars, 0, 0);
+    });
+}
+
+arma::Mat<double> build_feature_matrix(const arma::Mat<double>& raw, int version) {
+    return build_feature_matrix(bars_view(raw), version);
+}
+
+arma::Mat<double> build_feature_tail(const BarsView& bars, size_t k, int version) {
+    if (bars.size() < 30) return arma::Mat<double>();
+    return feat_dispatch(version, [&](auto spec) {
+        return feat_build_tail<decltype(spec)>(bars, k);
+    });
+}
+
+arma::Mat<double> build_feature_tail(const arma::Mat<double>& raw, size_t k, int version) {
+    return build_feature_tail(bars_view(raw), k, version);
+}
+
+// ---------- классические индикаторы (features.h) ----------
+// В отличие от окон build_feature_matrix — рекурсивные EMA и Wilder-сглаживание.
+static DSpan fv_span(const arma::vec& x) {
+    return DSpan(x.memptr(), x.n_elem);
+}
+static arma::vec fv_to_vec(const std::vector<double>& v) {
+    arma::vec out(v.size());
+    std::copy(v.begin(), v.end(), out.memptr());
+    return out;
+}
+
+arma::vec compute_rsi(const arma::vec& close, int period) {
+    return fv_to_vec(rk::rsi_wilder(fv_span(close), period));
+}
+
+arma::vec compute_ema(const arma::vec& x, int period) {
+    return fv_to_vec(rk::ema(fv_span(x), period));
+}
+
+arma::vec compute_atr(const arma::vec& high, const arma::vec& low, const arma::vec& close, int period) {
+    return fv_to_vec(rk::atr_wilder(fv_span(high), fv_span(low), fv_span(close), period));
+}
+
+// колонки: macd, signal, hist
+arma::mat compute_macd(const arma::vec& close, int fast, int slow, int signal) {
+    const DSpan c = fv_span(close);
+    const std::vector<double> ef = rk::ema(c, fast);
+    const std::vector<double> es = rk::ema(c, slow);
+    const size_t n = c.size();
+    std::vector<double> macd(n), hist(n);
+    for (size_t i = 0; i < n; ++i) macd[i] = ef[i] - es[i];
+    // сигнальная сеется с первого полного окна MACD
+    std::vector<double> sig(n, NAN);
+    rk::Ema sig_ema(signal);
+    for (size_t i = 0; i < n; ++i) if (std::isfinite(macd[i])) sig[i] = sig_ema.push(macd[i]);
+    for (size_t i = 0; i < n; ++i) hist[i] = macd[i] - sig[i];
+    arma::mat out(n, 3);
+    for (size_t i = 0; i < n; ++i) { out(i, 0) = macd[i]; out(i, 1) = sig[i]; out(i, 2) = hist[i]; }
+    return out;
+}
+
+// колонки: sma, width = (upper − lower)/sma при ±2σ
+arma::mat compute_bb_width(const arma::vec& close, int period) {
+    const DSpan c = fv_span(close);
+    const size_t n = c.size();
+    std::vector<double> c2(n);
+    for (size_t i = 0; i < n; ++i) c2[i] = c[i] * c[i];
+    const std::vector<double> m  = rk::sma(c, period);
+    const std::vector<double> m2 = rk::sma(c2, period);
+    arma::mat out(n, 2);
+    for (size_t i = 0; i < n; ++i) {
+        const double var = std::max(0.0, m2[i] - m[i] * m[i]);
+        out(i, 0) = m[i];
+        out(i, 1) = (m[i] != 0.0) ? 4.0 * std::sqrt(var) / m[i] : NAN;
+    }
+    return out;
+}
+
+arma::vec compute_momentum(const arma::vec& close, int period) {
+    const size_t n = close.n_elem;
+    arma::vec out(n);
+    for (size_t i = 0; i < n; ++i)
+        out(i) = (period > 0 && i >= (size_t)period) ? close(i) - close(i - period) : NAN;
+    return out;
+}
+
 // ---------- JSON экспортер ----------
 json make_features(const std::vector<double>& o,
                    const std::vector<double>& h,
                    const std::vector<double>& l,
                    const std::vector<double>& c,
                    const std::vector<double>& v) {
-    arma::Mat<double> raw(o.size(), 6, arma::fill::zeros);
-    for (size_t i = 0; i < o.size(); ++i) {
-        raw(i, 1) = o[i];
-        raw(i, 2) = h[i];
-        raw(i, 3) = l[i];
-        raw(i, 4) = c[i];
-        raw(i, 5) = v[i];
-    }
-    arma::Mat<double> F = build_feature_matrix(raw);
+    // вид прямо над входными векторами (ts нет → 0, как раньше нулевая колонка)
+    BarsView bars;
+    bars.open = o; bars.high = h; bars.low = l; bars.close = c; bars.volume = v;
+    const int version = feature_version();
+    arma::Mat<double> F = build_feature_matrix(bars, version);
     json out;
-    // Версию поднимаем до 10 только если включен Money Flow
-    out["version"] = env_enabled("ETAI_FEAT_ENABLE_MFLOW") ? 10 : FEAT_VERSION_BASE;
+    out["version"] = version;
     out["rows"] = F.n_rows;
     out["cols"] = F.n_cols;
     return out;
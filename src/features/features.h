@@ -1,9 +1,17 @@
 #pragma once
 #include <armadillo>
+#include "bars_view.h"
+#include "feature_spec.h"
 
 // Построение набора признаков (RSI, EMA, MACD, ATR, BB-width, Momentum)
 namespace etai {
-    arma::mat build_feature_matrix(const arma::mat& ohlcv);
+    // Вход — вид на серию (bars_view.h); перегрузки с N×6 матрицей — тот же расчёт над её колонками.
+    // version — версия признаков (feature_spec.h: 9 → 28 колонок, 10 → 32); неизвестная — пустая матрица
+    arma::mat build_feature_matrix(const BarsView& bars, int version = feature_version());
+    arma::mat build_feature_matrix(const arma::mat& ohlcv, int version = feature_version());
+    // Только последние k строк build_feature_matrix (те же значения), стоимость O(k + прогрев версии)
+    arma::mat build_feature_tail(const BarsView& bars, size_t k = 1, int version = feature_version());
+    arma::mat build_feature_tail(const arma::mat& ohlcv, size_t k = 1, int version = feature_version());
 
     arma::vec compute_rsi(const arma::vec& close, int period=14);
     arma::vec compute_ema(const arma::vec& x, int period);
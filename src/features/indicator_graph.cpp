@@ -0,0 +1,97 @@
+#include "indicator_graph.h"
+#include "rolling_kernels.h"
+
+namespace etai {
+
+const char* ind_name(Ind id) {
+    switch (id) {
+        case Ind::Returns:     return "returns";
+        case Ind::TR:          return "tr";
+        case Ind::ATR14:       return "atr14";
+        case Ind::ATR14_AVG14: return "atr14_avg14";
+        case Ind::EMA12:       return "ema12";
+        case Ind::EMA26:       return "ema26";
+        case Ind::MACD:        return "macd";
+        case Ind::MACD_SIG9:   return "macd_sig9";
+        case Ind::MACD_HIST:   return "macd_hist";
+        case Ind::RSI14:       return "rsi14";
+        case Ind::VOL_MAX21:   return "vol_max21";
+        case Ind::Count:       break;
+    }
+    return "?";
+}
+
+IndicatorGraph::IndicatorGraph(const BarsView& bars, size_t phase) : bars_(bars), phase_(phase) {}
+
+IndicatorGraph::IndicatorGraph(const arma::mat& raw, size_t from)
+    : bars_(bars_view(raw).slice(from)), phase_(from) {}
+
+const std::vector<double>& IndicatorGraph::get(Ind id) {
+    const size_t k = (size_t)id;
+    std::call_once(once_[k], [&]{ compute(id); done_[k].store(true, std::memory_order_release); });
+    return node_[k];
+}
+
+bool IndicatorGraph::computed(Ind id) const {
+    return done_[(size_t)id].load(std::memory_order_acquire);
+}
+
+unsigned IndicatorGraph::computed_count() const {
+    unsigned c = 0;
+    for (const auto& d : done_) c += d.load(std::memory_order_acquire) ? 1u : 0u;
+    return c;
+}
+
+// Зависимости берутся через get() — их once_flag другие, рекурсия безопасна
+void IndicatorGraph::compute(Ind id) {
+    const size_t n = size();
+    std::vector<double>& out = node_[(size_t)id];
+    switch (id) {
+        case Ind::Returns:
+            out.assign(n, rk::NaN);
+            for (size_t i = 1; i < n; ++i) out[i] = bars_.close[i] - bars_.close[i - 1];
+            break;
+        case Ind::TR:
+            out = rk::true_range(bars_.high, bars_.low, bars_.close);
+            break;
+        case Ind::ATR14:
+            out = rk::atr_sma_tr(get(Ind::TR), 14, phase_);
+            break;
+        case Ind::ATR14_AVG14:
+            out = rk::sma(get(Ind::ATR14), 14, phase_);
+            break;
+        case Ind::EMA12:
+            out = rk::window_ema(bars_.close, 12, phase_);
+            break;
+        case Ind::EMA26:
+            out = rk::window_ema(bars_.close, 26, phase_);
+            break;
+        case Ind::MACD: {
+            const auto& f = get(Ind::EMA12);
+            const auto& s = get(Ind::EMA26);
+            out.resize(n);
+            for (size_t i = 0; i < n; ++i) out[i] = f[i] - s[i];
+            break;
+        }
+        case Ind::MACD_SIG9:
+            out = rk::window_ema(get(Ind::MACD), 9, phase_);
+            break;
+        case Ind::MACD_HIST: {
+            const auto& m = get(Ind::MACD);
+            const auto& s = get(Ind::MACD_SIG9);
+            out.resize(n);
+            for (size_t i = 0; i < n; ++i) out[i] = m[i] - s[i];
+            break;
+        }
+        case Ind::RSI14:
+            out = rk::rsi_window(bars_.close, 14, phase_);
+            break;
+        case Ind::VOL_MAX21:
+            out = rk::rolling_max(bars_.volume, 21);
+            break;
+        case Ind::Count:
+            break;
+    }
+}
+
+} // namespace etai
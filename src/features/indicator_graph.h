@@ -0,0 +1,80 @@
+#pragma once
+#include <armadillo>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "bars_view.h"
+
+// ============================================================================
+// Граф промежуточных рядов индикаторов над одной серией баров.
+// Узел (returns, TR, ATR14, EMA12/26, MACD, RSI14, …) считается один раз —
+// при первом обращении, вместе с зависимостями (MACD → EMA12/EMA26, ATR14 → TR),
+// и дальше отдаётся по ссылке всем потребителям: матрице признаков, контексту,
+// диагностике. Граф живёт столько, сколько его владелец (запрос / сборка матрицы).
+// Бары граф не копирует — держит BarsView над источником (bars_view.h).
+// Семантика окон — rolling_kernels (phase — абсолютный индекс первого бара среза),
+// поэтому значения совпадают с прежними прямыми вызовами rk:: бит-в-бит.
+// ============================================================================
+
+namespace etai {
+
+enum class Ind : int {
+    Returns = 0,   // close[i] − close[i−1] (NaN на первом баре)
+    TR,            // true range (NaN на первом баре)
+    ATR14,         // SMA(TR, 14) — семантика atr_one/ctx_atr_one
+    ATR14_AVG14,   // SMA(ATR14, 14) — база энергии контекста
+    EMA12,         // оконные EMA (ema_one)
+    EMA26,
+    MACD,          // EMA12 − EMA26
+    MACD_SIG9,     // оконная EMA(MACD, 9)
+    MACD_HIST,     // MACD − сигнальная
+    RSI14,         // RSI по суммам окна (rsi_one)
+    VOL_MAX21,     // rolling max(volume, 21) — ликвидность контекста
+    Count
+};
+
+const char* ind_name(Ind id);
+
+class IndicatorGraph {
+public:
+    // Вид на серию; phase — абсолютный индекс первого бара вида в ряду
+    explicit IndicatorGraph(const BarsView& bars, size_t phase = 0);
+    // Срез raw[from, N) матрицы N×6 (ts,open,high,low,close,vol); phase = from.
+    // Матрица должна пережить граф (колонки не копируются)
+    explicit IndicatorGraph(const arma::mat& raw, size_t from = 0);
+
+    IndicatorGraph(const IndicatorGraph&) = delete;
+    IndicatorGraph& operator=(const IndicatorGraph&) = delete;
+
+    size_t size()  const { return bars_.size(); }
+    size_t phase() const { return phase_; }
+
+    const BarsView& bars()   const { return bars_; }
+    DSpan           open()   const { return bars_.open; }
+    DSpan           high()   const { return bars_.high; }
+    DSpan           low()    const { return bars_.low; }
+    DSpan           close()  const { return bars_.close; }
+    DSpan           volume() const { return bars_.volume; }
+
+    // Ряд узла (считается при первом обращении; потокобезопасно)
+    const std::vector<double>& get(Ind id);
+    const std::vector<double>& operator[](Ind id) { return get(id); }
+
+    bool     computed(Ind id) const;
+    unsigned computed_count() const;   // сколько узлов посчитано (диагностика)
+
+private:
+    void compute(Ind id);
+
+    BarsView bars_;
+    size_t phase_ = 0;
+
+    static constexpr size_t N_IND = (size_t)Ind::Count;
+    std::array<std::vector<double>, N_IND> node_;
+    std::array<std::once_flag, N_IND>      once_;
+    std::array<std::atomic<bool>, N_IND>   done_{};
+};
+
+} // namespace etai
@@ -3,13 +3,8 @@
 #include <algorithm>
 namespace etai {
 
-std::vector<int> false_break_flags(const std::vector<double>& open,
-                                   const std::vector<double>& high,
-                                   const std::vector<double>& low,
-                                   const std::vector<double>& close,
-                                   const std::vector<double>& sup,
-                                   const std::vector<double>& res,
-                                   double tol)
+std::vector<int> false_break_flags(DSpan open, DSpan high, DSpan low, DSpan close,
+                                   DSpan sup, DSpan res, double tol)
 {
     const size_t n = close.size();
     std::vector<int> f(n, 0);
@@ -26,10 +21,7 @@ std::vector<int> false_break_flags(const std::vector<double>& open,
     return f;
 }
 
-std::vector<double> trap_index_series(const std::vector<double>& open,
-                                      const std::vector<double>& high,
-                                      const std::vector<double>& low,
-                                      const std::vector<double>& close)
+std::vector<double> trap_index_series(DSpan open, DSpan high, DSpan low, DSpan close)
 {
     const size_t n = close.size();
     std::vector<double> t(n, 0.0);
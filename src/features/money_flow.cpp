@@ -1,33 +1,21 @@
 #include "money_flow.h"
+#include "rolling_kernels.h"
 #include <algorithm>
 #include <cmath>
 #include <numeric>
 
 namespace etai {
 
-std::vector<double> calc_mfi(const std::vector<double>& high,
-                             const std::vector<double>& low,
-                             const std::vector<double>& close,
-                             const std::vector<double>& volume,
-                             int period)
+std::vector<double> calc_mfi(DSpan high, DSpan low, DSpan close, DSpan volume, int period)
 {
     const size_t n = close.size();
     std::vector<double> mfi(n, 50.0);
     if (n < static_cast<size_t>(period) + 2) return mfi;
 
-    std::vector<double> tp(n), mf(n);
-    for (size_t i = 0; i < n; ++i) {
-        tp[i] = (high[i] + low[i] + close[i]) / 3.0;
-        mf[i] = tp[i] * volume[i];
-    }
-
+    std::vector<double> pos, neg;
+    rk::mfi_flow_sums(high, low, close, volume, period, pos, neg);
     for (size_t i = period; i < n; ++i) {
-        double pos = 0.0, neg = 0.0;
-        for (size_t j = i - period + 1; j <= i; ++j) {
-            if (tp[j] > tp[j - 1])       pos += mf[j];
-            else if (tp[j] < tp[j - 1])  neg += mf[j];
-        }
-        const double ratio = (neg <= 0.0) ? 100.0 : pos / neg;
+        const double ratio = (neg[i] <= 0.0) ? 100.0 : pos[i] / neg[i];
         mfi[i] = 100.0 - (100.0 / (1.0 + ratio));
     }
     return mfi;
@@ -65,6 +53,28 @@ std::vector<double> calc_cum_flow(const std::vector<double>& flow_ratio)
     return cf;
 }
 
+std::vector<double> calc_cum_flow_prefix(const std::vector<double>& flow_ratio)
+{
+    const size_t n = flow_ratio.size();
+    std::vector<double> cf(n, 0.0);
+    double run = 0.0, total = 0.0, lo = 0.0, hi = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        run += std::isfinite(flow_ratio[i]) ? (flow_ratio[i] - 0.5) : 0.0;
+        total += run;
+        if (i == 0) { lo = hi = run; }
+        else { lo = std::min(lo, run); hi = std::max(hi, run); }
+        double v = run;
+        if (i >= 1) {
+            const double mean   = total / static_cast<double>(i + 1);
+            const double maxdev = std::max(std::fabs(hi - mean), std::fabs(lo - mean));
+            const double scale  = (maxdev > 0.0) ? (1.0 / maxdev) : 1.0;
+            v = (run - mean) * scale;
+        }
+        cf[i] = v;
+    }
+    return cf;
+}
+
 std::vector<double> calc_sfi(const std::vector<double>& flow_ratio,
                              const std::vector<double>& mfi)
 {
@@ -1,14 +1,11 @@
 #pragma once
 #include <vector>
+#include "bars_view.h"
 
 namespace etai {
 
-// Money Flow Index (MFI), период по умолчанию 14
-std::vector<double> calc_mfi(const std::vector<double>& high,
-                             const std::vector<double>& low,
-                             const std::vector<double>& close,
-                             const std::vector<double>& volume,
-                             int period = 14);
+// Money Flow Index (MFI), период по умолчанию 14 (колонки — виды серии, без копий)
+std::vector<double> calc_mfi(DSpan high, DSpan low, DSpan close, DSpan volume, int period = 14);
 
 // Потоковый коэффициент ~ [0..1] на основе MFI (упрощённо: MFI/100)
 std::vector<double> calc_flow_ratio(const std::vector<double>& mfi);
@@ -16,6 +13,10 @@ std::vector<double> calc_flow_ratio(const std::vector<double>& mfi);
 // Кумулятивный поток (центрирован и нормирован к [-1..1] условно)
 std::vector<double> calc_cum_flow(const std::vector<double>& flow_ratio);
 
+// То же, но бар i нормирован по префиксу [0..i] (среднее и max|отклонения| до i) —
+// без заглядывания вперёд; арифметика — как у потокового FeatureState
+std::vector<double> calc_cum_flow_prefix(const std::vector<double>& flow_ratio);
+
 // SFI — Smart Flow Index: взвешенный поток ([-1..1])
 std::vector<double> calc_sfi(const std::vector<double>& flow_ratio,
                              const std::vector<double>& mfi);
@@ -0,0 +1,245 @@
+#include "rolling_kernels.h"
+#include <algorithm>
+
+namespace etai {
+namespace rk {
+
+// ---------- RollingSum ----------
+RollingSum::RollingSum(int p, size_t phase)
+    : p_(std::max(1, p)), head_((int)(phase % (size_t)std::max(1, p))), buf_((size_t)std::max(1, p), 0.0) {}
+
+void RollingSum::push(double x) {
+    if (filled_ == p_) {
+        const double out = buf_[head_];
+        if (std::isnan(out)) --nan_;
+        else { s_ -= out; if (out != 0.0) --nz_; }
+    } else {
+        ++filled_;
+    }
+    buf_[head_] = x;
+    if (std::isnan(x)) ++nan_;
+    else { s_ += x; if (x != 0.0) ++nz_; }
+    if (++head_ == p_) head_ = 0;
+
+    if (head_ == 0 && filled_ == p_) {
+        // раз в окно (на абсолютной позиции, кратной p) — точный пересчёт от старого к новому
+        double s = 0.0;
+        for (int j = 0; j < p_; ++j) if (!std::isnan(buf_[j])) s += buf_[j];
+        s_ = s;
+    } else if (nz_ == 0) {
+        s_ = 0.0;   // окно из нулей: сравнения "== 0" (RSI/MFI) должны срабатывать точно
+    }
+}
+
+double RollingSum::sum() const {
+    if (filled_ < p_ || nan_ > 0) return NaN;
+    return (nz_ == 0) ? 0.0 : s_;
+}
+
+// ---------- RollingVar ----------
+RollingVar::RollingVar(int p) : p_(std::max(2, p)), buf_((size_t)std::max(2, p), 0.0) {}
+
+void RollingVar::push(double x) {
+    if (filled_ < p_) {
+        ++filled_;
+        const double d = x - m_;
+        m_  += d / filled_;
+        m2_ += d * (x - m_);
+    } else {
+        const double y = buf_[head_];
+        const double m_new = m_ + (x - y) / p_;
+        m2_ += (x - y) * (x - m_new + y - m_);
+        m_ = m_new;
+    }
+    buf_[head_] = x;
+    if (++head_ == p_) head_ = 0;
+
+    if (head_ == 0 && filled_ == p_) {
+        double s = 0.0;
+        for (int j = 0; j < p_; ++j) s += buf_[j];
+        m_ = s / p_;
+        double q = 0.0;
+        for (int j = 0; j < p_; ++j) { const double d = buf_[j] - m_; q += d * d; }
+        m2_ = q;
+    }
+}
+
+double RollingVar::var() const {
+    if (filled_ < 2) return 0.0;
+    return std::max(0.0, m2_ / (filled_ - 1));
+}
+
+// ---------- WindowEma ----------
+WindowEma::WindowEma(int p, size_t phase)
+    : p_(std::max(1, p)),
+      head_((int)(phase % (size_t)std::max(1, p))),
+      k_(2.0 / (std::max(1, p) + 1)),
+      q_(1.0 - 2.0 / (std::max(1, p) + 1)),
+      qp_(std::pow(1.0 - 2.0 / (std::max(1, p) + 1), std::max(1, p))),
+      buf_((size_t)std::max(1, p), 0.0) {}
+
+double WindowEma::recompute() const {
+    // дословно ema_one: сид — старейший элемент окна
+    double e = buf_[head_];
+    for (int t = 1; t < p_; ++t) e = buf_[(head_ + t) % p_] * k_ + e * (1.0 - k_);
+    return e;
+}
+
+double WindowEma::push(double x) {
+    double dropped = NaN;
+    if (filled_ == p_) {
+        dropped = buf_[head_];
+        if (std::isnan(dropped)) --nan_;
+    } else {
+        ++filled_;
+    }
+    buf_[head_] = x;
+    if (std::isnan(x)) ++nan_;
+    if (++head_ == p_) head_ = 0;
+
+    if (filled_ < p_ || nan_ > 0) { valid_ = false; return NaN; }
+    if (!valid_ || head_ == 0) { e_ = recompute(); valid_ = true; return e_; }
+    e_ = q_ * e_ + k_ * x + qp_ * (buf_[head_] - dropped);
+    return e_;
+}
+
+// ---------- Ema / Wilder ----------
+double Ema::push(double x) {
+    seed_.push(x);
+    if (std::isnan(e_)) { if (seed_.ready()) e_ = seed_.mean(); return e_; }
+    e_ = a_ * x + (1.0 - a_) * e_;
+    return e_;
+}
+
+double Wilder::push(double x) {
+    seed_.push(x);
+    if (std::isnan(e_)) { if (seed_.ready()) e_ = seed_.mean(); return e_; }
+    e_ = e_ + (x - e_) / p_;
+    return e_;
+}
+
+// ---------- batch ----------
+template<class Acc, class F>
+static std::vector<double> run_acc(DSpan v, Acc acc, F f) {
+    std::vector<double> out(v.size());
+    for (size_t i = 0; i < v.size(); ++i) out[i] = f(acc, v[i]);
+    return out;
+}
+
+std::vector<double> rolling_sum(DSpan v, int p, size_t phase) {
+    return run_acc(v, RollingSum(p, phase), [](RollingSum& a, double x){ a.push(x); return a.sum(); });
+}
+
+std::vector<double> sma(DSpan v, int p, size_t phase) {
+    if (p <= 0) return std::vector<double>(v.size(), NaN);
+    return run_acc(v, RollingSum(p, phase), [](RollingSum& a, double x){ a.push(x); return a.mean(); });
+}
+
+std::vector<double> window_ema(DSpan v, int p, size_t phase) {
+    return run_acc(v, WindowEma(p, phase), [](WindowEma& a, double x){ return a.push(x); });
+}
+
+std::vector<double> ema(DSpan v, int p) {
+    return run_acc(v, Ema(p), [](Ema& a, double x){ return a.push(x); });
+}
+
+std::vector<double> wilder(DSpan v, int p) {
+    return run_acc(v, Wilder(p), [](Wilder& a, double x){ return a.push(x); });
+}
+
+std::vector<double> rolling_stddev(DSpan v, int p) {
+    return run_acc(v, RollingVar(p), [](RollingVar& a, double x){ a.push(x); return a.stddev(); });
+}
+
+std::vector<double> true_range(DSpan h, DSpan l, DSpan c) {
+    const size_t n = c.size();
+    std::vector<double> tr(n, NaN);
+    for (size_t j = 1; j < n; ++j)
+        tr[j] = std::max({h[j] - l[j], std::fabs(h[j] - c[j - 1]), std::fabs(l[j] - c[j - 1])});
+    return tr;
+}
+
+std::vector<double> atr_sma(DSpan h, DSpan l, DSpan c, int p, size_t phase) {
+    return atr_sma_tr(true_range(h, l, c), p, phase);
+}
+
+std::vector<double> atr_sma_tr(DSpan tr, int p, size_t phase) {
+    const size_t n = tr.size();
+    std::vector<double> out(n, NaN);
+    RollingSum s(p, phase);
+    for (size_t j = 1; j < n; ++j) {
+        s.push(tr[j]);
+        if (j >= (size_t)p) out[j] = s.mean();
+    }
+    return out;
+}
+
+std::vector<double> atr_wilder(DSpan h, DSpan l, DSpan c, int p) {
+    const size_t n = c.size();
+    std::vector<double> out(n, NaN);
+    Wilder w(p);
+    for (size_t j = 1; j < n; ++j)
+        out[j] = w.push(std::max({h[j] - l[j], std::fabs(h[j] - c[j - 1]), std::fabs(l[j] - c[j - 1])}));
+    return out;
+}
+
+std::vector<double> rsi_window(DSpan c, int p, size_t phase) {
+    const size_t n = c.size();
+    std::vector<double> out(n, NaN);
+    RollingSum gain(p, phase), loss(p, phase);
+    for (size_t j = 1; j < n; ++j) {
+        const double diff = c[j] - c[j - 1];
+        if (diff >= 0) { gain.push(diff); loss.push(0.0); }
+        else           { gain.push(0.0);  loss.push(-diff); }
+        if (j < (size_t)p) continue;
+        const double g = gain.sum(), ls = loss.sum();
+        out[j] = (ls == 0) ? 100.0 : 100.0 - (100.0 / (1.0 + g / ls));
+    }
+    return out;
+}
+
+std::vector<double> rsi_wilder(DSpan c, int p) {
+    const size_t n = c.size();
+    std::vector<double> out(n, NaN);
+    Wilder gain(p), loss(p);
+    for (size_t j = 1; j < n; ++j) {
+        const double diff = c[j] - c[j - 1];
+        const double g  = gain.push(diff > 0 ? diff : 0.0);
+        const double ls = loss.push(diff < 0 ? -diff : 0.0);
+        if (std::isnan(g) || std::isnan(ls)) continue;
+        out[j] = (ls == 0) ? 100.0 : 100.0 - (100.0 / (1.0 + g / ls));
+    }
+    return out;
+}
+
+std::vector<double> rolling_max(DSpan v, int w) {
+    return run_acc(v, RollingMax(w), [](RollingMax& a, double x){ a.push(x); return a.value(); });
+}
+
+std::vector<double> rolling_min(DSpan v, int w) {
+    return run_acc(v, RollingMin(w), [](RollingMin& a, double x){ a.push(x); return a.value(); });
+}
+
+void mfi_flow_sums(DSpan h, DSpan l, DSpan c, DSpan vol, int p,
+                   std::vector<double>& pos,
+                   std::vector<double>& neg,
+                   size_t phase) {
+    const size_t n = c.size();
+    pos.assign(n, NaN);
+    neg.assign(n, NaN);
+    RollingSum sp(p, phase), sn(p, phase);
+    double tp_prev = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+        const double tp = (h[j] + l[j] + c[j]) / 3.0;
+        if (j >= 1) {
+            const double mf = tp * vol[j];
+            sp.push(tp > tp_prev ? mf : 0.0);
+            sn.push(tp < tp_prev ? mf : 0.0);
+            if (j >= (size_t)p) { pos[j] = sp.sum(); neg[j] = sn.sum(); }
+        }
+        tp_prev = tp;
+    }
+}
+
+} // namespace rk
+} // namespace etai
@@ -0,0 +1,145 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "bars_view.h"
+
+// ============================================================================
+// Общие O(n) роллинг-ядра для признаков, контекста, Money Flow и уровней.
+// Потоковые аккумуляторы (push по одному значению) + batch-обёртки над ними,
+// поэтому batch и потоковый расчёт (FeatureState) дают одинаковые числа.
+// NaN-семантика как у прежних *_one: окно неполное или содержит NaN → NaN.
+// phase — абсолютный индекс первого элемента среза: точные пересчёты окон
+// привязаны к абсолютной позиции, поэтому расчёт по хвосту ряда после прогрева
+// совпадает с расчётом по всему ряду бит-в-бит (build_feature_tail).
+// ============================================================================
+
+namespace etai {
+namespace rk {
+
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+// Скользящая сумма окна p; раз в p шагов — точный пересчёт (порядок как у цикла j=i-p+1..i)
+class RollingSum {
+public:
+    explicit RollingSum(int p = 1, size_t phase = 0);
+    void   push(double x);
+    bool   ready() const { return filled_ == p_; }
+    double sum()   const;                       // NaN, если окно неполное или есть NaN
+    double mean()  const { return sum() / p_; }
+private:
+    int p_, head_ = 0, filled_ = 0, nan_ = 0, nz_ = 0;
+    double s_ = 0.0;
+    std::vector<double> buf_;
+};
+
+// Скользящая выборочная дисперсия окна p (Welford со сдвигом: добавить x, убрать x[i-p]);
+// раз в p шагов — точный двухпроходный пересчёт, чтобы не копить ошибку
+class RollingVar {
+public:
+    explicit RollingVar(int p = 2);
+    void   push(double x);
+    bool   ready()  const { return filled_ == p_; }
+    int    count()  const { return filled_; }
+    double mean()   const { return filled_ ? m_ : NaN; }
+    double var()    const;                      // (n−1)-знаменатель, по заполненной части окна
+    double stddev() const { return std::sqrt(var()); }
+private:
+    int p_, head_ = 0, filled_ = 0;
+    double m_ = 0.0, m2_ = 0.0;
+    std::vector<double> buf_;
+};
+
+// EMA, пересеянная в начале окна p (ema_one): e = x[i-p+1]; e = x·k + e·(1−k) ...
+// e_{i+1} = q·e_i + k·x[i+1] + q^p·(x[i-p+2] − x[i-p+1]), q = 1−k
+class WindowEma {
+public:
+    explicit WindowEma(int p = 1, size_t phase = 0);
+    double push(double x);                      // NaN до заполнения окна / при NaN в окне
+private:
+    double recompute() const;
+    int p_, head_ = 0, filled_ = 0, nan_ = 0;
+    double k_, q_, qp_, e_ = 0.0;
+    bool valid_ = false;
+    std::vector<double> buf_;
+};
+
+// Классическая рекурсивная EMA (сид — SMA первых p значений), alpha = 2/(p+1)
+class Ema {
+public:
+    explicit Ema(int p = 1) : p_(p < 1 ? 1 : p), a_(2.0 / (p_ + 1)), seed_(p_) {}
+    double push(double x);
+private:
+    int p_;
+    double a_, e_ = NaN;
+    RollingSum seed_;
+};
+
+// Wilder-сглаживание (RMA): сид — SMA первых p, далее e = e + (x − e)/p
+class Wilder {
+public:
+    explicit Wilder(int p = 1) : p_(p < 1 ? 1 : p), seed_(p_) {}
+    double push(double x);
+private:
+    int p_;
+    double e_ = NaN;
+    RollingSum seed_;
+};
+
+// Скользящий экстремум окна w (монотонная очередь); NaN пропускаются
+template<bool IsMax>
+class RollingExtremum {
+public:
+    explicit RollingExtremum(int w = 1) : w_(w < 1 ? 1 : w) {}
+    void push(double x) {
+        ++idx_;
+        if (!std::isnan(x)) {
+            while (!q_.empty() && (IsMax ? q_.back().second <= x : q_.back().second >= x)) q_.pop_back();
+            q_.emplace_back(idx_, x);
+        }
+        while (!q_.empty() && q_.front().first <= idx_ - w_) q_.pop_front();
+    }
+    double value() const { return q_.empty() ? NaN : q_.front().second; }
+private:
+    int w_;
+    long long idx_ = -1;
+    std::deque<std::pair<long long, double>> q_;
+};
+using RollingMax = RollingExtremum<true>;
+using RollingMin = RollingExtremum<false>;
+
+// ---------- batch ----------
+std::vector<double> rolling_sum(DSpan v, int p, size_t phase = 0);
+std::vector<double> sma(DSpan v, int p, size_t phase = 0);
+std::vector<double> window_ema(DSpan v, int p, size_t phase = 0);   // == ema_one для каждого i
+std::vector<double> ema(DSpan v, int p);          // рекурсивная
+std::vector<double> wilder(DSpan v, int p);
+std::vector<double> rolling_stddev(DSpan v, int p);   // по неполному окну в начале ряда
+
+// TR[i] (TR[0] = NaN — нет предыдущего close)
+std::vector<double> true_range(DSpan h, DSpan l, DSpan c);
+// ATR = SMA(TR, p) — семантика atr_one/ctx_atr_one
+std::vector<double> atr_sma(DSpan h, DSpan l, DSpan c, int p, size_t phase = 0);
+// То же по готовому TR (TR[0] не участвует)
+std::vector<double> atr_sma_tr(DSpan tr, int p, size_t phase = 0);
+std::vector<double> atr_wilder(DSpan h, DSpan l, DSpan c, int p);
+
+// RSI по сумме прибылей/убытков окна p — семантика rsi_one
+std::vector<double> rsi_window(DSpan c, int p, size_t phase = 0);
+std::vector<double> rsi_wilder(DSpan c, int p);
+
+// Экстремум окна w (усечённое окно в начале ряда); пустое окно → NaN
+std::vector<double> rolling_max(DSpan v, int w);
+std::vector<double> rolling_min(DSpan v, int w);
+
+// Суммы положительного/отрицательного денежного потока окна p по TP-сравнениям (MFI)
+void mfi_flow_sums(DSpan h, DSpan l, DSpan c, DSpan vol, int p,
+                   std::vector<double>& pos,
+                   std::vector<double>& neg,
+                   size_t phase = 0);
+
+} // namespace rk
+} // namespace etai
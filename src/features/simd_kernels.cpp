@@ -0,0 +1,283 @@
+#include "simd_kernels.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+// GCC 12: ложные -Wmaybe-uninitialized на '__Y' внутри заголовков интринсиков
+// (_mm512_min/max_pd, _mm512_slli_epi64, cvtt/i32gather: `__m512d __Y = __Y;`
+// как «неопределённый» аргумент). Место диагностики — строка заголовка, поэтому
+// push/pop вокруг одного включения: наш код в этом файле проверяется как обычно.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#define ETAI_VK_X86 1
+#else
+#define ETAI_VK_X86 0
+#endif
+
+// Бит-в-бит между уровнями держится только без сжатия a·b + c в FMA (AVX-512F
+// умеет FMA и без -mfma): -ffp-contract=off для файла (CMakeLists.txt) и здесь же.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace etai {
+namespace vk {
+
+// e^x (fdlibm e_exp.c): 1.5·2^52 — округление k к ближайшему, k — в младших битах мантиссы
+constexpr double EXP_MAGIC  = 6755399441055744.0;
+constexpr double EXP_INVLN2 = 1.44269504088896338700e+00;
+constexpr double EXP_LN2HI  = 6.93147180369123816490e-01;
+constexpr double EXP_LN2LO  = 1.90821492927058770002e-10;
+constexpr double EXP_P1     =  1.66666666666666019037e-01;
+constexpr double EXP_P2     = -2.77777777770155933842e-03;
+constexpr double EXP_P3     =  6.61375632143793436117e-05;
+constexpr double EXP_P4     = -1.65339022054652515390e-06;
+constexpr double EXP_P5     =  4.13813679705723846039e-08;
+
+// tanh при |x| < 0.625 (Cephes): x + x·z·P(z)/Q(z)
+constexpr double TANH_P0 = -9.64399179425052238628e-01;
+constexpr double TANH_P1 = -9.92877231001918586564e+01;
+constexpr double TANH_P2 = -1.61468768441708447952e+03;
+constexpr double TANH_Q0 =  1.12811678491632931402e+02;
+constexpr double TANH_Q1 =  2.23548839060100448583e+03;
+constexpr double TANH_Q2 =  4.84406305325125486048e+03;
+
+constexpr double SESSION_TS_EXACT = 35184372088832.0;   // 2^45 мс
+
+// sin/cos 2π·h/24 для h ∈ [−23, 23] (ts < 0 → отрицательный час, как у % в C++)
+struct SessionTable {
+    double s[47], c[47];
+    SessionTable() {
+        for (int h = -23; h <= 23; ++h) {
+            const double ang = (2.0 * M_PI * (double)h) / 24.0;
+            s[h + 23] = std::sin(ang);
+            c[h + 23] = std::cos(ang);
+        }
+    }
+};
+static const SessionTable& session_table() {
+    static const SessionTable t;
+    return t;
+}
+
+void session1(long long ts_ms, double& s, double& c) {
+    const long long hour = (ts_ms / 1000LL / 3600LL) % 24LL;
+    const SessionTable& t = session_table();
+    s = t.s[hour + 23];
+    c = t.c[hour + 23];
+}
+
+// ts из колонки матрицы (как BarsView::ts: усечение к int64)
+static inline void session_ts(double ts, double& s, double& c) {
+    session1((std::isfinite(ts) && std::fabs(ts) < 9.2e18) ? (long long)ts : 0LL, s, c);
+}
+
+// ---------- уровни: traits + общее тело ядер ----------
+// min/max — семантика minpd/maxpd: a<b?a:b / a>b?a:b
+
+struct V1 {
+    using T = double;
+    using M = bool;
+    static constexpr size_t W = 1;
+    static T load(const double* p) { return *p; }
+    static void store(double* p, T v) { *p = v; }
+    static T set1(double x) { return x; }
+    static T add(T a, T b) { return a + b; }
+    static T sub(T a, T b) { return a - b; }
+    static T mul(T a, T b) { return a * b; }
+    static T div(T a, T b) { return a / b; }
+    static T min(T a, T b) { return a < b ? a : b; }
+    static T max(T a, T b) { return a > b ? a : b; }
+    static T abs(T a) { return std::fabs(a); }
+    static T copysign_of(T mag, T sgn) { return std::copysign(mag, sgn); }
+    static T trunc(T a) { return std::trunc(a); }
+    static M lt(T a, T b) { return a < b; }
+    static M gt(T a, T b) { return a > b; }
+    static M finite(T a) { return (a - a) == 0.0; }
+    static M isnan(T a) { return a != a; }
+    static T select(M m, T a, T b) { return m ? a : b; }
+    static bool all(M m) { return m; }
+    static T pow2_magic(T t, T magic) {
+        uint64_t bt, bm;
+        std::memcpy(&bt, &t, 8);
+        std::memcpy(&bm, &magic, 8);
+        const uint64_t b = (bt - bm + 1023u) << 52;
+        double r;
+        std::memcpy(&r, &b, 8);
+        return r;
+    }
+    static T gather(const double* tbl, T idx) { return tbl[(int)idx]; }
+};
+
+namespace scalar {
+#define VK_FN static inline
+using V = V1;
+#include "simd_kernels.inc.cpp"
+#undef VK_FN
+} // namespace scalar
+
+#if ETAI_VK_X86
+#define VK_AVX2 __attribute__((target("avx2")))
+
+struct V256 {
+    using T = __m256d;
+    using M = __m256d;
+    static constexpr size_t W = 4;
+    VK_AVX2 static T load(const double* p) { return _mm256_loadu_pd(p); }
+    VK_AVX2 static void store(double* p, T v) { _mm256_storeu_pd(p, v); }
+    VK_AVX2 static T set1(double x) { return _mm256_set1_pd(x); }
+    VK_AVX2 static T add(T a, T b) { return _mm256_add_pd(a, b); }
+    VK_AVX2 static T sub(T a, T b) { return _mm256_sub_pd(a, b); }
+    VK_AVX2 static T mul(T a, T b) { return _mm256_mul_pd(a, b); }
+    VK_AVX2 static T div(T a, T b) { return _mm256_div_pd(a, b); }
+    VK_AVX2 static T min(T a, T b) { return _mm256_min_pd(a, b); }
+    VK_AVX2 static T max(T a, T b) { return _mm256_max_pd(a, b); }
+    VK_AVX2 static T abs(T a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    VK_AVX2 static T copysign_of(T mag, T sgn) {
+        return _mm256_or_pd(mag, _mm256_and_pd(sgn, _mm256_set1_pd(-0.0)));
+    }
+    VK_AVX2 static T trunc(T a) { return _mm256_round_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+    VK_AVX2 static M lt(T a, T b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    VK_AVX2 static M gt(T a, T b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    VK_AVX2 static M finite(T a) { return _mm256_cmp_pd(_mm256_sub_pd(a, a), _mm256_setzero_pd(), _CMP_EQ_OQ); }
+    VK_AVX2 static M isnan(T a) { return _mm256_cmp_pd(a, a, _CMP_UNORD_Q); }
+    VK_AVX2 static T select(M m, T a, T b) { return _mm256_blendv_pd(b, a, m); }
+    VK_AVX2 static bool all(M m) { return _mm256_movemask_pd(m) == 0xF; }
+    VK_AVX2 static T pow2_magic(T t, T magic) {
+        __m256i k = _mm256_sub_epi64(_mm256_castpd_si256(t), _mm256_castpd_si256(magic));
+        k = _mm256_add_epi64(k, _mm256_set1_epi64x(1023));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(k, 52));
+    }
+    VK_AVX2 static T gather(const double* tbl, T idx) {
+        return _mm256_i32gather_pd(tbl, _mm256_cvttpd_epi32(idx), 8);
+    }
+};
+
+namespace avx2 {
+#define VK_FN static inline VK_AVX2
+using V = V256;
+#include "simd_kernels.inc.cpp"
+#undef VK_FN
+} // namespace avx2
+
+#define VK_AVX512 __attribute__((target("avx512f")))
+
+struct V512 {
+    using T = __m512d;
+    using M = __mmask8;
+    static constexpr size_t W = 8;
+    VK_AVX512 static T load(const double* p) { return _mm512_loadu_pd(p); }
+    VK_AVX512 static void store(double* p, T v) { _mm512_storeu_pd(p, v); }
+    VK_AVX512 static T set1(double x) { return _mm512_set1_pd(x); }
+    VK_AVX512 static T add(T a, T b) { return _mm512_add_pd(a, b); }
+    VK_AVX512 static T sub(T a, T b) { return _mm512_sub_pd(a, b); }
+    VK_AVX512 static T mul(T a, T b) { return _mm512_mul_pd(a, b); }
+    VK_AVX512 static T div(T a, T b) { return _mm512_div_pd(a, b); }
+    VK_AVX512 static T min(T a, T b) { return _mm512_min_pd(a, b); }
+    VK_AVX512 static T max(T a, T b) { return _mm512_max_pd(a, b); }
+    VK_AVX512 static T abs(T a) { return _mm512_abs_pd(a); }
+    VK_AVX512 static T copysign_of(T mag, T sgn) {   // or/and_pd — AVX-512DQ, здесь целочисленные
+        const __m512i sb = _mm512_and_si512(_mm512_castpd_si512(sgn), _mm512_set1_epi64((long long)0x8000000000000000ULL));
+        return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(mag), sb));
+    }
+    VK_AVX512 static T trunc(T a) { return _mm512_mask_roundscale_pd(a, 0xFF, a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+    VK_AVX512 static M lt(T a, T b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    VK_AVX512 static M gt(T a, T b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    VK_AVX512 static M finite(T a) { return _mm512_cmp_pd_mask(_mm512_sub_pd(a, a), _mm512_setzero_pd(), _CMP_EQ_OQ); }
+    VK_AVX512 static M isnan(T a) { return _mm512_cmp_pd_mask(a, a, _CMP_UNORD_Q); }
+    VK_AVX512 static T select(M m, T a, T b) { return _mm512_mask_blend_pd(m, b, a); }
+    VK_AVX512 static bool all(M m) { return m == 0xFF; }
+    VK_AVX512 static T pow2_magic(T t, T magic) {
+        __m512i k = _mm512_sub_epi64(_mm512_castpd_si512(t), _mm512_castpd_si512(magic));
+        k = _mm512_add_epi64(k, _mm512_set1_epi64(1023));
+        return _mm512_castsi512_pd(_mm512_slli_epi64(k, 52));
+    }
+    VK_AVX512 static T gather(const double* tbl, T idx) {
+        return _mm512_i32gather_pd(_mm512_cvttpd_epi32(idx), tbl, 8);
+    }
+};
+
+namespace avx512 {
+#define VK_FN static inline VK_AVX512
+using V = V512;
+#include "simd_kernels.inc.cpp"
+#undef VK_FN
+} // namespace avx512
+#endif
+
+// ---------- таблицы и выбор уровня ----------
+
+#define VK_TABLE(ns) Kernels{ ns::ratio_eps, ns::abs_ratio_eps, ns::body_pct, ns::candle_sentiment, \
+                              ns::session_cycle, ns::tanh_k, ns::sigmoid_k, ns::affine_cols, ns::zscore }
+
+static const Kernels K_SCALAR = VK_TABLE(scalar);
+#if ETAI_VK_X86
+static const Kernels K_AVX2   = VK_TABLE(avx2);
+static const Kernels K_AVX512 = VK_TABLE(avx512);
+#endif
+
+bool level_supported(Level l) {
+#if ETAI_VK_X86
+    __builtin_cpu_init();
+    if (l == Level::AVX2)   return __builtin_cpu_supports("avx2");
+    if (l == Level::AVX512) return __builtin_cpu_supports("avx512f");
+#endif
+    return l == Level::Scalar;
+}
+
+const char* level_name(Level l) {
+    switch (l) {
+        case Level::AVX2:   return "avx2";
+        case Level::AVX512: return "avx512";
+        default:            return "scalar";
+    }
+}
+
+// Лучший уровень CPU; ETAI_SIMD=scalar|avx2 понижает (повысить нельзя)
+static Level detect_level() {
+    Level best = level_supported(Level::AVX512) ? Level::AVX512
+               : level_supported(Level::AVX2)   ? Level::AVX2 : Level::Scalar;
+    const char* s = std::getenv("ETAI_SIMD");
+    if (s && *s) {
+        const std::string v(s);
+        const Level want = (v == "scalar") ? Level::Scalar : (v == "avx2") ? Level::AVX2 : best;
+        if ((int)want < (int)best) best = want;
+    }
+    return best;
+}
+
+Level active_level() {
+    static const Level l = detect_level();
+    return l;
+}
+
+const Kernels& kernels(Level l) {
+#if ETAI_VK_X86
+    if (l == Level::AVX512 && level_supported(l)) return K_AVX512;
+    if (l == Level::AVX2   && level_supported(l)) return K_AVX2;
+#endif
+    (void)l;
+    return K_SCALAR;
+}
+
+const Kernels& kernels() {
+    static const Kernels& k = kernels(active_level());
+    return k;
+}
+
+double tanh1(double x)    { return scalar::tanh_v(x); }
+double sigmoid1(double z) { return scalar::sigmoid_v(z); }
+
+} // namespace vk
+} // namespace etai
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+
+// ============================================================================
+// Векторные колоночные ядра (поэлементная математика признаков и скоринга).
+// Уровни: scalar / AVX2 / AVX-512F — один бинарник, уровень выбирается при
+// старте по CPUID (ETAI_SIMD=scalar|avx2|avx512 — понизить принудительно).
+// Все уровни — один и тот же алгоритм (simd_kernels.inc.cpp) без FMA-сжатия,
+// поэтому результат бит-в-бит одинаков на любом хосте и уровне; поэлементные
+// *1-функции — та же арифметика для потокового расчёта (FeatureState).
+// tanh/exp — свои (fdlibm-редукция, ≤ ~1 ulp), не libm.
+// Редукции (zscore) — фиксированный порядок по 8 дорожкам.
+// ============================================================================
+
+namespace etai {
+namespace vk {
+
+enum class Level : int { Scalar = 0, AVX2 = 1, AVX512 = 2 };
+
+struct Kernels {
+    // out = a / (b + eps)
+    void   (*ratio_eps)(const double* a, const double* b, double eps, double* out, size_t n);
+    // out = |a| / (b + eps)
+    void   (*abs_ratio_eps)(const double* a, const double* b, double eps, double* out, size_t n);
+    // out = open > 0 ? (close − open) / open : 0
+    void   (*body_pct)(const double* open, const double* close, double* out, size_t n);
+    // out = tanh((close − open) / max(1e-6, atr)), нечисловой atr → 0 (свечной sentiment контекста)
+    void   (*candle_sentiment)(const double* open, const double* close, const double* atr, double* out, size_t n);
+    // sin/cos часа суток по ts (мс) — таблица, те же значения, что 2π·hour/24
+    void   (*session_cycle)(const double* ts, double* s, double* c, size_t n);
+    void   (*tanh)(const double* x, double* out, size_t n);
+    // 1 / (1 + e^−z), нечисловой z → 0.5
+    void   (*sigmoid)(const double* z, double* out, size_t n);
+    // out[i] = b + Σ_j w[j]·F[j·ld + i] (колонки column-major, порядок j — как у цикла)
+    void   (*affine_cols)(const double* F, size_t ld, size_t n, size_t cols,
+                          const double* w, double b, double* out);
+    // out = (x − mean) / sd, sd — выборочное (n−1); sd < 1e-12 / нечисловое → 1
+    void   (*zscore)(const double* x, double* out, size_t n);
+};
+
+Level          active_level();                 // выбран при первом обращении (старт сервера)
+bool           level_supported(Level l);
+const char*    level_name(Level l);
+const Kernels& kernels(Level l);               // неподдерживаемый уровень → scalar
+const Kernels& kernels();                      // активный уровень
+
+// ---------- обёртки над активным уровнем ----------
+inline void ratio_eps(const double* a, const double* b, double eps, double* out, size_t n) { kernels().ratio_eps(a, b, eps, out, n); }
+inline void abs_ratio_eps(const double* a, const double* b, double eps, double* out, size_t n) { kernels().abs_ratio_eps(a, b, eps, out, n); }
+inline void body_pct(const double* o, const double* c, double* out, size_t n) { kernels().body_pct(o, c, out, n); }
+inline void candle_sentiment(const double* o, const double* c, const double* atr, double* out, size_t n) { kernels().candle_sentiment(o, c, atr, out, n); }
+inline void session_cycle(const double* ts, double* s, double* c, size_t n) { kernels().session_cycle(ts, s, c, n); }
+inline void tanh(const double* x, double* out, size_t n) { kernels().tanh(x, out, n); }
+inline void sigmoid(const double* z, double* out, size_t n) { kernels().sigmoid(z, out, n); }
+inline void affine_cols(const double* F, size_t ld, size_t n, size_t cols, const double* w, double b, double* out) {
+    kernels().affine_cols(F, ld, n, cols, w, b, out);
+}
+inline void zscore(const double* x, double* out, size_t n) { kernels().zscore(x, out, n); }
+
+// ---------- поэлементно (та же арифметика, что у ядер) ----------
+double tanh1(double x);
+double sigmoid1(double z);
+void   session1(long long ts_ms, double& s, double& c);
+
+} // namespace vk
+} // namespace etai
@@ -0,0 +1,180 @@
+// Тело ядер одного уровня. Включается в simd_kernels.cpp внутри namespace
+// уровня после `using V = <traits>;` и VK_FN (атрибут target уровня).
+// Хвосты (< W элементов) — через scalar:: с той же арифметикой (у scalar W = 1,
+// хвоста нет: if constexpr, иначе GCC -O1 видит в пустом цикле «переполнение» i).
+
+using T = V::T;
+constexpr size_t W = V::W;
+constexpr size_t LANES = 8 / W;   // векторов на 8 дорожек редукции
+
+// ---------- поэлементно ----------
+
+// e^x, x ∈ [−700, 700]: x = k·ln2 + r, |r| ≤ ln2/2; 2^k — сборкой экспоненты
+VK_FN T exp_core(T x) {
+    const T magic = V::set1(EXP_MAGIC);
+    const T t  = V::add(V::mul(x, V::set1(EXP_INVLN2)), magic);
+    const T kd = V::sub(t, magic);
+    const T hi = V::sub(x, V::mul(kd, V::set1(EXP_LN2HI)));
+    const T lo = V::mul(kd, V::set1(EXP_LN2LO));
+    const T r  = V::sub(hi, lo);
+    const T rr = V::mul(r, r);
+    T p = V::set1(EXP_P5);
+    p = V::add(V::set1(EXP_P4), V::mul(rr, p));
+    p = V::add(V::set1(EXP_P3), V::mul(rr, p));
+    p = V::add(V::set1(EXP_P2), V::mul(rr, p));
+    p = V::add(V::set1(EXP_P1), V::mul(rr, p));
+    const T c = V::sub(r, V::mul(rr, p));
+    const T q = V::div(V::mul(r, c), V::sub(V::set1(2.0), c));
+    const T y = V::sub(V::set1(1.0), V::sub(V::sub(lo, q), hi));
+    return V::mul(y, V::pow2_magic(t, magic));
+}
+
+VK_FN T tanh_v(T x) {
+    const T one = V::set1(1.0);
+    const T ax  = V::abs(x);
+    // |x| < 0.625: x + x·z·P(z)/Q(z), z = x²
+    const T z = V::mul(x, x);
+    T p = V::add(V::mul(V::set1(TANH_P0), z), V::set1(TANH_P1));
+    p = V::add(V::mul(p, z), V::set1(TANH_P2));
+    T q = V::add(z, V::set1(TANH_Q0));
+    q = V::add(V::mul(q, z), V::set1(TANH_Q1));
+    q = V::add(V::mul(q, z), V::set1(TANH_Q2));
+    const T small = V::add(x, V::mul(V::mul(x, z), V::div(p, q)));
+    // иначе ±(1 − 2/(e^{2|x|} + 1)); с |x| = 20 это уже 1.0
+    const T e   = exp_core(V::mul(V::set1(2.0), V::min(ax, V::set1(20.0))));
+    const T big = V::copysign_of(V::sub(one, V::div(V::set1(2.0), V::add(e, one))), x);
+    return V::select(V::isnan(x), x, V::select(V::lt(ax, V::set1(0.625)), small, big));
+}
+
+VK_FN T sigmoid_v(T z) {
+    const T one = V::set1(1.0);
+    const T zc  = V::max(V::min(z, V::set1(700.0)), V::set1(-700.0));
+    const T s   = V::div(one, V::add(one, exp_core(V::sub(V::set1(0.0), zc))));
+    return V::select(V::finite(z), s, V::set1(0.5));
+}
+
+VK_FN T sentiment_v(T o, T c, T atr) {
+    const T a = V::select(V::finite(atr), atr, V::set1(0.0));
+    return tanh_v(V::div(V::sub(c, o), V::max(a, V::set1(1e-6))));
+}
+
+VK_FN T body_pct_v(T o, T c) {
+    return V::select(V::gt(o, V::set1(0.0)), V::div(V::sub(c, o), o), V::set1(0.0));
+}
+
+// 8 дорожек (i mod 8) → одно число; порядок фиксирован для всех уровней
+VK_FN double sum8(const double* l) {
+    return ((l[0] + l[4]) + (l[2] + l[6])) + ((l[1] + l[5]) + (l[3] + l[7]));
+}
+
+// ---------- ядра ----------
+
+VK_FN void ratio_eps(const double* a, const double* b, double eps, double* out, size_t n) {
+    const T e = V::set1(eps);
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(out + i, V::div(V::load(a + i), V::add(V::load(b + i), e)));
+    for (; i < n; ++i) out[i] = a[i] / (b[i] + eps);
+}
+
+VK_FN void abs_ratio_eps(const double* a, const double* b, double eps, double* out, size_t n) {
+    const T e = V::set1(eps);
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(out + i, V::div(V::abs(V::load(a + i)), V::add(V::load(b + i), e)));
+    for (; i < n; ++i) out[i] = std::fabs(a[i]) / (b[i] + eps);
+}
+
+VK_FN void body_pct(const double* o, const double* c, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(out + i, body_pct_v(V::load(o + i), V::load(c + i)));
+    if constexpr (W > 1) for (; i < n; ++i) out[i] = scalar::body_pct_v(o[i], c[i]);
+}
+
+VK_FN void candle_sentiment(const double* o, const double* c, const double* atr, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(out + i, sentiment_v(V::load(o + i), V::load(c + i), V::load(atr + i)));
+    if constexpr (W > 1) for (; i < n; ++i) out[i] = scalar::sentiment_v(o[i], c[i], atr[i]);
+}
+
+// час = trunc(ts / 3.6e6) mod 24 (знак как у % в C++); при |ts| < 2^45 деление в double точно
+VK_FN void session_cycle(const double* ts, double* s, double* c, size_t n) {
+    const SessionTable& tb = session_table();
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        const T t = V::trunc(V::load(ts + i));
+        if (!V::all(V::lt(V::abs(t), V::set1(SESSION_TS_EXACT)))) {
+            for (size_t j = i; j < i + W; ++j) session_ts(ts[j], s[j], c[j]);
+            continue;
+        }
+        const T q   = V::trunc(V::div(t, V::set1(3600000.0)));
+        const T h   = V::sub(q, V::mul(V::set1(24.0), V::trunc(V::div(q, V::set1(24.0)))));
+        const T idx = V::add(h, V::set1(23.0));
+        V::store(s + i, V::gather(tb.s, idx));
+        V::store(c + i, V::gather(tb.c, idx));
+    }
+    for (; i < n; ++i) session_ts(ts[i], s[i], c[i]);
+}
+
+VK_FN void tanh_k(const double* x, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(out + i, tanh_v(V::load(x + i)));
+    if constexpr (W > 1) for (; i < n; ++i) out[i] = scalar::tanh_v(x[i]);
+}
+
+VK_FN void sigmoid_k(const double* z, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(out + i, sigmoid_v(V::load(z + i)));
+    if constexpr (W > 1) for (; i < n; ++i) out[i] = scalar::sigmoid_v(z[i]);
+}
+
+VK_FN void affine_cols(const double* F, size_t ld, size_t n, size_t cols,
+                       const double* w, double b, double* out) {
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        T acc = V::set1(b);
+        for (size_t j = 0; j < cols; ++j) acc = V::add(acc, V::mul(V::set1(w[j]), V::load(F + j * ld + i)));
+        V::store(out + i, acc);
+    }
+    for (; i < n; ++i) {
+        double z = b;
+        for (size_t j = 0; j < cols; ++j) z += w[j] * F[j * ld + i];
+        out[i] = z;
+    }
+}
+
+VK_FN void zscore(const double* x, double* out, size_t n) {
+    if (n == 0) return;
+    const size_t n8 = n - n % 8;
+    double l1[8], l2[8];
+    T a1[LANES], a2[LANES];
+
+    // среднее
+    for (size_t a = 0; a < LANES; ++a) a1[a] = V::set1(0.0);
+    for (size_t i = 0; i < n8; i += 8)
+        for (size_t a = 0; a < LANES; ++a) a1[a] = V::add(a1[a], V::load(x + i + a * W));
+    for (size_t a = 0; a < LANES; ++a) V::store(l1 + a * W, a1[a]);
+    for (size_t i = n8; i < n; ++i) l1[i - n8] += x[i];
+    const double mu = sum8(l1) / (double)n;
+
+    // дисперсия: двухпроходная с поправкой (Σd² − (Σd)²/n) / (n − 1)
+    const T m = V::set1(mu);
+    for (size_t a = 0; a < LANES; ++a) { a1[a] = V::set1(0.0); a2[a] = V::set1(0.0); }
+    for (size_t i = 0; i < n8; i += 8)
+        for (size_t a = 0; a < LANES; ++a) {
+            const T d = V::sub(V::load(x + i + a * W), m);
+            a1[a] = V::add(a1[a], d);
+            a2[a] = V::add(a2[a], V::mul(d, d));
+        }
+    for (size_t a = 0; a < LANES; ++a) { V::store(l1 + a * W, a1[a]); V::store(l2 + a * W, a2[a]); }
+    for (size_t i = n8; i < n; ++i) { const double d = x[i] - mu; l1[i - n8] += d; l2[i - n8] += d * d; }
+    double sd = 0.0;
+    if (n > 1) {
+        const double s1 = sum8(l1);
+        sd = std::sqrt((sum8(l2) - s1 * s1 / (double)n) / (double)(n - 1));
+    }
+    if (!std::isfinite(sd) || sd < 1e-12) sd = 1.0;
+
+    const T s = V::set1(sd);
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(out + i, V::div(V::sub(V::load(x + i), m), s));
+    for (; i < n; ++i) out[i] = (x[i] - mu) / sd;
+}
@@ -0,0 +1,156 @@
+#include "htf_aggregate.h"
+#include <algorithm>
+
+namespace etai {
+
+HtfAggregator::HtfAggregator(int tf_minutes, HtfAggOptions opt)
+    : opt_(opt),
+      tf_ms_((int64_t)std::max(1, tf_minutes) * 60000LL),
+      per_bucket_(std::max(1, tf_minutes / std::max(1, opt.base_minutes))) {}
+
+int64_t HtfAggregator::bucket_of(int64_t ts) const {
+  int64_t q = ts / tf_ms_;
+  if (ts % tf_ms_ < 0) --q;
+  return q * tf_ms_;
+}
+
+void HtfAggregator::fold(Acc& a, const Acc& b) {
+  if (b.n == 0) return;
+  if (a.n == 0) { a = b; return; }
+  a.h = std::max(a.h, b.h);
+  a.l = std::min(a.l, b.l);
+  a.c = b.c;
+  a.v += b.v;
+  a.to += b.to;
+  a.n += b.n;
+}
+
+HtfAggregator::Acc HtfAggregator::current() const {
+  Acc a = prev_;
+  if (has_last_) fold(a, last_);
+  return a;
+}
+
+bool HtfAggregator::keep(const Acc& a, bool closed) const {
+  if (a.n == 0) return false;
+  if (head_ && head_truncated_ && !opt_.partial_head) return false;
+  if (closed && opt_.gap == HtfGap::Drop && a.n < per_bucket_) return false;
+  return true;
+}
+
+void HtfAggregator::close_bucket(BarRows& closed) {
+  const Acc a = current();
+  if (keep(a, true)) {
+    closed.push_back(start_, a.o, a.h, a.l, a.c, a.v, a.to);
+    ++emitted_;
+    if (a.n < per_bucket_) ++incomplete_;
+  } else {
+    ++dropped_;
+  }
+  open_ = false;
+  head_ = false;
+  has_last_ = false;
+  prev_ = Acc{};
+}
+
+void HtfAggregator::push(int64_t ts, double o, double h, double l, double c, double v, double to,
+                         BarRows& closed) {
+  const Acc bar{o, h, l, c, v, to, 1};
+  if (has_last_ && ts == last_ts_) { last_ = bar; return; }   // формирующийся 15m обновился
+  if (ts < last_ts_) { ++ignored_; return; }
+
+  const int64_t b = bucket_of(ts);
+  if (open_ && b != start_) close_bucket(closed);
+  if (!open_) {
+    open_ = true;
+    start_ = b;
+    prev_ = Acc{};
+    has_last_ = false;
+    head_truncated_ = head_ && ts != b;
+  } else if (has_last_) {
+    fold(prev_, last_);
+  }
+  last_ = bar;
+  has_last_ = true;
+  last_ts_ = ts;
+}
+
+bool HtfAggregator::forming(BarRows& out) const {
+  if (!open_) return false;
+  const Acc a = current();
+  if (!keep(a, false)) return false;
+  out.push_back(start_, a.o, a.h, a.l, a.c, a.v, a.to);
+  return true;
+}
+
+BarRows aggregate_bars(const BarRows& base, int tf_minutes, const HtfAggOptions& opt,
+                       HtfAggregator* stats) {
+  HtfAggregator agg(tf_minutes, opt);
+  BarRows out;
+  out.has_turnover = base.has_turnover;
+  out.reserve(base.size() / std::max(1, tf_minutes / std::max(1, opt.base_minutes)) + 2);
+  for (size_t i = 0; i < base.size(); ++i) agg.push(base, i, out);
+  agg.forming(out);
+  if (stats) *stats = agg;
+  return out;
+}
+
+bool htf_update_series(const std::string& base_csv, const std::string& htf_csv, int tf_minutes,
+                       const HtfAggOptions& opt, HtfUpdateStats* st) {
+  HtfUpdateStats local;
+  if (!st) st = &local;
+  *st = HtfUpdateStats{};
+
+  auto mb = open_bars_for_csv(base_csv);
+  if (!mb || mb->size() == 0) return false;
+  const auto ts = mb->ts();
+  const auto o = mb->col(BAR_OPEN), h = mb->col(BAR_HIGH), l = mb->col(BAR_LOW);
+  const auto c = mb->col(BAR_CLOSE), v = mb->col(BAR_VOLUME), to = mb->col(BAR_TURNOVER);
+
+  HtfAggOptions run_opt = opt;
+  HtfAggregator agg(tf_minutes, run_opt);
+  int64_t last_htf = 0;
+  size_t  htf_rows = 0;
+  const bool have = series_last_ts(htf_csv, last_htf, &htf_rows) && htf_rows > 0;
+  const int64_t from = have ? agg.bucket_of(last_htf) : 0;
+  const bool incremental = have && from >= mb->first_ts();
+
+  // дельта: с начала последней корзины ТФ — база там полная, пропуск в начале — это gap
+  size_t k = 0;
+  if (incremental) {
+    k = (size_t)(std::lower_bound(ts.begin(), ts.end(), from) - ts.begin());
+    run_opt.partial_head = true;
+    agg = HtfAggregator(tf_minutes, run_opt);
+  }
+
+  BarRows out;
+  out.has_turnover = mb->has_turnover();
+  for (size_t i = k; i < mb->size(); ++i) agg.push(ts[i], o[i], h[i], l[i], c[i], v[i], to[i], out);
+  agg.forming(out);
+  st->base_rows  = mb->size() - k;
+  st->dropped    = agg.dropped();
+  st->incomplete = agg.incomplete();
+
+  if (incremental) {
+    AppendStats ast;
+    const bool ok = append_series(htf_csv, out, &ast);
+    st->rows = ast.rows;
+    st->appended = ast.appended;
+    st->replaced = ast.replaced;
+    st->rewritten = ast.rewritten;
+    return ok;
+  }
+
+  st->rewritten = true;
+  if (out.empty()) { st->rows = htf_rows; return true; }
+  BarRows merged;
+  if (have) load_series(htf_csv, merged);
+  const size_t before = merged.size();
+  merge_bars(merged, out);
+  st->appended = merged.size() - before;
+  st->replaced = out.size() - st->appended;
+  st->rows = merged.size();
+  return store_series(htf_csv, merged);
+}
+
+} // namespace etai
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "bar_store.h"
+
+namespace etai {
+
+// ============================================================================
+// Старшие ТФ (60/240/1440) из базовых 15m баров — один проход, без сети.
+//   Корзина ТФ: [floor(ts / tf) · tf, +tf) в UTC (как у Bybit: 4h — 00/04/08…, 1D — 00:00).
+//   open — первый, high — max, low — min, close — последний; volume/turnover — сумма.
+// Пропуски: в корзине может не хватать 15m баров.
+//   Keep — корзина собирается из того, что есть (по умолчанию);
+//   Drop — неполная закрытая корзина отбрасывается (формирующаяся — всегда выдаётся).
+// Корзина в начале ряда, начатого не с границы ТФ (история обрезана), по умолчанию
+// отбрасывается: иначе её open/high/low занижены и при merge затрут полный бар.
+// ============================================================================
+
+enum class HtfGap { Keep, Drop };
+
+struct HtfAggOptions {
+  HtfGap gap = HtfGap::Keep;
+  bool   partial_head = false;      // выдавать обрезанную первую корзину
+  int    base_minutes = 15;
+};
+
+// Потоковый агрегатор: бары базы по возрастанию ts; бар с ts == последнему
+// (формирующийся 15m) заменяет предыдущую версию, более ранние — игнорируются.
+class HtfAggregator {
+public:
+  explicit HtfAggregator(int tf_minutes, HtfAggOptions opt = {});
+
+  // Закрытые корзины дописываются в closed по мере перехода в следующую корзину
+  void push(int64_t ts, double o, double h, double l, double c, double v, double to, BarRows& closed);
+  void push(const BarRows& base, size_t i, BarRows& closed) {
+    push(base.ts[i], base.cols[0][i], base.cols[1][i], base.cols[2][i],
+         base.cols[3][i], base.cols[4][i], base.cols[5][i], closed);
+  }
+
+  // Текущая (формирующаяся) корзина → out; false — её нет / отброшена политикой
+  bool forming(BarRows& out) const;
+  bool forming_complete() const { return open_ && count() == per_bucket_; }
+
+  int64_t bucket_of(int64_t ts) const;
+  int64_t tf_ms() const { return tf_ms_; }
+  size_t  emitted()    const { return emitted_; }
+  size_t  dropped()    const { return dropped_; }
+  size_t  incomplete() const { return incomplete_; }   // выданных корзин с пропусками
+  size_t  ignored()    const { return ignored_; }
+
+private:
+  struct Acc { double o = 0, h = 0, l = 0, c = 0, v = 0, to = 0; int n = 0; };
+  static void fold(Acc& a, const Acc& b);
+  Acc  current() const;
+  int  count() const { return prev_.n + (has_last_ ? 1 : 0); }
+  bool keep(const Acc& a, bool closed) const;
+  void close_bucket(BarRows& closed);
+
+  HtfAggOptions opt_;
+  int64_t tf_ms_;
+  int     per_bucket_;
+
+  bool    open_ = false, head_ = true, head_truncated_ = false;
+  int64_t start_ = 0;              // начало текущей корзины
+  Acc     prev_;                   // бары корзины кроме последнего
+  Acc     last_;                   // последний бар (может быть заменён)
+  bool    has_last_ = false;
+  int64_t last_ts_ = INT64_MIN;
+
+  size_t emitted_ = 0, dropped_ = 0, incomplete_ = 0, ignored_ = 0;
+};
+
+// Весь ряд базы → ТФ, включая формирующуюся корзину в конце
+BarRows aggregate_bars(const BarRows& base, int tf_minutes, const HtfAggOptions& opt = {},
+                       HtfAggregator* stats = nullptr);
+
+// Обновить серию ТФ по серии базы (пути CSV, рядом — .bars):
+//   серия ТФ доходит до начала базы — пересчёт с последней корзины ТФ и append_series
+//   (последний бар заменяется, новые дописываются на место);
+//   иначе — агрегат всей базы merge в имеющуюся историю ТФ и полная запись.
+struct HtfUpdateStats {
+  size_t base_rows = 0;            // 15m баров прочитано
+  size_t rows = 0;                 // баров в серии ТФ после обновления
+  size_t appended = 0, replaced = 0;
+  size_t dropped = 0, incomplete = 0;
+  bool   rewritten = false;
+};
+bool htf_update_series(const std::string& base_csv, const std::string& htf_csv, int tf_minutes,
+                       const HtfAggOptions& opt = {}, HtfUpdateStats* st = nullptr);
+
+} // namespace etai
@@ -0,0 +1,137 @@
+#include "infer_cache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace etai {
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Slot {
+    InferCachePtr e;
+    std::list<std::string>::iterator lru;
+};
+
+std::mutex                             g_mu;
+std::unordered_map<std::string, Slot>  g_map;
+std::list<std::string>                 g_lru;     // front — самый свежий
+
+std::atomic<unsigned long long> g_hits{0};
+std::atomic<unsigned long long> g_misses{0};
+std::atomic<unsigned long long> g_not_modified{0};
+std::atomic<unsigned long long> g_evictions{0};
+
+size_t capacity() {
+    static const size_t c = []{
+        long long n = 1024;
+        if (const char* s = std::getenv("ETAI_INFER_CACHE_MAX")) {
+            try { n = std::stoll(s); } catch (...) {}
+        }
+        return (size_t)(n < 1 ? 1 : n);
+    }();
+    return c;
+}
+
+} // namespace
+
+bool infer_cache_enabled() {
+    static const bool on = []{
+        const char* s = std::getenv("ETAI_INFER_CACHE");
+        if (!s || !*s) return true;
+        return !(s[0] == '0' || s[0] == 'f' || s[0] == 'F' || s[0] == 'n' || s[0] == 'N');
+    }();
+    return on;
+}
+
+InferCachePtr infer_cache_get(const std::string& key, const std::string& fingerprint) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    auto it = g_map.find(key);
+    if (it == g_map.end() || it->second.e->fingerprint != fingerprint) {
+        g_misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    g_lru.splice(g_lru.begin(), g_lru, it->second.lru);
+    g_hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second.e;
+}
+
+InferCachePtr infer_cache_put(const std::string& key, const std::string& fingerprint,
+                              std::string body, const std::string& signal) {
+    auto e = std::make_shared<InferCacheEntry>();
+    e->fingerprint = fingerprint;
+    e->etag   = infer_cache_etag(body);
+    e->body   = std::move(body);
+    e->signal = signal;
+
+    std::lock_guard<std::mutex> lk(g_mu);
+    auto it = g_map.find(key);
+    if (it != g_map.end()) {
+        it->second.e = e;
+        g_lru.splice(g_lru.begin(), g_lru, it->second.lru);
+        return e;
+    }
+    while (g_map.size() >= capacity() && !g_lru.empty()) {
+        g_map.erase(g_lru.back());
+        g_lru.pop_back();
+        g_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    g_lru.push_front(key);
+    g_map.emplace(key, Slot{e, g_lru.begin()});
+    return e;
+}
+
+std::string infer_cache_etag(const std::string& body) {
+    unsigned long long h = 1469598103934665603ULL;
+    for (unsigned char c : body) { h ^= c; h *= 1099511628211ULL; }
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "\"%016llx\"", h);
+    return buf;
+}
+
+bool infer_cache_etag_matches(const std::string& if_none_match, const std::string& etag) {
+    if (if_none_match.empty()) return false;
+    size_t i = 0;
+    while (i < if_none_match.size()) {
+        size_t j = if_none_match.find(',', i);
+        if (j == std::string::npos) j = if_none_match.size();
+        std::string t = if_none_match.substr(i, j - i);
+        const size_t a = t.find_first_not_of(" \t");
+        const size_t b = t.find_last_not_of(" \t");
+        t = (a == std::string::npos) ? std::string() : t.substr(a, b - a + 1);
+        if (t.rfind("W/", 0) == 0) t = t.substr(2);     // слабое сравнение для GET
+        if (t == "*" || t == etag) return true;
+        i = j + 1;
+    }
+    return false;
+}
+
+void infer_cache_note_not_modified() {
+    g_not_modified.fetch_add(1, std::memory_order_relaxed);
+}
+
+void infer_cache_clear() {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_map.clear();
+    g_lru.clear();
+}
+
+json infer_cache_stats() {
+    std::lock_guard<std::mutex> lk(g_mu);
+    return json{
+        {"enabled",      infer_cache_enabled()},
+        {"entries",      (unsigned long long)g_map.size()},
+        {"capacity",     (unsigned long long)capacity()},
+        {"hits",         g_hits.load(std::memory_order_relaxed)},
+        {"misses",       g_misses.load(std::memory_order_relaxed)},
+        {"not_modified", g_not_modified.load(std::memory_order_relaxed)},
+        {"evictions",    g_evictions.load(std::memory_order_relaxed)}
+    };
+}
+
+} // namespace etai
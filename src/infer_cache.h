@@ -0,0 +1,49 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "json.hpp"
+
+namespace etai {
+
+// ============================================================================
+// Кэш ответов /api/infer.
+//   Ключ запроса — symbol|interval|htf|k_atr|eps; к нему привязан отпечаток
+//   состояния: поколение политики + (rows, ts, close) последнего бара каждого ТФ.
+//   Пока отпечаток тот же (бар не закрылся, модель не менялась) — отдаётся
+//   готовое тело; новый отпечаток вытесняет старую запись того же ключа.
+//   ETag — FNV-1a тела, If-None-Match → 304. Тело в кэше — без agents:
+//   счётчики сигналов дописываются к каждому ответу заново и в ETag не входят.
+//   Объём: ETAI_INFER_CACHE_MAX ключей (по умолчанию 1024), LRU.
+//   ETAI_INFER_CACHE=0 — выключить.
+// ============================================================================
+
+struct InferCacheEntry {
+    std::string fingerprint;
+    std::string body;
+    std::string etag;      // в кавычках, готов для заголовка
+    std::string signal;    // LONG/SHORT/NEUTRAL — для счётчиков на попадании
+};
+using InferCachePtr = std::shared_ptr<const InferCacheEntry>;
+
+bool infer_cache_enabled();
+
+// Запись по ключу, если отпечаток совпал (иначе nullptr — промах)
+InferCachePtr infer_cache_get(const std::string& key, const std::string& fingerprint);
+
+// Положить готовое тело ответа
+InferCachePtr infer_cache_put(const std::string& key, const std::string& fingerprint,
+                              std::string body, const std::string& signal);
+
+// "\"<16 hex>\"" — FNV-1a 64 от тела
+std::string infer_cache_etag(const std::string& body);
+
+// If-None-Match содержит etag (список через запятую или "*")
+bool infer_cache_etag_matches(const std::string& if_none_match, const std::string& etag);
+
+void infer_cache_note_not_modified();
+void infer_cache_clear();
+
+// Телеметрия: entries, capacity, hits, misses, not_modified, evictions
+nlohmann::json infer_cache_stats();
+
+} // namespace etai
@@ -1,5 +1,9 @@
 #include "infer_policy.h"
 #include "features/features.h"
+#include "features/feature_state.h"
+#include "features/money_flow.h"
+#include "features/rolling_kernels.h"
+#include "features/simd_kernels.h"
 #include "json.hpp"
 #include <armadillo>
 #include <cmath>
@@ -18,18 +22,53 @@ static inline double clamp(double v, double a, double b){
 
 // Z-score per column (fallback, если нет policy.norm)
 static arma::mat zscore_cols(const arma::mat& X) {
-    arma::mat Z = X;
-    const arma::uword D = Z.n_cols;
-    for (arma::uword j = 0; j < D; ++j) {
-        arma::vec col = Z.col(j);
-        double mu = arma::mean(col);
-        double sd = arma::stddev(col);
-        if (!std::isfinite(sd) || sd < 1e-12) sd = 1.0;
-        Z.col(j) = (Z.col(j) - mu) / sd;
+    arma::mat Z(X.n_rows, X.n_cols);
+    for (arma::uword j = 0; j < X.n_cols; ++j) vk::zscore(X.colptr(j), Z.colptr(j), X.n_rows);
+    return Z;
+}
+
+// Z-score по расширяющемуся окну (карта/хвост): строка i — по среднему и sd строк [0..i]
+// (Welford, sd выборочное; < 2 строк / sd < 1e-12 → 1). Для последней строки это та же
+// статистика, что у zscore_cols по всей F. Возвращает последние k строк.
+static arma::mat zscore_cols_prefix(const arma::mat& X, size_t k) {
+    const size_t N = X.n_rows, s = N - k;
+    arma::mat Z(k, X.n_cols);
+    for (arma::uword j = 0; j < X.n_cols; ++j) {
+        const double* x = X.colptr(j);
+        double* z = Z.colptr(j);
+        double mean = 0.0, m2 = 0.0;
+        for (size_t i = 0; i < N; ++i) {
+            const double d = x[i] - mean;
+            mean += d / (double)(i + 1);
+            m2   += d * (x[i] - mean);
+            if (i < s) continue;
+            double sd = i >= 1 ? std::sqrt(m2 / (double)i) : 0.0;
+            if (!std::isfinite(sd) || sd < 1e-12) sd = 1.0;
+            z[i - s] = (x[i] - mean) / sd;
+        }
     }
     return Z;
 }
 
+// cum_flow (v10) в batch нормирован по всему ряду — в строках F (последние F.n_rows баров
+// raw) заменить значением, известным к бару: с norm — нормировка по префиксу, как в
+// потоковом FeatureState; для z-score (run_sum) — сама накопленная сумма: нормировка по
+// префиксу [0..i] аффинна (scale > 0) и z-score строки i по [0..i] её не замечает
+static void cum_flow_prefix_col(const arma::mat& raw, int feat_version, arma::mat& F, bool run_sum) {
+    if (feature_dim(feat_version) <= (size_t)FeatCol::CUM_FLOW || F.n_rows > raw.n_rows) return;
+    const BarsView bv = bars_view(raw);
+    std::vector<double> cf = calc_flow_ratio(calc_mfi(bv.high, bv.low, bv.close, bv.volume, 14));
+    if (run_sum) {
+        double run = 0.0;
+        for (double& x : cf) { run += std::isfinite(x) ? (x - 0.5) : 0.0; x = run; }
+    } else {
+        cf = calc_cum_flow_prefix(cf);
+    }
+    const size_t off = raw.n_rows - F.n_rows;
+    double* col = F.colptr((arma::uword)FeatCol::CUM_FLOW);
+    for (arma::uword r = 0; r < F.n_rows; ++r) col[r] = std::isfinite(cf[off + r]) ? cf[off + r] : 0.0;
+}
+
 static double last_sigma_returns_from_raw_close(const arma::mat& raw, size_t lookback=64) {
     if (raw.n_rows < 2) return 0.0;
     const arma::uword N = raw.n_rows;
@@ -46,80 +85,97 @@ static double last_sigma_returns_from_raw_close(const arma::mat& raw, size_t loo
     return sd;
 }
 
-// Попытка достать нормировку из policy
-static bool extract_policy_norm(const json& policy, arma::vec& mu, arma::vec& sd, int D){
-    if (!policy.contains("norm") || !policy["norm"].is_object()) return false;
-    const json& n = policy["norm"];
-    if (!n.contains("mu") || !n.contains("sd")) return false;
-    if (!n["mu"].is_array() || !n["sd"].is_array()) return false;
-    if ((int)n["mu"].size() != D || (int)n["sd"].size() != D) return false;
-
-    mu.set_size(D); sd.set_size(D);
-    for (int i = 0; i < D; ++i) {
-        mu(i) = n["mu"][i].get<double>();
-        sd(i) = n["sd"][i].get<double>();
-        if (!std::isfinite(sd(i)) || sd(i) < 1e-12) sd(i) = 1.0;
-    }
-    return true;
-}
-
-// Применить нормировку X = (X - mu) / sd
-static void apply_norm_inplace(arma::mat& X, const arma::vec& mu, const arma::vec& sd){
-    const arma::uword D = X.n_cols;
-    for (arma::uword j = 0; j < D; ++j) {
-        X.col(j) = (X.col(j) - mu(j)) / sd(j);
-    }
-}
-
-// Build score a = tanh(Wx+b) на любом TF raw OHLCV (N×6)
+// Build score a = tanh(Wx+b) на любом TF raw OHLCV (N×6).
+// С policy.norm нормировка уже вшита в веса (policy_registry): нужна только последняя
+// строка F — из потокового FeatureState (stream_key задан) или хвостового режима.
+// Без norm нужен z-score по всей F — тогда полный batch.
 static bool policy_score_on_raw(const arma::mat& raw,
-                                const json& policy,
+                                const CompiledPolicy& policy,
                                 double& out_score,
                                 int& out_feat_dim,
-                                bool& out_used_norm)
+                                bool& out_used_norm,
+                                const std::string& stream_key = std::string())
 {
     out_used_norm = false;
     if (raw.n_cols < 6 || raw.n_rows < 60) return false;
+    if (!policy.ok()) return false;
+    const int D = policy.feat_dim;
+
+    if (policy.has_norm) {
+        arma::rowvec f;
+        bool have = !stream_key.empty() && feature_stream_enabled()
+                 && stream_feature_last_row(stream_key, raw, f, policy.feat_version) && (int)f.n_elem == D;
+        if (!have) {
+            arma::mat F = build_feature_tail(raw, 1, policy.feat_version);
+            if ((int)F.n_cols != D || F.n_rows < 1) return false;
+            f = F.row(F.n_rows - 1);
+        }
+        out_score = vk::tanh1(policy.fused_z(f.memptr()));
+        out_feat_dim = D;
+        out_used_norm = true;
+        return true;
+    }
 
-    int D = policy.value("feat_dim", 0);
-    std::vector<double> wv = policy.value("W", std::vector<double>{});
-    std::vector<double> bv = policy.value("b", std::vector<double>{});
-    if (D <= 0 || (int)wv.size() != D || (int)bv.size() != 1) return false;
-
-    arma::mat F = build_feature_matrix(raw);
+    arma::mat F = build_feature_matrix(raw, policy.feat_version);
     if ((int)F.n_cols != D || F.n_rows < 2) return false;
+    F = zscore_cols(F);
 
-    // Нормализация: сперва пробуем policy.norm; если нет — локальный zscore
-    arma::vec mu, sd;
-    if (extract_policy_norm(policy, mu, sd, D)) {
-        apply_norm_inplace(F, mu, sd);
-        out_used_norm = true;
+    // z = b + W·x по последней строке (колонки F с шагом n_rows)
+    double z = 0.0;
+    vk::affine_cols(F.colptr(0) + (F.n_rows - 1), F.n_rows, 1, (size_t)D, policy.w_raw.data(), policy.b_raw, &z);
+    out_score = vk::tanh1(z); // [-1,1]
+    out_feat_dim = D;
+    return true;
+}
+
+// Скоры tanh(Wx+b) по последним k барам одним произведением матрица×вектор.
+// Бар i оценивается только по префиксу [0..i]: с norm — хвостовой режим признаков,
+// без norm — z-score по расширяющемуся окну; cum_flow (v10) — нормировка по префиксу.
+// Последняя строка — та же статистика, что у policy_score_on_raw.
+// Fpre — готовая полная F по тем же барам (хранилище признаков), иначе считается здесь.
+static bool policy_scores_tail(const arma::mat& raw, const CompiledPolicy& policy,
+                               size_t k, arma::vec& out, const arma::mat* Fpre = nullptr)
+{
+    if (raw.n_cols < 6 || raw.n_rows < 60 || !policy.ok() || k == 0) return false;
+    const int D = policy.feat_dim;
+    k = std::min<size_t>(k, raw.n_rows);
+    if (Fpre && (Fpre->n_rows != raw.n_rows || (int)Fpre->n_cols != D)) Fpre = nullptr;
+
+    arma::mat F;
+    const std::vector<double>* w = &policy.w_raw;
+    double b = policy.b_raw;
+    if (policy.has_norm) {
+        F = Fpre ? arma::mat(Fpre->tail_rows(k)) : build_feature_tail(raw, k, policy.feat_version);
+        if ((int)F.n_cols != D) return false;
+        cum_flow_prefix_col(raw, policy.feat_version, F, false);
+        w = &policy.w_fused;
+        b = policy.b_fused;
     } else {
-        F = zscore_cols(F);
-        out_used_norm = false;
+        F = Fpre ? *Fpre : build_feature_matrix(raw, policy.feat_version);
+        if ((int)F.n_cols != D || F.n_rows < 2) return false;
+        cum_flow_prefix_col(raw, policy.feat_version, F, true);
+        F = zscore_cols_prefix(F, k);
     }
+    if ((int)F.n_cols != D || F.n_rows != k) return false;
 
-    const arma::uword last = F.n_rows - 1;
-    arma::vec x = F.row(last).t(); // D×1
-
-    arma::rowvec W(D);
-    for (int i = 0; i < D; ++i) W(i) = wv[(size_t)i];
-    double b = bv[0];
-
-    double z = arma::as_scalar(W * x + b);
-    out_score = std::tanh(z); // [-1,1]
-    out_feat_dim = D;
+    // tanh(b + F·W) колоночными ядрами; строка та же, что fused_z (порядок суммы по j)
+    out.set_size(k);
+    vk::affine_cols(F.memptr(), F.n_rows, k, (size_t)D, w->data(), b, out.memptr());
+    vk::tanh(out.memptr(), out.memptr(), k);
     return true;
 }
 
 // ---------- single-TF policy inference ----------
 nlohmann::json infer_with_policy(const arma::mat& raw15, const nlohmann::json& model) {
+    return infer_with_policy(raw15, *compile_policy(model));
+}
+
+nlohmann::json infer_with_policy(const arma::mat& raw15, const CompiledPolicy& P) {
     if (raw15.n_cols < 6 || raw15.n_rows < 60)
         return json{{"ok", false}, {"error", "not_enough_data"}, {"raw_rows", (int)raw15.n_rows}, {"raw_cols", (int)raw15.n_cols}};
-    if (!model.is_object() || !model.contains("policy"))
+    if (P.error == "no_policy_in_model")
         return json{{"ok", false}, {"error", "no_policy_in_model"}};
 
-    const json& P = model["policy"];
     int D = 0;
     double a15 = 0.0;
     bool used_norm = false;
@@ -147,27 +203,43 @@ nlohmann::json infer_with_policy(const arma::mat& raw15, const nlohmann::json& m
 // ---------- MTF-aware policy inference ----------
 nlohmann::json infer_with_policy_mtf(const arma::mat& raw15,
                                      const nlohmann::json& model,
+                                     const arma::mat* raw60,   int ma60,
+                                     const arma::mat* raw240,  int ma240,
+                                     const arma::mat* raw1440, int ma1440,
+                                     const std::string& symbol,
+                                     const std::string& interval)
+{
+    return infer_with_policy_mtf(raw15, *compile_policy(model), raw60, ma60, raw240, ma240,
+                                 raw1440, ma1440, symbol, interval);
+}
+
+nlohmann::json infer_with_policy_mtf(const arma::mat& raw15,
+                                     const CompiledPolicy& P,
                                      const arma::mat* raw60,   int /*ma60*/,
                                      const arma::mat* raw240,  int /*ma240*/,
-                                     const arma::mat* raw1440, int /*ma1440*/)
+                                     const arma::mat* raw1440, int /*ma1440*/,
+                                     const std::string& symbol,
+                                     const std::string& interval)
 {
-    if (!model.is_object() || !model.contains("policy"))
+    if (P.error == "no_policy_in_model")
         return json{{"ok", false}, {"error", "no_policy_in_model"}};
-    const json& P = model["policy"];
 
     // 1) score on 15m (required)
     int D = 0;
     double s15 = 0.0;
     bool used_norm_15 = false;
-    if (!policy_score_on_raw(raw15, P, s15, D, used_norm_15))
+    // ключи потокового состояния признаков (пустые → полный batch)
+    auto skey = [&](const std::string& tf){ return symbol.empty() ? std::string() : symbol + "_" + tf; };
+
+    if (!policy_score_on_raw(raw15, P, s15, D, used_norm_15, skey(interval)))
         return json{{"ok", false}, {"error", "policy_scoring_failed_15"}};
 
     // 2) optional HTF scores
     double s60 = 0.0, s240 = 0.0, s1440 = 0.0;
     bool used_norm_60=false, used_norm_240=false, used_norm_1440=false;
-    bool has60   = raw60   && raw60->n_elem   && policy_score_on_raw(*raw60,   P, s60,   D, used_norm_60);
-    bool has240  = raw240  && raw240->n_elem  && policy_score_on_raw(*raw240,  P, s240,  D, used_norm_240);
-    bool has1440 = raw1440 && raw1440->n_elem && policy_score_on_raw(*raw1440, P, s1440, D, used_norm_1440);
+    bool has60   = raw60   && raw60->n_elem   && policy_score_on_raw(*raw60,   P, s60,   D, used_norm_60,   skey("60"));
+    bool has240  = raw240  && raw240->n_elem  && policy_score_on_raw(*raw240,  P, s240,  D, used_norm_240,  skey("240"));
+    bool has1440 = raw1440 && raw1440->n_elem && policy_score_on_raw(*raw1440, P, s1440, D, used_norm_1440, skey("1440"));
 
     auto sgn = [](double x)->int { return (x>0) - (x<0); };
 
@@ -223,4 +295,111 @@ nlohmann::json infer_with_policy_mtf(const arma::mat& raw15,
     return out;
 }
 
+// ---------- карта сигналов политики ----------
+nlohmann::json infer_policy_signal_map(const arma::mat& raw15,
+                                       const CompiledPolicy& P,
+                                       const arma::mat* raw60,
+                                       const arma::mat* raw240,
+                                       const arma::mat* raw1440,
+                                       size_t last_n,
+                                       const arma::mat* F15)
+{
+    if (P.error == "no_policy_in_model")
+        return json{{"ok", false}, {"error", "no_policy_in_model"}};
+    if (raw15.n_cols < 6 || raw15.n_rows < 60)
+        return json{{"ok", false}, {"error", "not_enough_data"}, {"raw_rows", (int)raw15.n_rows}};
+
+    // как у одиночного инфера: бар i оценивается по префиксу длиной ≥ 60
+    const size_t N = raw15.n_rows;
+    const size_t start = std::max<size_t>(N - std::min(std::max<size_t>(last_n, 1), N), 59);
+    const size_t n = N - start;
+
+    arma::vec s15;
+    if (!policy_scores_tail(raw15, P, n, s15, F15))
+        return json{{"ok", false}, {"error", "policy_scoring_failed_15"}};
+
+    std::vector<long long> ts(n);
+    for (size_t i = 0; i < n; ++i) ts[i] = (long long)raw15(start + i, 0);
+
+    // sigma15[i] = stddev доходностей r[i-64..i] (last_sigma_returns_from_raw_close по префиксу)
+    std::vector<double> sigma(n, 0.0);
+    {
+        rk::RollingVar rv(65);
+        const size_t j0 = std::max<size_t>(1, start >= 64 ? start - 64 : 1);
+        for (size_t j = j0; j < N; ++j) {
+            const double c0 = raw15(j - 1, 4);
+            rv.push(c0 <= 0.0 ? 0.0 : (raw15(j, 4) - c0) / c0);
+            if (j >= start) sigma[j - start] = (rv.count() >= 2) ? rv.stddev() : 0.0;
+        }
+    }
+
+    // HTF: скоры только по барам, покрывающим окно, и один проход слияния по ts.
+    // Бару i — последний HTF-бар, закрытый к концу бара i: open + tf ≤ ts[i] + 15m.
+    // Формирующийся HTF-бар (open ≤ ts[i]) брать нельзя — его close/ATR из будущего.
+    constexpr long long M15_MS = 15LL * 60 * 1000;
+    json htf_cols = json::object();
+    std::vector<std::vector<double>> htf_aligned;
+    auto align_htf = [&](const char* key, const arma::mat* raw, long long tf_ms) {
+        if (!raw || raw->n_rows < 60 || raw->n_cols < 6) return;
+        const size_t NH = raw->n_rows;
+        auto closed_by = [&](size_t j, long long t) { return (long long)(*raw)(j, 0) + tf_ms <= t + M15_MS; };
+        size_t h0 = 0;
+        while (h0 + 1 < NH && closed_by(h0 + 1, ts[0])) ++h0;
+        arma::vec sh;
+        if (!policy_scores_tail(*raw, P, NH - h0, sh)) return;
+
+        std::vector<double> col(n, rk::NaN);
+        size_t j = h0;
+        for (size_t i = 0; i < n; ++i) {
+            while (j + 1 < NH && closed_by(j + 1, ts[i])) ++j;
+            // как у одиночного инфера: HTF-префикс короче 60 баров не оценивается
+            if (closed_by(j, ts[i]) && j >= 59) col[i] = sh(j - h0);
+        }
+        htf_cols[key] = col;     // NaN → null
+        htf_aligned.push_back(std::move(col));
+    };
+    align_htf("60",   raw60,   60LL * 60 * 1000);
+    align_htf("240",  raw240,  240LL * 60 * 1000);
+    align_htf("1440", raw1440, 1440LL * 60 * 1000);
+
+    // вес HTF-контекста и решение — как в infer_with_policy_mtf
+    const double act_gate = 0.10;
+    auto sgn = [](double x)->int { return (x>0) - (x<0); };
+    std::vector<double> score15(n), score_w(n), wctx(n);
+    std::vector<int> signal(n);
+    for (size_t i = 0; i < n; ++i) {
+        const double a = s15(i);
+        int avail = 0, agree = 0;
+        for (const auto& col : htf_aligned) {
+            if (std::isnan(col[i])) continue;
+            ++avail;
+            if (sgn(col[i]) == sgn(a)) ++agree;
+        }
+        const double w = avail > 0 ? 0.75 + 0.25 * (double)agree / (double)avail : 1.0;
+        const double aw = a * w;
+        score15[i] = a;
+        wctx[i]    = w;
+        score_w[i] = aw;
+        signal[i]  = std::abs(aw) >= act_gate ? (aw >= 0.0 ? 1 : -1) : 0;
+    }
+
+    return json{
+        {"ok", true},
+        {"mode", "policy"},
+        {"n", (int)n},
+        {"ts", ts},
+        {"signal", signal},
+        {"signal_legend", {{"1", "LONG"}, {"0", "NEUTRAL"}, {"-1", "SHORT"}}},
+        {"score15", score15},
+        {"score_w", score_w},
+        {"wctx_htf", wctx},
+        {"sigma15", sigma},
+        {"htf", htf_cols},
+        {"act_gate", act_gate},
+        {"vol_threshold", 0.001},
+        {"used_norm", P.has_norm},
+        {"feat_dim_used", P.feat_dim}
+    };
+}
+
 } // namespace etai
@@ -1,17 +1,47 @@
 #pragma once
 #include <armadillo>
+#include <string>
 #include "json.hpp"
+#include "policy_registry.h"
 
 namespace etai {
 
 // Single-TF inference with logistic policy (already used by /api/infer fallback)
 nlohmann::json infer_with_policy(const arma::mat& raw15, const nlohmann::json& model);
+nlohmann::json infer_with_policy(const arma::mat& raw15, const CompiledPolicy& policy);
 
-// MTF-aware policy inference: uses 15m as core and softly weights by HTFs (60/240/1440)
+// MTF-aware policy inference: uses 15m as core and softly weights by HTFs (60/240/1440).
+// symbol задан → признаки считаются потоково по ключам <symbol>_<tf> (только новые бары).
 nlohmann::json infer_with_policy_mtf(const arma::mat& raw15,
                                      const nlohmann::json& model,
                                      const arma::mat* raw60,   int ma60,
                                      const arma::mat* raw240,  int ma240,
-                                     const arma::mat* raw1440, int ma1440);
+                                     const arma::mat* raw1440, int ma1440,
+                                     const std::string& symbol = std::string(),
+                                     const std::string& interval = "15");
+
+// То же по скомпилированной политике из реестра (без разбора JSON на запрос)
+nlohmann::json infer_with_policy_mtf(const arma::mat& raw15,
+                                     const CompiledPolicy& policy,
+                                     const arma::mat* raw60,   int ma60,
+                                     const arma::mat* raw240,  int ma240,
+                                     const arma::mat* raw1440, int ma1440,
+                                     const std::string& symbol = std::string(),
+                                     const std::string& interval = "15");
+
+// Карта сигналов по последним last_n барам 15m: все бары одним W·F по хвосту признаков,
+// бар i оценивается только по префиксу [0..i] (z-score без norm — расширяющееся окно,
+// cum_flow v10 — нормировка по префиксу), т.е. так же, как его оценил бы живой /api/infer в момент закрытия;
+// sigma — скользящее окно Welford, HTF-скоры сведены по ts одним проходом:
+// бару i соответствует последний HTF-бар, ЗАКРЫТЫЙ к концу бара i (ts_htf + tf ≤ ts[i] + 15m).
+// Ответ колонками: ts[], signal[] (1/0/-1), score15[], score_w[], wctx_htf[], sigma15[], htf{tf:[]}.
+// F15 — готовая F по барам raw15 (хранилище признаков); nullptr — посчитать по raw15.
+nlohmann::json infer_policy_signal_map(const arma::mat& raw15,
+                                       const CompiledPolicy& policy,
+                                       const arma::mat* raw60,
+                                       const arma::mat* raw240,
+                                       const arma::mat* raw1440,
+                                       size_t last_n,
+                                       const arma::mat* F15 = nullptr);
 
 } // namespace etai
@@ -0,0 +1,149 @@
+#include "kline_decode.h"
+#include "json.hpp"
+
+#include <charconv>
+
+namespace etai {
+
+using json = nlohmann::json;
+
+namespace {
+
+// ts: ведущие цифры (как parse_timestamp_token: пробелы/BOM у Bybit не встречаются)
+bool to_ts(std::string_view s, int64_t& out) {
+  const char* b = s.data();
+  const char* e = b + s.size();
+  auto r = std::from_chars(b, e, out);
+  return r.ec == std::errc() && r.ptr != b;
+}
+
+bool to_num(std::string_view s, double& out) {
+  const char* b = s.data();
+  return std::from_chars(b, b + s.size(), out).ec == std::errc();
+}
+
+// Глубины: 1 — корень, 2 — result, 3 — list, 4 — строка свечи
+class KlineSax {
+public:
+  KlineSax(BarRows& out, KlineDecodeStats& st, int64_t lo, int64_t hi)
+      : out_(out), st_(st), lo_(lo), hi_(hi) {}
+
+  bool null()                                  { return field_skip(); }
+  bool boolean(bool)                           { return field_skip(); }
+  bool number_integer(json::number_integer_t v)   { return number((double)v, (int64_t)v); }
+  bool number_unsigned(json::number_unsigned_t v) { return number((double)v, (int64_t)v); }
+  bool number_float(json::number_float_t v, const json::string_t&) { return number(v, (int64_t)v); }
+  bool binary(json::binary_t&)                 { return field_skip(); }
+
+  bool string(json::string_t& s) {
+    if (in_row()) {
+      if (field_ == 0)      row_ok_ = to_ts(s, ts_);
+      else if (field_ < 7)  row_ok_ = row_ok_ && to_num(s, v_[field_ - 1]);
+      ++field_;
+    } else if (depth_ == 1 && want_ret_) {
+      int64_t rc = -1;
+      if (to_ts(s, rc)) st_.ret_code = (int)rc;
+    }
+    want_ret_ = false;
+    return true;
+  }
+
+  bool start_object(std::size_t) {
+    if (in_row()) field_skip();
+    ++depth_;
+    if (depth_ == 2 && want_result_) in_result_ = true;
+    want_ret_ = want_result_ = want_list_ = false;
+    return true;
+  }
+  bool end_object() {
+    if (depth_ == 2) in_result_ = false;
+    --depth_;
+    return true;
+  }
+
+  bool key(json::string_t& k) {
+    if (depth_ == 1) {
+      want_ret_    = (k == "retCode");
+      want_result_ = (k == "result");
+    } else if (depth_ == 2 && in_result_) {
+      want_list_ = (k == "list");
+    }
+    return true;
+  }
+
+  bool start_array(std::size_t) {
+    if (in_row()) field_skip();
+    ++depth_;
+    if (depth_ == 3 && want_list_) in_list_ = true;
+    else if (depth_ == 4 && in_list_) { field_ = 0; row_ok_ = false; }
+    want_ret_ = want_result_ = want_list_ = false;
+    return true;
+  }
+  bool end_array() {
+    if (in_row()) finish_row();
+    else if (depth_ == 3) in_list_ = false;
+    --depth_;
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) { return false; }
+
+private:
+  bool in_row() const { return in_list_ && depth_ == 4; }
+
+  bool number(double d, int64_t i) {
+    if (in_row()) {
+      if (field_ == 0)      { ts_ = i; row_ok_ = true; }
+      else if (field_ < 7)  v_[field_ - 1] = d;
+      ++field_;
+    } else if (depth_ == 1 && want_ret_) {
+      st_.ret_code = (int)i;
+    }
+    want_ret_ = false;
+    return true;
+  }
+
+  bool field_skip() {
+    if (in_row()) { if (field_ < 7) row_ok_ = false; ++field_; }
+    want_ret_ = false;
+    return true;
+  }
+
+  void finish_row() {
+    ++st_.raw_rows;
+    if (field_ < 7) return;
+    if (!row_ok_) { ++st_.skipped; return; }
+    if (ts_ < lo_ || ts_ > hi_) { ++st_.filtered; return; }
+    out_.push_back(ts_, v_[0], v_[1], v_[2], v_[3], v_[4], v_[5]);
+  }
+
+  BarRows& out_;
+  KlineDecodeStats& st_;
+  int64_t lo_, hi_;
+
+  int  depth_ = 0;
+  bool want_ret_ = false, want_result_ = false, want_list_ = false;
+  bool in_result_ = false, in_list_ = false;
+
+  int     field_ = 0;
+  bool    row_ok_ = false;
+  int64_t ts_ = 0;
+  double  v_[6] = {0, 0, 0, 0, 0, 0};
+};
+
+} // namespace
+
+bool decode_bybit_klines(std::string_view body,
+                         BarRows& out,
+                         KlineDecodeStats* stats,
+                         int64_t min_ts,
+                         int64_t max_ts)
+{
+  KlineDecodeStats local;
+  KlineDecodeStats& st = stats ? *stats : local;
+  st = KlineDecodeStats{};
+  KlineSax sax(out, st, min_ts, max_ts);
+  return json::sax_parse(body.begin(), body.end(), &sax);
+}
+
+} // namespace etai
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include "bar_store.h"
+
+namespace etai {
+
+// ============================================================================
+// Потоковый разбор ответа Bybit v5 /market/kline (SAX nlohmann, без DOM):
+//   {"retCode":0, "result":{"list":[["ts","o","h","l","c","v","turnover"], ...]}}
+// Поля сразу переводятся from_chars в int64/double и дописываются в колонки
+// BarRows — без std::string на поле и без DOM между сетью и хранилищем.
+// Порядок строк — как в ответе (у Bybit — от новых к старым).
+// ============================================================================
+
+struct KlineDecodeStats {
+  int    ret_code = -1;       // -1 — поля retCode нет
+  size_t raw_rows = 0;        // строк в list (включая отброшенные)
+  size_t skipped  = 0;        // битый ts / числа
+  size_t filtered = 0;        // вне [min_ts, max_ts]
+};
+
+// false — не JSON. Строки с ts вне [min_ts, max_ts] пропускаются (filtered),
+// строки короче 7 полей — молча (как прежде).
+bool decode_bybit_klines(std::string_view body,
+                         BarRows& out,
+                         KlineDecodeStats* stats = nullptr,
+                         int64_t min_ts = std::numeric_limits<int64_t>::min(),
+                         int64_t max_ts = std::numeric_limits<int64_t>::max());
+
+} // namespace etai
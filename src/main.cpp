@@ -20,6 +20,7 @@
 #include "routes/pipeline.cpp"
 #include "routes/compat_stubs.cpp"
 #include "routes/version_status.cpp"
+#include "routes/bench.cpp"
 
 #include "robot/utils.cpp"
 #include "robot/bybit_helpers.cpp"
@@ -71,12 +72,14 @@ int main(int argc, char** argv) {
     register_pipeline_routes(svr);
     register_compat_stubs(svr);
     register_version_status_routes(svr);
+    register_bench_routes(svr);
     
     std::cout << "[EdgeTrader] Server started on port " << port << std::endl;
     std::cout << "[EdgeTrader] 🤖 Robot: READY" << std::endl;
     std::cout << "[EdgeTrader] Model: thr=" << etai::get_model_thr()
               << " ma=" << etai::get_model_ma_len()
               << " feat=" << etai::get_model_feat_dim() << std::endl;
+    std::cout << "[EdgeTrader] SIMD: " << etai::vk::level_name(etai::vk::active_level()) << std::endl;
     
     svr.listen("0.0.0.0", port);
     
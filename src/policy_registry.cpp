@@ -0,0 +1,223 @@
+#include "policy_registry.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+namespace etai {
+
+using json = nlohmann::json;
+
+namespace {
+
+std::mutex                                  g_mu;
+std::unordered_map<std::string, PolicyPtr>  g_map;     // "<SYM>_<TF>" → снимок
+
+std::atomic<unsigned long long> g_generation{0};
+std::atomic<unsigned long long> g_hits{0};
+std::atomic<unsigned long long> g_loads{0};
+std::atomic<unsigned long long> g_publishes{0};
+
+long long mtime_ns(const std::string& path) {
+  struct stat st{};
+  if (path.empty() || ::stat(path.c_str(), &st) != 0) return -1;
+  return (long long)st.st_mtim.tv_sec * 1000000000LL + (long long)st.st_mtim.tv_nsec;
+}
+
+std::string model_path_for(const std::string& symbol, const std::string& interval) {
+  return "cache/models/" + symbol + "_" + interval + "_ppo_pro.json";
+}
+
+std::string key_of(const std::string& symbol, const std::string& interval) {
+  return symbol + "_" + canonical_interval(interval);
+}
+
+// <SYM>_<TF>_ppo_pro.json → SYM, TF
+bool parse_model_filename(const std::string& path, std::string& symbol, std::string& interval) {
+  static const std::string suffix = "_ppo_pro.json";
+  const size_t slash = path.find_last_of('/');
+  std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+  if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+    return false;
+  name.resize(name.size() - suffix.size());
+  const size_t us = name.find_last_of('_');
+  if (us == std::string::npos || us == 0 || us + 1 == name.size()) return false;
+  symbol   = name.substr(0, us);
+  interval = name.substr(us + 1);
+  return true;
+}
+
+PolicyPtr load_from_disk(const std::string& symbol, const std::string& interval, const std::string& path) {
+  const long long t = mtime_ns(path);
+  if (t < 0) return nullptr;
+  json model;
+  try {
+    std::ifstream f(path);
+    if (!f) return nullptr;
+    f >> model;
+  } catch (...) {
+    auto p = std::make_shared<CompiledPolicy>();
+    p->symbol = symbol; p->interval = interval; p->path = path;
+    p->error = "model_parse_failed";
+    p->mtime_ns = t;
+    return p;
+  }
+  auto p = std::const_pointer_cast<CompiledPolicy>(compile_policy(model, symbol, interval, path));
+  p->mtime_ns = t;
+  return p;
+}
+
+} // namespace
+
+PolicyPtr compile_policy(const json& model,
+                         const std::string& symbol,
+                         const std::string& interval,
+                         const std::string& path)
+{
+  auto p = std::make_shared<CompiledPolicy>();
+  p->symbol = symbol; p->interval = interval; p->path = path;
+  p->generation = g_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+
+  try {
+    if (!model.is_object()) { p->error = "no_policy_in_model"; return p; }
+    p->best_thr = model.value("best_thr", 0.0);
+    p->ma_len   = model.value("ma_len", 12);
+    p->version  = model.value("version", 3);
+    p->tp       = model.value("tp", 0.0);
+    p->sl       = model.value("sl", 0.0);
+
+    if (!model.contains("policy") || !model["policy"].is_object()) { p->error = "no_policy_in_model"; return p; }
+    const json& P = model["policy"];
+
+    const int D = P.value("feat_dim", 0);
+    std::vector<double> wv = P.value("W", std::vector<double>{});
+    std::vector<double> bv = P.value("b", std::vector<double>{});
+    if (D <= 0 || (int)wv.size() != D || bv.size() != 1) { p->error = "policy_scoring_failed"; return p; }
+
+    p->feat_dim = D;
+    const int fv = P.value("feat_version", 0);
+    p->feat_version = (feature_dim(fv) == (size_t)D) ? fv : feature_version_for_dim((size_t)D);
+    if (feature_dim(p->feat_version) != (size_t)D) { p->error = "bad_feat_version"; return p; }
+    p->w_raw    = std::move(wv);
+    p->b_raw    = bv[0];
+
+    // policy.norm → вшиваем в веса (правила как у прежнего extract_policy_norm)
+    if (P.contains("norm") && P["norm"].is_object()) {
+      const json& n = P["norm"];
+      if (n.contains("mu") && n.contains("sd") && n["mu"].is_array() && n["sd"].is_array()
+          && (int)n["mu"].size() == D && (int)n["sd"].size() == D) {
+        p->w_fused.resize((size_t)D);
+        double b = p->b_raw;
+        for (int i = 0; i < D; ++i) {
+          const double mu = n["mu"][i].get<double>();
+          double sd = n["sd"][i].get<double>();
+          if (!std::isfinite(sd) || sd < 1e-12) sd = 1.0;
+          const double w = p->w_raw[(size_t)i] / sd;
+          p->w_fused[(size_t)i] = w;
+          b -= w * mu;
+        }
+        p->b_fused  = b;
+        p->has_norm = true;
+      }
+    }
+  } catch (const std::exception&) {
+    p->error = "policy_scoring_failed";
+    p->has_norm = false;
+  }
+  return p;
+}
+
+PolicyPtr get_policy(const std::string& symbol, const std::string& interval) {
+  const std::string tf   = canonical_interval(interval);
+  const std::string key  = key_of(symbol, tf);
+  PolicyPtr cur;
+  {
+    std::lock_guard<std::mutex> lk(g_mu);
+    auto it = g_map.find(key);
+    if (it != g_map.end()) cur = it->second;
+  }
+  // файл переписан снаружи (скрипты, ручная правка) — перекомпилируем
+  const std::string path = cur ? cur->path : model_path_for(symbol, tf);
+  const long long t = mtime_ns(path);
+  if (cur && cur->mtime_ns == t && t >= 0) {
+    g_hits.fetch_add(1, std::memory_order_relaxed);
+    return cur;
+  }
+
+  PolicyPtr fresh = load_from_disk(symbol, tf, path);
+  if (!fresh && cur && cur->path != model_path_for(symbol, tf))
+    fresh = load_from_disk(symbol, tf, model_path_for(symbol, tf));
+  g_loads.fetch_add(1, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lk(g_mu);
+  if (fresh) g_map[key] = fresh;
+  else       g_map.erase(key);
+  return fresh;
+}
+
+PolicyPtr publish_policy(const json& model,
+                         const std::string& path,
+                         const std::string& symbol,
+                         const std::string& interval)
+{
+  std::string sym = symbol, tf = interval;
+  if (sym.empty() || tf.empty()) {
+    std::string fs, ft;
+    if (parse_model_filename(path, fs, ft)) {
+      if (sym.empty()) sym = fs;
+      if (tf.empty())  tf  = ft;
+    }
+  }
+  if (model.is_object()) {
+    if (sym.empty()) sym = model.value("symbol", std::string());
+    if (tf.empty())  tf  = model.value("interval", std::string());
+  }
+  if (sym.empty() || tf.empty()) return nullptr;     // не к чему привязать
+  tf = canonical_interval(tf);
+
+  auto p = std::const_pointer_cast<CompiledPolicy>(compile_policy(model, sym, tf, path));
+  p->mtime_ns = mtime_ns(path);
+  g_publishes.fetch_add(1, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lk(g_mu);
+  g_map[key_of(sym, tf)] = p;
+  return p;
+}
+
+void invalidate_policy(const std::string& symbol, const std::string& interval) {
+  std::lock_guard<std::mutex> lk(g_mu);
+  g_map.erase(key_of(symbol, interval));
+}
+
+json policy_registry_stats() {
+  json entries = json::array();
+  std::lock_guard<std::mutex> lk(g_mu);
+  for (const auto& kv : g_map) {
+    const CompiledPolicy& p = *kv.second;
+    entries.push_back(json{
+      {"key",        kv.first},
+      {"path",       p.path},
+      {"ok",         p.ok()},
+      {"error",      p.ok() ? json(nullptr) : json(p.error)},
+      {"feat_dim",   p.feat_dim},
+      {"feat_version", p.feat_version},
+      {"has_norm",   p.has_norm},
+      {"best_thr",   p.best_thr},
+      {"generation", p.generation}
+    });
+  }
+  return json{
+    {"entries",   entries},
+    {"count",     (unsigned long long)g_map.size()},
+    {"hits",      g_hits.load(std::memory_order_relaxed)},
+    {"loads",     g_loads.load(std::memory_order_relaxed)},
+    {"publishes", g_publishes.load(std::memory_order_relaxed)}
+  };
+}
+
+} // namespace etai
@@ -0,0 +1,69 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "features/feature_spec.h"
+
+namespace etai {
+
+// ============================================================================
+// Реестр скомпилированных политик per (symbol, interval).
+// Модель парсится один раз; нормировка (x − mu)/sd вшита в веса:
+//   z = b_fused + Σ w_fused[i]·x[i],  w_fused = W/sd,  b_fused = b − Σ W·mu/sd
+// Записи неизменяемы и подменяются целиком (reload / set / train),
+// читатель держит shared_ptr на снимок до конца запроса.
+// ============================================================================
+
+struct CompiledPolicy {
+    std::string symbol, interval, path;
+    std::string error;                 // пусто — политика пригодна для скоринга
+
+    int    feat_dim = 0;
+    int    feat_version = FEAT_V9;     // policy.feat_version; старые модели — по feat_dim
+    bool   has_norm = false;
+    std::vector<double> w_fused;       // D (при has_norm)
+    double b_fused = 0.0;
+    std::vector<double> w_raw;         // D — для fallback с z-score по всей матрице
+    double b_raw = 0.0;
+
+    double best_thr = 0.0;
+    int    ma_len   = 12;
+    int    version  = 3;
+    double tp = 0.0, sl = 0.0;
+
+    long long mtime_ns = -1;           // mtime файла на момент компиляции
+    unsigned long long generation = 0; // номер публикации (растёт при каждой подмене)
+
+    bool ok() const { return error.empty(); }
+
+    // z = b + W·x по «сырой» строке признаков (только при has_norm)
+    double fused_z(const double* x) const {
+        double z = b_fused;
+        for (int i = 0; i < feat_dim; ++i) z += w_fused[(size_t)i] * x[i];
+        return z;
+    }
+};
+using PolicyPtr = std::shared_ptr<const CompiledPolicy>;
+
+// Скомпилировать JSON модели (без регистрации)
+PolicyPtr compile_policy(const nlohmann::json& model,
+                         const std::string& symbol = std::string(),
+                         const std::string& interval = std::string(),
+                         const std::string& path = std::string());
+
+// Политика для пары; при промахе или изменённом на диске файле — загрузка
+// cache/models/<SYM>_<TF>_ppo_pro.json. nullptr — файла нет / не JSON.
+PolicyPtr get_policy(const std::string& symbol, const std::string& interval);
+
+// Подменить запись (после записи файла / горячей подстановки).
+// symbol/interval пустые — берутся из имени файла <SYM>_<TF>_ppo_pro.json или из полей модели.
+PolicyPtr publish_policy(const nlohmann::json& model,
+                         const std::string& path,
+                         const std::string& symbol = std::string(),
+                         const std::string& interval = std::string());
+
+void invalidate_policy(const std::string& symbol, const std::string& interval);
+nlohmann::json policy_registry_stats();
+
+} // namespace etai
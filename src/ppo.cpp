@@ -1,4 +1,5 @@
 #include "ppo.h"
+#include "bars_view.h"
 #include <armadillo>
 #include <cmath>
 #include <algorithm>
@@ -23,10 +24,10 @@ static arma::vec rolling_mean(const arma::vec& x, int w) {
   return out;
 }
 
-static arma::vec price_to_returns(const arma::vec& close) {
-  arma::vec ret = arma::zeros(close.n_elem);
-  for (size_t i = 1; i < close.n_elem; i++)
-    ret(i) = (close(i) - close(i - 1)) / close(i - 1);
+static arma::vec price_to_returns(DSpan close) {
+  arma::vec ret = arma::zeros(close.size());
+  for (size_t i = 1; i < close.size(); i++)
+    ret(i) = (close[i] - close[i - 1]) / close[i - 1];
   return ret;
 }
 
@@ -36,14 +37,14 @@ json evalPPO_internal(const arma::mat& M,
                       double tp_pct,
                       double sl_pct,
                       int ma_len) {
-  if (M.n_rows < 5 || M.n_cols < (size_t)(ma_len + 2)) {
+  const BarsView bars = bars_view(M);
+  if (bars.size() < (size_t)(ma_len + 2)) {
     return json{{"ok", false}, {"error", "not_enough_data"}};
   }
 
-  const arma::vec open  = M.row(1).t();
-  const arma::vec high  = M.row(2).t();
-  const arma::vec low   = M.row(3).t();
-  const arma::vec close = M.row(4).t();
+  const DSpan high  = bars.high;
+  const DSpan low   = bars.low;
+  const DSpan close = bars.close;
 
   arma::vec ret = price_to_returns(close);
   arma::vec rma = rolling_mean(ret, ma_len);
@@ -51,26 +52,26 @@ json evalPPO_internal(const arma::mat& M,
   auto evaluate = [&](double thr) {
     double totalReward = 0.0;
     int trades = 0, wins = 0;
-    for (size_t i = ma_len + 1; i + 1 < close.n_elem; i++) {
+    for (size_t i = ma_len + 1; i + 1 < close.size(); i++) {
       double s = rma(i);
       int action = 0;
       if (std::abs(s) > thr) action = (s > 0) ? +1 : -1;
 
       if (action != 0) {
-        double entry    = close(i);
+        double entry    = close[i];
         double tp_price = entry * (1.0 + (action > 0 ? tp_pct : -tp_pct));
         double sl_price = entry * (1.0 - (action > 0 ? sl_pct : -sl_pct));
         double r = 0.0;
 
         // conservative intrabar: SL приоритетнее TP
-        if ((action > 0 && low(i + 1)  <= sl_price) ||
-            (action < 0 && high(i + 1) >= sl_price)) {
+        if ((action > 0 && low[i + 1]  <= sl_price) ||
+            (action < 0 && high[i + 1] >= sl_price)) {
           r = -sl_pct;
-        } else if ((action > 0 && high(i + 1) >= tp_price) ||
-                   (action < 0 && low(i + 1)  <= tp_price)) {
+        } else if ((action > 0 && high[i + 1] >= tp_price) ||
+                   (action < 0 && low[i + 1]  <= tp_price)) {
           r = tp_pct;
         } else {
-          r = (close(i + 1) - entry) / entry;
+          r = (close[i + 1] - entry) / entry;
           if (action < 0) r = -r;
         }
 
@@ -103,26 +104,26 @@ json evalPPO_internal(const arma::mat& M,
   json agents = json::array();
   auto eval_agent = [&](const char* name, int sign) {
     double tot=0.0; int trades=0, wins=0;
-    std::vector<double> eq; eq.reserve(close.n_elem);
+    std::vector<double> eq; eq.reserve(close.size());
     double equity=0.0, peak=0.0, dd=0.0;
 
-    for (size_t i = ma_len + 1; i + 1 < close.n_elem; i++) {
+    for (size_t i = ma_len + 1; i + 1 < close.size(); i++) {
       double s = rma(i) * sign;
       int act = (s > best_thr) ? +1 : 0;
       if (act != 0) {
-        double entry = close(i);
+        double entry = close[i];
         double tp_price = entry * (1.0 + (sign > 0 ? tp_pct : -tp_pct));
         double sl_price = entry * (1.0 - (sign > 0 ? sl_pct : -sl_pct));
         double r = 0.0;
 
-        if ((sign > 0 && low(i + 1)  <= sl_price) ||
-            (sign < 0 && high(i + 1) >= sl_price)) {
+        if ((sign > 0 && low[i + 1]  <= sl_price) ||
+            (sign < 0 && high[i + 1] >= sl_price)) {
           r = -sl_pct;
-        } else if ((sign > 0 && high(i + 1) >= tp_price) ||
-                   (sign < 0 && low(i + 1)  <= tp_price)) {
+        } else if ((sign > 0 && high[i + 1] >= tp_price) ||
+                   (sign < 0 && low[i + 1]  <= tp_price)) {
           r = tp_pct;
         } else {
-          r = (close(i + 1) - entry) / entry;
+          r = (close[i + 1] - entry) / entry;
           if (sign < 0) r = -r;
         }
 
@@ -166,7 +167,7 @@ json evalPPO_internal(const arma::mat& M,
   // neutral (volatility)
   double sigma_thr = 0.001;
   int calm_bars = 0;
-  int total_bars = (int)close.n_elem;
+  int total_bars = (int)close.size();
   arma::vec ret2 = price_to_returns(close);
   for (size_t i = ma_len + 20; i < ret2.n_elem; i++) {
     double sigma = arma::stddev(ret2.rows(i - 20, i - 1));
@@ -199,11 +200,11 @@ json evalPPO_internal(const arma::mat& M,
 
 // === single-TF inference (kept) ===
 json infer_with_threshold(const arma::mat& M, double best_thr, int ma_len) {
-  if (M.n_rows < 5 || M.n_cols < (size_t)(ma_len + 1)) {
+  const BarsView bars = bars_view(M);
+  if (bars.size() < (size_t)(ma_len + 1)) {
     return json{{"ok", false}, {"error", "not_enough_data"}};
   }
-  const arma::vec close = M.row(4).t();
-  arma::vec ret = price_to_returns(close);
+  arma::vec ret = price_to_returns(bars.close);
   arma::vec rma = rolling_mean(ret, ma_len);
 
   double s = rma(rma.n_elem - 1);
@@ -230,11 +231,11 @@ json infer_mtf(const arma::mat& M15, double thr15, int ma15,
                const arma::mat* M240,  int ma240,
                const arma::mat* M1440, int ma1440) {
   // 15m
-  if (M15.n_rows < 5 || M15.n_cols < (size_t)(ma15 + 1)) {
+  const BarsView b15 = bars_view(M15);
+  if (b15.size() < (size_t)(ma15 + 1)) {
     return json{{"ok", false}, {"error", "not_enough_data_15"}};
   }
-  const arma::vec close15 = M15.row(4).t();
-  arma::vec ret15 = price_to_returns(close15);
+  arma::vec ret15 = price_to_returns(b15.close);
   arma::vec rma15 = rolling_mean(ret15, ma15);
   double s15 = rma15(rma15.n_elem - 1);
 
@@ -249,9 +250,9 @@ json infer_mtf(const arma::mat& M15, double thr15, int ma15,
   // Старшие ТФ
   auto compute_s = [&](const arma::mat* M, int ma) -> std::pair<bool,double> {
     if (!M) return {false, 0.0};
-    if (M->n_rows < 5 || M->n_cols < (size_t)(ma + 1)) return {false, 0.0};
-    arma::vec c = M->row(4).t();
-    arma::vec r = price_to_returns(c);
+    const BarsView b = bars_view(*M);
+    if (b.size() < (size_t)(ma + 1)) return {false, 0.0};
+    arma::vec r = price_to_returns(b.close);
     arma::vec rm = rolling_mean(r, ma);
     return {true, rm(rm.n_elem - 1)};
   };
@@ -311,26 +312,24 @@ json infer_mtf_batch(const arma::mat& M15, double thr15, int ma15,
                      const arma::mat* M240,  int ma240,
                      const arma::mat* M1440, int ma1440,
                      int last_n) {
-  if (M15.n_rows < 5 || M15.n_cols < (size_t)(ma15 + 21)) {
+  const BarsView b15 = bars_view(M15);
+  if (b15.size() < (size_t)(ma15 + 21)) {
     return json{{"ok", false}, {"error", "not_enough_data_15"}};
   }
-  const arma::rowvec ts15 = M15.row(0);
-  const arma::vec close15 = M15.row(4).t();
-  arma::vec ret15 = price_to_returns(close15);
+  arma::vec ret15 = price_to_returns(b15.close);
   arma::vec rma15 = rolling_mean(ret15, ma15);
 
   auto build_scores = [&](const arma::mat* M, int ma) {
     std::vector<std::pair<long long,double>> out;
     if (!M) return out;
-    if (M->n_rows < 5 || M->n_cols < (size_t)(ma + 1)) return out;
-    const arma::rowvec ts = M->row(0);
-    arma::vec c = M->row(4).t();
-    arma::vec r = price_to_returns(c);
+    const BarsView b = bars_view(*M);
+    if (b.size() < (size_t)(ma + 1)) return out;
+    arma::vec r = price_to_returns(b.close);
     arma::vec rm = rolling_mean(r, ma);
     size_t start = std::max( (size_t)(ma+1), (size_t)1 );
-    out.reserve(M->n_cols);
-    for (size_t i = start; i < M->n_cols; ++i) {
-      out.emplace_back( (long long)ts(i), rm(i) );
+    out.reserve(b.size());
+    for (size_t i = start; i < b.size(); ++i) {
+      out.emplace_back( (long long)b.ts(i), rm(i) );
     }
     return out;
   };
@@ -350,7 +349,7 @@ json infer_mtf_batch(const arma::mat& M15, double thr15, int ma15,
 
   size_t i60=0, i240=0, i1440=0;
 
-  size_t end = M15.n_cols; // not inclusive
+  size_t end = b15.size(); // not inclusive
   size_t start = (end > (size_t)last_n) ? end - (size_t)last_n : 0;
   size_t warmup = std::max((size_t)(ma15 + 20), (size_t)1);
   if (start < warmup) start = warmup;
@@ -358,7 +357,7 @@ json infer_mtf_batch(const arma::mat& M15, double thr15, int ma15,
   json items = json::array();
 
   for (size_t i = start; i < end; ++i) {
-    long long ts = (long long)ts15(i);
+    long long ts = (long long)b15.ts(i);
     double s15 = rma15(i);
     double sigma15 = arma::stddev(ret15.rows(i - 20, i - 1));
 
@@ -4,6 +4,8 @@
 
 namespace etai {
 
+// Матрицы баров — N×6 (ts,open,high,low,close,vol), как bar_cache; читаются через bars_view
+
 // ВНУТРЕННЯЯ оценочная функция для PRO-поиска параметров.
 // Не пишет модель, не является публичным режимом.
 nlohmann::json evalPPO_internal(const arma::mat& M,
@@ -1,5 +1,4 @@
 #include "ppo_pro.h"
-#include "features.h"
 #include "json.hpp"
 #include <armadillo>
 #include <vector>
@@ -11,6 +10,9 @@
 #include "metrics.h"
 #include "rewardv2_accessors.h"
 
+#include "bars_view.h"
+#include "features/features.h"
+#include "features/simd_kernels.h"
 #include "features/support_resistance.h"
 #include "features/manip_detector.h"
 
@@ -19,8 +21,6 @@ using namespace arma;
 
 namespace etai {
 
-arma::Mat<double> build_feature_matrix(const arma::Mat<double>&);
-
 // ----------------- утилиты -----------------
 static inline bool env_enabled(const char* k){
     const char* s = std::getenv(k);
@@ -33,9 +33,11 @@ static inline double clampd(double v,double lo,double hi){
     if(v>hi) return hi;
     return v;
 }
-static inline double sigmoid(double z){
-    if(!std::isfinite(z)) z=0.0;
-    return 1.0/(1.0+std::exp(-z));
+// σ(z) векторным ядром (нечисловой z → 0.5)
+static vec sigmoid_vec(const vec& z){
+    vec p(z.n_elem);
+    vk::sigmoid(z.memptr(), p.memptr(), z.n_elem);
+    return p;
 }
 
 // простая логрег
@@ -43,16 +45,14 @@ static void train_logreg(const mat& X,const vec& y,vec& W,double& b,int epochs,d
     W.set_size(X.n_cols); W.zeros(); b=0.0;
     for(int e=0;e<epochs;++e){
         vec z=X*W+b;
-        vec p=1.0/(1.0+arma::exp(-z));
+        vec p=sigmoid_vec(z);
         vec g=X.t()*(p-y)/X.n_rows + l2*W;
         double gb=arma::accu(p-y)/X.n_rows;
         W-=lr*g; b-=lr*gb;
     }
 }
 static vec predict_proba(const mat& X,const vec& W,double b){
-    vec z=X*W+b;
-    for(uword i=0;i<z.n_rows;++i) z(i)=sigmoid(z(i));
-    return z;
+    return sigmoid_vec(X*W+b);
 }
 
 // PnL серия под tp/sl + комиссия
@@ -109,6 +109,21 @@ static int trend_sign_from_features(const mat& F, uword start_row, uword end_row
 
 // ---------- Тренер ----------
 json trainPPO_pro(const arma::mat& raw15,
+                  const arma::mat* raw60,
+                  const arma::mat* raw240,
+                  const arma::mat* raw1440,
+                  int episodes,
+                  double tp, double sl, int ma_len,
+                  bool use_antimanip)
+{
+    const int ver = feature_version();
+    const mat F = (raw15.n_cols>=6 && raw15.n_rows>=300) ? build_feature_matrix(raw15, ver) : mat();
+    return trainPPO_pro(raw15, F, ver, raw60, raw240, raw1440, episodes, tp, sl, ma_len, use_antimanip);
+}
+
+json trainPPO_pro(const arma::mat& raw15,
+                  const arma::mat& F,
+                  int feat_version,
                   const arma::mat* raw60,
                   const arma::mat* raw240,
                   const arma::mat* raw1440,
@@ -123,22 +138,25 @@ json trainPPO_pro(const arma::mat& raw15,
             out["raw_cols"]=(int)raw15.n_cols; out["N_rows"]=(int)raw15.n_rows;
             return out;
         }
+        if(F.n_rows!=raw15.n_rows||F.n_cols==0||F.n_cols!=feature_dim(feat_version)){
+            out["ok"]=false; out["error"]="bad_feature_shape";
+            out["F_rows"]=(int)F.n_rows; out["N_rows"]=(int)raw15.n_rows;
+            out["F_cols"]=(int)F.n_cols; out["feat_version"]=feat_version;
+            return out;
+        }
 
-        // 1) Фичи 15m
-        mat F = build_feature_matrix(raw15);
+        // 1) Фичи 15m (готовая матрица — из хранилища признаков или build_feature_matrix)
         const uword N = F.n_rows;
         const uword D = F.n_cols;
-        const int FEAT_VERSION = (D > 28 ? 10 : 9);
+        const int FEAT_VERSION = feat_version;   // атрибут модели: policy.feat_version
 
         // 2) Будущая доходность
-        vec close = raw15.col(4);
-        vec high  = raw15.col(2);
-        vec low   = raw15.col(3);
-        vec open  = raw15.col(1);
+        const BarsView bars = bars_view(raw15);   // колонки raw15 без копий
+        const DSpan close = bars.close;
 
         vec r(N, fill::zeros);
         for(uword i=0;i+1<N;++i){
-            double c0=close(i), c1=close(i+1);
+            double c0=close[i], c1=close[i+1];
             r(i) = (c0>0.0) ? (c1/c0 - 1.0) : 0.0;
         }
         vec fut = arma::shift(r,-1); fut(N-1)=0.0;
@@ -204,12 +222,9 @@ json trainPPO_pro(const arma::mat& raw15,
         // 8) Anti-manip (за флагом)
         double manip_ratio = 0.0;
         if(env_enabled("ETAI_ENABLE_ANTI_MANIP")){
-            std::vector<double> Vopen(N), Vhigh(N), Vlow(N), Vclose(N);
-            for(uword i=0;i<N;++i){ Vopen[i]=open(i); Vhigh[i]=high(i); Vlow[i]=low(i); Vclose[i]=close(i); }
-
-            auto sup = rolling_support(Vlow,  20);
-            auto res = rolling_resistance(Vhigh,20);
-            auto fbf = false_break_flags(Vopen, Vhigh, Vlow, Vclose, sup, res, /*tol*/5e-4);
+            auto sup = rolling_support(bars.low,  20);
+            auto res = rolling_resistance(bars.high,20);
+            auto fbf = false_break_flags(bars.open, bars.high, bars.low, bars.close, sup, res, /*tol*/5e-4);
 
             uword a = std::min<uword>(split, (uword)idx.size());
             uword bnd = (idx.size()==0) ? 0 : (uword)idx.size();
@@ -247,7 +262,7 @@ json trainPPO_pro(const arma::mat& raw15,
 
             auto sign_from_raw = [&](const arma::mat* raw)->int{
                 if(!raw || raw->n_rows<10 || raw->n_cols<6) return 0;
-                arma::mat Fh = build_feature_matrix(*raw);
+                arma::mat Fh = build_feature_matrix(*raw, FEAT_VERSION);
                 if (Fh.n_cols==0) return 0;
                 return trend_sign_from_features(Fh, (uword)0, Fh.n_rows>20? (uword)(Fh.n_rows-1): (uword)(Fh.n_rows-1));
             };
@@ -305,7 +320,7 @@ json trainPPO_pro(const arma::mat& raw15,
         metrics["htf_agree60"]    = htf_agree60;
         metrics["htf_agree240"]   = htf_agree240;
         // FIXED: добавляем version в metrics
-        metrics["version"]        = env_enabled("ETAI_FEAT_ENABLE_MFLOW") ? 10 : 9;
+        metrics["version"]        = FEAT_VERSION;
 
         // Прометеус-гейджи
         etai::set_reward_avg(reward_v2);
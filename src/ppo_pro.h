@@ -16,4 +16,18 @@ nlohmann::json trainPPO_pro(const arma::mat& raw15,
                             int ma_len,
                             bool use_antimanip = false);
 
+// То же с готовой матрицей признаков F15 версии feat_version
+// (строки — бары raw15; хранилище признаков). Версия пишется в policy.feat_version.
+nlohmann::json trainPPO_pro(const arma::mat& raw15,
+                            const arma::mat& F15,
+                            int feat_version,
+                            const arma::mat* raw60,
+                            const arma::mat* raw240,
+                            const arma::mat* raw1440,
+                            int episodes,
+                            double tp,
+                            double sl,
+                            int ma_len,
+                            bool use_antimanip = false);
+
 } // namespace etai
@@ -6,12 +6,33 @@
 #include "utils.h"          // etai::backfill_last_months
 #include "utils_data.h"     // etai::data_health_report()
 #include "rt_metrics.h"     // REQ_BACKFILL
+#include "backfill_engine.h" // etai::backfill_submit / backfill_wait
 #include <set>
 #include <string>
 
 using json = nlohmann::json;
 
-// /api/backfill?symbol=BTCUSDT&months=1&which=15,60,240,1440
+// "15,60" → {"15","60"}; пусто — все ТФ
+static inline std::set<std::string> backfill_which(const httplib::Request& req) {
+  std::set<std::string> wanted = {"15","60","240","1440"};
+  const auto which = qp(req, "which", "");
+  if(!which.empty()){
+    wanted.clear();
+    std::string acc;
+    for(char c: which){
+      if(c==','){ if(!acc.empty()) { wanted.insert(acc); acc.clear(); } }
+      else acc.push_back(c);
+    }
+    if(!acc.empty()) wanted.insert(acc);
+  }
+  return wanted;
+}
+
+// /api/backfill?symbol=BTCUSDT&months=1&which=15,60,240,1440[&mode=auto|delta|full][&htf_source=agg|fetch]
+//   auto  — дельта, если серия уже покрывает окно months, иначе полная выгрузка
+//   delta — только бары после последнего сохранённого (дозапись)
+//   full  — всё окно заново + merge (история не обрезается, см. /api/backfill/compact)
+//   htf_source=agg (по умолчанию, ETAI_HTF_SOURCE) — 60/240/1440 из 15m без запросов к бирже
 static inline void register_backfill_routes(httplib::Server& srv){
   srv.Get("/api/backfill", [](const httplib::Request& req, httplib::Response& res){
     REQ_BACKFILL.fetch_add(1, std::memory_order_relaxed);
@@ -21,36 +42,32 @@ static inline void register_backfill_routes(httplib::Server& srv){
       try { return std::max(1, std::stoi(qp(req,"months","1"))); } catch(...) { return 1; }
     }();
 
-    std::set<std::string> wanted = {"15","60","240","1440"};
-    {
-      const auto which = qp(req, "which", "");
-      if(!which.empty()){
-        wanted.clear();
-        std::string acc;
-        for(char c: which){
-          if(c==','){ if(!acc.empty()) { wanted.insert(acc); acc.clear(); } }
-          else acc.push_back(c);
-        }
-        if(!acc.empty()) wanted.insert(acc);
-      }
-    }
+    const std::set<std::string> wanted = backfill_which(req);
+    const std::string mode = qp(req, "mode", "auto");
+    const std::string htf_source = qp(req, "htf_source", "");
 
     json intervals = json::array();
     json health    = json::array();
 
-    auto do_one = [&](const std::string& tf){
-      auto r = etai::backfill_last_months(symbol, tf, months);
+    // все ТФ — параллельно через движок (общий лимитер запросов), ответ — когда готовы все
+    std::vector<etai::BackfillJobSpec> specs;
+    for (auto& tf: wanted){
+      if (tf=="15"||tf=="60"||tf=="240"||tf=="1440") specs.push_back({symbol, tf, months, mode, htf_source, {}});
+    }
+    const auto ids = etai::backfill_submit(specs);
+
+    for (size_t i = 0; i < specs.size(); ++i){
+      const std::string& tf = specs[i].interval;
+      json r = etai::backfill_result_for(etai::backfill_wait(ids[i]), tf);
       intervals.push_back({
         {"symbol",symbol},{"interval",tf},{"months",months},
-        {"ok", r.value("ok", false)}, {"rows", r.value("rows", 0)}
+        {"ok", r.value("ok", false)}, {"rows", r.value("rows", 0)},
+        {"mode", r.value("mode", std::string())}, {"pages", r.value("pages", 0)},
+        {"appended", r.value("appended", 0)}
       });
       auto h = etai::data_health_report(symbol, tf);
       h["interval"] = tf; h["symbol"] = symbol;
       health.push_back(h);
-    };
-
-    for (auto& tf: wanted){
-      if (tf=="15"||tf=="60"||tf=="240"||tf=="1440") do_one(tf);
     }
 
     json out{
@@ -60,4 +77,168 @@ static inline void register_backfill_routes(httplib::Server& srv){
     };
     res.set_content(out.dump(2), "application/json");
   });
+
+  // /api/backfill/batch?symbols=BTCUSDT,ETHUSDT&which=15,60&months=6[&mode=auto|delta|full]
+  // POST: {"symbols":[...], "which":[...], "months":6, "mode":"auto"} — асинхронно, прогресс в /api/backfill/jobs
+  auto batch = [](const httplib::Request& req, httplib::Response& res){
+    REQ_BACKFILL.fetch_add(1, std::memory_order_relaxed);
+    try {
+      std::vector<std::string> symbols;
+      std::set<std::string> wanted = backfill_which(req);
+      int months = [&]{
+        try { return std::max(1, std::stoi(qp(req,"months","6"))); } catch(...) { return 6; }
+      }();
+      std::string mode = qp(req, "mode", "auto");
+      std::string htf_source = qp(req, "htf_source", "");
+
+      if (req.method == "POST" && !req.body.empty()) {
+        json b = json::parse(req.body);
+        if (b.contains("symbols") && b["symbols"].is_array())
+          for (auto& v : b["symbols"]) if (v.is_string()) symbols.push_back(v.get<std::string>());
+        if (b.contains("which") && b["which"].is_array()) {
+          wanted.clear();
+          for (auto& v : b["which"]) if (v.is_string()) wanted.insert(v.get<std::string>());
+        }
+        months = std::max(1, b.value("months", months));
+        mode   = b.value("mode", mode);
+        htf_source = b.value("htf_source", htf_source);
+      }
+      if (symbols.empty()) {
+        std::string acc;
+        for (char c : qp(req, "symbols", "")) {
+          if (c == ',') { if (!acc.empty()) { symbols.push_back(acc); acc.clear(); } }
+          else acc.push_back(c);
+        }
+        if (!acc.empty()) symbols.push_back(acc);
+      }
+      if (symbols.empty()) {
+        res.set_content(json{{"ok",false},{"error","symbols_required"}}.dump(), "application/json");
+        return;
+      }
+
+      std::vector<etai::BackfillJobSpec> specs;
+      for (auto& s : symbols)
+        for (auto& tf : wanted)
+          if (tf=="15"||tf=="60"||tf=="240"||tf=="1440") specs.push_back({s, tf, months, mode, htf_source, {}});
+      unsigned long long batch_id = 0;
+      const auto ids = etai::backfill_submit(specs, &batch_id);
+      json out{{"ok", true}, {"batch", batch_id}, {"jobs", ids}, {"count", ids.size()}};
+      res.set_content(out.dump(2), "application/json");
+    } catch (const std::exception& e) {
+      res.set_content(json{{"ok",false},{"error","bad_request"},{"what",e.what()}}.dump(), "application/json");
+    }
+  };
+  srv.Get("/api/backfill/batch", batch);
+  srv.Post("/api/backfill/batch", batch);
+
+  // /api/backfill/jobs[?batch=N | ?id=N] — прогресс задач движка
+  srv.Get("/api/backfill/jobs", [](const httplib::Request& req, httplib::Response& res){
+    try {
+      if (!qp(req, "id", "").empty()) {
+        res.set_content(etai::backfill_job_status(std::stoull(qp(req, "id", "0"))).dump(2), "application/json");
+        return;
+      }
+      const unsigned long long b = std::stoull(qp(req, "batch", "0"));
+      res.set_content(etai::backfill_jobs_status(b).dump(2), "application/json");
+    } catch (const std::exception& e) {
+      res.set_content(json{{"ok",false},{"error","bad_request"},{"what",e.what()}}.dump(), "application/json");
+    }
+  });
+
+  // /api/backfill/derive?symbol=BTCUSDT&which=60,240,1440 — пересчитать старшие ТФ из 15m (без сети)
+  srv.Get("/api/backfill/derive", [](const httplib::Request& req, httplib::Response& res){
+    const std::string symbol = qp(req, "symbol", "BTCUSDT");
+    std::set<std::string> wanted = backfill_which(req);
+    wanted.erase("15");
+    json intervals = json::array();
+    bool ok = true;
+    for (auto& tf : wanted) {
+      if (!(tf=="60"||tf=="240"||tf=="1440")) continue;
+      json r = etai::backfill_derive(symbol, tf);
+      ok = ok && r.value("ok", false);
+      intervals.push_back(r);
+    }
+    json out{{"ok", ok}, {"intervals", intervals}};
+    res.set_content(out.dump(2), "application/json");
+  });
+
+  // /api/backfill/clean?symbol=BTCUSDT&which=15,60[&fill=1] — raw → cache/clean/ в процессе
+  // (порядок, дубли, проверка OHLC, индекс пропусков); fill=1 — дозаполнить пропуски с биржи
+  srv.Get("/api/backfill/clean", [](const httplib::Request& req, httplib::Response& res){
+    const std::string symbol = qp(req, "symbol", "BTCUSDT");
+    const bool fill = qp(req, "fill", "0") == "1";
+    json intervals = json::array();
+    bool ok = true;
+    for (auto& tf : backfill_which(req)) {
+      if (!(tf=="15"||tf=="60"||tf=="240"||tf=="1440")) continue;
+      json r = etai::clean_cache(symbol, tf, fill);
+      ok = ok && r.value("ok", false);
+      intervals.push_back(r);
+    }
+    json out{{"ok", ok}, {"intervals", intervals}};
+    res.set_content(out.dump(2), "application/json");
+  });
+
+  // /api/backfill/compact?symbol=BTCUSDT&months=6&which=15,60 — обрезка истории старше months
+  srv.Get("/api/backfill/compact", [](const httplib::Request& req, httplib::Response& res){
+    const std::string symbol = qp(req, "symbol", "BTCUSDT");
+    const int months = [&]{
+      try { return std::max(1, std::stoi(qp(req,"months","6"))); } catch(...) { return 6; }
+    }();
+    json intervals = json::array();
+    bool ok = true;
+    for (auto& tf : backfill_which(req)) {
+      if (!(tf=="15"||tf=="60"||tf=="240"||tf=="1440")) continue;
+      json r = etai::compact_cache(symbol, tf, months);
+      ok = ok && r.value("ok", false);
+      intervals.push_back(r);
+    }
+    json out{{"ok", ok}, {"intervals", intervals}};
+    res.set_content(out.dump(2), "application/json");
+  });
+
+  // /api/backfill/archive?symbol=BTCUSDT&months=6&which=15,60 — история старше months → cache/archive
+  srv.Get("/api/backfill/archive", [](const httplib::Request& req, httplib::Response& res){
+    const std::string symbol = qp(req, "symbol", "BTCUSDT");
+    const int months = [&]{
+      try { return std::max(1, std::stoi(qp(req,"months","6"))); } catch(...) { return 6; }
+    }();
+    json intervals = json::array();
+    bool ok = true;
+    for (auto& tf : backfill_which(req)) {
+      if (!(tf=="15"||tf=="60"||tf=="240"||tf=="1440")) continue;
+      json r = etai::archive_cache(symbol, tf, months);
+      ok = ok && r.value("ok", false);
+      intervals.push_back(r);
+    }
+    json out{{"ok", ok}, {"intervals", intervals}};
+    res.set_content(out.dump(2), "application/json");
+  });
+
+  // /api/backfill/history?symbol=BTCUSDT&interval=15[&tail=N] — что видят обучение и признаки
+  // (load_bars: серия select_raw_path + её архив; tail — последние N баров через load_tail,
+  // читается только хвост, при нехватке горячей серии — конец архива)
+  srv.Get("/api/backfill/history", [](const httplib::Request& req, httplib::Response& res){
+    const std::string symbol = qp(req, "symbol", "BTCUSDT");
+    const std::string tf = etai::canonical_interval(qp(req, "interval", "15"));
+    const long long tail = [&]{
+      try { return std::max(0LL, std::stoll(qp(req, "tail", "0"))); } catch(...) { return 0LL; }
+    }();
+    bool used_clean = false;
+    const std::string path = etai::select_raw_path(symbol, tf, used_clean);
+    arma::mat raw;
+    const bool ok = tail > 0 ? etai::load_tail(symbol, tf, (size_t)tail, raw)
+                             : etai::load_bars(symbol, tf, INT64_MIN, INT64_MAX, raw);
+    if (!ok) {
+      res.set_content(json{{"ok",false},{"error","no_series"},{"path",path}}.dump(), "application/json");
+      return;
+    }
+    json out{
+      {"ok", true}, {"symbol", symbol}, {"interval", tf},
+      {"path", path}, {"clean", used_clean},
+      {"rows", (unsigned long long)raw.n_rows}
+    };
+    if (raw.n_rows) { out["ts_min"] = (long long)raw(0, 0); out["ts_max"] = (long long)raw(raw.n_rows - 1, 0); }
+    res.set_content(out.dump(2), "application/json");
+  });
 }
@@ -0,0 +1,390 @@
+#include "../httplib.h"
+#include "json.hpp"
+#include <armadillo>
+#include "../features/rolling_kernels.h"
+#include "../features/simd_kernels.h"
+#include "../kline_decode.h"
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Бенчмарки грузят CPU на потоках HTTP — только при ETAI_ENABLE_BENCH=1 (по умолчанию выкл.)
+static bool bench_enabled(httplib::Response& res) {
+    const char* s = std::getenv("ETAI_ENABLE_BENCH");
+    if (s && *s && (s[0]=='1'||s[0]=='T'||s[0]=='t'||s[0]=='Y'||s[0]=='y')) return true;
+    res.set_content(json{{"ok", false}, {"error", "not_enabled"}, {"hint", "set ETAI_ENABLE_BENCH=1"}}.dump(), "application/json");
+    return false;
+}
+
+// ---------- наивные O(n·p) эталоны (как прежние *_one) ----------
+static std::vector<double> bench_naive_sma(const std::vector<double>& v, int p) {
+    std::vector<double> out(v.size(), NAN);
+    for (size_t i = (size_t)p - 1; i < v.size(); ++i) {
+        double s = 0.0;
+        for (size_t j = i + 1 - p; j <= i; ++j) s += v[j];
+        out[i] = s / p;
+    }
+    return out;
+}
+
+static std::vector<double> bench_naive_window_ema(const std::vector<double>& v, int p) {
+    std::vector<double> out(v.size(), NAN);
+    const double k = 2.0 / (p + 1);
+    for (size_t i = (size_t)p - 1; i < v.size(); ++i) {
+        double e = v[i - p + 1];
+        for (size_t j = i - p + 2; j <= i; ++j) e = v[j] * k + e * (1.0 - k);
+        out[i] = e;
+    }
+    return out;
+}
+
+static std::vector<double> bench_naive_rsi(const std::vector<double>& c, int p) {
+    std::vector<double> out(c.size(), NAN);
+    for (size_t i = (size_t)p; i < c.size(); ++i) {
+        double gain = 0, loss = 0;
+        for (size_t j = i + 1 - p; j <= i; ++j) {
+            const double d = c[j] - c[j - 1];
+            if (d >= 0) gain += d; else loss -= d;
+        }
+        out[i] = (loss == 0) ? 100.0 : 100.0 - (100.0 / (1.0 + gain / loss));
+    }
+    return out;
+}
+
+static std::vector<double> bench_naive_max(const std::vector<double>& v, int w) {
+    std::vector<double> out(v.size());
+    for (size_t i = 0; i < v.size(); ++i) {
+        const size_t a = (i + 1 >= (size_t)w) ? i + 1 - w : 0;
+        out[i] = *std::max_element(v.begin() + a, v.begin() + i + 1);
+    }
+    return out;
+}
+
+template<class F>
+static double bench_ms(F&& f, std::vector<double>& out) {
+    const auto t0 = std::chrono::steady_clock::now();
+    out = f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static json bench_compare(const char* name,
+                          const std::function<std::vector<double>()>& naive,
+                          const std::function<std::vector<double>()>& kernel) {
+    std::vector<double> a, b;
+    const double t_naive  = bench_ms(naive, a);
+    const double t_kernel = bench_ms(kernel, b);
+    double max_rel = 0.0;
+    for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+        if (std::isnan(a[i]) != std::isnan(b[i])) { max_rel = INFINITY; break; }
+        if (std::isnan(a[i])) continue;
+        max_rel = std::max(max_rel, std::fabs(a[i] - b[i]) / (1.0 + std::fabs(a[i])));
+    }
+    return json{
+        {"name", name},
+        {"naive_ms", t_naive},
+        {"kernel_ms", t_kernel},
+        {"speedup", t_kernel > 0 ? t_naive / t_kernel : 0.0},
+        {"max_rel_err", std::isfinite(max_rel) ? json(max_rel) : json("nan_mismatch")}
+    };
+}
+
+// ---------- разбор свечей Bybit: DOM + строки (прежний путь) против SAX → колонки ----------
+static std::string bench_kline_body(size_t n, std::mt19937& rng) {
+    std::normal_distribution<double> nd(0.0, 1.0);
+    const long long t_end = 1700000000000LL;
+    std::string body = "{\"retCode\":0,\"retMsg\":\"OK\",\"result\":{\"category\":\"linear\",\"symbol\":\"BTCUSDT\",\"list\":[";
+    double px = 30000.0;
+    for (size_t i = 0; i < n; ++i) {
+        const double o = px, c = px * (1.0 + 0.002 * nd(rng));
+        const double h = std::max(o, c) * 1.001, l = std::min(o, c) * 0.999;
+        px = c;
+        char buf[256];
+        std::snprintf(buf, sizeof(buf), "%s[\"%lld\",\"%.2f\",\"%.2f\",\"%.2f\",\"%.2f\",\"%.3f\",\"%.4f\"]",
+                      i ? "," : "", t_end - (long long)i * 900000LL, o, h, l, c, 12.345 + i % 97, 370000.5 + i);
+        body += buf;
+    }
+    body += "]},\"retExtInfo\":{},\"time\":1700000000000}";
+    return body;
+}
+
+static size_t bench_dom_klines(const std::string& body, std::vector<std::array<std::string,7>>& rows) {
+    rows.clear();
+    auto j = json::parse(body, nullptr, false);
+    if (j.is_discarded() || j.value("retCode", -1) != 0) return 0;
+    for (const auto& row : j["result"]["list"]) {
+        std::array<std::string,7> r;
+        for (int k = 0; k < 7; ++k) r[k] = row.at(k).get<std::string>();
+        rows.push_back(std::move(r));
+    }
+    return rows.size();
+}
+
+// ---------- векторные ядра vk:: против прежних скалярных циклов ----------
+struct BenchSimdCase {
+    const char* name;
+    std::function<void(std::vector<double>&)> scalar;                            // прежний цикл
+    std::function<void(const etai::vk::Kernels&, std::vector<double>&)> kernel;
+};
+
+// лучшее из reps прогонов, мс
+static double bench_best_ms(const std::function<void()>& f, size_t reps) {
+    double best = INFINITY;
+    for (size_t r = 0; r < reps; ++r) {
+        const auto t0 = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+}
+
+static json bench_simd_case(const BenchSimdCase& c, size_t n_out, size_t reps) {
+    using etai::vk::Level;
+    std::vector<double> ref(n_out), got(n_out), first;
+    const double t_scalar = bench_best_ms([&]{ c.scalar(ref); }, reps);
+
+    json levels = json::object();
+    bool identical = true;
+    double t_active = 0.0;
+    for (Level l : {Level::Scalar, Level::AVX2, Level::AVX512}) {
+        if (!etai::vk::level_supported(l)) continue;
+        const etai::vk::Kernels& k = etai::vk::kernels(l);
+        const double t = bench_best_ms([&]{ c.kernel(k, got); }, reps);
+        levels[etai::vk::level_name(l)] = t;
+        if (l == etai::vk::active_level()) t_active = t;
+        if (first.empty()) first = got;
+        else identical = identical && std::memcmp(first.data(), got.data(), n_out * sizeof(double)) == 0;
+    }
+    c.kernel(etai::vk::kernels(), got);
+    double max_rel = 0.0;
+    for (size_t i = 0; i < n_out; ++i) {
+        if (std::isnan(ref[i]) && std::isnan(got[i])) continue;
+        max_rel = std::max(max_rel, std::fabs(ref[i] - got[i]) / std::max(1.0, std::fabs(ref[i])));
+    }
+    return json{
+        {"name", c.name},
+        {"scalar_ms", t_scalar},
+        {"kernel_ms", t_active},
+        {"speedup", t_active > 0 ? t_scalar / t_active : 0.0},
+        {"levels_ms", levels},
+        {"identical_levels", identical},
+        {"max_rel_err", std::isfinite(max_rel) ? json(max_rel) : json("nan_mismatch")}
+    };
+}
+
+void register_bench_routes(httplib::Server& svr) {
+    // GET /api/bench/kernels?n=100000&p=14 — наивные окна против rolling_kernels на синтетике
+    // (n ≤ 200000, p ≤ 200: наивный эталон — O(n·p))
+    svr.Get("/api/bench/kernels", [](const httplib::Request& req, httplib::Response& res) {
+        if (!bench_enabled(res)) return;
+        try {
+            size_t n = 100000;
+            int    p = 14;
+            if (req.has_param("n")) n = (size_t)std::stoull(req.get_param_value("n"));
+            if (req.has_param("p")) p = std::stoi(req.get_param_value("p"));
+            n = std::clamp<size_t>(n, 100, 200000);
+            p = std::clamp(p, 2, 200);
+
+            std::mt19937 rng(42);
+            std::normal_distribution<double> nd(0.0, 1.0);
+            std::uniform_real_distribution<double> ud(0.0, 1.0);
+            std::vector<double> close(n), vol(n);
+            double px = 30000.0;
+            for (size_t i = 0; i < n; ++i) {
+                px *= 1.0 + 0.002 * nd(rng);
+                close[i] = px;
+                vol[i]   = 100.0 + 1000.0 * ud(rng);
+            }
+
+            json rows = json::array();
+            rows.push_back(bench_compare("sma",
+                [&]{ return bench_naive_sma(close, p); },
+                [&]{ return etai::rk::sma(close, p); }));
+            rows.push_back(bench_compare("window_ema",
+                [&]{ return bench_naive_window_ema(close, p); },
+                [&]{ return etai::rk::window_ema(close, p); }));
+            rows.push_back(bench_compare("rsi_window",
+                [&]{ return bench_naive_rsi(close, p); },
+                [&]{ return etai::rk::rsi_window(close, p); }));
+            rows.push_back(bench_compare("rolling_max",
+                [&]{ return bench_naive_max(vol, p); },
+                [&]{ return etai::rk::rolling_max(vol, p); }));
+
+            json out{{"ok", true}, {"n", n}, {"p", p}, {"kernels", rows}};
+            res.set_content(out.dump(2), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 500;
+            res.set_content(json{{"ok", false}, {"error", e.what()}}.dump(), "application/json");
+        }
+    });
+
+    // GET /api/bench/kline_decode?n=1000&reps=200 — разбор страницы /v5/market/kline:
+    // DOM + std::array<std::string,7> + from_chars (прежний путь) против SAX-декодера в колонки
+    // (n ≤ 1000 — одна страница Bybit, reps ≤ 200)
+    svr.Get("/api/bench/kline_decode", [](const httplib::Request& req, httplib::Response& res) {
+        if (!bench_enabled(res)) return;
+        try {
+            size_t n = 1000, reps = 200;
+            if (req.has_param("n"))    n    = (size_t)std::stoull(req.get_param_value("n"));
+            if (req.has_param("reps")) reps = (size_t)std::stoull(req.get_param_value("reps"));
+            n    = std::clamp<size_t>(n, 1, 1000);
+            reps = std::clamp<size_t>(reps, 1, 200);
+
+            std::mt19937 rng(42);
+            const std::string body = bench_kline_body(n, rng);
+
+            std::vector<std::array<std::string,7>> rows;
+            etai::BarRows dom;
+            auto t0 = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < reps; ++r) {
+                bench_dom_klines(body, rows);
+                dom.clear();
+                for (const auto& x : rows) {
+                    long long ts = 0;
+                    double v[6];
+                    std::from_chars(x[0].data(), x[0].data() + x[0].size(), ts);
+                    for (int k = 0; k < 6; ++k) std::from_chars(x[k + 1].data(), x[k + 1].data() + x[k + 1].size(), v[k]);
+                    dom.push_back(ts, v[0], v[1], v[2], v[3], v[4], v[5]);
+                }
+            }
+            const double t_dom = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            etai::BarRows sax;
+            etai::KlineDecodeStats st;
+            bool ok = true;
+            t0 = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < reps; ++r) {
+                sax.clear();
+                ok = etai::decode_bybit_klines(body, sax, &st) && ok;
+            }
+            const double t_sax = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            bool same = ok && dom.size() == sax.size() && dom.ts == sax.ts;
+            for (int k = 0; k < 6 && same; ++k) same = dom.cols[k] == sax.cols[k];
+
+            const double rows_total = (double)n * (double)reps;
+            json out{
+                {"ok", true}, {"n", n}, {"reps", reps}, {"body_bytes", body.size()},
+                {"dom_ms", t_dom}, {"sax_ms", t_sax},
+                {"dom_rows_per_s", t_dom > 0 ? rows_total / t_dom * 1000.0 : 0.0},
+                {"sax_rows_per_s", t_sax > 0 ? rows_total / t_sax * 1000.0 : 0.0},
+                {"speedup", t_sax > 0 ? t_dom / t_sax : 0.0},
+                {"identical", same}
+            };
+            res.set_content(out.dump(2), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 500;
+            res.set_content(json{{"ok", false}, {"error", e.what()}}.dump(), "application/json");
+        }
+    });
+
+    // GET /api/bench/simd?n=200000&d=28&reps=20 — векторные ядра (все уровни CPU) против
+    // прежних скалярных циклов: время, совпадение уровней бит-в-бит, отклонение от libm/arma
+    // (n ≤ 200000, d ≤ 64, reps ≤ 50)
+    svr.Get("/api/bench/simd", [](const httplib::Request& req, httplib::Response& res) {
+        if (!bench_enabled(res)) return;
+        try {
+            size_t n = 200000, d = 28, reps = 20;
+            if (req.has_param("n"))    n    = (size_t)std::stoull(req.get_param_value("n"));
+            if (req.has_param("d"))    d    = (size_t)std::stoull(req.get_param_value("d"));
+            if (req.has_param("reps")) reps = (size_t)std::stoull(req.get_param_value("reps"));
+            n    = std::clamp<size_t>(n, 16, 200000);
+            d    = std::clamp<size_t>(d, 1, 64);
+            reps = std::clamp<size_t>(reps, 1, 50);
+
+            std::mt19937 rng(42);
+            std::normal_distribution<double> nd(0.0, 1.0);
+            std::vector<double> open(n), close(n), atr(n), a(n), b(n), z(n), ts(n), w(d);
+            double px = 30000.0;
+            for (size_t i = 0; i < n; ++i) {
+                open[i]  = px;
+                px      *= 1.0 + 0.002 * nd(rng);
+                close[i] = px;
+                atr[i]   = std::fabs(px * 0.003 * (1.0 + 0.3 * nd(rng)));
+                a[i]     = nd(rng);
+                b[i]     = std::fabs(nd(rng));
+                z[i]     = 3.0 * nd(rng);
+                ts[i]    = 1700000000000.0 + 900000.0 * (double)i;
+            }
+            for (auto& x : w) x = 0.1 * nd(rng);
+            const size_t rows = std::max<size_t>(1, n / d);
+            arma::mat F(rows, d);
+            for (double& x : F) x = nd(rng);
+            const arma::vec a_col(a), W(w);
+
+            const std::vector<BenchSimdCase> cases = {
+                {"ratio_eps",
+                 [&](std::vector<double>& o){ for (size_t i = 0; i < n; ++i) o[i] = a[i] / (b[i] + 1e-8); },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.ratio_eps(a.data(), b.data(), 1e-8, o.data(), n); }},
+                {"abs_ratio_eps",
+                 [&](std::vector<double>& o){ for (size_t i = 0; i < n; ++i) o[i] = std::fabs(a[i]) / (b[i] + 1e-8); },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.abs_ratio_eps(a.data(), b.data(), 1e-8, o.data(), n); }},
+                {"body_pct",
+                 [&](std::vector<double>& o){ for (size_t i = 0; i < n; ++i) o[i] = (open[i] > 0) ? (close[i] - open[i]) / open[i] : 0.0; },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.body_pct(open.data(), close.data(), o.data(), n); }},
+                {"candle_sentiment",
+                 [&](std::vector<double>& o){
+                     for (size_t i = 0; i < n; ++i)
+                         o[i] = std::tanh((close[i] - open[i]) / std::max(1e-6, std::isfinite(atr[i]) ? atr[i] : 0.0));
+                 },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.candle_sentiment(open.data(), close.data(), atr.data(), o.data(), n); }},
+                {"session_cycle",
+                 [&](std::vector<double>& o){
+                     for (size_t i = 0; i < n; ++i) {
+                         const long long hour = ((long long)ts[i] / 1000LL / 3600LL) % 24LL;
+                         const double ang = (2.0 * M_PI * (double)hour) / 24.0;
+                         o[i] = std::sin(ang);
+                         o[n + i] = std::cos(ang);
+                     }
+                 },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.session_cycle(ts.data(), o.data(), o.data() + n, n); }},
+                {"tanh",
+                 [&](std::vector<double>& o){ for (size_t i = 0; i < n; ++i) o[i] = std::tanh(z[i]); },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.tanh(z.data(), o.data(), n); }},
+                {"sigmoid",
+                 [&](std::vector<double>& o){ for (size_t i = 0; i < n; ++i) o[i] = 1.0 / (1.0 + std::exp(-z[i])); },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.sigmoid(z.data(), o.data(), n); }},
+                {"zscore",
+                 [&](std::vector<double>& o){
+                     double mu = arma::mean(a_col), sd = arma::stddev(a_col);
+                     if (!std::isfinite(sd) || sd < 1e-12) sd = 1.0;
+                     for (size_t i = 0; i < n; ++i) o[i] = (a[i] - mu) / sd;
+                 },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){ k.zscore(a.data(), o.data(), n); }},
+                {"policy_scores",   // tanh(F·W + b) по rows строкам d признаков
+                 [&](std::vector<double>& o){
+                     arma::vec s = arma::tanh(F * W + 0.05);
+                     std::copy(s.begin(), s.end(), o.begin());
+                 },
+                 [&](const etai::vk::Kernels& k, std::vector<double>& o){
+                     k.affine_cols(F.memptr(), rows, rows, d, w.data(), 0.05, o.data());
+                     k.tanh(o.data(), o.data(), rows);
+                 }},
+            };
+            const size_t n_out[] = {n, n, n, n, 2 * n, n, n, n, rows};
+
+            json rows_j = json::array();
+            for (size_t c = 0; c < cases.size(); ++c) rows_j.push_back(bench_simd_case(cases[c], n_out[c], reps));
+
+            json supported = json::array();
+            for (auto l : {etai::vk::Level::Scalar, etai::vk::Level::AVX2, etai::vk::Level::AVX512})
+                if (etai::vk::level_supported(l)) supported.push_back(etai::vk::level_name(l));
+            json out{{"ok", true}, {"n", n}, {"d", d}, {"reps", reps},
+                     {"level", etai::vk::level_name(etai::vk::active_level())},
+                     {"supported", supported}, {"kernels", rows_j}};
+            res.set_content(out.dump(2), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 500;
+            res.set_content(json{{"ok", false}, {"error", e.what()}}.dump(), "application/json");
+        }
+    });
+}
@@ -19,7 +19,6 @@ inline void register_compat_stubs(httplib::Server& svr){
     };
 
     svr.Get("/api/model/read",                not_impl("/api/model/read"));
-    svr.Get("/api/infer/batch",               not_impl("/api/infer/batch"));
     svr.Get("/api/pipeline/prepare_train",    not_impl("/api/pipeline/prepare_train"));
     svr.Get("/api/agents/test",               not_impl("/api/agents/test"));
     svr.Get("/api/robot/keys",                not_impl("/api/robot/keys"));
@@ -1,6 +1,7 @@
 #include "../httplib.h"
 #include "../server_accessors.h"
 #include "../utils_data.h"
+#include "../bar_store.h"
 #include "json.hpp"
 #include <fstream>
 
@@ -9,18 +10,15 @@ using json = nlohmann::json;
 static json check_cache_file(const std::string& symbol, const std::string& interval) {
     json r;
     std::string path = "cache/" + symbol + "_" + interval + ".csv";
-    std::ifstream f(path);
+    etai::SeriesMeta m{};
+    const bool have = etai::series_meta(path, m);   // сайдкар .meta, без чтения CSV
     
     r["path"] = path;
-    r["exists"] = f.good();
-    
-    if (f.good()) {
-        int lines = 0;
-        std::string line;
-        while (std::getline(f, line)) ++lines;
-        r["rows"] = lines - 1; // минус header
-    } else {
-        r["rows"] = 0;
+    r["exists"] = have;
+    r["rows"] = have ? (long long)m.rows : 0LL;
+    if (have) {
+        r["ts_max"] = m.ts_max;
+        r["gaps"] = m.gaps;
     }
     
     return r;
@@ -31,8 +29,9 @@ void register_diagnostic_routes(httplib::Server& svr) {
         json out;
         out["timestamp"] = (long long)time(nullptr) * 1000;
         
-        // 1. Текущая модель из RAM
-        json model = etai::get_current_model();
+        // 1. Текущая модель из RAM (один снимок: JSON и атомики согласованы)
+        const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
+        const json& model = snap->model;
         std::string model_symbol   = model.value("symbol", "");
         std::string model_interval = model.value("interval", "");
         double model_thr      = model.value("best_thr", 0.0);
@@ -56,9 +55,10 @@ void register_diagnostic_routes(httplib::Server& svr) {
         
         // 2. Атомики
         out["atomics"] = {
-            {"thr", etai::get_model_thr()},
-            {"ma_len", (long long)etai::get_model_ma_len()},
-            {"feat_dim", etai::get_model_feat_dim()}
+            {"thr", snap->thr},
+            {"ma_len", snap->ma_len},
+            {"feat_dim", snap->feat_dim},
+            {"version", snap->version}
         };
         
         // 3. Проверка кэшей для модели
@@ -94,9 +94,9 @@ void register_diagnostic_routes(httplib::Server& svr) {
         }
         
         // Несоответствия атомиков и модели
-        if (model_thr > 0 && std::abs(model_thr - etai::get_model_thr()) > 1e-6)
+        if (model_thr > 0 && std::abs(model_thr - snap->thr) > 1e-6)
             issues.push_back("atomic_thr_mismatch");
-        if (model_feat_dim > 0 && model_feat_dim != etai::get_model_feat_dim())
+        if (model_feat_dim > 0 && model_feat_dim != snap->feat_dim)
             issues.push_back("atomic_feat_dim_mismatch");
         
         out["issues"] = issues;
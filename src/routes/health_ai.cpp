@@ -111,7 +111,8 @@ struct Ctx { std::string symbol; std::string interval; std::string source; };
 static Ctx compute_context_only_model() {
     Ctx ctx;
     try {
-        auto m = etai::get_current_model();
+        const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
+        const json& m = snap->model;
         std::string msym, mivl, mpath;
         if (m.contains("symbol") && m["symbol"].is_string())   msym = m["symbol"].get<std::string>();
         if (m.contains("interval") && m["interval"].is_string()) mivl = m["interval"].get<std::string>();
@@ -198,7 +199,8 @@ void register_health_ai(httplib::Server& svr) {
 
         // model — RAM -> перезапись ядра из диска -> фоллбэк latest
         json ms = null_model_short();
-        try { json m = etai::get_current_model(); fill_from_ram(ms, m); } catch (...) {}
+        const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
+        try { fill_from_ram(ms, snap->model); } catch (...) {}
 
         // если есть model_path RAM — дочитаем и ПЕРЕЗАПИШЕМ ядро
         if (ms.contains("model_path") && ms["model_path"].is_string()) {
@@ -254,14 +256,14 @@ void register_health_ai(httplib::Server& svr) {
             if (ms.contains("best_thr") && !ms["best_thr"].is_null())
                 out["model_thr"] = ms["best_thr"];
             else
-                out["model_thr"] = etai::get_model_thr();
+                out["model_thr"] = snap->thr;
         } catch (...) {}
         try {
-            out["model_ma_len"] = etai::get_model_ma_len();
+            out["model_ma_len"] = snap->ma_len;
             if (!ms.contains("ma_len") || ms["ma_len"].is_null()) ms["ma_len"]=out["model_ma_len"];
         } catch (...) {}
         try {
-            out["model_feat_dim"] = etai::get_model_feat_dim();
+            out["model_feat_dim"] = snap->feat_dim;
             if (!ms.contains("feat_dim") || ms["feat_dim"].is_null()) ms["feat_dim"]=out["model_feat_dim"];
         } catch (...) { out["model_feat_dim"]=nullptr; }
 
@@ -5,10 +5,28 @@
 #include "ppo.h"
 #include "utils.h"
 #include "infer_policy.h"
+#include "policy_registry.h"
+#include "infer_cache.h"
 #include "utils_data.h"
+#include "bar_cache.h"
 #include "features/features.h"
+#include "features/feature_state.h"
+#include "features/indicator_graph.h"
+#include "feature_store.h"
 #include <armadillo>
 #include <set>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
 #include <fstream>
 #include <ctime>
 #include <cmath>
@@ -63,10 +81,20 @@ static inline json make_agents_summary() {
     };
 }
 
-// last close + tp/sl levels
+// Тело из кэша + текущие agents: счётчики живые, поэтому в кэш (и в ETag) не входят
+static std::string infer_body_with_agents(const std::string& body) {
+    if (body.size() < 2 || body.back() != '}') return body;
+    std::string out(body, 0, body.size() - 1);
+    out += ",\"agents\":";
+    out += make_agents_summary().dump();
+    out += '}';
+    return out;
+}
+
+// last close + tp/sl levels (N×6: ts,open,high,low,close,vol)
 static inline void enrich_with_levels(json &out, const arma::mat& M15, double tp, double sl) {
-    if (M15.n_rows >= 5 && M15.n_cols >= 1) {
-        double last = (double) M15.row(4)(M15.n_cols - 1); // close
+    if (M15.n_cols >= 5 && M15.n_rows >= 1) {
+        double last = M15(M15.n_rows - 1, 4); // close
         out["tp_price_long"]   = last * (1.0 + tp);
         out["sl_price_long"]   = last * (1.0 - sl);
         out["tp_price_short"]  = last * (1.0 - tp);
@@ -75,25 +103,15 @@ static inline void enrich_with_levels(json &out, const arma::mat& M15, double tp
     }
 }
 
-// ATR(14) по 6×N матрице (rows: ts,open,high,low,close,vol)
+// ATR(14) последнего бара по N×6 матрице (cols: ts,open,high,low,close,vol) — узел ATR14
+// графа индикаторов, т.е. то же значение, что колонка 4 признаков. Срез в 32 бара:
+// после точного пересчёта окна суммы совпадают с расчётом по всему ряду.
 static inline double atr14_from_M(const arma::mat& M) {
-    if (M.n_cols < 16 || M.n_rows < 5) return 0.0;
-    size_t N = M.n_cols;
-    double prevClose = (double)M.row(4)(N-16);
-    double alpha = 1.0/14.0;
-    double ema = 0.0;
-    bool init=false;
-
-    for (size_t i = N-15; i < N; ++i) {
-        double hi = (double)M.row(2)(i);
-        double lo = (double)M.row(3)(i);
-        double cl = (double)M.row(4)(i);
-        double tr = std::max({hi - lo, std::fabs(hi - prevClose), std::fabs(lo - prevClose)});
-        if (!init) { ema = tr; init = true; }
-        else { ema = alpha*tr + (1.0-alpha)*ema; }
-        prevClose = cl;
-    }
-    return ema;
+    if (M.n_rows < 16 || M.n_cols < 6) return 0.0;
+    const size_t from = M.n_rows > 32 ? M.n_rows - 32 : 0;
+    etai::IndicatorGraph g(M, from);
+    const double atr = g[etai::Ind::ATR14].back();
+    return std::isfinite(atr) ? atr : 0.0;
 }
 
 // Простой разбор HTF-голосов (null-safe)
@@ -109,6 +127,247 @@ static inline void htf_votes(const json& inf, int& up, int& down) {
     }
 }
 
+// "a,b,,c" → {"a","b","c"}
+static std::vector<std::string> infer_split_csv(const std::string& s) {
+    std::vector<std::string> out;
+    std::string t;
+    for (char c : s) {
+        if (c == ',') { if (!t.empty()) { out.push_back(t); t.clear(); } }
+        else if (c != ' ') t.push_back(c);
+    }
+    if (!t.empty()) out.push_back(t);
+    return out;
+}
+
+static size_t infer_env_size(const char* k, size_t defv) {
+    const char* s = std::getenv(k);
+    if (!s || !*s) return defv;
+    long long v = std::atoll(s);
+    return v > 0 ? (size_t)v : defv;
+}
+
+// Общий пул воркеров для /api/infer/batch: число потоков фиксировано на процесс
+// (ETAI_INFER_WORKERS, по умолчанию — число ядер), параллельные batch-запросы
+// делят одну очередь, а не плодят потоки.
+class InferWorkerPool {
+public:
+    explicit InferWorkerPool(size_t n) : n_(std::max<size_t>(1, n)) {
+        for (size_t i = 0; i < n_; ++i) std::thread([this]{ loop(); }).detach();
+    }
+    std::future<void> submit(std::function<void()> fn) {
+        auto task = std::make_shared<std::packaged_task<void()>>(std::move(fn));
+        std::future<void> f = task->get_future();
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            q_.push_back([task]{ (*task)(); });
+        }
+        cv_.notify_one();
+        return f;
+    }
+    size_t size() const { return n_; }
+private:
+    void loop() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait(lk, [this]{ return !q_.empty(); });
+                job = std::move(q_.front());
+                q_.pop_front();
+            }
+            job();
+        }
+    }
+    size_t n_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> q_;
+};
+
+static InferWorkerPool& infer_pool() {
+    static InferWorkerPool pool(std::min<size_t>(64,
+        infer_env_size("ETAI_INFER_WORKERS", std::max(1u, std::thread::hardware_concurrency()))));
+    return pool;
+}
+
+// счётчики сигналов + время последнего инфера (и на попадании в кэш ответов)
+static void infer_count_signal(const std::string& sig) {
+    if (sig == "LONG") INFER_SIG_LONG.fetch_add(1, std::memory_order_relaxed);
+    else if (sig == "SHORT") INFER_SIG_SHORT.fetch_add(1, std::memory_order_relaxed);
+    else INFER_SIG_NEUTRAL.fetch_add(1, std::memory_order_relaxed);
+
+    LAST_INFER_TS.store((long long)time(nullptr)*1000, std::memory_order_relaxed);
+}
+
+// Полный ответ /api/infer для одной пары (без agents). Ошибки — {"ok":false,...}, не исключения.
+// counted_sig — сигнал, ушедший в счётчики (до flat-коррекции).
+static json infer_one(const std::string& symbol, const std::string& interval,
+                      const std::set<std::string>& wanted, double k_atr, double eps,
+                      std::string* counted_sig = nullptr)
+{
+    try {
+        REQ_INFER.fetch_add(1, std::memory_order_relaxed);
+
+        // скомпилированная политика из реестра (JSON разбирается только при смене модели)
+        etai::PolicyPtr policy = etai::get_policy(symbol, interval);
+        if (!policy) {
+            const std::string path = "cache/models/" + symbol + "_" + interval + "_ppo_pro.json";
+            json out{{"ok",false},{"error","model_not_found"},{"path",path}};
+            return out;
+        }
+        if (policy->error == "model_parse_failed") {
+            json out{{"ok",false},{"error","infer_failed"},{"what","model_parse_failed"},{"path","/api/infer"}};
+            return out;
+        }
+
+        double best_thr = policy->best_thr;
+        int    ma_len   = policy->ma_len;
+        int    version  = policy->version;
+        double tp       = policy->tp;
+        double sl       = policy->sl;
+
+        // N×6 (ts,open,high,low,close,vol) из процессного кэша баров
+        etai::BarMatrixPtr bars15 = etai::get_cached_bars(symbol, interval);
+        if (!bars15 || bars15->n_elem == 0) {
+            json out{{"ok",false},{"error","no_cached_data"},{"hint","call /api/backfill first"}};
+            return out;
+        }
+
+        // HTF матрицы как N×6 (shared_ptr держит снимок на время запроса)
+        etai::BarMatrixPtr b60, b240, b1440;
+        const arma::mat *p60=nullptr, *p240=nullptr, *p1440=nullptr;
+        if (wanted.count("60"))   { b60   = etai::get_cached_bars(symbol, "60");   if (b60   && b60->n_elem)   p60   = b60.get(); }
+        if (wanted.count("240"))  { b240  = etai::get_cached_bars(symbol, "240");  if (b240  && b240->n_elem)  p240  = b240.get(); }
+        if (wanted.count("1440")) { b1440 = etai::get_cached_bars(symbol, "1440"); if (b1440 && b1440->n_elem) p1440 = b1440.get(); }
+
+        const arma::mat& raw15 = *bars15;
+
+        // policy-инфер
+        json inf = etai::infer_with_policy_mtf(raw15, *policy, p60, 12, p240, 12, p1440, 12,
+                                               symbol, etai::canonical_interval(interval));
+
+        std::string sig = jstr(inf, "signal", "NEUTRAL");
+        double score15  = jnum(inf, "score15", 0.0);
+
+        infer_count_signal(sig);
+        if (counted_sig) *counted_sig = sig;
+
+        // --- РЕЖИМЫ + УВЕРЕННОСТЬ ---
+        double thr = best_thr > 0 ? best_thr : 0.5;
+
+        int upVotes=0, downVotes=0;
+        htf_votes(inf, upVotes, downVotes);
+        int netHTF = upVotes - downVotes;
+
+        std::string marketMode = "flat";
+        double confidence = 0.0;
+
+        double excess = std::fabs(score15) - thr;
+        if (excess >= 0.0) {
+            if (score15 > 0) {
+                if (netHTF >= 2) { marketMode = "trendUp"; }
+                else if (netHTF <= -2) { marketMode = "correction"; }
+                else { marketMode = "trendUp"; }
+            } else if (score15 < 0) {
+                if (netHTF <= -2) { marketMode = "trendDown"; }
+                else if (netHTF >= 2) { marketMode = "correction"; }
+                else { marketMode = "trendDown"; }
+            }
+            double htfFactor = std::min(1.0, std::fabs((double)netHTF)/4.0);
+            confidence = std::min(100.0, 100.0 * (0.5*std::min(1.0, excess/(thr>0?thr:0.5)) + 0.5*htfFactor));
+        } else {
+            double atr = atr14_from_M(raw15);
+            double band = k_atr * atr;
+
+            if (score15 >= -thr*eps && score15 <= thr*eps) {
+                sig = "NEUTRAL";
+            } else if (score15 > thr*eps) {
+                sig = "SHORT";
+            } else if (score15 < -thr*eps) {
+                sig = "LONG";
+            }
+            marketMode = "flat";
+            double flatRatio = std::min(1.0, std::fabs(score15)/(thr>0?thr:0.5));
+            confidence = std::min(100.0, 70.0 * flatRatio);
+            inf["flat_band"] = band;
+            inf["flat_k_atr"] = k_atr;
+        }
+
+        // Нулл-безопасные поля из inf
+        json safe_htf = (inf.contains("htf") && inf["htf"].is_object()) ? inf["htf"] : json::object();
+        double safe_wctx_htf = jnum(inf, "wctx_htf", 0.0);
+        double safe_vol_thr  = jnum(inf, "vol_threshold", 0.0);
+        int    safe_feat_dim = jint(inf, "feat_dim_used", 0);
+        bool   safe_used_norm= jbool(inf, "used_norm", true);
+
+        json out{
+            {"ok", jbool(inf, "ok", false)},
+            {"mode", "pro"},
+            {"symbol", symbol},
+            {"interval", interval},
+            {"version", version},
+            {"thr", best_thr},
+            {"ma_len", ma_len},
+            {"tp", tp},
+            {"sl", sl},
+            {"signal", sig},
+            {"score15", score15},
+            {"market_mode", marketMode},
+            {"confidence", confidence},
+            {"htf", safe_htf},
+            {"feat_dim_used", safe_feat_dim},
+            {"used_norm", safe_used_norm},
+            {"wctx_htf", safe_wctx_htf},
+            {"vol_threshold", safe_vol_thr}
+        };
+
+        enrich_with_levels(out, raw15, tp, sl);
+        return out;
+    }
+    catch (const std::exception& e) {
+        json out{
+            {"ok", false},
+            {"error", "infer_failed"},
+            {"what", e.what()},
+            {"path", "/api/infer"}
+        };
+        return out;
+    }
+    catch (...) {
+        json out{
+            {"ok", false},
+            {"error", "infer_failed"},
+            {"what", "unknown"},
+            {"path", "/api/infer"}
+        };
+        return out;
+    }
+}
+
+// Отпечаток состояния для кэша ответов: поколение политики + (rows, ts, close, vol)
+// последнего бара каждого ТФ. Пусто — нет модели/данных, такой запрос не кэшируется.
+static std::string infer_fingerprint(const std::string& symbol, const std::string& interval,
+                                     const std::set<std::string>& wanted)
+{
+    etai::PolicyPtr policy = etai::get_policy(symbol, interval);
+    if (!policy || !policy->ok()) return std::string();
+    std::string fp = std::to_string(policy->generation);
+    auto add = [&](const std::string& tf) {
+        etai::BarMatrixPtr b = etai::get_cached_bars(symbol, tf);
+        if (!b || b->n_rows == 0) { fp += "|-"; return false; }
+        const arma::mat& M = *b;
+        const arma::uword r = M.n_rows - 1;
+        char buf[128];
+        std::snprintf(buf, sizeof(buf), "|%llu:%lld:%.17g:%.17g",
+                      (unsigned long long)M.n_rows, (long long)M(r, 0), M(r, 4), M(r, 5));
+        fp += buf;
+        return true;
+    };
+    if (!add(interval)) return std::string();
+    for (const char* tf : {"60", "240", "1440"}) if (wanted.count(tf)) add(tf);
+    return fp;
+}
+
 void register_infer_routes(httplib::Server& srv) {
     // DIAG: фичи
     srv.Get("/api/infer/feat_cols", [&](const httplib::Request& req, httplib::Response& res){
@@ -121,166 +380,295 @@ void register_infer_routes(httplib::Server& srv) {
             res.set_content(out.dump(), "application/json");
             return;
         }
-        arma::mat F = etai::build_feature_matrix(raw);
+        const int ver = (int)qpd(req, "ver", etai::feature_version());
+        if (!etai::feature_version_supported(ver)) {
+            out["error"] = "bad_feat_version";
+            res.set_content(out.dump(), "application/json");
+            return;
+        }
+        arma::mat F = etai::build_feature_matrix(raw, ver);
         out["ok"] = true;
         out["raw_rows"] = (int)raw.n_rows;   out["raw_cols"] = (int)raw.n_cols;
         out["F_rows"]   = (int)F.n_rows;     out["F_cols"]   = (int)F.n_cols;
+        out["feat_version"] = ver;
+        out["max_lookback"] = etai::feature_max_lookback(ver);
+        out["tail_warmup"]  = (int)etai::feature_tail_warmup(ver);
+        out["full_history"] = etai::feature_full_history(ver);
+        json names = json::array();
+        for (size_t k = 0; k < etai::feature_dim(ver); ++k) names.push_back(etai::feature_col_name(k));
+        out["columns"] = names;
         out["ETAI_FEAT_ENABLE_MFLOW"] = (std::getenv("ETAI_FEAT_ENABLE_MFLOW")? true:false);
+        out["feature_store"] = etai::feature_store_stats();
         res.set_content(out.dump(), "application/json");
     });
 
-    // --- MAIN: /api/infer ---
-    srv.Get("/api/infer", [&](const httplib::Request& req, httplib::Response& res){
-        try {
-            REQ_INFER.fetch_add(1, std::memory_order_relaxed);
+    // DIAG: потоковые признаки vs batch (эквивалентность + стоимость)
+    srv.Get("/api/infer/stream_check", [&](const httplib::Request& req, httplib::Response& res){
+        std::string symbol   = qp(req, "symbol", "BTCUSDT");
+        std::string interval = qp(req, "interval", "15");
+        const size_t tail = (size_t)std::max(0.0, qpd(req, "tail", 2000));
+        const double tol  = qpd(req, "tol", 1e-9);
+        arma::mat raw;
+        if (!etai::load_raw_ohlcv(symbol, interval, raw)) {
+            json out{{"ok", false}, {"error", "load_raw_failed"}};
+            res.set_content(out.dump(), "application/json");
+            return;
+        }
+        const int ver = (int)qpd(req, "ver", etai::feature_version());
+        json out = etai::stream_feature_check(raw, tail, tol, ver);
+        out["symbol"] = symbol;
+        out["interval"] = interval;
+        out["stream"] = etai::stream_feature_stats();
+        res.set_content(out.dump(), "application/json");
+    });
 
+    // DIAG: хвостовой режим признаков vs полная матрица (точное совпадение + стоимость)
+    srv.Get("/api/infer/tail_check", [&](const httplib::Request& req, httplib::Response& res){
+        std::string symbol   = qp(req, "symbol", "BTCUSDT");
+        std::string interval = qp(req, "interval", "15");
+        const size_t k = (size_t)std::max(1.0, qpd(req, "k", 1));
+        auto bars = etai::get_cached_bars(symbol, interval);
+        if (!bars) {
+            json out{{"ok", false}, {"error", "load_raw_failed"}};
+            res.set_content(out.dump(), "application/json");
+            return;
+        }
+        const arma::mat& raw = *bars;
+        const int ver = (int)qpd(req, "ver", etai::feature_version());
+        using clk = std::chrono::steady_clock;
+        auto t0 = clk::now();
+        arma::mat F = etai::build_feature_matrix(raw, ver);
+        const double full_ms = std::chrono::duration<double, std::milli>(clk::now() - t0).count();
+        t0 = clk::now();
+        arma::mat T = etai::build_feature_tail(raw, k, ver);
+        const double tail_ms = std::chrono::duration<double, std::milli>(clk::now() - t0).count();
+
+        json out{{"ok", false}, {"symbol", symbol}, {"interval", interval}, {"rows", (int)raw.n_rows}};
+        if (F.n_rows == 0 || T.n_rows == 0 || T.n_cols != F.n_cols || T.n_rows > F.n_rows) {
+            out["error"] = "shape_mismatch";
+            out["F_rows"] = (int)F.n_rows; out["T_rows"] = (int)T.n_rows;
+            res.set_content(out.dump(), "application/json");
+            return;
+        }
+        const size_t off = F.n_rows - T.n_rows;
+        size_t mismatches = 0;
+        double max_abs = 0.0;
+        for (arma::uword i = 0; i < T.n_rows; ++i)
+            for (arma::uword j = 0; j < T.n_cols; ++j) {
+                const double d = std::fabs(T(i, j) - F(off + i, j));
+                if (T(i, j) != F(off + i, j)) ++mismatches;
+                max_abs = std::max(max_abs, d);
+            }
+        out["ok"]         = (mismatches == 0);
+        out["k"]          = (int)T.n_rows;
+        out["dim"]        = (int)T.n_cols;
+        out["mismatches"] = (unsigned long long)mismatches;
+        out["max_abs"]    = max_abs;
+        out["full_ms"]    = full_ms;
+        out["tail_ms"]    = tail_ms;
+        res.set_content(out.dump(), "application/json");
+    });
+
+    // Карта сигналов политики по последним n барам: /api/infer/signal_map?symbol=&interval=15&n=2000&htf=60,240,1440
+    srv.Get("/api/infer/signal_map", [&](const httplib::Request& req, httplib::Response& res){
+        try {
             std::string symbol   = qp(req, "symbol", "BTCUSDT");
             std::string interval = qp(req, "interval", "15");
-            const std::string path = "cache/models/" + symbol + "_" + interval + "_ppo_pro.json";
+            const size_t n = (size_t)std::min(20000.0, std::max(1.0, qpd(req, "n", 2000)));
+            std::set<std::string> wanted;
+            for (auto& t : infer_split_csv(qp(req, "htf", "60,240,1440"))) wanted.insert(t);
 
-            std::ifstream f(path);
-            if (!f) {
-                json out{{"ok",false},{"error","model_not_found"},{"path",path}};
+            etai::PolicyPtr policy = etai::get_policy(symbol, interval);
+            if (!policy) {
+                json out{{"ok",false},{"error","model_not_found"},{"path","cache/models/" + symbol + "_" + interval + "_ppo_pro.json"}};
                 res.set_content(out.dump(), "application/json");
                 return;
             }
-            json model; f >> model;
-
-            double best_thr = jnum(model, "best_thr", 0.0);
-            int    ma_len   = jint(model, "ma_len", 12);
-            int    version  = jint(model, "version", 3);
-            double tp       = jnum(model, "tp", 0.0);
-            double sl       = jnum(model, "sl", 0.0);
-
-            // Кэш 6×N (ts,open,high,low,close,vol)
-            arma::mat M15 = etai::load_cached_matrix(symbol, interval);
-            if (M15.n_elem == 0) {
+            etai::BarMatrixPtr bars15 = etai::get_cached_bars(symbol, interval);
+            if (!bars15 || bars15->n_elem == 0) {
                 json out{{"ok",false},{"error","no_cached_data"},{"hint","call /api/backfill first"}};
                 res.set_content(out.dump(), "application/json");
                 return;
             }
+            etai::BarMatrixPtr b60, b240, b1440;
+            if (wanted.count("60"))   b60   = etai::get_cached_bars(symbol, "60");
+            if (wanted.count("240"))  b240  = etai::get_cached_bars(symbol, "240");
+            if (wanted.count("1440")) b1440 = etai::get_cached_bars(symbol, "1440");
+
+            const auto t0 = std::chrono::steady_clock::now();
+            // признаки 15m — из хранилища, если оно покрывает те же бары (хвост архив + серия)
+            etai::FeatureSet fset;
+            arma::mat F15;
+            const arma::uword n15 = bars15->n_rows;
+            if (etai::feature_store_load(etai::cache_file(symbol, interval), fset, policy->feat_version, false) &&
+                fset.F.n_rows >= n15 && (double)fset.last_ts == (*bars15)(n15 - 1, 0))
+                F15 = fset.F.tail_rows(n15);
+            json out = etai::infer_policy_signal_map(*bars15, *policy, b60.get(), b240.get(), b1440.get(), n,
+                                                     F15.n_rows ? &F15 : nullptr);
+            out["elapsed_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            out["symbol"]   = symbol;
+            out["interval"] = interval;
+            out["thr"]      = policy->best_thr;
+            out["version"]  = policy->version;
+            res.set_content(out.dump(), "application/json");
+        } catch (const std::exception& e) {
+            json out{{"ok",false},{"error","infer_failed"},{"what",e.what()},{"path","/api/infer/signal_map"}};
+            res.set_content(out.dump(), "application/json");
+        }
+    });
+
+    // DIAG: кэш ответов /api/infer
+    srv.Get("/api/infer/cache", [&](const httplib::Request& req, httplib::Response& res){
+        if (qp(req, "clear", "0") == "1") etai::infer_cache_clear();
+        json out{{"ok", true}, {"cache", etai::infer_cache_stats()}};
+        res.set_content(out.dump(), "application/json");
+    });
+
+    // --- MAIN: /api/infer ---
+    srv.Get("/api/infer", [&](const httplib::Request& req, httplib::Response& res){
+        std::string symbol   = qp(req, "symbol", "BTCUSDT");
+        std::string interval = qp(req, "interval", "15");
+        std::set<std::string> wanted;
+        for (auto& t : infer_split_csv(qp(req, "htf", "60,240,1440"))) wanted.insert(t);
+
+        const double k_atr = qpd(req, "k_atr", 1.2);
+        const double eps   = qpd(req, "eps",   0.05);
+
+        // кэш ответов: пока бар не закрылся и модель та же — готовое тело / 304
+        std::string key, fp;
+        if (etai::infer_cache_enabled()) {
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), "|%.17g|%.17g", k_atr, eps);
+            key = symbol + "|" + interval + "|";
+            for (auto& t : wanted) key += t + ",";
+            key += buf;
+            fp = infer_fingerprint(symbol, interval, wanted);
+            if (!fp.empty()) {
+                if (etai::InferCachePtr hit = etai::infer_cache_get(key, fp)) {
+                    REQ_INFER.fetch_add(1, std::memory_order_relaxed);
+                    infer_count_signal(hit->signal);
+                    res.set_header("ETag", hit->etag);
+                    res.set_header("X-Infer-Cache", "hit");
+                    if (etai::infer_cache_etag_matches(req.get_header_value("If-None-Match"), hit->etag)) {
+                        etai::infer_cache_note_not_modified();
+                        res.status = 304;
+                        return;
+                    }
+                    res.set_content(infer_body_with_agents(hit->body), "application/json");
+                    return;
+                }
+            }
+        }
 
-            // Параметры flat-коридора
+        std::string counted;
+        json out = infer_one(symbol, interval, wanted, k_atr, eps, &counted);
+        std::string body = out.dump();
+        if (!fp.empty() && jbool(out, "ok", false)) {
+            etai::InferCachePtr e = etai::infer_cache_put(key, fp, body, counted);
+            res.set_header("ETag", e->etag);
+            res.set_header("X-Infer-Cache", "miss");
+        }
+        if (out.contains("signal")) body = infer_body_with_agents(body);
+        res.set_content(body, "application/json");
+    });
+
+    // --- BATCH: /api/infer/batch?symbols=BTCUSDT,ETHUSDT&intervals=15[&htf=60,240,1440&k_atr=&eps=] ---
+    // POST: {"symbols":[...], "intervals":[...], "htf":"60,240", "k_atr":1.2, "eps":0.05}
+    // Пары symbol×interval считаются параллельно на общем пуле; results — в порядке запроса.
+    auto batch = [&](const httplib::Request& req, httplib::Response& res){
+        try {
+            std::vector<std::string> symbols, intervals;
+            std::string htf = qp(req, "htf", "60,240,1440");
             double k_atr = qpd(req, "k_atr", 1.2);
             double eps   = qpd(req, "eps",   0.05);
 
-            // HTF список
-            std::string htf = qp(req, "htf", "60,240,1440");
+            if (req.method == "POST" && !req.body.empty()) {
+                json body = json::parse(req.body);
+                auto list = [&](const char* k, std::vector<std::string>& dst){
+                    if (!body.contains(k)) return;
+                    if (body[k].is_array()) { for (auto& v : body[k]) if (v.is_string()) dst.push_back(v.get<std::string>()); }
+                    else if (body[k].is_string()) dst = infer_split_csv(body[k].get<std::string>());
+                };
+                list("symbols", symbols);
+                list("intervals", intervals);
+                htf   = jstr(body, "htf", htf.c_str());
+                k_atr = jnum(body, "k_atr", k_atr);
+                eps   = jnum(body, "eps", eps);
+            }
+            if (symbols.empty())   symbols   = infer_split_csv(qp(req, "symbols", ""));
+            if (intervals.empty()) intervals = infer_split_csv(qp(req, "intervals", "15"));
+
+            if (symbols.empty()) {
+                res.set_content(json{{"ok",false},{"error","symbols_required"},{"path","/api/infer/batch"}}.dump(), "application/json");
+                return;
+            }
+
+            std::vector<std::pair<std::string, std::string>> jobs;
+            {
+                std::set<std::string> seen;
+                for (auto& s : symbols) for (auto& tf : intervals)
+                    if (seen.insert(s + "_" + tf).second) jobs.emplace_back(s, tf);
+            }
+            const size_t max_jobs = infer_env_size("ETAI_INFER_BATCH_MAX", 1000);
+            if (jobs.size() > max_jobs) {
+                res.set_content(json{{"ok",false},{"error","too_many_jobs"},{"jobs",jobs.size()},{"max",max_jobs}}.dump(), "application/json");
+                return;
+            }
+
             std::set<std::string> wanted;
-            { std::string t; for (char c: htf){ if(c==','){ if(!t.empty()){wanted.insert(t); t.clear();} } else t.push_back(c);} if(!t.empty()) wanted.insert(t); }
-
-            // HTF матрицы как N×6
-            arma::mat M60, M240, M1440;
-            const arma::mat *p60=nullptr, *p240=nullptr, *p1440=nullptr;
-            if (wanted.count("60"))   { M60    = etai::load_cached_matrix(symbol, "60");   if (M60.n_elem)    { M60 = M60.t();    p60    = &M60; } }
-            if (wanted.count("240"))  { M240   = etai::load_cached_matrix(symbol, "240");  if (M240.n_elem)   { M240 = M240.t();  p240   = &M240; } }
-            if (wanted.count("1440")) { M1440  = etai::load_cached_matrix(symbol, "1440"); if (M1440.n_elem)  { M1440 = M1440.t();p1440  = &M1440; } }
-
-            // 15m → N×6
-            arma::mat raw15 = M15.t();
-
-            // policy-инфер
-            json inf = etai::infer_with_policy_mtf(raw15, model, p60, 12, p240, 12, p1440, 12);
-
-            std::string sig = jstr(inf, "signal", "NEUTRAL");
-            double score15  = jnum(inf, "score15", 0.0);
-
-            if (sig == "LONG") INFER_SIG_LONG.fetch_add(1, std::memory_order_relaxed);
-            else if (sig == "SHORT") INFER_SIG_SHORT.fetch_add(1, std::memory_order_relaxed);
-            else INFER_SIG_NEUTRAL.fetch_add(1, std::memory_order_relaxed);
-
-            LAST_INFER_TS.store((long long)time(nullptr)*1000, std::memory_order_relaxed);
-
-            // --- РЕЖИМЫ + УВЕРЕННОСТЬ ---
-            double thr = best_thr > 0 ? best_thr : 0.5;
-
-            int upVotes=0, downVotes=0;
-            htf_votes(inf, upVotes, downVotes);
-            int netHTF = upVotes - downVotes;
-
-            std::string marketMode = "flat";
-            double confidence = 0.0;
-
-            double excess = std::fabs(score15) - thr;
-            if (excess >= 0.0) {
-                if (score15 > 0) {
-                    if (netHTF >= 2) { marketMode = "trendUp"; }
-                    else if (netHTF <= -2) { marketMode = "correction"; }
-                    else { marketMode = "trendUp"; }
-                } else if (score15 < 0) {
-                    if (netHTF <= -2) { marketMode = "trendDown"; }
-                    else if (netHTF >= 2) { marketMode = "correction"; }
-                    else { marketMode = "trendDown"; }
-                }
-                double htfFactor = std::min(1.0, std::fabs((double)netHTF)/4.0);
-                confidence = std::min(100.0, 100.0 * (0.5*std::min(1.0, excess/(thr>0?thr:0.5)) + 0.5*htfFactor));
-            } else {
-                double atr = atr14_from_M(M15);
-                double band = k_atr * atr;
-
-                if (score15 >= -thr*eps && score15 <= thr*eps) {
-                    sig = "NEUTRAL";
-                } else if (score15 > thr*eps) {
-                    sig = "SHORT";
-                } else if (score15 < -thr*eps) {
-                    sig = "LONG";
-                }
-                marketMode = "flat";
-                double flatRatio = std::min(1.0, std::fabs(score15)/(thr>0?thr:0.5));
-                confidence = std::min(100.0, 70.0 * flatRatio);
-                inf["flat_band"] = band;
-                inf["flat_k_atr"] = k_atr;
+            for (auto& t : infer_split_csv(htf)) wanted.insert(t);
+
+            // Состояние запроса принадлежит задачам (shared_ptr по значению): если обработчик
+            // выйдет раньше (исключение), оставшиеся задачи пула пишут не в разрушенный стек.
+            struct BatchState {
+                std::vector<std::pair<std::string, std::string>> jobs;
+                std::set<std::string> wanted;
+                double k_atr, eps;
+                std::vector<json> results;
+            };
+            auto st = std::make_shared<BatchState>();
+            st->jobs   = std::move(jobs);
+            st->wanted = std::move(wanted);
+            st->k_atr  = k_atr;
+            st->eps    = eps;
+            st->results.resize(st->jobs.size());
+
+            const auto t0 = std::chrono::steady_clock::now();
+            std::vector<std::future<void>> done;
+            done.reserve(st->jobs.size());
+            InferWorkerPool& pool = infer_pool();
+            for (size_t i = 0; i < st->jobs.size(); ++i) {
+                done.push_back(pool.submit([st, i]{
+                    const auto& job = st->jobs[i];
+                    json r = infer_one(job.first, job.second, st->wanted, st->k_atr, st->eps);
+                    if (!r.contains("symbol"))   r["symbol"]   = job.first;
+                    if (!r.contains("interval")) r["interval"] = job.second;
+                    st->results[i] = std::move(r);
+                }));
             }
+            for (auto& f : done) f.get();
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
 
-            // Нулл-безопасные поля из inf
-            json safe_htf = (inf.contains("htf") && inf["htf"].is_object()) ? inf["htf"] : json::object();
-            double safe_wctx_htf = jnum(inf, "wctx_htf", 0.0);
-            double safe_vol_thr  = jnum(inf, "vol_threshold", 0.0);
-            int    safe_feat_dim = jint(inf, "feat_dim_used", 0);
-            bool   safe_used_norm= jbool(inf, "used_norm", true);
+            size_t n_ok = 0;
+            json arr = json::array();
+            for (auto& r : st->results) { if (jbool(r, "ok", false)) ++n_ok; arr.push_back(std::move(r)); }
 
             json out{
-                {"ok", jbool(inf, "ok", false)},
-                {"mode", "pro"},
-                {"symbol", symbol},
-                {"interval", interval},
-                {"version", version},
-                {"thr", best_thr},
-                {"ma_len", ma_len},
-                {"tp", tp},
-                {"sl", sl},
-                {"signal", sig},
-                {"score15", score15},
-                {"market_mode", marketMode},
-                {"confidence", confidence},
-                {"htf", safe_htf},
-                {"feat_dim_used", safe_feat_dim},
-                {"used_norm", safe_used_norm},
-                {"wctx_htf", safe_wctx_htf},
-                {"vol_threshold", safe_vol_thr},
+                {"ok", true},
+                {"count", (unsigned long long)st->jobs.size()},
+                {"ok_count", (unsigned long long)n_ok},
+                {"failed", (unsigned long long)(st->jobs.size() - n_ok)},
+                {"workers", (unsigned long long)pool.size()},
+                {"elapsed_ms", ms},
+                {"results", arr},
                 {"agents", make_agents_summary()}
             };
-
-            enrich_with_levels(out, M15, tp, sl);
             res.set_content(out.dump(), "application/json");
         }
         catch (const std::exception& e) {
-            json out{
-                {"ok", false},
-                {"error", "infer_failed"},
-                {"what", e.what()},
-                {"path", "/api/infer"}
-            };
-            res.set_content(out.dump(), "application/json");
-        }
-        catch (...) {
-            json out{
-                {"ok", false},
-                {"error", "infer_failed"},
-                {"what", "unknown"},
-                {"path", "/api/infer"}
-            };
-            res.set_content(out.dump(), "application/json");
+            res.set_content(json{{"ok",false},{"error","infer_batch_failed"},{"what",e.what()},{"path","/api/infer/batch"}}.dump(), "application/json");
         }
-    });
+    };
+    srv.Get("/api/infer/batch", batch);
+    srv.Post("/api/infer/batch", batch);
 }
@@ -1,6 +1,9 @@
 #include "httplib.h"
 #include "../server_accessors.h"
 #include "../rewardv2_accessors.h"
+#include "../bar_cache.h"
+#include "../infer_cache.h"
+#include "../feature_store.h"
 #include <sstream>
 #include <iomanip>
 
@@ -12,18 +15,23 @@ void register_metrics_routes(httplib::Server& srv){
         oss.setf(std::ios::fixed); 
         oss.precision(12);
 
-        // --- Model atoms ---
+        // --- Model atoms (один снимок) ---
+        const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
         oss << "# HELP edge_model_thr Model decision threshold\n";
         oss << "# TYPE edge_model_thr gauge\n";
-        oss << "edge_model_thr " << etai::get_model_thr() << "\n";
+        oss << "edge_model_thr " << snap->thr << "\n";
 
         oss << "# HELP edge_model_ma_len Model moving-average length\n";
         oss << "# TYPE edge_model_ma_len gauge\n";
-        oss << "edge_model_ma_len " << (long long)etai::get_model_ma_len() << "\n";
+        oss << "edge_model_ma_len " << snap->ma_len << "\n";
 
         oss << "# HELP edge_model_feat_dim Feature vector dimension of current policy\n";
         oss << "# TYPE edge_model_feat_dim gauge\n";
-        oss << "edge_model_feat_dim " << (int)etai::get_model_feat_dim() << "\n";
+        oss << "edge_model_feat_dim " << snap->feat_dim << "\n";
+
+        oss << "# HELP edge_model_version Current model snapshot version (publications since start)\n";
+        oss << "# TYPE edge_model_version counter\n";
+        oss << "edge_model_version " << snap->version << "\n";
 
         // --- Last inference telemetry ---
         oss << "# HELP edge_last_infer_score Last inference score (policy output)\n";
@@ -68,6 +76,74 @@ void register_metrics_routes(httplib::Server& srv){
         oss << "# TYPE edge_mu_manip_eff gauge\n";
         oss << "edge_mu_manip_eff " << etai::get_mu_manip_eff() << "\n";
 
+        // --- Bar cache (OHLCV в памяти) ---
+        {
+            const auto bc = etai::bar_cache_stats();
+            oss << "# HELP edge_bar_cache_entries Series held in the in-memory bar cache\n";
+            oss << "# TYPE edge_bar_cache_entries gauge\n";
+            oss << "edge_bar_cache_entries " << bc["entries"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_bar_cache_bytes Bytes held by the bar cache\n";
+            oss << "# TYPE edge_bar_cache_bytes gauge\n";
+            oss << "edge_bar_cache_bytes " << bc["bytes"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_bar_cache_hits_total Bar cache hits\n";
+            oss << "# TYPE edge_bar_cache_hits_total counter\n";
+            oss << "edge_bar_cache_hits_total " << bc["hits"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_bar_cache_misses_total Bar cache misses (disk loads)\n";
+            oss << "# TYPE edge_bar_cache_misses_total counter\n";
+            oss << "edge_bar_cache_misses_total " << bc["misses"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_bar_cache_evictions_total Bar cache LRU evictions\n";
+            oss << "# TYPE edge_bar_cache_evictions_total counter\n";
+            oss << "edge_bar_cache_evictions_total " << bc["evictions"].get<unsigned long long>() << "\n";
+        }
+
+        // --- Хранилище признаков (cache/features) ---
+        {
+            const auto fs = etai::feature_store_stats();
+            oss << "# HELP edge_feature_store_hits_total Feature matrices served from the store unchanged\n";
+            oss << "# TYPE edge_feature_store_hits_total counter\n";
+            oss << "edge_feature_store_hits_total " << fs["hits"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_feature_store_extends_total Feature matrices extended with new bars only\n";
+            oss << "# TYPE edge_feature_store_extends_total counter\n";
+            oss << "edge_feature_store_extends_total " << fs["extends"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_feature_store_rebuilds_total Full feature matrix rebuilds (new data, version or code change)\n";
+            oss << "# TYPE edge_feature_store_rebuilds_total counter\n";
+            oss << "edge_feature_store_rebuilds_total " << fs["rebuilds"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_feature_store_rows_built_total Feature rows computed by the store\n";
+            oss << "# TYPE edge_feature_store_rows_built_total counter\n";
+            oss << "edge_feature_store_rows_built_total " << fs["rows_built"].get<unsigned long long>() << "\n";
+        }
+
+        // --- Кэш ответов /api/infer ---
+        {
+            const auto ic = etai::infer_cache_stats();
+            oss << "# HELP edge_infer_cache_entries Cached /api/infer responses\n";
+            oss << "# TYPE edge_infer_cache_entries gauge\n";
+            oss << "edge_infer_cache_entries " << ic["entries"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_infer_cache_hits_total Inference responses served from cache\n";
+            oss << "# TYPE edge_infer_cache_hits_total counter\n";
+            oss << "edge_infer_cache_hits_total " << ic["hits"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_infer_cache_misses_total Inference requests computed (no cached response for current bars/model)\n";
+            oss << "# TYPE edge_infer_cache_misses_total counter\n";
+            oss << "edge_infer_cache_misses_total " << ic["misses"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_infer_cache_not_modified_total Inference requests answered with 304 Not Modified\n";
+            oss << "# TYPE edge_infer_cache_not_modified_total counter\n";
+            oss << "edge_infer_cache_not_modified_total " << ic["not_modified"].get<unsigned long long>() << "\n";
+
+            oss << "# HELP edge_infer_cache_evictions_total Inference cache LRU evictions\n";
+            oss << "# TYPE edge_infer_cache_evictions_total counter\n";
+            oss << "edge_infer_cache_evictions_total " << ic["evictions"].get<unsigned long long>() << "\n";
+        }
+
         // --- Optional anti-manip gauges (if trainer set them earlier) ---
         // Оставляем как есть: если атомики не выставлены — Prometheus всё равно съест нули.
         // Эти set_* могут не вызываться в текущей версии, но назад-совместимо.
@@ -2,6 +2,7 @@
 
 #include "../httplib.h"
 #include "../server_accessors.h"
+#include "../policy_registry.h"
 #include "json.hpp"
 #include <fstream>
 #include <sstream>
@@ -30,13 +31,16 @@ inline void register_model_routes(httplib::Server& svr) {
     svr.Get("/api/model", [](const httplib::Request&, httplib::Response& res) {
         json r;
         r["ok"] = true;
-        r["model_thr"]    = etai::get_model_thr();
-        r["model_ma_len"] = etai::get_model_ma_len();
-        try { r["model_feat_dim"] = etai::get_model_feat_dim(); } catch (...) {}
+        // один снимок: атомики и JSON модели согласованы
+        const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
+        r["model_thr"]      = snap->thr;
+        r["model_ma_len"]   = snap->ma_len;
+        r["model_feat_dim"] = snap->feat_dim;
+        r["model_version"]  = snap->version;
 
         // Дополнительно: извлечь ключевые поля из current_model
         try {
-            json m = etai::get_current_model();
+            const json& m = snap->model;
             json mshort;
             if (m.contains("best_thr")) mshort["best_thr"] = m["best_thr"];
             if (m.contains("tp"))       mshort["tp"]       = m["tp"];
@@ -67,8 +71,9 @@ inline void register_model_routes(httplib::Server& svr) {
         }
 
         // --- defaults from current ---
-        double thr = etai::get_model_thr();
-        int    ma  = etai::get_model_ma_len();
+        const etai::ModelSnapshotPtr cur = etai::get_model_snapshot();
+        double thr = cur->thr;
+        int    ma  = (int)cur->ma_len;
         int    feat = 0;
 
         try { if (j.contains("best_thr")) thr = j["best_thr"].get<double>(); } catch (...) {}
@@ -76,15 +81,24 @@ inline void register_model_routes(httplib::Server& svr) {
         try { if (j.contains("policy") && j["policy"].contains("feat_dim"))
                   feat = j["policy"]["feat_dim"].get<int>(); } catch (...) {}
 
-        etai::set_model_thr(thr);
-        etai::set_model_ma_len(ma);
-        if (feat > 0) etai::set_model_feat_dim(feat);
-        etai::set_current_model(j);
+        etai::publish_model(j, thr, ma, feat);
+        etai::PolicyPtr pol = etai::publish_policy(j, path);
 
         json r;
         r["ok"] = true;
         r["applied"] = { {"thr", thr}, {"ma_len", ma}, {"feat_dim", feat} };
         r["path"] = path;
+        r["registry"] = pol ? json{{"symbol", pol->symbol}, {"interval", pol->interval},
+                                   {"generation", pol->generation}, {"ok", pol->ok()}}
+                            : json(nullptr);
+        res.status = 200;
+        res.set_content(r.dump(2), "application/json");
+    });
+
+    // 3) Реестр скомпилированных политик (symbol/interval → снимок)
+    svr.Get("/api/model/registry", [](const httplib::Request&, httplib::Response& res) {
+        json r = etai::policy_registry_stats();
+        r["ok"] = true;
         res.status = 200;
         res.set_content(r.dump(2), "application/json");
     });
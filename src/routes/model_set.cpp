@@ -1,5 +1,6 @@
 #include "../httplib.h"
 #include "../server_accessors.h"
+#include "../policy_registry.h"
 #include "json.hpp"
 #include <fstream>
 #include <sstream>
@@ -57,9 +58,8 @@ inline void register_model_set_routes(httplib::Server& svr) {
     // Логика:
     // 1) Читаем текущую модель из атомиков/диска
     // 2) Применяем присланные поля
-    // 3) Обновляем атомики (thr/ma/feat_dim)
-    // 4) Перезаписываем JSON на диск (best_thr/ma_len/tp/sl и policy.feat_dim)
-    // 5) Кладём обновлённый JSON в set_current_model(...)
+    // 3) Перезаписываем JSON на диск (best_thr/ma_len/tp/sl и policy.feat_dim)
+    // 4) Публикуем новый снимок модели (JSON + thr/ma/feat_dim одним шагом)
     svr.Post("/api/model/set", [](const httplib::Request& req, httplib::Response& res) {
         json in;
         try {
@@ -76,8 +76,9 @@ inline void register_model_set_routes(httplib::Server& svr) {
             path = in["path"].get<std::string>();
         }
 
-        // Считать базовый JSON из set_current_model(), если пуст — с диска
-        json base = etai::get_current_model();
+        // Считать базовый JSON из текущего снимка, если пуст — с диска
+        const etai::ModelSnapshotPtr cur = etai::get_model_snapshot();
+        json base = cur->model;
         if (!base.is_object() || base.empty()) {
             std::string rerr;
             base = read_json_file(path, rerr);
@@ -87,9 +88,9 @@ inline void register_model_set_routes(httplib::Server& svr) {
             }
         }
 
-        // Значения к применению (с дефолтами из атомиков)
-        double thr = etai::get_model_thr();
-        long long ma = etai::get_model_ma_len();
+        // Значения к применению (с дефолтами из снимка)
+        double thr = cur->thr;
+        long long ma = cur->ma_len;
         int feat = 0;
 
         // Присланные поля (всё опционально)
@@ -133,11 +134,6 @@ inline void register_model_set_routes(httplib::Server& svr) {
             has_sl = true;
         }
 
-        // Обновляем атомики
-        if (has_thr) etai::set_model_thr(thr);
-        if (has_ma)  etai::set_model_ma_len(ma);
-        if (has_feat && feat > 0) etai::set_feat_dim(feat);
-
         // Подготовим структуру в JSON
         if (!base.is_object()) base = json::object();
         if (has_thr) base["best_thr"] = thr;
@@ -158,8 +154,11 @@ inline void register_model_set_routes(httplib::Server& svr) {
             res.status = 500; res.set_content(r.dump(2), "application/json"); return;
         }
 
-        // Обновляем текущую модель в памяти
-        try { etai::set_current_model(base); } catch (...) {}
+        // Обновляем текущую модель в памяти (только после успешной записи)
+        etai::ModelSnapshotPtr snap;
+        try { snap = etai::publish_model(base, thr, ma, has_feat ? feat : 0); } catch (...) {}
+        if (!snap) snap = etai::get_model_snapshot();
+        try { etai::publish_policy(base, path); } catch (...) {}
 
         // Ответ
         json r;
@@ -174,9 +173,10 @@ inline void register_model_set_routes(httplib::Server& svr) {
 
         // Текущее состояние атомиков для удобства
         r["state"] = {
-            {"model_thr",       etai::get_model_thr()},
-            {"model_ma_len",    etai::get_model_ma_len()},
-            {"model_feat_dim",  etai::get_model_feat_dim()}
+            {"model_thr",       snap->thr},
+            {"model_ma_len",    snap->ma_len},
+            {"model_feat_dim",  snap->feat_dim},
+            {"model_version",   snap->version}
         };
 
         res.status = 200;
@@ -2,45 +2,13 @@
 // Конвейер: backfill -> clean -> fill gaps (15m) -> train -> infer snapshot.
 // Порт 3000. JSON-in / JSON-out. Никаких новых портов.
 
-#include <cstdio>
-#include <cstdlib>
 #include <sstream>
 #include <string>
-#include <vector>
-#include <array>
 #include <stdexcept>
 
 #include <httplib.h>
 #include "json.hpp"
-
-namespace {
-
-using json = nlohmann::json;
-
-std::string run_cmd(const std::string& cmd) {
-    std::array<char, 4096> buf{};
-    std::string out;
-    FILE* pipe = popen((cmd + " 2>&1").c_str(), "r");
-    if (!pipe) return "";
-    while (fgets(buf.data(), buf.size(), pipe)) out.append(buf.data());
-    pclose(pipe);
-    return out;
-}
-
-// есть ли дырки по 15m (шаг != 900000)
-bool has_15m_gaps(const std::string& clean_path) {
-    std::string awk = "awk -F, 'NR>1 {d=$1-prev; if(d!=900000) bad++; prev=$1} NR==1 {prev=$1} END{exit (bad?1:0)}' " + clean_path;
-    int rc = std::system(awk.c_str());
-    if (WIFEXITED(rc)) return (WEXITSTATUS(rc) != 0);
-    return true; // подстраховка
-}
-
-long rows_in_file(const std::string& path) {
-    std::string out = run_cmd("wc -l < " + path + " | tr -d ' \\n'");
-    try { return std::stol(out); } catch (...) { return -1; }
-}
-
-} // namespace
+#include "utils.h"          // etai::clean_cache / fill_gaps_series
 
 inline void register_pipeline_routes(httplib::Server& svr) {
     // POST /api/pipeline/prepare_train
@@ -77,22 +45,26 @@ inline void register_pipeline_routes(httplib::Server& svr) {
             step_ok("backfill", {{"intervals", back.value("intervals", json::array())}});
         } catch(const std::exception& e){ step_fail("backfill", e.what()); res.status=500; resp["steps"]=steps; res.set_content(resp.dump(2),"application/json"); return; }
 
-        // 2) CLEAN из RAW (все ТФ)
+        // 2) CLEAN из RAW (все ТФ) — в процессе: порядок, дубли, проверка OHLC, индекс пропусков
+        json clean15;
         {
-            std::string out = run_cmd("bash scripts/clean_from_raw.sh '"+sym+"'");
-            long r15 = rows_in_file("cache/clean/"+sym+"_15.csv");
-            if (r15 < 0){ step_fail("clean","clean_15_missing",{{"stdout",out}}); res.status=500; resp["steps"]=steps; res.set_content(resp.dump(2),"application/json"); return; }
-            step_ok("clean", {{"rows15", r15}});
+            json per_tf = json::object();
+            for (const char* tf : {"15","60","240","1440"}) {
+                json c = etai::clean_cache(sym, tf, false);
+                per_tf[tf] = c.contains("clean") ? c["clean"] : c;
+                if (std::string(tf) == "15") clean15 = c;
+            }
+            if (!clean15.value("ok", false)){ step_fail("clean","clean_15_missing",{{"intervals",per_tf}}); res.status=500; resp["steps"]=steps; res.set_content(resp.dump(2),"application/json"); return; }
+            step_ok("clean", {{"rows15", clean15.value("rows", 0)}, {"intervals", per_tf}});
         }
 
-        // 3) Автозаполнение дыр 15m при необходимости
+        // 3) Автозаполнение дыр 15m: пропуски склеиваются в диапазонные запросы
         {
-            const std::string clean15 = "cache/clean/"+sym+"_15.csv";
-            if (has_15m_gaps(clean15)) {
-                std::string out = run_cmd("bash scripts/fill_gaps_bybit_15m.sh '"+sym+"'");
-                long r15 = rows_in_file(clean15);
-                if (has_15m_gaps(clean15)){ step_fail("fill_gaps_15m","gaps_remain",{{"rows15",r15},{"stdout",out}}); res.status=500; resp["steps"]=steps; res.set_content(resp.dump(2),"application/json"); return; }
-                step_ok("fill_gaps_15m", {{"rows15", r15}});
+            if (clean15.value("gaps", 0) > 0) {
+                clean15 = etai::clean_cache(sym, "15", true);
+                const json& f = clean15["fill"];
+                if (clean15.value("gaps", 0) > 0){ step_fail("fill_gaps_15m","gaps_remain",{{"rows15",clean15.value("rows",0)},{"fill",f}}); res.status=500; resp["steps"]=steps; res.set_content(resp.dump(2),"application/json"); return; }
+                step_ok("fill_gaps_15m", {{"rows15", clean15.value("rows", 0)}, {"fill", f}});
             } else {
                 step_ok("fill_gaps_15m", {{"note","no_gaps"}});
             }
@@ -100,7 +72,7 @@ inline void register_pipeline_routes(httplib::Server& svr) {
 
         // 4) Верификация минимума строк на 15m
         {
-            long r15 = rows_in_file("cache/clean/"+sym+"_15.csv");
+            const long r15 = clean15.value("rows", 0L);
             if (r15 < 300){ step_fail("verify_rows_15m","too_few_rows",{{"rows15",r15}}); res.status=400; resp["steps"]=steps; res.set_content(resp.dump(2),"application/json"); return; }
             step_ok("verify_rows_15m", {{"rows15", r15}});
         }
@@ -1,6 +1,8 @@
 #include "../httplib.h"
 #include "../server_accessors.h"
+#include "../policy_registry.h"
 #include "../utils_data.h"
+#include "../bar_store.h"
 #include "../train_logic.h"
 #include "json.hpp"
 #include <fstream>
@@ -10,13 +12,8 @@
 using json = nlohmann::json;
 
 static bool cache_exists_and_fresh(const std::string& symbol, const std::string& interval) {
-    std::string path = "cache/" + symbol + "_" + interval + ".csv";
-    std::ifstream f(path);
-    if (!f.good()) return false;
-    int lines = 0;
-    std::string line;
-    while (std::getline(f, line)) ++lines;
-    return lines > 100;
+    etai::SeriesMeta m{};
+    return etai::series_meta("cache/" + symbol + "_" + interval + ".csv", m) && m.rows > 100;
 }
 
 // Проверка что модель ВАЛИДНАЯ (ok: true)
@@ -53,10 +50,8 @@ static bool load_model_to_ram(const std::string& symbol, const std::string& inte
         if (model.contains("policy") && model["policy"].contains("feat_dim"))
             feat_dim = model["policy"]["feat_dim"].get<int>();
         
-        etai::set_model_thr(best_thr);
-        etai::set_model_ma_len(ma_len);
-        if (feat_dim > 0) etai::set_model_feat_dim(feat_dim);
-        etai::set_current_model(model);
+        etai::publish_model(model, best_thr, ma_len, feat_dim);
+        etai::publish_policy(model, path, symbol, interval);
         
         return true;
     } catch (...) {
@@ -184,7 +179,8 @@ void register_symbol_prepare_routes(httplib::Server& svr) {
         }
         
         // 6. Финальная проверка
-        json model = etai::get_current_model();
+        const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
+        const json& model = snap->model;
         std::string loaded_sym = model.value("symbol", "");
         std::string loaded_int = model.value("interval", "");
         
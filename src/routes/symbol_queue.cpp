@@ -14,7 +14,8 @@
 
 #include "json.hpp"
 #include "utils.h"        // parse utils, join_csv (для совместимости включён)
-#include "utils_data.h"   // etai::backfill_last_months
+#include "utils_data.h"
+#include "backfill_engine.h"   // etai::backfill_run — общий лимитер и соединения
 
 using json = nlohmann::json;
 using Clock = std::chrono::system_clock;
@@ -184,7 +185,12 @@ void worker_loop() {
     try {
       const unsigned timeout_sec = get_timeout_sec();
       auto fut = std::async(std::launch::async, [task]() {
-        return etai::backfill_last_months(task->symbol, task->interval, task->months);
+        etai::BackfillJobSpec spec;
+        spec.symbol   = task->symbol;
+        spec.interval = task->interval;
+        spec.months   = task->months;
+        spec.mode     = "auto";
+        return etai::backfill_run(spec);
       });
 
       if (fut.wait_for(std::chrono::seconds(timeout_sec)) == std::future_status::ready) {
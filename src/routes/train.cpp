@@ -119,8 +119,10 @@ void register_train_routes(Server& svr) {
                 }
             }
 
-            // 2) Запускаем тренировку на только что подготовленных cache/* и cache/clean/*
-            json out = etai::run_train_pro_and_save(symbol, interval, episodes, tp, sl, ma, use_antimanip);
+            // 2) Запускаем тренировку на только что подготовленных cache/* и cache/clean/*;
+            //    явный months — обучение только на этом окне истории
+            const int train_months = req.has_param("months") ? months : 0;
+            json out = etai::run_train_pro_and_save(symbol, interval, episodes, tp, sl, ma, use_antimanip, train_months);
             promote_metrics(out);
 
             // 3) По запросу — удаляем RAW/CLEAN свечи по символу (модель остаётся)
@@ -7,6 +7,8 @@
 #include <fstream>
 #include <cmath>
 #include "utils_data.h"
+#include "feature_store.h"
+#include "bars_view.h"
 #include "features/features.h"
 #include "server_accessors.h"   // get_model_thr,get_model_ma_len,get_model_feat_dim
 
@@ -73,7 +75,7 @@ static void zscore_by_ref(mat& X, const mat& ref){
     }
 }
 
-// ATR proxy (col 4 в фичах — наш ATR)
+// ATR14 признаков (колонка 4 — узел ATR14 графа индикаторов, без повторного расчёта)
 static vec atr_col(const mat& F){ if(F.n_cols>4) return abs(F.col(4)); return vec(F.n_rows,fill::zeros); }
 
 // Энергия из ATR в [0..1] (робастная нормировка через медиану)
@@ -213,25 +215,27 @@ void register_train_env_routes(httplib::Server& svr){
         // ATR on/off
         bool use_atr = qs_int(req,"atr", env_enabled("ETAI_ENV_ATR")?1:0) != 0;
 
-        arma::mat raw;
-        if(!etai::load_raw_ohlcv(symbol,interval,raw)){
+        // бары + признаки из хранилища (архив + горячая серия; считаются только новые бары)
+        etai::FeatureSet fset;
+        if(!etai::feature_store_get(symbol,interval,fset)){
             out["error"]="data_load_fail";
             res.set_content(out.dump(2),"application/json");
             return;
         }
+        const etai::BarsView bars = etai::bars_view(fset.raw);
 
         // future return (t+1)
-        vec close = raw.col(4);
-        uword Nraw = raw.n_rows;
+        const etai::DSpan close = bars.close;
+        uword Nraw = bars.size();
         vec fut(Nraw, fill::zeros);
         for(uword i=0;i+1<Nraw;i++){
-            double c0=close(i), c1=close(i+1);
+            double c0=close[i], c1=close[i+1];
             fut(i)=(c0>0.0)? (c1/c0-1.0):0.0;
         }
         fut(Nraw-1)=0.0;
 
         // features
-        mat F = etai::build_feature_matrix(raw);
+        const mat& F = fset.F;
         if(F.n_cols==0){
             out["error"]="feature_build_fail";
             res.set_content(out.dump(2),"application/json");
@@ -272,7 +276,7 @@ void register_train_env_routes(httplib::Server& svr){
         };
 
         out["ok"]=true;
-        out["rows"]=(int)raw.n_rows; out["cols"]=(int)F.n_cols; out["steps"]=(int)N;
+        out["rows"]=(int)Nraw; out["cols"]=(int)F.n_cols; out["steps"]=(int)N;
         out["fee"]=fee; out["tp"]=tp; out["sl"]=sl; out["use_atr"]=use_atr;
         out["policy"]={{"name",policy},{"source",(policy=="model"?"model_json":"derived")},
                        {"thr", thr_cut},{"feat_dim",(int)Fw.n_cols}};
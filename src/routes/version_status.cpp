@@ -43,7 +43,8 @@ inline void register_version_status_routes(httplib::Server& svr) {
         j["build_time"]= getenv_def("ETAI_BUILD_TIME", "");
         j["now"]       = now_iso8601();
         try {
-            json m = etai::get_current_model();
+            const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
+            const json& m = snap->model;
             json ms = {
                 {"best_thr", m.value("best_thr", json(nullptr))},
                 {"ma_len",   m.value("ma_len",   json(nullptr))},
@@ -72,12 +73,15 @@ inline void register_version_status_routes(httplib::Server& svr) {
         st["ok"] = true;
         st["uptime_ms"] = up_ms;
         st["pid"] = static_cast<int>(::getpid());
-        st["thr"]   = etai::get_model_thr();
-        st["ma"]    = etai::get_model_ma_len();
-        st["feat"]  = etai::get_model_feat_dim();
+        const etai::ModelSnapshotPtr snap = etai::get_model_snapshot();
+        st["thr"]   = snap->thr;
+        st["ma"]    = snap->ma_len;
+        st["feat"]  = snap->feat_dim;
+        st["model_version"] = snap->version;
         st["flags"] = {
             {"ETAI_AGENT_ENABLE",       getenv_def("ETAI_AGENT_ENABLE","")},
             {"ETAI_ENABLE_TRAIN_ENV",   getenv_def("ETAI_ENABLE_TRAIN_ENV","")},
+            {"ETAI_ENABLE_BENCH",       getenv_def("ETAI_ENABLE_BENCH","")},
             {"ETAI_MTF_ENABLE",         getenv_def("ETAI_MTF_ENABLE","")},
             {"ETAI_ENABLE_ANTI_MANIP",  getenv_def("ETAI_ENABLE_ANTI_MANIP","")}
         };
@@ -1,6 +1,7 @@
 #include "server_accessors.h"
 #include "json.hpp"
 #include <atomic>
+#include <memory>
 #include <limits>
 #include <fstream>
 #include <cmath>
@@ -10,32 +11,34 @@ namespace etai {
 using json = nlohmann::json;
 
 // === Глобальное состояние (единый инстанс) ===
-// Без NaN и мусора — валидные дефолты.
-static std::atomic<double>     G_MODEL_THR{0.38};
-static std::atomic<long long>  G_MODEL_MA{12};
-static std::atomic<int>        G_FEAT_DIM{28};
-static json                    G_CURRENT_MODEL = json::object();
+// Текущая модель — неизменяемый снимок; C++17 atomic_load/atomic_store над shared_ptr.
+static ModelSnapshotPtr                 G_MODEL = std::make_shared<const ModelSnapshot>();
+static std::atomic<unsigned long long>  G_MODEL_VERSION{0};
 
 // Последний инференс (телеметрия)
 static std::atomic<double>     G_LAST_SCORE{0.0};
 static std::atomic<double>     G_LAST_SIGMA{0.0};
 static std::atomic<int>        G_LAST_SIGNAL{0}; // -1/0/1
 
+ModelSnapshotPtr get_model_snapshot() {
+  return std::atomic_load_explicit(&G_MODEL, std::memory_order_acquire);
+}
+
+static ModelSnapshotPtr store_snapshot(std::shared_ptr<ModelSnapshot> s) {
+  s->version = G_MODEL_VERSION.fetch_add(1, std::memory_order_relaxed) + 1;
+  ModelSnapshotPtr p = std::move(s);
+  std::atomic_store_explicit(&G_MODEL, p, std::memory_order_release);
+  return p;
+}
+
 // --- Threshold ---
-double get_model_thr() { return G_MODEL_THR.load(std::memory_order_relaxed); }
-void   set_model_thr(double v) { G_MODEL_THR.store(v, std::memory_order_relaxed); }
+double get_model_thr() { return get_model_snapshot()->thr; }
 
 // --- MA length ---
-long long get_model_ma_len() { return G_MODEL_MA.load(std::memory_order_relaxed); }
-void      set_model_ma_len(long long v) { G_MODEL_MA.store(v, std::memory_order_relaxed); }
+long long get_model_ma_len() { return get_model_snapshot()->ma_len; }
 
 // --- Feature dimension (каноническая) ---
-int  get_feat_dim() { return G_FEAT_DIM.load(std::memory_order_relaxed); }
-void set_feat_dim(int d) { G_FEAT_DIM.store(d, std::memory_order_relaxed); }
-
-// --- Current model JSON ---
-json get_current_model() { return G_CURRENT_MODEL; }
-void set_current_model(const json& j) { G_CURRENT_MODEL = j; }
+int  get_feat_dim() { return get_model_snapshot()->feat_dim; }
 
 // --- Safe JSON read ---
 static inline json safe_read_json_file(const char* p){
@@ -93,33 +96,45 @@ static inline long long extract_ma_from_disk(const json& disk, long long def_ma)
   return def_ma;
 }
 
-// --- Startup init: читаем диск, выставляем атомики, гарантируем не-NaN ---
+// --- Публикация снимка ---
+// feat_dim <= 0 → из самой модели (policy.feat_dim / metrics.feat_cols), иначе прежний
+ModelSnapshotPtr publish_model(const json& j, double thr, long long ma_len, int feat_dim) {
+  auto s = std::make_shared<ModelSnapshot>();
+  s->model    = j.is_object() ? j : json::object();
+  s->thr      = thr;
+  s->ma_len   = ma_len;
+  s->feat_dim = feat_dim > 0 ? feat_dim
+                             : extract_feat_dim_from_disk(s->model, get_model_snapshot()->feat_dim);
+  return store_snapshot(std::move(s));
+}
+
+// --- Current model JSON ---
+json get_current_model() { return get_model_snapshot()->model; }
+
+void set_current_model(const json& j) {
+  ModelSnapshotPtr cur = get_model_snapshot();
+  const json m = j.is_object() ? j : json::object();
+  publish_model(m,
+                extract_thr_from_disk(m, cur->thr),
+                extract_ma_from_disk(m, cur->ma_len),
+                extract_feat_dim_from_disk(m, cur->feat_dim));
+}
+
+// --- Startup init: читаем диск, публикуем снимок, гарантируем не-NaN ---
 void init_model_atoms_from_disk(const char* path,
                                 double def_thr,
                                 long long def_ma,
                                 int def_feat_dim)
 {
-  // Дефолты заранее
-  set_model_thr(def_thr);
-  set_model_ma_len(def_ma);
-  set_feat_dim(def_feat_dim);
-  set_current_model(json::object());
-
-  // Читаем модель с диска, если есть
+  // Читаем модель с диска, если есть; иначе — пустая модель с дефолтами
   json disk = safe_read_json_file(path);
-  if (disk.is_object()) {
-    set_current_model(disk);
-
-    // Извлекаем агрегаты модели
-    double    thr = extract_thr_from_disk(disk, def_thr);
-    long long ma  = extract_ma_from_disk(disk,  def_ma);
-    int       fd  = extract_feat_dim_from_disk(disk, def_feat_dim);
-
-    // Последовательное и безопасное обновление атомиков
-    set_model_thr(thr);
-    set_model_ma_len(ma);
-    set_feat_dim(fd);
-  }
+  if (!disk.is_object()) disk = json::object();
+
+  // Извлекаем агрегаты модели и публикуем одним снимком
+  publish_model(disk,
+                extract_thr_from_disk(disk, def_thr),
+                extract_ma_from_disk(disk,  def_ma),
+                extract_feat_dim_from_disk(disk, def_feat_dim));
 
   // Сбрасываем телеметрию последнего инференса в нейтраль
   set_last_infer_score(0.0);
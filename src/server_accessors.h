@@ -1,27 +1,42 @@
 #pragma once
 #include <cstdint>
+#include <memory>
 #include "json.hpp"
 
 namespace etai {
 
-// --- Threshold ---
+// --- Threshold --- (поля снимка; меняются только через publish_model)
 double        get_model_thr();
-void          set_model_thr(double v);
 
 // --- MA length ---
 long long     get_model_ma_len();
-void          set_model_ma_len(long long v);
 
 // --- Feature dimension (canonical) ---
 int           get_feat_dim();
-void          set_feat_dim(int d);
 
 // Back-compat aliases expected by routes/metrics.cpp
 inline int    get_model_feat_dim() { return get_feat_dim(); }
-inline void   set_model_feat_dim(int d) { set_feat_dim(d); }
 
-// --- Current model JSON ---
+// --- Снимок текущей модели (RCU) ---
+// Неизменяемый объект, публикуется атомарной подменой shared_ptr.
+// thr/ma_len/feat_dim живут в том же снимке, что и JSON — читатель видит их согласованными.
+struct ModelSnapshot {
+    nlohmann::json     model = nlohmann::json::object();
+    double             thr      = 0.38;
+    long long          ma_len   = 12;
+    int                feat_dim = 28;
+    unsigned long long version  = 0;   // растёт при каждой публикации
+};
+using ModelSnapshotPtr = std::shared_ptr<const ModelSnapshot>;
+
+ModelSnapshotPtr get_model_snapshot();
+
+// Опубликовать модель вместе с агрегатами одним шагом (feat_dim <= 0 — из policy.feat_dim модели)
+ModelSnapshotPtr publish_model(const nlohmann::json& j, double thr, long long ma_len, int feat_dim);
+
+// --- Current model JSON (совместимость; копия JSON из снимка) ---
 nlohmann::json get_current_model();
+// thr/ma/feat_dim берутся из j (best_thr, ma_len, policy.feat_dim), иначе — из текущего снимка
 void           set_current_model(const nlohmann::json& j);
 
 // --- Startup initialization from disk (with safe defaults) ---
@@ -32,18 +32,13 @@ inline int minutes_of(const std::string& interval){
 }
 
 inline json data_health_report(const std::string& symbol, const std::string& interval){
-  arma::mat M = etai::load_cached_matrix(symbol, interval);
-  json out{{"interval", interval},{"symbol",symbol},{"ok", M.n_elem>0},{"rows",(int)M.n_cols}};
-  if (M.n_elem==0) return out;
-  const arma::rowvec ts = M.row(0);
-  int gaps=0, dups=0;
-  long long ts_min=(long long)ts(0), ts_max=(long long)ts(M.n_cols-1);
-  long long step_ms = (long long)minutes_of(interval) * 60LL * 1000LL;
-  for (size_t i=1;i<M.n_cols;++i){
-    long long dt = (long long)ts(i) - (long long)ts(i-1);
-    if (dt>step_ms) gaps++; else if (dt==0) dups++;
-  }
-  out["gaps"]=gaps; out["dups"]=dups; out["ts_min"]=ts_min; out["ts_max"]=ts_max;
+  // сводка из сайдкара .meta — без чтения серии
+  etai::SeriesMeta m{};
+  const bool have = etai::series_meta("cache/" + symbol + "_" + interval + ".csv", m);
+  json out{{"interval", interval},{"symbol",symbol},{"ok", have && m.rows>0},{"rows",have ? (long long)m.rows : 0LL}};
+  if (!have || m.rows==0) return out;
+  out["gaps"]=m.gaps; out["missing"]=m.missing; out["dups"]=m.dups;
+  out["ts_min"]=(long long)m.ts_min; out["ts_max"]=(long long)m.ts_max;
   return out;
 }
 
@@ -1,9 +1,13 @@
 #include "train_logic.h"
 #include "server_accessors.h"
+#include "policy_registry.h"
 #include "ppo_pro.h"
 #include "utils_data.h"
+#include "feature_store.h"
+#include "bar_store.h"
 #include "http_reply.h"
 #include <armadillo>
+#include <cstdint>
 #include <mutex>
 #include <iostream>
 #include <fstream>
@@ -13,11 +17,13 @@ using json = nlohmann::json;
 namespace etai {
 static std::mutex train_mutex;
 
+// ts_from — начало окна обучения (INT64_MIN — вся история, включая архив)
 static inline bool try_load_raw(const std::string& symbol,
                                 const std::string& interval,
-                                arma::mat& out)
+                                arma::mat& out,
+                                int64_t ts_from = INT64_MIN)
 {
-    if (!load_raw_ohlcv(symbol, interval, out)) {
+    if (!load_bars(symbol, interval, ts_from, INT64_MAX, out)) {
         std::cerr << "[TRAIN] warn: HTF " << interval << " not loaded\n";
         out.reset();
         return false;
@@ -37,13 +43,23 @@ json run_train_pro_and_save(const std::string& symbol,
                             double tp,
                             double sl,
                             int ma_len,
-                            bool use_antimanip)
+                            bool use_antimanip,
+                            int months)
 {
     std::lock_guard<std::mutex> lock(train_mutex);
 
-    // --- 1) Загрузка данных
-    arma::mat raw15;
-    if (!load_raw_ohlcv(symbol, interval, raw15))
+    // --- 1) Загрузка данных (окно months — от последнего бара серии, читается только оно)
+    int64_t ts_from = INT64_MIN;
+    if (months > 0) {
+        bool used_clean = false;
+        SeriesMeta meta{};
+        if (series_meta(select_raw_path(symbol, interval, used_clean), meta) && meta.rows > 0)
+            ts_from = meta.ts_max - (int64_t)(months * 30.5 * 24 * 60 * 60 * 1000.0);
+    }
+    // признаки 15m — из хранилища (архив + горячая серия; считаются только новые бары)
+    FeatureSet fs15;
+    arma::mat raw15, F15;
+    if (!feature_store_get(symbol, interval, fs15) || !feature_set_since(fs15, ts_from, raw15, F15))
         throw std::runtime_error("Failed to load OHLCV");
 
     arma::mat raw60, raw240, raw1440;
@@ -51,18 +67,19 @@ json run_train_pro_and_save(const std::string& symbol,
     const arma::mat *p240  = nullptr;
     const arma::mat *p1440 = nullptr;
 
-    if (try_load_raw(symbol, "60",   raw60))   p60   = &raw60;
-    if (try_load_raw(symbol, "240",  raw240))  p240  = &raw240;
-    if (try_load_raw(symbol, "1440", raw1440)) p1440 = &raw1440;
+    if (try_load_raw(symbol, "60",   raw60,   ts_from)) p60   = &raw60;
+    if (try_load_raw(symbol, "240",  raw240,  ts_from)) p240  = &raw240;
+    if (try_load_raw(symbol, "1440", raw1440, ts_from)) p1440 = &raw1440;
 
     std::cout << "[TRAIN] shapes: 15=" << raw15.n_rows
               << " 60="   << (p60   ? raw60.n_rows   : 0)
               << " 240="  << (p240  ? raw240.n_rows  : 0)
               << " 1440=" << (p1440 ? raw1440.n_rows : 0)
-              << "  (cols15=" << raw15.n_cols << ")\n";
+              << "  (cols15=" << raw15.n_cols << ")"
+              << "  feat: built=" << fs15.built_rows << "/" << fs15.F.n_rows << "\n";
 
     // --- 2) Обучение модели
-    json trainer = trainPPO_pro(raw15, p60, p240, p1440, episodes, tp, sl, ma_len, use_antimanip);
+    json trainer = trainPPO_pro(raw15, F15, fs15.feat_version, p60, p240, p1440, episodes, tp, sl, ma_len, use_antimanip);
 
     // --- 3) Добавляем служебные поля на верхний уровень
     trainer["tp"]       = tp;
@@ -70,6 +87,7 @@ json run_train_pro_and_save(const std::string& symbol,
     trainer["interval"] = interval;
     trainer["sl"]       = sl;
     trainer["ma_len"]   = ma_len;
+    if (months > 0) trainer["months"] = months;
 
     // --- 4) Вычисляем feat_dim из policy или metrics.feat_cols
     int feat_dim = 0;
@@ -112,10 +130,8 @@ json run_train_pro_and_save(const std::string& symbol,
 
     // --- 7) Обновляем атомики для health/metrics
     const double best_thr = trainer.value("best_thr", 0.5);
-    set_model_thr(best_thr);
-    set_model_ma_len(ma_len);
-    if (feat_dim > 0) set_model_feat_dim(feat_dim);
-    set_current_model(trainer);
+    publish_model(trainer, best_thr, ma_len, feat_dim);
+    publish_policy(trainer, model_path, symbol, interval);
 
     // --- 8) Логирование
     try {
@@ -4,13 +4,15 @@
 
 namespace etai {
 
-// Запуск тренировки с сохранением модели на диск
+// Запуск тренировки с сохранением модели на диск.
+// months > 0 — обучение на последних months месяцах серии (load_bars по окну)
 nlohmann::json run_train_pro_and_save(const std::string& symbol,
                                       const std::string& interval,
                                       int episodes,
                                       double tp,
                                       double sl,
                                       int ma_len,
-                                      bool use_antimanip);
+                                      bool use_antimanip,
+                                      int months = 0);   // окно истории (0 — вся)
 
 } // namespace etai
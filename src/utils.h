@@ -1,6 +1,12 @@
 #pragma once
 #include "httplib.h"
 #include "json.hpp"
+#include "bar_store.h"
+#include "kline_decode.h"
+#include "htf_aggregate.h"
+#include "data_clean.h"
+#include "bar_archive.h"
+#include "bar_cache.h"
 
 #include <armadillo>
 #include <string>
@@ -9,6 +15,9 @@
 #include <map>
 #include <chrono>
 #include <thread>
+#include <functional>
+#include <cstdlib>
+#include <memory>
 #include <fstream>
 #include <algorithm>
 #include <sstream>
@@ -119,37 +128,67 @@ inline std::optional<long long> parse_timestamp_token(std::string_view token) {
   return value;
 }
 
-// ===== CSV CACHE =====
+// ===== CACHE (бинарное хранилище .bars, CSV — зеркало) =====
+inline std::string format_bar_line(const BarRows& r, size_t i) {
+  char buf[64];
+  std::string s;
+  auto p = std::to_chars(buf, buf + sizeof(buf), (long long)r.ts[i]);
+  s.append(buf, p.ptr);
+  const int ncol = r.has_turnover ? 6 : 5;
+  for (int k = 0; k < ncol; ++k) {
+    p = std::to_chars(buf, buf + sizeof(buf), r.cols[k][i]);
+    s.push_back(',');
+    s.append(buf, p.ptr);
+  }
+  return s;
+}
+
+// Совместимость: серия → map<ts, строка CSV>. Возвращает число битых строк.
 inline size_t read_cache(const std::string& path, std::map<long long, std::string>& out) {
-  std::ifstream f(path);
-  if (!f.good()) return 0;
-  std::string line;
+  BarRows rows;
   size_t skipped = 0;
-  while (std::getline(f, line)) {
-    if (line.empty()) continue;
-    size_t pos = line.find(',');
-    if (pos == std::string::npos) continue;
-    auto ts = parse_timestamp_token(std::string_view(line.data(), pos));
-    if (!ts) { ++skipped; continue; }
-    out[*ts] = line;
-  }
+  if (!load_series(path, rows, &skipped)) return skipped;
+  for (size_t i = 0; i < rows.size(); ++i) out[rows.ts[i]] = format_bar_line(rows, i);
   return skipped;
 }
 
+// Совместимость: map<ts, строка CSV> → .bars + CSV-зеркало
 inline void write_cache(const std::string& path, const std::map<long long, std::string>& data) {
-  std::ofstream f(path, std::ios::trunc);
-  for (auto& kv : data) f << kv.second << "\n";
+  BarRows rows;
+  rows.reserve(data.size());
+  for (auto& kv : data) {
+    double v[7] = {0,0,0,0,0,0,0};
+    int nf = 0;
+    const char* b = kv.second.data();
+    const char* e = b + kv.second.size();
+    while (b < e && nf < 7) {
+      const char* ce = std::find(b, e, ',');
+      if (std::from_chars(b, ce, v[nf]).ec != std::errc()) break;
+      ++nf;
+      b = (ce < e) ? ce + 1 : e;
+    }
+    if (nf < 6) continue;
+    if (nf >= 7) rows.has_turnover = true;
+    rows.push_back(kv.first, v[1], v[2], v[3], v[4], v[5], v[6]);
+  }
+  store_series(path, rows);
 }
 
 // ===== BYBIT v5 /market/kline =====
-inline bool bybit_fetch_batch(httplib::SSLClient& cli,
+constexpr int BYBIT_PAGE_LIMIT = 1000;
+
+// Одна страница [start_ms, end_ms] (границы включительно, limit=1000) → колонки page
+// по возрастанию ts. Биржа отдаёт самые новые бары диапазона, от новых к старым.
+// raw_rows — сколько строк вернула биржа (включая отброшенные): < limit → страница последняя.
+inline bool bybit_fetch_batch(httplib::Client& cli,
                               const std::string& category,
                               const std::string& symbol,
                               const std::string& interval,
                               long long start_ms,
                               long long end_ms,
-                              std::vector<std::array<std::string,7>>& out_rows,
-                              size_t* skipped_rows = nullptr) {
+                              BarRows& page,
+                              size_t* skipped_rows = nullptr,
+                              size_t* raw_rows = nullptr) {
   const std::string interval_param = bybit_interval_param(interval);
   std::vector<std::pair<std::string,std::string>> kv{
     {"category", category},
@@ -157,194 +196,420 @@ inline bool bybit_fetch_batch(httplib::SSLClient& cli,
     {"interval", interval_param},
     {"start",    std::to_string(start_ms)},
     {"end",      std::to_string(end_ms)},
-    {"limit",    "1000"}
+    {"limit",    std::to_string(BYBIT_PAGE_LIMIT)}
   };
   std::string path = "/v5/market/kline?" + make_query(kv);
 
   auto res = cli.Get(path.c_str());
   if (!res || res->status != 200) return false;
 
-  auto j = json::parse(res->body, nullptr, false);
-  if (j.is_discarded()) return false;
-  if (!j.contains("retCode")) return false;
-  if (j["retCode"].get<int>() != 0) return false;
-
-  if (!j.contains("result") || !j["result"].contains("list")) return true;
-  const auto& arr = j["result"]["list"];
-  if (!arr.is_array()) return true;
-
-  std::vector<std::pair<long long, std::array<std::string,7>>> batch;
-  batch.reserve(arr.size());
-  for (const auto& row : arr) {
-    if (!row.is_array() || row.size() < 7) continue;
-    std::array<std::string,7> r{
-      row.at(0).get<std::string>(),
-      row.at(1).get<std::string>(),
-      row.at(2).get<std::string>(),
-      row.at(3).get<std::string>(),
-      row.at(4).get<std::string>(),
-      row.at(5).get<std::string>(),
-      row.at(6).get<std::string>()
-    };
-    auto ts = parse_timestamp_token(r[0]);
-    if (!ts) {
-      if (skipped_rows) ++(*skipped_rows);
-      continue;
-    }
-    batch.emplace_back(*ts, std::move(r));
-  }
-
-  std::sort(batch.begin(), batch.end(), [](const auto& a, const auto& b){
-    return a.first < b.first;
-  });
-
-  for (auto& item : batch) {
-    out_rows.emplace_back(std::move(item.second));
+  page.clear();
+  page.has_turnover = true;
+  page.reserve(BYBIT_PAGE_LIMIT);
+  KlineDecodeStats st;
+  if (!decode_bybit_klines(res->body, page, &st, start_ms, end_ms)) return false;
+  if (st.ret_code != 0) return false;
+  if (skipped_rows) *skipped_rows += st.skipped;
+  if (raw_rows) *raw_rows = st.raw_rows;
+
+  // newest-first → по возрастанию; сортировка только если биржа нарушила порядок
+  std::reverse(page.ts.begin(), page.ts.end());
+  for (auto& c : page.cols) std::reverse(c.begin(), c.end());
+  if (!std::is_sorted(page.ts.begin(), page.ts.end())) {
+    std::vector<size_t> idx(page.size());
+    for (size_t i = 0; i < idx.size(); ++i) idx[i] = i;
+    std::stable_sort(idx.begin(), idx.end(), [&](size_t a, size_t b){ return page.ts[a] < page.ts[b]; });
+    BarRows sorted;
+    sorted.has_turnover = true;
+    sorted.reserve(idx.size());
+    for (size_t i : idx)
+      sorted.push_back(page.ts[i], page.cols[0][i], page.cols[1][i], page.cols[2][i],
+                       page.cols[3][i], page.cols[4][i], page.cols[5][i]);
+    page = std::move(sorted);
   }
   return true;
 }
 
 // ===== BACKFILL (15/60/240/1440) =====
-inline nlohmann::json backfill_last_months(const std::string& symbol,
-                                           const std::string& interval,
-                                           int months = 6,
-                                           const std::string& category = "linear") {
-  ensure_dir("cache");
-
-  const long long now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+inline long long backfill_now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::system_clock::now().time_since_epoch()).count();
-  const long long span_ms = (long long)(months * 30.5 * 24 * 60 * 60 * 1000.0);
-  const long long since_ms = now_ms - span_ms;
+}
+
+inline long long backfill_span_ms(int months) {
+  return (long long)(months * 30.5 * 24 * 60 * 60 * 1000.0);
+}
 
-  httplib::SSLClient cli("api.bybit.com");
+// Транспорт выгрузки. По умолчанию (nullptr) — свой клиент на вызов и пауза 60 мс
+// между страницами; движок backfill_engine подставляет постоянное соединение
+// и общий ограничитель запросов, а также получает прогресс постранично.
+struct BackfillIo {
+  httplib::Client* cli = nullptr;
+  std::function<void()> acquire;                                      // перед каждым запросом
+  std::function<void(long long since, long long until, long long cursor, int pages, size_t rows)> progress;
+};
+
+// База REST рыночных данных: ETAI_BYBIT_BASE_URL (scheme://host[:port]), по умолчанию
+// https://api.bybit.com; http://127.0.0.1:PORT — локальный стенд tools/bybit_standin
+inline std::string bybit_base_url() {
+  const char* e = std::getenv("ETAI_BYBIT_BASE_URL");
+  std::string url = (e && *e) ? e : "https://api.bybit.com";
+  while (!url.empty() && url.back() == '/') url.pop_back();
+  return url;
+}
+
+inline void bybit_setup_client(httplib::Client& cli) {
   cli.enable_server_certificate_verification(true);
   cli.set_connection_timeout(5, 0);
   cli.set_read_timeout(20, 0);
+}
 
-  std::vector<std::array<std::string,7>> rows;
-  rows.reserve(50000);
+inline std::unique_ptr<httplib::Client> bybit_make_client() {
+  auto cli = std::make_unique<httplib::Client>(bybit_base_url());
+  bybit_setup_client(*cli);
+  return cli;
+}
+
+// Постраничная выгрузка [since_ms, now_ms] → колонки, назад от now_ms полными страницами
+// по 1000 баров: следующая страница заканчивается перед самым старым баром предыдущей,
+// остановка — на неполной странице или когда следующий бар был бы раньше since_ms.
+// Число запросов — ceil(баров / 1000). pages — число полученных страниц.
+// Неудачный запрос повторяется с экспоненциальной паузой (200 мс × 2^k, не более 5 с);
+// false — страница не получена за BYBIT_MAX_RETRIES попыток, fresh — то, что успели.
+constexpr int BYBIT_MAX_RETRIES = 6;
+
+inline bool bybit_fetch_range(const std::string& symbol,
+                              const std::string& interval,
+                              const std::string& category,
+                              long long since_ms,
+                              long long now_ms,
+                              BarRows& fresh,
+                              size_t& skipped_rows,
+                              int& pages,
+                              BackfillIo* io = nullptr) {
+  std::unique_ptr<httplib::Client> own;
+  httplib::Client* cli = io ? io->cli : nullptr;
+  if (!cli) {
+    own = bybit_make_client();
+    cli = own.get();
+  }
+  const bool limited = io && io->acquire;
+  if (io && io->progress) io->progress(since_ms, now_ms, now_ms, 0, 0);
 
-  long long cursor = since_ms;
   const long long frame = tf_ms(interval);
-  long long last_ts_seen = -1;
+  std::vector<BarRows> chunks;   // от новых страниц к старым
+  size_t total = 0;
+  bool ok = true;
+  long long end_ms = now_ms;
+
+  while (end_ms >= since_ms) {
+    BarRows page;
+    size_t raw = 0;
+    int attempt = 0;
+    for (;;) {
+      if (limited) io->acquire();
+      if (bybit_fetch_batch(*cli, category, symbol, interval, since_ms, end_ms, page, &skipped_rows, &raw))
+        break;
+      if (++attempt >= BYBIT_MAX_RETRIES) { ok = false; break; }
+      std::this_thread::sleep_for(std::chrono::milliseconds(std::min(5000LL, 200LL << (attempt - 1))));
+    }
+    if (!ok) break;
+    ++pages;
+    if (page.empty()) break;
+
+    const long long oldest = page.ts.front();
+    total += page.size();
+    chunks.push_back(std::move(page));
+    if (io && io->progress) io->progress(since_ms, now_ms, oldest, pages, total);
+    if (raw < (size_t)BYBIT_PAGE_LIMIT || oldest - frame < since_ms) break;
+    end_ms = oldest - 1;
+    if (!limited) std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  }
+
+  // склейка колонок: старые страницы первыми
+  fresh.clear();
+  fresh.has_turnover = true;
+  fresh.reserve(total);
+  for (auto c = chunks.rbegin(); c != chunks.rend(); ++c) {
+    fresh.ts.insert(fresh.ts.end(), c->ts.begin(), c->ts.end());
+    for (int k = 0; k < 6; ++k)
+      fresh.cols[k].insert(fresh.cols[k].end(), c->cols[k].begin(), c->cols[k].end());
+  }
+  return ok;
+}
+
+inline nlohmann::json backfill_result(const std::string& symbol, const std::string& interval, int months,
+                                      const char* mode, size_t rows, size_t skipped_rows, int pages,
+                                      bool fetched = true, bool stored = true) {
+  json out{
+    {"ok", fetched && stored && skipped_rows == 0},
+    {"symbol", symbol},
+    {"interval", canonical_interval(interval)},
+    {"months", months},
+    {"mode", mode},
+    {"rows", (int)rows},
+    {"pages", pages}
+  };
+  if (skipped_rows > 0) {
+    out["error"] = "invalid_timestamp";
+    out["skipped_rows"] = skipped_rows;
+  }
+  if (!fetched) out["error"] = "fetch_failed";
+  if (!stored)  out["error"] = "store_failed";
+  return out;
+}
+
+// Полная выгрузка окна months + merge с имеющейся серией (без обрезки — см. compact_cache)
+inline nlohmann::json backfill_full(const std::string& symbol,
+                                    const std::string& interval,
+                                    int months,
+                                    const std::string& category,
+                                    BackfillIo* io = nullptr) {
+  ensure_dir("cache");
+  const long long now_ms = backfill_now_ms();
+  const long long since_ms = now_ms - backfill_span_ms(months);
+
   size_t skipped_rows = 0;
+  int pages = 0;
+  BarRows fresh;
+  const bool fetched = bybit_fetch_range(symbol, interval, category, since_ms, now_ms, fresh, skipped_rows, pages, io);
 
-  while (cursor < now_ms) {
-    long long end_ms = std::min(cursor + frame * 1000, now_ms);
-    if (!bybit_fetch_batch(cli, category, symbol, interval, cursor, end_ms, rows, &skipped_rows)) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(200));
-      continue;
-    }
-    if (rows.empty()) {
-      cursor += frame * 1000;
-      continue;
-    }
-    // найти последний валидный ts
-    auto it = std::find_if(rows.rbegin(), rows.rend(), [](const auto& r){
-      return parse_timestamp_token(r[0]).has_value();
-    });
-    if (it == rows.rend()) { ++skipped_rows; cursor += frame; continue; }
-    long long new_last = *parse_timestamp_token((*it)[0]);
-    if (new_last <= last_ts_seen) { cursor += frame; }
-    else { last_ts_seen = new_last; cursor = last_ts_seen + frame; }
-    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  const auto path = cache_file(symbol, interval);
+  BarRows merged;
+  load_series(path, merged, &skipped_rows);
+  bool stored = true;
+  if (!fresh.empty()) {
+    merge_bars(merged, fresh);
+    stored = store_series(path, merged);
   }
+  return backfill_result(symbol, interval, months, "full", merged.size(), skipped_rows, pages, fetched, stored);
+}
 
-  // merge → cache
-  std::map<long long, std::string> merged;
+// Дельта: только бары после последнего сохранённого ts (он сам — перезапрашивается,
+// т.к. мог быть формирующимся), дозапись в конец серии без перезаписи файла.
+// Серии нет — полная выгрузка за months.
+inline nlohmann::json backfill_delta(const std::string& symbol,
+                                     const std::string& interval,
+                                     int months = 6,
+                                     const std::string& category = "linear",
+                                     BackfillIo* io = nullptr) {
+  ensure_dir("cache");
   const auto path = cache_file(symbol, interval);
-  skipped_rows += read_cache(path, merged);
-
-  for (const auto& r : rows) {
-    auto ts = parse_timestamp_token(r[0]);
-    if (!ts) { ++skipped_rows; continue; }
-    const long long ts_value = *ts;
-    std::vector<std::string> cols{ r[0], r[1], r[2], r[3], r[4], r[5], r[6] };
-    merged[ts_value] = join_csv(cols);
+  int64_t last_ts = 0;
+  if (!series_last_ts(path, last_ts)) return backfill_full(symbol, interval, months, category, io);
+
+  size_t skipped_rows = 0;
+  int pages = 0;
+  BarRows fresh;
+  const bool fetched = bybit_fetch_range(symbol, interval, category, last_ts, backfill_now_ms(),
+                                         fresh, skipped_rows, pages, io);
+
+  AppendStats st;
+  const bool stored = append_series(path, fresh, &st);
+  json out = backfill_result(symbol, interval, months, st.rewritten ? "delta_rewrite" : "delta",
+                             st.rows, skipped_rows, pages, fetched, stored);
+  out["appended"] = st.appended;
+  out["replaced"] = st.replaced;
+  return out;
+}
+
+// Рабочая точка входа (роуты, очередь): если серия уже покрывает окно months — дельта,
+// иначе полная выгрузка. force_full — всегда полная.
+inline nlohmann::json backfill_last_months(const std::string& symbol,
+                                           const std::string& interval,
+                                           int months = 6,
+                                           const std::string& category = "linear",
+                                           bool force_full = false,
+                                           BackfillIo* io = nullptr) {
+  if (!force_full) {
+    auto mb = open_bars_for_csv(cache_file(symbol, interval));
+    if (mb && mb->size() > 0 &&
+        mb->first_ts() <= backfill_now_ms() - backfill_span_ms(months) + tf_ms(interval))
+      return backfill_delta(symbol, interval, months, category, io);
   }
+  return backfill_full(symbol, interval, months, category, io);
+}
 
-  // trim N месяцев
-  if (!merged.empty()) {
-    std::map<long long, std::string> trimmed;
-    for (auto it2 = merged.lower_bound(since_ms); it2 != merged.end(); ++it2)
-      trimmed.emplace(it2->first, it2->second);
-    merged.swap(trimmed);
+// Старший ТФ из 15m серии (без сети): пересчёт с последней корзины и дозапись
+inline nlohmann::json backfill_derive(const std::string& symbol, const std::string& interval) {
+  const std::string tf = canonical_interval(interval);
+  HtfUpdateStats st;
+  const bool ok = htf_update_series(cache_file(symbol, "15"), cache_file(symbol, tf), minutes_of(tf), {}, &st);
+  json out{
+    {"ok", ok},
+    {"symbol", symbol},
+    {"interval", tf},
+    {"mode", st.rewritten ? "agg_rewrite" : "agg"},
+    {"source", "15"},
+    {"rows", (int)st.rows},
+    {"pages", 0},
+    {"base_rows", st.base_rows},
+    {"appended", st.appended},
+    {"replaced", st.replaced},
+    {"dropped_buckets", st.dropped},
+    {"incomplete_buckets", st.incomplete}
+  };
+  if (!ok) out["error"] = "no_base_series";
+  return out;
+}
+
+// Дозаполнение пропусков серии (индекс из clean_bars): соседние пропуски склеиваются
+// в окна до 1000 баров, окно — один диапазонный запрос (вместо запроса на каждый бар).
+// Полученные бары merge в исходную (raw) серию; после — повторный clean.
+inline nlohmann::json fill_gaps_series(const std::string& symbol,
+                                       const std::string& interval,
+                                       const std::vector<BarGap>& gaps,
+                                       const std::string& category = "linear",
+                                       BackfillIo* io = nullptr) {
+  const std::string tf = canonical_interval(interval);
+  const long long step = tf_ms(tf);
+
+  // окна [from, to]: пропуски подряд, пока окно укладывается в одну страницу
+  std::vector<std::pair<long long,long long>> windows;
+  for (const auto& g : gaps) {
+    if (!windows.empty() && (g.to_ts - windows.back().first) / step + 1 <= BYBIT_PAGE_LIMIT)
+      windows.back().second = g.to_ts;
+    else
+      windows.emplace_back(g.from_ts, g.to_ts);
   }
 
-  write_cache(path, merged);
+  std::unique_ptr<httplib::Client> own;
+  BackfillIo local;
+  if (!io || !io->cli) {
+    own = bybit_make_client();
+    own->set_keep_alive(true);
+    local.cli = own.get();
+    if (io) { local.acquire = io->acquire; local.progress = io->progress; }
+    io = &local;
+  }
 
-  if (skipped_rows > 0) {
-    return json{
-      {"ok", false},
-      {"symbol", symbol},
-      {"interval", canonical_interval(interval)},
-      {"months", months},
-      {"rows", (int)merged.size()},
-      {"error", "invalid_timestamp"},
-      {"skipped_rows", skipped_rows}
-    };
+  BarRows add;
+  add.has_turnover = true;
+  size_t skipped_rows = 0;
+  int pages = 0;
+  bool fetched = true;
+  for (size_t w = 0; w < windows.size(); ++w) {
+    BarRows part;
+    fetched = bybit_fetch_range(symbol, tf, category, windows[w].first, windows[w].second,
+                                part, skipped_rows, pages, io) && fetched;
+    merge_bars(add, part);
+    if (!io->acquire && w + 1 < windows.size()) std::this_thread::sleep_for(std::chrono::milliseconds(60));
   }
 
+  size_t rows = 0;
+  bool stored = true;
+  if (!add.empty()) {
+    const auto path = cache_file(symbol, tf);
+    BarRows merged;
+    load_series(path, merged);
+    merge_bars(merged, add);
+    stored = store_series(path, merged);
+    rows = merged.size();
+  }
+  size_t wanted = 0;
+  for (const auto& g : gaps) wanted += g.missing;
+  json out{
+    {"ok", fetched && stored},
+    {"symbol", symbol},
+    {"interval", tf},
+    {"gaps", gaps.size()},
+    {"missing_bars", wanted},
+    {"windows", windows.size()},
+    {"pages", pages},
+    {"fetched_rows", add.size()},
+    {"rows", (int)rows}
+  };
+  if (!stored) out["error"] = "store_failed";
+  return out;
+}
+
+// raw → clean/<SYM>_<TF> c проверкой баров; fill — дозаполнить пропуски и перечистить
+inline nlohmann::json clean_cache(const std::string& symbol, const std::string& interval,
+                                  bool fill = false, const std::string& category = "linear") {
+  const std::string tf = canonical_interval(interval);
+  ensure_dir("cache/clean");
+  const std::string raw = cache_file(symbol, tf);
+  const std::string cln = "cache/clean/" + symbol + "_" + tf + ".csv";
+  CleanReport rep;
+  if (!clean_series(raw, cln, tf_ms(tf), &rep))
+    return json{{"ok", false}, {"symbol", symbol}, {"interval", tf}, {"error", "no_raw_series"}};
+
+  json out{{"ok", true}, {"symbol", symbol}, {"interval", tf}, {"clean", clean_report_json(rep)}};
+  if (fill && !rep.gaps.empty()) {
+    json f = fill_gaps_series(symbol, tf, rep.gaps, category);
+    clean_series(raw, cln, tf_ms(tf), &rep);
+    f["gaps_after"] = rep.gaps.size();
+    f["missing_after"] = rep.missing_bars;
+    out["fill"] = f;
+    out["clean"] = clean_report_json(rep);
+  }
+  out["rows"] = rep.rows_out;
+  out["gaps"] = rep.gaps.size();
+  return out;
+}
+
+// Компакция: отбросить историю старше months (редкая операция, полная перезапись)
+inline nlohmann::json compact_cache(const std::string& symbol, const std::string& interval, int months) {
+  const auto path = cache_file(symbol, interval);
+  size_t dropped = 0;
+  const bool ok = compact_series(path, backfill_now_ms() - backfill_span_ms(months), &dropped);
+  size_t rows = 0;
+  int64_t last_ts = 0;
+  series_last_ts(path, last_ts, &rows);
   return json{
-    {"ok", true},
+    {"ok", ok},
     {"symbol", symbol},
     {"interval", canonical_interval(interval)},
     {"months", months},
-    {"rows", (int)merged.size()}
+    {"dropped", dropped},
+    {"rows", (int)rows}
   };
 }
 
-// ===== LOAD MATRIX (нормализуем в 6×N: ts,open,high,low,close,volume) =====
-inline arma::mat load_cached_matrix(const std::string& symbol, const std::string& interval) {
-  const auto path = cache_file(symbol, interval);
-  std::ifstream f(path);
-  if (!f.good()) return arma::mat();
-
-  std::vector<double> buf;
-  buf.reserve(6 * 100000);
-
-  std::string line;
-  size_t nrows = 0;
-  bool header_checked = false;
-
-  while (std::getline(f, line)) {
-    if (line.empty()) continue;
-
-    // пропускаем заголовок, если он случайно попал
-    if (!header_checked) {
-      header_checked = true;
-      // если первая ячейка не число — это точно заголовок
-      std::string first = line.substr(0, line.find(','));
-      bool digits = !first.empty() && std::all_of(first.begin(), first.end(), [](unsigned char c){ return std::isdigit(c); });
-      if (!digits) continue;
-    }
-
-    // парсим CSV
-    std::stringstream ss(line);
-    std::string cell;
-    std::vector<double> row;
-    row.reserve(7);
-    while (std::getline(ss, cell, ',')) {
-      if (cell.empty()) { row.clear(); break; }
-      try { row.push_back(std::stod(cell)); }
-      catch (...) { row.clear(); break; }
-    }
-    if (row.empty()) continue;
-
-    // ожидаем минимум 6 колонок: ts,o,h,l,c,vol; если 7 — игнорируем turnover
-    if (row.size() < 6) continue;
-    // только первые 6 полей
-    for (int i=0;i<6;++i) buf.push_back(row[i]);
-    ++nrows;
+// Архив: бары старше months → cache/archive (сжатый формат), горячая серия обрезается.
+// clean-серия (её читают обучение и хранилище признаков) — с той же границей в
+// cache/clean/archive, иначе следующий clean_cache пересоберёт её из обрезанной raw.
+inline nlohmann::json archive_cache(const std::string& symbol, const std::string& interval, int months) {
+  const std::string tf = canonical_interval(interval);
+  const auto path = cache_file(symbol, tf);
+  const int64_t before_ts = backfill_now_ms() - backfill_span_ms(months);
+  size_t moved = 0;
+  bool ok = archive_series(path, before_ts, &moved);
+  size_t rows = 0;
+  int64_t last_ts = 0;
+  series_last_ts(path, last_ts, &rows);
+  json out{
+    {"ok", ok},
+    {"symbol", symbol},
+    {"interval", tf},
+    {"months", months},
+    {"moved", moved},
+    {"rows", (int)rows}
+  };
+  const std::string cln = "cache/clean/" + symbol + "_" + tf + ".csv";
+  struct stat st{};
+  if (ok && (::stat(cln.c_str(), &st) == 0 || ::stat(bars_path_for(cln).c_str(), &st) == 0)) {
+    size_t clean_moved = 0;
+    ok = archive_series(cln, before_ts, &clean_moved);
+    out["ok"] = ok;
+    out["clean_moved"] = clean_moved;
   }
+  ArchiveInfo ai;
+  if (archive_info(archive_path_for(path), ai)) {
+    out["archive"] = json{
+      {"rows", ai.rows}, {"blocks", ai.blocks}, {"bytes", ai.bytes},
+      {"ts_min", ai.ts_min}, {"ts_max", ai.ts_max},
+      {"bytes_per_bar", ai.rows ? (double)ai.bytes / (double)ai.rows : 0.0}
+    };
+  }
+  return out;
+}
 
-  if (nrows == 0) return arma::mat();
-
-  arma::mat M(6, nrows);
-  for (size_t i = 0; i < nrows; ++i)
-    for (size_t c = 0; c < 6; ++c)
-      M(c, i) = buf[i*6 + c];
-  return M;
+// ===== LOAD MATRIX (N×6: ts,open,high,low,close,volume — как bar_cache и признаки) =====
+// Копия общей матрицы кэша; без копии — get_cached_bars + bars_view (bars_view.h)
+inline arma::mat load_cached_matrix(const std::string& symbol, const std::string& interval) {
+  BarMatrixPtr M = get_cached_bars(symbol, interval);
+  return M ? *M : arma::mat();
 }
 
 } // namespace etai
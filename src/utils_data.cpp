@@ -1,4 +1,7 @@
 #include "utils_data.h"
+#include "bar_store.h"
+#include "bar_archive.h"
+#include "feature_store.h"
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -6,6 +9,7 @@
 #include <vector>
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
@@ -25,31 +29,19 @@ bool load_cached_xy(const std::string& symbol,
                     const std::string& interval,
                     arma::mat& X, arma::mat& y)
 {
-  // как было раньше: читаем/строим X,y и сохраняем на диск; не трогаем логику (заглушка под существующую реализацию)
-  // Если у тебя есть старая реализация ниже — можно вернуть её; тут — минимализм ради компоновки.
+  // X — полная матрица признаков из хранилища (cache/features), y — будущая доходность
+  // бара (close[i+2]/close[i+1] − 1, как разметка тренера; последние строки — 0)
   try {
-    const std::string xfile = "cache/xy/" + upper(symbol) + "_" + norm_interval(interval) + "_X.csv";
-    const std::string yfile = "cache/xy/" + upper(symbol) + "_" + norm_interval(interval) + "_y.csv";
-    if (fs::exists(xfile) && fs::exists(yfile)) {
-      X.load(xfile, arma::csv_ascii);
-      y.load(yfile, arma::csv_ascii);
-      return (X.n_rows>0 && X.n_cols>0 && y.n_rows==X.n_rows);
+    FeatureSet fs;
+    if (!feature_store_get(symbol, interval, fs) || fs.F.n_rows == 0) return false;
+    const arma::uword n = fs.F.n_rows;
+    arma::mat Y(n, 1, arma::fill::zeros);
+    for (arma::uword i = 0; i + 2 < n; ++i) {
+      const double c1 = fs.raw(i + 1, 4), c2 = fs.raw(i + 2, 4);
+      Y(i, 0) = (c1 > 0.0) ? (c2 / c1 - 1.0) : 0.0;
     }
-    // если кэша нет — строим из базового csv (через raw) и делаем простые фичи как в тренере,
-    // чтобы только получить feat_dim (продакшн-фичи всё равно строятся внутри тренера)
-    arma::mat raw;
-    if(!load_raw_ohlcv(symbol, interval, raw)) return false;
-
-    // простые заглушки фич (D=8 нулевых) — чтобы сохранить совместимость с policy.feat_dim
-    arma::mat F(raw.n_rows, 8, arma::fill::zeros);
-    arma::mat Y(raw.n_rows, 1, arma::fill::zeros);
-
-    X = std::move(F);
+    X = std::move(fs.F);
     y = std::move(Y);
-
-    fs::create_directories("cache/xy");
-    X.save(xfile, arma::csv_ascii);
-    y.save(yfile, arma::csv_ascii);
     return true;
   } catch (...) {
     return false;
@@ -71,12 +63,6 @@ std::string select_raw_path(const std::string& symbol,
   return p_raw;
 }
 
-static inline void trim_to_6_cols(arma::mat& M){
-  if (M.n_cols > 6) {
-    M = M.cols(0,5);
-  }
-}
-
 bool load_raw_ohlcv(const std::string& symbol,
                     const std::string& interval,
                     arma::mat& raw)
@@ -84,22 +70,26 @@ bool load_raw_ohlcv(const std::string& symbol,
   try{
     bool used_clean = false;
     const std::string path = select_raw_path(symbol, interval, used_clean);
-    if (!fs::exists(path)) {
+    if (!fs::exists(path) && !fs::exists(bars_path_for(path))) {
       std::cerr << "[RAW] missing csv: " << path << std::endl;
       return false;
     }
 
-    arma::mat M;
-    if(!M.load(path, arma::csv_ascii)){
-      std::cerr << "[RAW] failed to load csv: " << path << std::endl;
+    // .bars (mmap) → N×6; CSV импортируется один раз, если .bars нет/устарел
+    auto mb = open_bars_for_csv(path);
+    if (!mb) {
+      std::cerr << "[RAW] failed to load series: " << path << std::endl;
       return false;
     }
 
-    trim_to_6_cols(M);
-
-    if (M.n_cols != 6) {
-      std::cerr << "[RAW] bad cols=" << M.n_cols << " (need 6) path=" << path << std::endl;
-      return false;
+    const size_t n = mb->size();
+    arma::mat M(n, 6);
+    auto ts = mb->ts();
+    double* c0 = M.colptr(0);
+    for (size_t i = 0; i < n; ++i) c0[i] = (double)ts[i];
+    for (int k = BAR_OPEN; k <= BAR_VOLUME; ++k) {
+      auto c = mb->col(k);
+      std::copy(c.begin(), c.end(), M.colptr(k + 1));
     }
 
     if (M.n_rows < 300) {
@@ -107,11 +97,6 @@ bool load_raw_ohlcv(const std::string& symbol,
       // продолжаем, как и оговаривали
     }
 
-    if (!used_clean && path.find("/cache/") != std::string::npos) {
-      // если падаем на сырой csv с 7 колонками — мы уже обрезали до 6: залогируем мягкое предупреждение
-      std::cerr << "[RAW] fallback used, trimmed to 6 cols from raw: " << path << std::endl;
-    }
-
     raw = std::move(M);
     return true;
   }catch(const std::exception& e){
@@ -132,21 +117,23 @@ static json one_health(const std::string& symbol, const std::string& interval){
   const std::string p_clean = "cache/clean/" + s + "_" + tf + ".csv";
   const std::string p_raw   = "cache/"       + s + "_" + tf + ".csv";
 
+  // сводка из сайдкара .meta (O(1)); пересчёт — только если его нет или он отстал
   auto probe = [](const std::string& p)->json{
-    json j{{"exists", fs::exists(p)}, {"path", p}, {"cols", 0}, {"rows", 0}};
-    if (j["exists"].get<bool>()) {
-      try{
-        std::ifstream f(p);
-        std::string line;
-        if(std::getline(f, line)){
-          int cols = 1 + std::count(line.begin(), line.end(), ',');
-          j["cols"] = cols;
-        }
-        std::uintmax_t rows = 0;
-        { std::ifstream fr(p); rows = std::count(std::istreambuf_iterator<char>(fr), {}, '\n'); }
-        j["rows"] = rows;
-      }catch(...){}
-    }
+    SeriesMeta m{};
+    if (!series_meta(p, m)) return json{{"exists", false}, {"path", p}, {"cols", 0}, {"rows", 0}};
+    json j{{"exists", true}, {"path", p}, {"cols", m.cols}, {"rows", m.rows}};
+    j["ts_min"]      = m.ts_min;
+    j["ts_max"]      = m.ts_max;
+    j["step_ms"]     = m.step_ms;
+    j["min_step_ms"] = m.min_step_ms;
+    j["gaps"]        = m.gaps;
+    j["missing"]     = m.missing;
+    j["dups"]        = m.dups;
+    j["skipped"]     = m.skipped;
+    j["written_ms"]  = m.written_ms;
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)m.hash);
+    j["hash"] = hex;
     return j;
   };
 
@@ -164,6 +151,44 @@ static json one_health(const std::string& symbol, const std::string& interval){
   return r;
 }
 
+// BarRows → N×6 (ts,open,high,low,close,volume)
+static arma::mat rows_to_raw(const BarRows& rows) {
+  const size_t n = rows.size();
+  arma::mat M(n, 6);
+  double* c0 = M.colptr(0);
+  for (size_t i = 0; i < n; ++i) c0[i] = (double)rows.ts[i];
+  for (int k = BAR_OPEN; k <= BAR_VOLUME; ++k)
+    std::copy(rows.cols[k].begin(), rows.cols[k].end(), M.colptr(k + 1));
+  return M;
+}
+
+bool load_bars(const std::string& symbol, const std::string& interval,
+               int64_t ts_from, int64_t ts_to, arma::mat& raw)
+{
+  bool used_clean = false;
+  const std::string path = select_raw_path(symbol, interval, used_clean);
+  BarRows rows;
+  if (!load_history_range(path, ts_from, ts_to, rows)) {
+    std::cerr << "[RAW] missing series: " << path << std::endl;
+    return false;
+  }
+  raw = rows_to_raw(rows);
+  return true;
+}
+
+bool load_tail(const std::string& symbol, const std::string& interval, size_t n, arma::mat& raw)
+{
+  bool used_clean = false;
+  const std::string path = select_raw_path(symbol, interval, used_clean);
+  BarRows rows;
+  if (!load_history_tail(path, n, rows)) {
+    std::cerr << "[RAW] missing series: " << path << std::endl;
+    return false;
+  }
+  raw = rows_to_raw(rows);
+  return true;
+}
+
 json data_health_report(const std::string& symbol, const std::string& interval){
   return one_health(symbol, interval);
 }
@@ -1,11 +1,12 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <armadillo>
 #include "json.hpp"
 
 namespace etai {
 
-// Кэш фичей X/y (как было)
+// X — признаки серии из хранилища (feature_store.h), y — будущая доходность бара
 bool load_cached_xy(const std::string& symbol,
                     const std::string& interval,
                     arma::mat& X, arma::mat& y);
@@ -20,6 +21,18 @@ bool load_raw_ohlcv(const std::string& symbol,
                     const std::string& interval,
                     arma::mat& raw);
 
+// Окно OHLCV (N×6) по времени [ts_from, ts_to] / последние n баров — читается только окно;
+// история старше горячей серии берётся из архива cache/archive (bar_archive.h)
+bool load_bars(const std::string& symbol,
+               const std::string& interval,
+               int64_t ts_from, int64_t ts_to,
+               arma::mat& raw);
+
+bool load_tail(const std::string& symbol,
+               const std::string& interval,
+               size_t n,
+               arma::mat& raw);
+
 // Отчёт по данным (health)
 nlohmann::json data_health_report(const std::string& symbol,
                                   const std::string& interval);
@@ -0,0 +1,359 @@
+// Локальный стенд Bybit v5 (рыночные данные) для офлайн-нагрузки выгрузки.
+//
+//   bybit_standin [--host 127.0.0.1] [--port 18080] [--threads 16]
+//                 [--data DIR]            записанные серии DIR/<SYM>_<TF>.csv (формат cache/)
+//                 [--history-days 1100]   глубина синтетической истории
+//                 [--latency-ms 0] [--jitter-ms 0]
+//                 [--rps 0]               лимит запросов/с (0 — без лимита), сверх — retCode 10006
+//                 [--fail-rate 0]         доля случайных ответов 10006
+//
+// Сервер: ETAI_BYBIT_BASE_URL=http://127.0.0.1:18080 — выгрузка (backfill, движок, очередь,
+// pipeline) ходит сюда вместо api.bybit.com.
+//
+//   GET /v5/market/kline?category=&symbol=&interval=&start=&end=&limit=
+//       как у Bybit: list от новых к старым, не больше limit (по умолчанию 200, максимум 1000)
+//       баров с start ≤ ts ≤ end; последний бар — формирующийся; числа — строками.
+//   GET /standin/stats   — счётчики запросов / баров / отказов
+//   GET /standin/reset   — обнулить счётчики
+//
+// Синтетика детерминирована по (symbol, interval, ts): одна и та же страница при любом
+// разбиении на запросы; open = close предыдущего бара. Без --data серия есть у любого символа,
+// с --data — только у записанных (иначе retCode 10001, как у Bybit на неизвестный символ).
+
+#include "httplib.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int    port = 18080;
+  int    threads = 16;
+  std::string data_dir;
+  int    history_days = 1100;
+  int    latency_ms = 0;
+  int    jitter_ms = 0;
+  double rps = 0.0;
+  double fail_rate = 0.0;
+};
+
+Options g_opt;
+
+std::atomic<unsigned long long> g_requests{0}, g_pages{0}, g_bars{0};
+std::atomic<unsigned long long> g_limited{0}, g_injected{0}, g_bad{0};
+
+long long now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------------
+// Лимит запросов: токен-бакет, ёмкость — секунда запросов
+// ---------------------------------------------------------------------------
+class RateLimit {
+public:
+  bool take() {
+    if (g_opt.rps <= 0.0) return true;
+    std::lock_guard<std::mutex> lk(mu_);
+    const auto t = std::chrono::steady_clock::now();
+    if (!init_) { tokens_ = g_opt.rps; last_ = t; init_ = true; }
+    tokens_ = std::min(g_opt.rps, tokens_ + std::chrono::duration<double>(t - last_).count() * g_opt.rps);
+    last_ = t;
+    if (tokens_ < 1.0) return false;
+    tokens_ -= 1.0;
+    return true;
+  }
+  int remaining() {
+    std::lock_guard<std::mutex> lk(mu_);
+    return (int)tokens_;
+  }
+
+private:
+  std::mutex mu_;
+  double tokens_ = 0.0;
+  bool init_ = false;
+  std::chrono::steady_clock::time_point last_;
+};
+
+RateLimit g_limit;
+
+// ---------------------------------------------------------------------------
+// Серии
+// ---------------------------------------------------------------------------
+struct Bar { long long ts; double o, h, l, c, v, t; };
+
+// Интервал Bybit → (мс, ТФ в именах cache/)
+bool interval_info(const std::string& iv, long long& frame, std::string& tf) {
+  static const std::map<std::string, int> minutes{
+    {"1",1},{"3",3},{"5",5},{"15",15},{"30",30},{"60",60},{"120",120},
+    {"240",240},{"360",360},{"720",720},{"D",1440}};
+  auto it = minutes.find(iv);
+  if (it == minutes.end()) return false;
+  frame = (long long)it->second * 60000LL;
+  tf = std::to_string(it->second);
+  return true;
+}
+
+uint64_t mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+double u01(uint64_t h) { return (double)(h >> 11) * (1.0 / 9007199254740992.0); }
+
+uint64_t symbol_seed(const std::string& s) {
+  uint64_t h = 1469598103934665603ULL;
+  for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+  return h;
+}
+
+double round_to(double v, double scale) { return std::round(v * scale) / scale; }
+
+// Синтетический close как функция времени: тренд + сезонность + шум по ts
+double synth_close(uint64_t seed, long long ts, long long frame) {
+  const double base = 50.0 + (double)(seed % 60000);
+  const double day = 86400000.0;
+  const double phase = u01(mix64(seed)) * 6.283185307179586;
+  const double x = 0.25 * std::sin(6.283185307179586 * (double)ts / (120.0 * day) + phase)
+                 + 0.06 * std::sin(6.283185307179586 * (double)ts / (9.0 * day) + 2.0 * phase)
+                 + 0.004 * (u01(mix64(seed ^ (uint64_t)(ts / frame))) - 0.5) * std::sqrt((double)frame / 900000.0);
+  return round_to(base * std::exp(x), 100.0);
+}
+
+Bar synth_bar(uint64_t seed, long long ts, long long frame) {
+  Bar b;
+  b.ts = ts;
+  b.o = synth_close(seed, ts - frame, frame);
+  b.c = synth_close(seed, ts, frame);
+  const uint64_t h = mix64(seed ^ 0x5bd1e995ULL ^ (uint64_t)ts);
+  b.h = round_to(std::max(b.o, b.c) * (1.0 + 0.002 * u01(h)), 100.0);
+  b.l = round_to(std::min(b.o, b.c) * (1.0 - 0.002 * u01(mix64(h))), 100.0);
+  b.v = round_to(1000.0 * u01(mix64(h + 1)) * std::sqrt((double)frame / 900000.0), 1000.0);
+  b.t = round_to(b.v * b.c, 10000.0);
+  return b;
+}
+
+// Записанная серия (CSV cache/: ts,open,high,low,close,volume[,turnover], заголовок допускается)
+using Recorded = std::shared_ptr<const std::vector<Bar>>;
+std::mutex g_rec_mu;
+std::map<std::string, Recorded> g_rec;
+
+Recorded recorded(const std::string& symbol, const std::string& tf) {
+  const std::string key = symbol + "_" + tf;
+  std::lock_guard<std::mutex> lk(g_rec_mu);
+  auto it = g_rec.find(key);
+  if (it != g_rec.end()) return it->second;
+  Recorded out;
+  std::ifstream f(g_opt.data_dir + "/" + key + ".csv");
+  if (f.good()) {
+    auto rows = std::make_shared<std::vector<Bar>>();
+    std::string line;
+    while (std::getline(f, line)) {
+      Bar b{};
+      b.t = 0.0;
+      const int n = std::sscanf(line.c_str(), "%lld,%lf,%lf,%lf,%lf,%lf,%lf",
+                                &b.ts, &b.o, &b.h, &b.l, &b.c, &b.v, &b.t);
+      if (n >= 6) rows->push_back(b);
+    }
+    std::sort(rows->begin(), rows->end(), [](const Bar& a, const Bar& b){ return a.ts < b.ts; });
+    rows->erase(std::unique(rows->begin(), rows->end(), [](const Bar& a, const Bar& b){ return a.ts == b.ts; }),
+                rows->end());
+    out = rows;
+    std::fprintf(stderr, "[standin] loaded %s rows=%zu\n", key.c_str(), rows->size());
+  }
+  g_rec[key] = out;
+  return out;
+}
+
+std::string num(double v) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.10g", v);
+  return buf;
+}
+
+void reply(httplib::Response& res, const json& body) {
+  res.set_header("X-Bapi-Limit", g_opt.rps > 0 ? std::to_string((long long)g_opt.rps) : "0");
+  res.set_header("X-Bapi-Limit-Status", std::to_string(g_limit.remaining()));
+  res.set_header("X-Bapi-Limit-Reset-Timestamp", std::to_string(now_ms() + 1000));
+  res.set_content(body.dump(), "application/json");
+}
+
+json error_body(int code, const std::string& msg) {
+  return json{{"retCode", code}, {"retMsg", msg}, {"result", json::object()},
+              {"retExtInfo", json::object()}, {"time", now_ms()}};
+}
+
+void handle_kline(const httplib::Request& req, httplib::Response& res) {
+  g_requests.fetch_add(1, std::memory_order_relaxed);
+  thread_local std::mt19937_64 rng{std::random_device{}()};
+
+  if (g_opt.latency_ms > 0 || g_opt.jitter_ms > 0) {
+    int d = g_opt.latency_ms;
+    if (g_opt.jitter_ms > 0) d += (int)(rng() % (uint64_t)(g_opt.jitter_ms + 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(d));
+  }
+  if (!g_limit.take()) {
+    g_limited.fetch_add(1, std::memory_order_relaxed);
+    reply(res, error_body(10006, "Too many visits. Exceeded the API Rate Limit."));
+    return;
+  }
+  if (g_opt.fail_rate > 0.0 && u01(rng()) < g_opt.fail_rate) {
+    g_injected.fetch_add(1, std::memory_order_relaxed);
+    reply(res, error_body(10006, "Too many visits. Exceeded the API Rate Limit."));
+    return;
+  }
+
+  const std::string category = req.get_param_value("category");
+  const std::string symbol   = req.get_param_value("symbol");
+  const std::string interval = req.get_param_value("interval");
+  long long frame = 0;
+  std::string tf;
+  if ((category != "linear" && category != "spot" && category != "inverse") ||
+      symbol.empty() || !interval_info(interval, frame, tf)) {
+    g_bad.fetch_add(1, std::memory_order_relaxed);
+    reply(res, error_body(10001, "params error"));
+    return;
+  }
+
+  long long limit = 200;
+  long long start = 0, end = 0;
+  try {
+    if (req.has_param("limit")) limit = std::stoll(req.get_param_value("limit"));
+    if (req.has_param("start")) start = std::stoll(req.get_param_value("start"));
+    if (req.has_param("end"))   end   = std::stoll(req.get_param_value("end"));
+  } catch (...) {
+    g_bad.fetch_add(1, std::memory_order_relaxed);
+    reply(res, error_body(10001, "params error"));
+    return;
+  }
+  limit = std::clamp(limit, 1LL, 1000LL);
+
+  const long long now = now_ms();
+  const long long live = now / frame * frame;                 // формирующийся бар
+  if (end <= 0 || end > now) end = now;
+
+  json list = json::array();
+  auto push = [&](const Bar& b) {
+    list.push_back(json::array({std::to_string(b.ts), num(b.o), num(b.h), num(b.l), num(b.c),
+                                num(b.v), num(b.t)}));
+  };
+
+  if (!g_opt.data_dir.empty()) {
+    Recorded rows = recorded(symbol, tf);
+    if (!rows) {
+      g_bad.fetch_add(1, std::memory_order_relaxed);
+      reply(res, error_body(10001, "Not supported symbols"));
+      return;
+    }
+    auto hi = std::upper_bound(rows->begin(), rows->end(), end,
+                               [](long long t, const Bar& b){ return t < b.ts; });
+    for (auto it = hi; it != rows->begin() && (long long)list.size() < limit; ) {
+      --it;
+      if (it->ts < start) break;
+      push(*it);
+    }
+  } else {
+    const uint64_t seed = symbol_seed(category + ":" + symbol);
+    const long long first = (now - (long long)g_opt.history_days * 86400000LL) / frame * frame;
+    long long ts = std::min(end / frame * frame, live);
+    const long long lo = std::max(start, first);
+    for (; ts >= lo && (long long)list.size() < limit; ts -= frame) {
+      if (ts < start) break;
+      push(synth_bar(seed, ts, frame));
+    }
+  }
+
+  g_pages.fetch_add(1, std::memory_order_relaxed);
+  g_bars.fetch_add(list.size(), std::memory_order_relaxed);
+  reply(res, json{
+    {"retCode", 0}, {"retMsg", "OK"},
+    {"result", {{"symbol", symbol}, {"category", category}, {"list", list}}},
+    {"retExtInfo", json::object()}, {"time", now}
+  });
+}
+
+json stats_json() {
+  return json{
+    {"requests", g_requests.load()}, {"pages", g_pages.load()}, {"bars", g_bars.load()},
+    {"rate_limited", g_limited.load()}, {"injected_errors", g_injected.load()}, {"bad_requests", g_bad.load()},
+    {"config", {{"rps", g_opt.rps}, {"fail_rate", g_opt.fail_rate}, {"latency_ms", g_opt.latency_ms},
+                {"jitter_ms", g_opt.jitter_ms}, {"threads", g_opt.threads},
+                {"data_dir", g_opt.data_dir}, {"history_days", g_opt.history_days}}}
+  };
+}
+
+bool parse_args(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string k = argv[i];
+    if (k == "-h" || k == "--help") return false;
+    if (i + 1 >= argc) { std::fprintf(stderr, "missing value for %s\n", k.c_str()); return false; }
+    const std::string v = argv[++i];
+    try {
+      if      (k == "--host")         g_opt.host = v;
+      else if (k == "--port")         g_opt.port = std::stoi(v);
+      else if (k == "--threads")      g_opt.threads = std::max(1, std::stoi(v));
+      else if (k == "--data")         g_opt.data_dir = v;
+      else if (k == "--history-days") g_opt.history_days = std::max(1, std::stoi(v));
+      else if (k == "--latency-ms")   g_opt.latency_ms = std::max(0, std::stoi(v));
+      else if (k == "--jitter-ms")    g_opt.jitter_ms = std::max(0, std::stoi(v));
+      else if (k == "--rps")          g_opt.rps = std::max(0.0, std::stod(v));
+      else if (k == "--fail-rate")    g_opt.fail_rate = std::clamp(std::stod(v), 0.0, 1.0);
+      else { std::fprintf(stderr, "unknown option %s\n", k.c_str()); return false; }
+    } catch (...) {
+      std::fprintf(stderr, "bad value for %s: %s\n", k.c_str(), v.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (!parse_args(argc, argv)) {
+    std::fprintf(stderr,
+      "usage: bybit_standin [--host H] [--port P] [--threads N] [--data DIR] [--history-days D]\n"
+      "                     [--latency-ms MS] [--jitter-ms MS] [--rps R] [--fail-rate F]\n");
+    return 2;
+  }
+
+  httplib::Server svr;
+  const int threads = g_opt.threads;
+  svr.new_task_queue = [threads] { return new httplib::ThreadPool(threads); };
+  svr.Get("/v5/market/kline", handle_kline);
+  svr.Get("/standin/stats", [](const httplib::Request&, httplib::Response& res) {
+    res.set_content(stats_json().dump(2), "application/json");
+  });
+  svr.Get("/standin/reset", [](const httplib::Request&, httplib::Response& res) {
+    g_requests = 0; g_pages = 0; g_bars = 0; g_limited = 0; g_injected = 0; g_bad = 0;
+    res.set_content(json{{"ok", true}}.dump(), "application/json");
+  });
+
+  std::fprintf(stderr, "[standin] listening on http://%s:%d (threads=%d rps=%g fail_rate=%g latency=%d+%dms%s%s)\n",
+               g_opt.host.c_str(), g_opt.port, threads, g_opt.rps, g_opt.fail_rate,
+               g_opt.latency_ms, g_opt.jitter_ms,
+               g_opt.data_dir.empty() ? "" : " data=", g_opt.data_dir.c_str());
+  if (!svr.listen(g_opt.host.c_str(), g_opt.port)) {
+    std::fprintf(stderr, "[standin] listen failed\n");
+    return 1;
+  }
+  return 0;
+}